@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include "config.h"
 
 // Attendance record structure
@@ -19,14 +20,16 @@ typedef struct {
     time_t recorded_time;
 } AttendanceRecord;
 
-// Attendance list structure
+// Attendance list structure. `lock` (recursive) works as GradeList's.
 typedef struct {
     AttendanceRecord* records;
     int count;
     int capacity;
+    pthread_mutex_t lock;
 } AttendanceList;
 
-// Attendance statistics structure
+// Attendance statistics of one student (or course); the whole-list
+// AttendanceStats in stats.h is a different structure
 typedef struct {
     int student_id;
     int course_id;
@@ -38,17 +41,25 @@ typedef struct {
     float attendance_percentage;
     int consecutive_absences;
     int consecutive_presents;
-} AttendanceStats;
+} AttendanceStudentStats;
 
 // Attendance management functions
 AttendanceList* attendance_list_create(void);
 void attendance_list_destroy(AttendanceList* list);
 int attendance_list_add(AttendanceList* list, AttendanceRecord record);
 int attendance_list_remove(AttendanceList* list, int record_id);
+int attendance_list_update(AttendanceList* list, AttendanceRecord record);
+void attendance_list_lock(AttendanceList* list);
+void attendance_list_unlock(AttendanceList* list);
 AttendanceRecord* attendance_list_find_by_id(AttendanceList* list, int record_id);
 AttendanceRecord* attendance_list_find_by_student_date(AttendanceList* list, int student_id, time_t date);
 AttendanceRecord* attendance_list_find_by_course_date(AttendanceList* list, int course_id, time_t date);
 
+// Filtered scan, as student_list_next_where
+typedef int (*AttendancePredicate)(const AttendanceRecord* record, const void* context);
+AttendanceRecord* attendance_list_next_where(AttendanceList* list, int* cursor, AttendancePredicate where,
+                                             const void* context);
+
 // Attendance operations
 int mark_attendance(AttendanceList* list, int student_id, int course_id, time_t date, int status, int teacher_id);
 int update_attendance(AttendanceList* list, int record_id, int new_status, const char* reason);
@@ -63,10 +74,10 @@ void attendance_list_display_date_attendance(AttendanceList* list, time_t date);
 void attendance_display_record(AttendanceRecord* record);
 
 // Attendance statistics
-AttendanceStats* calculate_student_attendance_stats(AttendanceList* list, int student_id, int course_id);
-AttendanceStats* calculate_course_attendance_stats(AttendanceList* list, int course_id);
-void display_attendance_stats(AttendanceStats* stats);
-void free_attendance_stats(AttendanceStats* stats);
+AttendanceStudentStats* calculate_student_attendance_stats(AttendanceList* list, int student_id, int course_id);
+AttendanceStudentStats* calculate_course_attendance_stats(AttendanceList* list, int course_id);
+void display_attendance_student_stats(AttendanceStudentStats* stats);
+void free_attendance_student_stats(AttendanceStudentStats* stats);
 
 // Attendance validation
 int attendance_validate_status(int status);
@@ -6,13 +6,14 @@
 #include <string.h>
 #include <time.h>
 #include "config.h"
+#include "crypto.h"
 
 // User structure
 typedef struct {
     int id;
     char username[50];
     char email[MAX_EMAIL_LENGTH];
-    char password_hash[65]; // SHA-256 hash
+    char password_hash[65]; // Versioned, see crypto.h
     char salt[33];
     UserRole role;
     time_t created_at;
@@ -21,19 +22,35 @@ typedef struct {
 } User;
 
 // Session structure
+#define SESSION_TOKEN_SIZE 33       // 128-bit token as 32 hex digits
+
 typedef struct {
     int user_id;
     char username[50];
     UserRole role;
     time_t login_time;
     int is_valid;
+    char token[SESSION_TOKEN_SIZE]; // Empty unless issued by a SessionManager
 } Session;
 
-// User list structure
+// Open-addressing index from a key to a position in UserList.users.
+// Slots hold position + 1, so 0 marks an empty slot.
+typedef struct {
+    int* slots;
+    int capacity;                   // Power of two, at least twice the count
+} UserIndex;
+
+// User list structure. Usernames and emails are indexed case-folded, ids
+// exactly; user_list_add/remove and auth_load_users keep the indexes
+// current. Code that edits a user's username, email or id in place must
+// call user_list_reindex afterwards.
 typedef struct {
     User* users;
     int count;
     int capacity;
+    UserIndex by_username;
+    UserIndex by_email;
+    UserIndex by_id;
 } UserList;
 
 // Function declarations
@@ -44,16 +61,50 @@ int user_list_remove(UserList* list, int user_id);
 User* user_list_find_by_username(UserList* list, const char* username);
 User* user_list_find_by_email(UserList* list, const char* email);
 User* user_list_find_by_id(UserList* list, int user_id);
+int user_list_reindex(UserList* list);
 
 // Authentication functions
 int auth_register(UserList* list, const char* username, const char* email, const char* password, UserRole role);
 int auth_login(UserList* list, const char* username, const char* password, Session* session);
+// As auth_login, for a client at ip_address (LogEntry.ip_address form; NULL
+// when unknown). Returns 1 on success, 0 on a wrong password and -1 when
+// the username or the address is out of attempts; throttled attempts are
+// refused before any hashing. auth_login reports throttling as 0.
+int auth_login_from(UserList* list, const char* username, const char* password, const char* ip_address,
+                    Session* session);
 int auth_logout(Session* session);
 int auth_validate_session(Session* session);
 int auth_change_password(UserList* list, int user_id, const char* old_password, const char* new_password);
 int auth_reset_password(UserList* list, const char* email);
 
-// Password functions
+// Bulk import: passwords are hashed on a thread pool, then the accounts
+// are added in order with the same checks as auth_register
+typedef struct {
+    const char* username;
+    const char* email;
+    const char* password;
+    UserRole role;
+} AuthRegistration;
+
+#define AUTH_MAX_HASH_THREADS 64
+
+// Login throttling: token buckets per username and per IP address. An
+// existing account's username gets AUTH_USER_ATTEMPTS attempts, refilled
+// at one per 12 s and restored by a successful login; names without an
+// account only count against the address. An address gets
+// AUTH_IP_ATTEMPTS at AUTH_IP_REFILL_PER_SECOND.
+#define AUTH_RATE_LIMIT_BUCKETS 65536
+#define AUTH_USER_ATTEMPTS 5.0
+#define AUTH_USER_REFILL_PER_SECOND (1.0 / 12.0)
+#define AUTH_IP_ATTEMPTS 30.0
+#define AUTH_IP_REFILL_PER_SECOND 1.0
+
+// results (may be NULL) gets 1 or 0 per entry; threads <= 0 uses one per
+// CPU. Returns the number of accounts added.
+int auth_register_bulk(UserList* list, const AuthRegistration* entries, int count, int threads, int* results);
+
+// Password functions. A successful login rehashes a password stored under
+// an older format or cost (including legacy SHA-256) with the current policy.
 void auth_hash_password(const char* password, const char* salt, char* hash);
 int auth_verify_password(const char* password, const char* hash, const char* salt);
 void auth_generate_salt(char* salt);
@@ -70,6 +121,26 @@ int session_is_student(Session* session);
 int auth_save_users(UserList* list, const char* filename);
 int auth_load_users(UserList* list, const char* filename);
 
+// Calibrates PBKDF2 and scrypt to target_ms per hash, installs the PBKDF2
+// cost as the policy, and times logins and a bulk import of `accounts`
+// accounts on 1 and on `threads` hashing threads
+void auth_password_benchmark(double target_ms, int accounts, int threads);
+
+// Builds `users` accounts with cheap legacy hashes and times `attempts`
+// logins and lookups against them, with a linear scan for comparison
+void auth_lookup_benchmark(int users, int attempts);
+
+// Replaces the login limiters; an attempts value <= 0 disables that limiter
+int auth_rate_limit_configure(double user_attempts, double user_refill_per_second, double ip_attempts,
+                              double ip_refill_per_second);
+void auth_display_rate_limit_stats(void);
+
+// Times legitimate logins, and reports how many were accepted, alone and
+// alongside a brute-force thread making attempts_per_second attempts from
+// many addresses against other accounts (limiters on and off) or against
+// made-up usernames
+void auth_rate_limit_benchmark(int attempts_per_second, int logins);
+
 // Utility functions
 const char* auth_role_to_string(UserRole role);
 UserRole auth_string_to_role(const char* role_str);
@@ -0,0 +1,55 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "config.h"
+#include "student.h"
+
+// Timer-driven autosave. One thread watches the generation counter of each
+// registered StudentList and calls student_list_auto_save once the list
+// has stopped changing for quiet_ms, or max_delay_ms after the first
+// unsaved edit when it keeps changing. A burst of edits therefore costs
+// one save, and a clean list costs no I/O at all (see the dirty tracking
+// in student.h). Stopping the thread saves whatever is still pending.
+
+#define AUTOSAVE_MAX_LISTS 8
+#define AUTOSAVE_DEFAULT_QUIET_MS 2000
+#define AUTOSAVE_DEFAULT_MAX_DELAY_MS 30000
+#define AUTOSAVE_MIN_TICK_MS 20
+#define AUTOSAVE_MAX_TICK_MS 1000
+
+typedef struct {
+    int quiet_ms;                   // Idle time that ends a burst of edits
+    int max_delay_ms;               // Longest an edit waits for its save
+} AutosaveConfig;
+
+typedef struct {
+    int running;
+    int lists;                      // Watched
+    int pending;                    // Lists with unsaved edits
+    unsigned long long edits;       // Generation steps seen
+    unsigned long long saves;
+    unsigned long long forced;      // Saves forced by max_delay_ms
+    unsigned long long failures;
+    double last_save_ms;
+    time_t last_save;
+} AutosaveMetrics;
+
+void autosave_config_default(AutosaveConfig* config);
+
+int autosave_start(const AutosaveConfig* config);
+// Saves the lists with pending edits, then stops the thread
+int autosave_stop(void);
+int is_autosave_running(void);
+
+// Lists may be watched before or after the thread starts; unwatch before
+// destroying a list
+int autosave_watch(StudentList* list);
+int autosave_unwatch(StudentList* list);
+
+int autosave_get_metrics(AutosaveMetrics* metrics);
+void display_autosave_status(void);
+
+#endif // AUTOSAVE_H
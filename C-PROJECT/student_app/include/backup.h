@@ -78,6 +78,9 @@ typedef struct {
     int compress_backups;
     int encrypt_backups;
     char backup_dir[256];
+    char source_dir[256];           // Data directory to back up
+    int max_read_mb_per_sec;        // Read throttle, 0 for no limit
+    unsigned char key[AES_KEY_SIZE];    // Used when encrypt_backups is set
     time_t last_backup_time;
 } AutoBackupConfig;
 
@@ -105,7 +108,7 @@ int is_backup_encrypted(const char* backup_path);
 typedef struct {
     int hour;
     int minute;
-    int day_of_week;  // 0-6, 0=Sunday
+    int day_of_week;  // 0-6, 0=Sunday, -1=any
     int day_of_month; // 1-31, 0=any
 } BackupSchedule;
 
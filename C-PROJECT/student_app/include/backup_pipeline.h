@@ -0,0 +1,83 @@
+#ifndef BACKUP_PIPELINE_H
+#define BACKUP_PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "config.h"
+#include "backup.h"
+#include "chunk_store.h"
+
+// Pipelined backup writer. The calling thread reads and chunks each file
+// once and submits the pieces in order; worker threads hash, compress and
+// encrypt chunks in parallel; one writer thread stores new chunks and
+// builds the manifest in submission order. Jobs live in a bounded window
+// of slots, so a slow disk or slow workers hold the reader back instead of
+// buffering the whole backup in memory.
+
+#define BACKUP_PIPELINE_MIN_WINDOW 16
+#define BACKUP_PIPELINE_MAX_THREADS 64
+
+typedef enum {
+    PIPELINE_JOB_FREE = 0,
+    PIPELINE_JOB_QUEUED,        // Submitted, waiting for a worker
+    PIPELINE_JOB_ENCODING,
+    PIPELINE_JOB_READY          // Waiting for the writer
+} PipelineJobState;
+
+typedef struct {
+    PipelineJobState state;
+    int is_file;                        // File header rather than a chunk
+    // File header
+    char path[MAX_BACKUP_PATH_LENGTH];
+    long long size;
+    long long mtime;
+    unsigned int mode;
+    const ManifestFile* reuse;          // Chunk list carried over unread, or NULL
+    // Chunk
+    unsigned char* data;                // CHUNK_MAX_SIZE
+    unsigned char* blob;                // CHUNK_BLOB_BOUND
+    int blob_size;                      // 0 when the chunk was already stored
+    ChunkRef ref;
+    BackupResult error;
+} PipelineJob;
+
+typedef struct {
+    ChunkStore* store;
+    BackupManifest* manifest;           // Touched only by the writer thread
+    BackupStats* stats;
+    PipelineJob* jobs;
+    int window;
+    long long submit_seq;               // Next job the reader fills
+    long long encode_seq;               // Next job a worker claims
+    long long write_seq;                // Next job the writer stores
+    int finishing;
+    BackupResult result;                // First error, BACKUP_SUCCESS otherwise
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+    pthread_cond_t job_queued;
+    pthread_cond_t job_ready;
+    pthread_t workers[BACKUP_PIPELINE_MAX_THREADS];
+    int worker_count;
+    pthread_t writer;
+    int started;
+} BackupPipeline;
+
+// threads <= 0 runs one worker per CPU
+BackupPipeline* backup_pipeline_create(ChunkStore* store, BackupManifest* manifest, BackupStats* stats, int threads);
+void backup_pipeline_destroy(BackupPipeline* pipeline);
+
+// Submission, from one thread. Chunks belong to the latest file begun.
+// Both return 0 once the pipeline has failed, so the reader can stop early.
+int backup_pipeline_begin_file(BackupPipeline* pipeline, const char* path, long long size, long long mtime,
+                               unsigned int mode, const ManifestFile* reuse);
+int backup_pipeline_add_chunk(BackupPipeline* pipeline, const unsigned char* data, int size);
+
+// Waits for every submitted job to be written and stops the threads
+BackupResult backup_pipeline_finish(BackupPipeline* pipeline);
+
+// Backs source_dir up into a fresh store under scratch_dir with one worker
+// and with `threads` workers, compressed and encrypted, and prints the rates
+void backup_pipeline_benchmark(const char* source_dir, const char* scratch_dir, int threads);
+
+#endif // BACKUP_PIPELINE_H
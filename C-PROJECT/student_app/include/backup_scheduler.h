@@ -0,0 +1,60 @@
+#ifndef BACKUP_SCHEDULER_H
+#define BACKUP_SCHEDULER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "config.h"
+#include "backup.h"
+#include "chunk_store.h"
+
+// Background auto-backup. One scheduler thread sleeps on a timerfd armed
+// for the next due time: the earliest BackupSchedule added with
+// schedule_backup, or last_backup_time + interval_hours when there are
+// none. Each run links the data files into a snapshot directory (saves
+// replace files by rename, so a snapshot holds the old inodes while
+// writers carry on; they only wait out the linking itself), backs the
+// snapshot up with throttled, cache-bypassing reads, then removes it.
+// The journal and the log are appended in place rather than renamed, so
+// the snapshot copies them instead, between two whole appends; their
+// writers wait for the copy, which grows with the file sizes.
+
+#define AUTO_BACKUP_MAX_SCHEDULES 16
+#define AUTO_BACKUP_SNAPSHOT_DIR ".backup_snapshot"
+
+typedef enum {
+    AUTO_BACKUP_IDLE = 0,
+    AUTO_BACKUP_SNAPSHOT,
+    AUTO_BACKUP_RUNNING
+} AutoBackupPhase;
+
+typedef struct {
+    int running;                    // Scheduler thread started
+    AutoBackupPhase phase;
+    char current_backup[MAX_BACKUP_NAME_LENGTH];
+    int files_total;                // Of the current run
+    int files_done;
+    long long bytes_total;
+    long long bytes_done;
+    time_t next_run;                // 0 when nothing is scheduled
+    int runs;
+    int failures;
+    BackupResult last_result;
+    time_t last_start;
+    double last_snapshot_ms;        // Writers were held off this long
+    double last_duration_ms;
+    double last_rate_mb_s;
+    BackupStats last_stats;
+} AutoBackupMetrics;
+
+// Snapshot of the scheduler's progress and timings
+int auto_backup_get_metrics(AutoBackupMetrics* metrics);
+void display_auto_backup_status(void);
+
+// Next time after `after` that matches the schedule, or 0
+time_t backup_schedule_next(const BackupSchedule* schedule, time_t after);
+
+// One snapshot + backup with the configuration's settings, on the caller's thread
+BackupResult auto_backup_run_once(AutoBackupConfig* config);
+
+#endif // BACKUP_SCHEDULER_H
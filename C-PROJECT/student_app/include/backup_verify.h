@@ -0,0 +1,73 @@
+#ifndef BACKUP_VERIFY_H
+#define BACKUP_VERIFY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "backup.h"
+#include "chunk_store.h"
+
+// Backup verification with Merkle trees. A backup's chunk list (files in
+// manifest order) is cut into fixed blocks of MERKLE_BLOCK_CHUNKS chunk
+// references; each block hashes to a leaf and leaves pair up into a binary
+// tree, saved next to the manifest as <name>.merkle. The tree checks the
+// manifest without reading data, lets data verification run in parallel
+// over blocks or over just a suspect range, and lets two trees be compared
+// top-down so only differing blocks are looked at.
+//
+// Leaf:     SHA-256(0x00 || digest || le32 length ...) over the block's chunks
+// Interior: SHA-256(0x01 || left || right); an unpaired node moves up as is
+
+#define MERKLE_BLOCK_CHUNKS 64
+#define MERKLE_EXTENSION ".merkle"
+
+typedef struct {
+    int block_count;                        // Leaves
+    int level_count;                        // Including the leaves and the root
+    int level_offsets[32];                  // First node of each level, leaves at 0
+    int level_sizes[32];
+    int node_count;
+    unsigned char (*nodes)[CRYPTO_SHA256_SIZE];
+} MerkleTree;
+
+typedef struct {
+    int blocks_checked;
+    int blocks_bad;
+    int first_bad_block;                    // -1 when none
+    long long chunks_checked;
+    long long chunks_bad;
+    long long bytes_checked;
+    int manifests_checked;                  // Scrub only
+    int manifests_bad;
+} VerifyReport;
+
+// Trees. refs lists every chunk of the backup in order.
+MerkleTree* merkle_tree_build(const ChunkRef* const* refs, long long count);
+MerkleTree* merkle_tree_from_manifest(const BackupManifest* manifest);
+void merkle_tree_destroy(MerkleTree* tree);
+int merkle_tree_save(const MerkleTree* tree, const char* filename);
+MerkleTree* merkle_tree_load(const char* filename);
+const unsigned char* merkle_tree_root(const MerkleTree* tree);
+int merkle_tree_equal(const MerkleTree* a, const MerkleTree* b);
+// Leaf indexes whose hashes differ, found top-down; returns how many were
+// found (at most max_blocks are stored), or -1 on error
+int merkle_tree_diff(const MerkleTree* a, const MerkleTree* b, int* blocks, int max_blocks);
+
+// Reads and checks the chunks of blocks [first_block, first_block + block_count)
+// on `threads` workers (0 for one per CPU); block_count < 0 means to the end.
+// key is needed for encrypted backups. Returns 1 when every chunk is intact.
+int backup_verify_blocks(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                         int first_block, int block_count, int threads, VerifyReport* report);
+// Same, for the blocks holding bytes [offset, offset + length) of one file
+int backup_verify_file_range(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                             const char* path, long long offset, long long length, int threads, VerifyReport* report);
+
+// Nightly scrub: checks every manifest against its tree (no data read),
+// then re-reads one `days`-th of the chunk store, chosen by the day, so a
+// chunk shared by many backups is read once per cycle however many
+// backups use it. key may be NULL when no backup is encrypted.
+int backup_verify_scrub(const char* backup_dir, const unsigned char* key, int days, int threads, VerifyReport* report);
+
+void display_verify_report(const VerifyReport* report);
+
+#endif // BACKUP_VERIFY_H
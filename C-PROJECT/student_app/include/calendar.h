@@ -0,0 +1,73 @@
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+
+// Day flags stored in the academic calendar table
+#define CALENDAR_WEEKDAY_MASK 0x07      // 0=Sunday .. 6=Saturday
+#define CALENDAR_FLAG_WEEKEND 0x08
+#define CALENDAR_FLAG_HOLIDAY 0x10
+#define CALENDAR_FLAG_TERM 0x20
+#define CALENDAR_FLAG_SCHOOL_DAY 0x40   // Term day that is neither weekend nor holiday
+
+// Supported year range for cached tables
+#define CALENDAR_MIN_YEAR 1970
+#define CALENDAR_MAX_YEAR 2199
+
+#define CALENDAR_MAX_HOLIDAYS 64
+#define CALENDAR_MAX_TERMS 8
+
+// Precomputed calendar for one civil year, built once and never modified.
+// Day numbers count local days since 1970-01-01.
+typedef struct {
+    int year;
+    int day_count;                  // 365 or 366
+    long first_day_number;          // Day number of January 1st
+    time_t day_start[367];          // Local midnight of each day, plus next January 1st
+    unsigned char day_flags[366];
+    int school_days_before[367];    // Prefix count of school days
+} AcademicCalendar;
+
+// Calendar configuration. Each change publishes a fresh set of tables; lookups
+// running at the time may still answer from the previous configuration.
+int calendar_add_holiday(int month, int day);
+int calendar_add_holiday_date(int year, int month, int day);
+int calendar_add_term(int start_month, int start_day, int end_month, int end_day);
+void calendar_clear_configuration(void);
+void calendar_reset(void);
+
+// Frees every table, including those kept alive for readers of an earlier
+// configuration. Only call once no other thread uses the calendar (shutdown).
+void calendar_cleanup(void);
+
+// Table access
+const AcademicCalendar* calendar_get_year(int year);
+
+// Fast conversions
+long calendar_day_number(time_t date);
+time_t calendar_day_start(long day_number);
+int calendar_day_flags(time_t date);
+int calendar_day_flags_by_number(long day_number);
+
+// Day classification
+int calendar_weekday(time_t date);
+int calendar_is_weekend(time_t date);
+int calendar_is_holiday(time_t date);
+int calendar_is_term_day(time_t date);
+int calendar_is_school_day(time_t date);
+int calendar_days_between(time_t start_date, time_t end_date);
+int calendar_school_days_between(time_t start_date, time_t end_date);
+
+// Civil date arithmetic (proleptic Gregorian, no time zone involved)
+long calendar_days_from_civil(int year, int month, int day);
+void calendar_civil_from_days(long day_number, int* year, int* month, int* day);
+int calendar_day_of_year(long day_number);
+
+// Benchmark: classify `iterations` dates with the table and with localtime_r
+void calendar_benchmark(long iterations);
+
+#endif // CALENDAR_H
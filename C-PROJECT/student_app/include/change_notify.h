@@ -0,0 +1,47 @@
+#ifndef CHANGE_NOTIFY_H
+#define CHANGE_NOTIFY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+
+// Entities whose lists publish mutations
+typedef enum {
+    ENTITY_STUDENT = 0,
+    ENTITY_GRADE = 1,
+    ENTITY_ATTENDANCE = 2,
+    ENTITY_CLUB = 3,
+    ENTITY_MEMBERSHIP = 4
+} EntityType;
+
+#define ENTITY_TYPE_COUNT 5
+
+typedef enum {
+    CHANGE_ADD = 0,
+    CHANGE_REMOVE = 1,
+    CHANGE_EDIT = 2
+} ChangeType;
+
+// A mutation, published after the list has been updated
+typedef struct {
+    EntityType entity;
+    ChangeType type;
+    const void* list;         // StudentList*, GradeList*, ... that changed
+    const void* old_record;   // Record before the change, NULL for CHANGE_ADD
+    const void* new_record;   // Record after the change, NULL for CHANGE_REMOVE
+} ChangeEvent;
+
+typedef void (*ChangeListener)(const ChangeEvent* event, void* user_data);
+
+// Subscription management
+int change_notify_subscribe(ChangeListener listener, void* user_data);
+int change_notify_unsubscribe(ChangeListener listener, void* user_data);
+int change_notify_has_listeners(void);
+
+// Publishing (called by the list functions)
+void change_notify_publish(EntityType entity, ChangeType type, const void* list,
+                           const void* old_record, const void* new_record);
+
+#define CHANGE_NOTIFY_MAX_LISTENERS 16
+
+#endif // CHANGE_NOTIFY_H
@@ -0,0 +1,143 @@
+#ifndef CHUNK_STORE_H
+#define CHUNK_STORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "config.h"
+#include "crypto.h"
+#include "backup.h"
+
+// Content-addressed chunk store for backups. Files are cut into chunks at
+// content-defined boundaries (gear rolling hash, FastCDC style), so an edit
+// only changes the chunks around it. Chunks are stored once under their
+// SHA-256 in <backup_dir>/chunks/ab/abcd...; each backup is a manifest
+// listing every file's chunks.
+//
+// Stored chunk blob: [u8 flags][u32 plain length][payload], where the
+// payload is LZ compressed when that saves space and, with a key set,
+// AES-256-GCM sealed as [12-byte nonce][ciphertext][16-byte tag] with the
+// chunk address as associated data. Encrypted stores address chunks by
+// HMAC-SHA-256 under the key so addresses do not reveal content.
+
+#define CHUNK_MIN_SIZE 2048
+#define CHUNK_AVG_SIZE 8192
+#define CHUNK_MAX_SIZE 65536
+#define CHUNK_DIR_NAME "chunks"
+#define MANIFEST_EXTENSION ".manifest"
+
+#define CHUNK_FLAG_COMPRESSED 0x01
+#define CHUNK_FLAG_ENCRYPTED 0x02
+#define CHUNK_HEADER_SIZE 5
+#define CHUNK_NONCE_SIZE 12
+#define CHUNK_TAG_SIZE 16
+#define CHUNK_KEY_ID_SIZE 16
+#define CHUNK_BLOB_BOUND (CHUNK_HEADER_SIZE + CHUNK_NONCE_SIZE + CHUNK_TAG_SIZE + CHUNK_MAX_SIZE + CHUNK_MAX_SIZE / 255 + 16)
+
+typedef struct {
+    unsigned char digest[CRYPTO_SHA256_SIZE];
+    unsigned int length;
+} ChunkRef;
+
+typedef struct {
+    char path[MAX_BACKUP_PATH_LENGTH];      // Relative to the source directory
+    long long size;
+    long long mtime;
+    unsigned int mode;
+    ChunkRef* chunks;
+    int chunk_count;
+    int chunk_capacity;
+} ManifestFile;
+
+typedef struct {
+    char name[MAX_BACKUP_NAME_LENGTH];
+    char type[16];                          // BACKUP_TYPE_FULL or BACKUP_TYPE_INCREMENTAL
+    time_t created;
+    int compressed;
+    int encrypted;
+    char key_id[CHUNK_KEY_ID_SIZE * 2 + 1];     // chunk_store_key_id of the store; empty when plain
+    ManifestFile* files;
+    int file_count;
+    int file_capacity;
+} BackupManifest;
+
+typedef struct {
+    char root[MAX_BACKUP_PATH_LENGTH];      // <backup_dir>/chunks
+    int compress;
+    int encrypt;
+    unsigned char key[AES_KEY_SIZE];
+    unsigned char dirty_dirs[256];          // Prefix directories with renames not yet synced
+} ChunkStore;
+
+// Options for create_chunked_backup
+typedef struct {
+    int incremental;
+    int compress;
+    int encrypt;
+    unsigned char key[AES_KEY_SIZE];
+    int threads;                // Compress/encrypt workers, 0 for one per CPU
+    long long max_read_rate;    // Bytes per second read from the source, 0 for no limit
+    int direct_io;              // Read with O_DIRECT so the backup leaves the page cache alone
+    // Called from the reading thread after each read; returning 0 cancels
+    int (*progress)(int files, long long bytes_read, void* user_data);
+    void* progress_data;
+} BackupOptions;
+
+typedef struct {
+    int files;
+    int files_reused;           // Unchanged since the previous manifest, not read
+    long long bytes_read;
+    long long chunks;
+    long long new_chunks;
+    long long new_bytes;        // Plain bytes of the new chunks
+    long long stored_bytes;     // Bytes written for them, after compression
+} BackupStats;
+
+// Chunking: length of the next chunk of data[0..size); when `final` is 0
+// and no boundary is found below CHUNK_MAX_SIZE, returns 0 (need more data)
+int chunk_next_boundary(const unsigned char* data, int size, int final);
+
+// Chunk store
+ChunkStore* chunk_store_open(const char* backup_dir);
+void chunk_store_close(ChunkStore* store);
+int chunk_store_set_options(ChunkStore* store, int compress, const unsigned char* key);    // key NULL: plain
+int chunk_store_put(ChunkStore* store, const unsigned char* data, int size, ChunkRef* ref, int* was_new);
+int chunk_store_get(ChunkStore* store, const ChunkRef* ref, unsigned char* buffer);   // buffer holds ref->length
+int chunk_store_contains(ChunkStore* store, const ChunkRef* ref);
+// Fingerprint of the store's key as hex (CHUNK_KEY_ID_SIZE * 2 + 1 bytes),
+// empty for a plain store. Chunks written under one key id are only
+// readable, and only shared, under the same one.
+int chunk_store_key_id(const ChunkStore* store, char* key_id);
+
+// The put stages, for callers that run them on separate threads. ctx is
+// the caller's own cipher context (NULL when not encrypting).
+int chunk_store_address(ChunkStore* store, const unsigned char* data, int size, ChunkRef* ref);
+int chunk_store_encode(ChunkStore* store, EVP_CIPHER_CTX* ctx, const ChunkRef* ref, const unsigned char* data,
+                       unsigned char* blob);     // Returns the blob size (blob holds CHUNK_BLOB_BOUND), or 0
+int chunk_store_write_blob(ChunkStore* store, const ChunkRef* ref, const unsigned char* blob, int size);
+// Makes every chunk written so far durable (their directories are synced
+// once here rather than per chunk); call before saving a manifest
+int chunk_store_sync(ChunkStore* store);
+
+// Manifests
+BackupManifest* backup_manifest_create(const char* name, const char* type);
+void backup_manifest_destroy(BackupManifest* manifest);
+ManifestFile* backup_manifest_add_file(BackupManifest* manifest, const char* path);
+int manifest_file_add_chunk(ManifestFile* file, const ChunkRef* ref);
+ManifestFile* backup_manifest_find_file(BackupManifest* manifest, const char* path);
+int backup_manifest_save(BackupManifest* manifest, const char* filename);
+BackupManifest* backup_manifest_load(const char* filename);
+int backup_manifest_checksum(BackupManifest* manifest, char* checksum);       // 65 bytes
+BackupManifest* backup_manifest_load_latest(const char* backup_dir);          // NULL when none
+
+// Backups with statistics; create_full_backup and create_incremental_backup
+// wrap this with compression on and no key. Incremental backups reuse the
+// chunk lists of files whose size and mtime match the latest manifest, when
+// that manifest was written with the same key.
+void backup_options_init(BackupOptions* options);
+BackupResult create_chunked_backup(const char* backup_name, const char* source_dir, const char* backup_dir,
+                                   const BackupOptions* options, BackupStats* stats);
+BackupResult restore_chunked_backup(const char* backup_name, const char* backup_dir, const char* restore_dir,
+                                    const unsigned char* key);
+
+#endif // CHUNK_STORE_H
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include "config.h"
 
 // Club structure
@@ -36,18 +37,22 @@ typedef struct {
     int is_active;
 } ClubMembership;
 
-// Club list structure
+// Club list structure. `lock` (recursive) is held by the functions that
+// change, load or save the list and by a journal checkpoint while it
+// copies the rows.
 typedef struct {
     Club* clubs;
     int count;
     int capacity;
+    pthread_mutex_t lock;
 } ClubList;
 
-// Membership list structure
+// Membership list structure, locked the same way
 typedef struct {
     ClubMembership* memberships;
     int count;
     int capacity;
+    pthread_mutex_t lock;
 } MembershipList;
 
 // Principal Club management functions
@@ -55,6 +60,9 @@ ClubList* club_list_create(void);
 void club_list_destroy(ClubList* list);
 int club_list_add(ClubList* list, Club club);
 int club_list_remove(ClubList* list, int club_id);
+int club_list_update(ClubList* list, Club club);
+void club_list_lock(ClubList* list);
+void club_list_unlock(ClubList* list);
 Club* club_list_find_by_id(ClubList* list, int club_id);
 Club* club_list_find_by_name(ClubList* list, const char* name);
 void club_list_display_all(ClubList* list);
@@ -65,6 +73,9 @@ MembershipList* membership_list_create(void);
 void membership_list_destroy(MembershipList* list);
 int membership_list_add(MembershipList* list, ClubMembership membership);
 int membership_list_remove(MembershipList* list, int membership_id);
+int membership_list_update(MembershipList* list, ClubMembership membership);
+void membership_list_lock(MembershipList* list);
+void membership_list_unlock(MembershipList* list);
 ClubMembership* membership_list_find_by_id(MembershipList* list, int membership_id);
 
 // Principal Membership operations
@@ -0,0 +1,48 @@
+#ifndef COUNTER_MAP_H
+#define COUNTER_MAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+
+// Running counters attached to an integer key (student id, course id, day number...)
+typedef struct {
+    int key;
+    int count;
+    int hits;
+    double sum;
+} Counter;
+
+// Open addressing map from int key to Counter. Entries are never removed;
+// callers treat a zero count as absent.
+typedef struct {
+    Counter* slots;
+    int capacity;
+    int size;
+} CounterMap;
+
+// Tally of names (courses, categories) kept in first-seen order
+typedef struct {
+    char name[MAX_COURSE_LENGTH];
+    int count;
+} NameCount;
+
+typedef struct {
+    NameCount* items;
+    int count;
+    int capacity;
+} NameCountList;
+
+int counter_map_init(CounterMap* map, int expected);
+void counter_map_free(CounterMap* map);
+Counter* counter_map_get(CounterMap* map, int key);
+Counter* counter_map_find(const CounterMap* map, int key);
+
+int name_count_add(NameCountList* list, const char* name, int delta);
+void name_count_top(const NameCountList* list, int* counts, int k);
+void name_count_free(NameCountList* list);
+
+#define COUNTER_MAP_EMPTY_KEY (-2147483647 - 1)
+
+#endif // COUNTER_MAP_H
@@ -25,6 +25,13 @@ int aes_decrypt_with_iv(const unsigned char* ciphertext, int ciphertext_len,
                         unsigned char* plaintext, const unsigned char* key,
                         const unsigned char* iv); 
 
+// SHA-256
+#define CRYPTO_SHA256_SIZE 32
+int crypto_sha256(const void* data, size_t size, unsigned char* digest);
+void crypto_sha256_to_hex(const unsigned char* digest, char* hex);     // hex holds 65 bytes
+int crypto_sha256_from_hex(const char* hex, unsigned char* digest);
+int crypto_hmac_sha256(const unsigned char* key, int key_size, const void* data, size_t size, unsigned char* digest);
+
 // Key generation and management
 int generate_random_key(unsigned char* key, int key_size);
 int generate_random_iv(unsigned char* iv, int iv_size);
@@ -32,7 +39,42 @@ int generate_random_salt(unsigned char* salt, int salt_size);
 int load_master_key(const char* filename, unsigned char* key);
 int save_master_key(const char* filename, const unsigned char* key);
 
-// Password hashing functions
+// Password hashing functions. Hashes are versioned and fit in 65 characters:
+//   $p2$<iterations>$<base64 digest>       PBKDF2-HMAC-SHA256
+//   $s1$<log2 N>.<r>.<p>$<base64 digest>   scrypt
+//   64 hex digits                          version 0, SHA-256(salt || password)
+// New hashes use the deployment's policy; a stored hash made under any
+// other kind or cost verifies but is flagged for rehashing.
+#define PASSWORD_HASH_SIZE 65
+#define PASSWORD_SALT_SIZE 33                   // 32 hex digits
+#define PASSWORD_DEFAULT_ITERATIONS 600000
+#define PASSWORD_DEFAULT_SCRYPT_LOG_N 15
+#define PASSWORD_MIN_ITERATIONS 10000
+
+typedef enum {
+    PASSWORD_KDF_LEGACY_SHA256 = 0,             // Verify only
+    PASSWORD_KDF_PBKDF2 = 1,
+    PASSWORD_KDF_SCRYPT = 2
+} PasswordKdf;
+
+typedef struct {
+    PasswordKdf kdf;
+    int iterations;                             // PBKDF2
+    int scrypt_log_n;
+    int scrypt_r;
+    int scrypt_p;
+} PasswordPolicy;
+
+void password_policy_default(PasswordPolicy* policy);
+void password_policy_set(const PasswordPolicy* policy);
+void password_policy_get(PasswordPolicy* policy);
+int password_hash_with_policy(const char* password, const char* salt, const PasswordPolicy* policy, char* hash);
+// Returns 1 on a match; *needs_rehash (may be NULL) is set when the hash
+// is not in the current policy's format
+int password_hash_verify(const char* password, const char* salt, const char* hash, int* needs_rehash);
+// Picks the cost of `kdf` that takes about target_ms per hash here
+int password_policy_calibrate(PasswordKdf kdf, double target_ms, PasswordPolicy* policy);
+
 void hash_password_with_salt(const char* password, const char* salt, char* hash);
 int verify_password_hash(const char* password, const char* hash, const char* salt);
 void generate_password_salt(char* salt);
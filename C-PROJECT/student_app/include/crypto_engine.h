@@ -0,0 +1,81 @@
+#ifndef CRYPTO_ENGINE_H
+#define CRYPTO_ENGINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "config.h"
+#include "crypto.h"
+#include "crypto_stream.h"
+
+// Parallel bulk encryption. Input is cut into the independently sealed
+// segments of crypto_stream.h, so files written here read back through
+// CryptoStreamReader and the other way round. A fixed pool of workers,
+// each holding one EVP_CIPHER_CTX for its whole life, seals or opens the
+// segments of a batch; the caller reads the next batch while the current
+// one is being processed.
+
+#define CRYPTO_ENGINE_MAX_THREADS 64
+#define CRYPTO_ENGINE_SEGMENTS_PER_THREAD 8
+#define CRYPTO_ENGINE_CLAIM 4               // Segments a worker takes at once
+
+typedef struct {
+    int decrypt;
+    const unsigned char* key;
+    const unsigned char* header;            // Stream header, bound into every segment
+    int segment_size;
+    long long first_index;                  // Stream index of the batch's first segment
+    int count;
+    int tail_length;                        // Plaintext length of the batch's last segment
+    int ends_stream;                        // The last segment is the stream's last
+    const unsigned char* in;                // Plain segments at segment_size strides,
+    unsigned char* out;                     // sealed ones at segment_size + overhead
+} CryptoEngineBatch;
+
+typedef struct {
+    pthread_t workers[CRYPTO_ENGINE_MAX_THREADS];
+    int worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    const CryptoEngineBatch* batch;         // NULL when idle
+    int next;                               // Next segment of the batch to claim
+    int pending;                            // Segments not yet finished
+    int failed;
+    int stopping;
+} CryptoEngine;
+
+typedef struct {
+    int threads;
+    long long bytes;                        // Plaintext
+    long long segments;
+    double seconds;
+    double gb_per_sec;
+} CryptoThroughput;
+
+// threads <= 0 runs one worker per CPU
+CryptoEngine* crypto_engine_create(int threads);
+void crypto_engine_destroy(CryptoEngine* engine);
+
+// Starts a batch and returns; wait blocks until it is done and returns 1
+// when every segment was sealed or authenticated. One batch at a time.
+int crypto_engine_submit(CryptoEngine* engine, const CryptoEngineBatch* batch);
+int crypto_engine_wait(CryptoEngine* engine);
+
+// Whole files, written atomically. segment_size <= 0 uses the default.
+// stats may be NULL.
+int crypto_engine_encrypt_file(CryptoEngine* engine, const char* input_file, const char* output_file,
+                               const unsigned char* key, int segment_size, CryptoThroughput* stats);
+int crypto_engine_decrypt_file(CryptoEngine* engine, const char* input_file, const char* output_file,
+                               const unsigned char* key, CryptoThroughput* stats);
+
+// Engine behind encrypt_file/decrypt_file, started on first use
+CryptoEngine* crypto_engine_shared(void);
+
+// Encrypts a size_mb file under scratch_dir with the single-threaded
+// stream writer and with the engine (on 1 and on `threads` workers),
+// decrypts it again, and prints GB/s for the files and for the cipher
+// work alone
+void crypto_engine_benchmark(const char* scratch_dir, int size_mb, int threads);
+
+#endif // CRYPTO_ENGINE_H
@@ -0,0 +1,99 @@
+#ifndef CRYPTO_STREAM_H
+#define CRYPTO_STREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "crypto.h"
+
+// Segmented authenticated encryption. Plaintext is cut into fixed-size
+// segments, each sealed on its own with AES-256-GCM, so a file can be
+// written and read incrementally and any segment range can be decrypted
+// without touching the rest.
+//
+// File:    header, then segments back to back
+// Header:  "SGCM" u8 version, 3 reserved bytes, le32 segment size, 16-byte random file id
+// Segment: [12-byte random nonce][ciphertext][16-byte tag]; every segment
+//          but the last holds exactly segment-size bytes of plaintext
+// AAD:     header || le64 segment index || u8 last-segment flag
+//
+// Binding the index stops segments being reordered or copied between
+// files; the last-segment flag makes truncation at a segment boundary
+// fail authentication. There is always at least one (possibly empty)
+// segment.
+
+#define CRYPTO_STREAM_MAGIC "SGCM"
+#define CRYPTO_STREAM_VERSION 1
+#define CRYPTO_STREAM_HEADER_SIZE 28
+#define CRYPTO_STREAM_NONCE_SIZE 12
+#define CRYPTO_STREAM_TAG_SIZE 16
+#define CRYPTO_STREAM_OVERHEAD (CRYPTO_STREAM_NONCE_SIZE + CRYPTO_STREAM_TAG_SIZE)
+#define CRYPTO_STREAM_DEFAULT_SEGMENT (64 * 1024)
+#define CRYPTO_STREAM_MIN_SEGMENT 4096
+#define CRYPTO_STREAM_MAX_SEGMENT (16 * 1024 * 1024)
+
+typedef struct {
+    FILE* file;                     // Not owned
+    EVP_CIPHER_CTX* ctx;
+    unsigned char key[AES_KEY_SIZE];
+    unsigned char header[CRYPTO_STREAM_HEADER_SIZE];
+    int segment_size;
+    unsigned char* plain;           // The segment being filled
+    unsigned char* sealed;
+    int used;
+    long long index;                // Of the segment being filled
+    long long bytes;                // Plaintext written
+    int failed;
+} CryptoStreamWriter;
+
+typedef struct {
+    FILE* file;
+    EVP_CIPHER_CTX* ctx;
+    unsigned char key[AES_KEY_SIZE];
+    unsigned char header[CRYPTO_STREAM_HEADER_SIZE];
+    int segment_size;
+    long long segment_count;
+    long long plaintext_size;
+    unsigned char* plain;           // Last segment decrypted
+    unsigned char* sealed;
+    long long cached_segment;       // -1 when none
+    int cached_length;
+    long long position;             // For crypto_stream_read
+} CryptoStreamReader;
+
+// Segment primitives, shared with the parallel engine. seal writes
+// nonce || ciphertext || tag (length + CRYPTO_STREAM_OVERHEAD bytes) to out;
+// open checks and decrypts one. ctx is reused across calls; with a NULL
+// key the key loaded by an earlier call is kept.
+int crypto_stream_header_init(unsigned char* header, int segment_size);
+int crypto_stream_header_parse(const unsigned char* header, int* segment_size);
+int crypto_stream_seal_segment(EVP_CIPHER_CTX* ctx, const unsigned char* key, const unsigned char* header,
+                               long long index, int last, const unsigned char* plain, int length,
+                               unsigned char* out);
+int crypto_stream_open_segment(EVP_CIPHER_CTX* ctx, const unsigned char* key, const unsigned char* header,
+                               long long index, int last, const unsigned char* sealed, int length,
+                               unsigned char* out);
+
+// Writing. The writer seals full segments as data arrives and holds at
+// most one segment; finish seals the last one. The caller owns `file`.
+CryptoStreamWriter* crypto_stream_writer_create(FILE* file, const unsigned char* key, int segment_size);
+int crypto_stream_writer_write(CryptoStreamWriter* writer, const void* data, size_t size);
+int crypto_stream_writer_finish(CryptoStreamWriter* writer);
+void crypto_stream_writer_destroy(CryptoStreamWriter* writer);
+
+// Reading
+CryptoStreamReader* crypto_stream_reader_open(const char* filename, const unsigned char* key);
+void crypto_stream_reader_close(CryptoStreamReader* reader);
+// Decrypts one segment into out (segment_size bytes); returns its length or -1
+int crypto_stream_read_segment(CryptoStreamReader* reader, long long index, unsigned char* out);
+// Decrypts segments [first, first + count) into out; returns the bytes or -1
+long long crypto_stream_read_segments(CryptoStreamReader* reader, long long first, long long count,
+                                      void* out, size_t capacity);
+// Plaintext bytes [offset, offset + size); returns the bytes read (short at the end) or -1
+long long crypto_stream_pread(CryptoStreamReader* reader, void* out, size_t size, long long offset);
+// Sequential reads from the current position
+long long crypto_stream_read(CryptoStreamReader* reader, void* out, size_t size);
+
+int crypto_stream_is_stream_file(const char* filename);
+
+#endif // CRYPTO_STREAM_H
@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include "config.h"
 #include "crypto.h"
+#include "segment_cache.h"
 
 // File operation result codes
 typedef enum {
@@ -56,11 +57,20 @@ FileResult copy_file(const char* source, const char* destination);
 FileResult move_file(const char* source, const char* destination);
 FileResult delete_file(const char* filename);
 
-// Encrypted file operations
+// Encrypted file operations. Files are written in the segmented format of
+// crypto_stream.h, so neither side holds more than one segment of ciphertext.
+// Reads of files up to half the shared segment cache are served from it.
 FileResult read_encrypted_file(const char* filename, char** content, size_t* content_size, const unsigned char* key);
 FileResult write_encrypted_file(const char* filename, const char* content, size_t content_size, const unsigned char* key);
+// Decrypts only the segments holding plaintext bytes [offset, offset + size),
+// through the shared segment cache so repeated fetches skip AES; *read_size
+// is set to the bytes copied, short at the end of the file
+FileResult read_encrypted_file_range(const char* filename, void* buffer, size_t size, long long offset,
+                                     size_t* read_size, const unsigned char* key);
 FileResult encrypt_existing_file(const char* filename, const unsigned char* key);
 FileResult decrypt_existing_file(const char* filename, const unsigned char* key);
+// Cache behind read_encrypted_file_range, created on first use
+SegmentCache* file_manager_segment_cache(void);
 
 // Data serialization/deserialization
 FileResult save_data_to_file(const void* data, size_t data_size, const char* filename, const unsigned char* key);
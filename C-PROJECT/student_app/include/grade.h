@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include "config.h"
 
 // Grade structure
@@ -25,11 +26,14 @@ typedef struct {
     int teacher_id;
 } Grade;
 
-// Grade list structure
+// Grade list structure. `lock` (recursive) is held by the functions that
+// change the list and by a journal checkpoint while it copies the rows;
+// code that edits grades in place takes it with grade_list_lock.
 typedef struct {
     Grade* grades;
     int count;
     int capacity;
+    pthread_mutex_t lock;
 } GradeList;
 
 // Course structure
@@ -57,6 +61,9 @@ GradeList* grade_list_create(void);
 void grade_list_destroy(GradeList* list);
 int grade_list_add(GradeList* list, Grade grade);
 int grade_list_remove(GradeList* list, int grade_id);
+int grade_list_update(GradeList* list, Grade grade);
+void grade_list_lock(GradeList* list);
+void grade_list_unlock(GradeList* list);
 Grade* grade_list_find_by_id(GradeList* list, int grade_id);
 Grade* grade_list_find_by_student(GradeList* list, int student_id);
 Grade* grade_list_find_by_course(GradeList* list, int course_id);
@@ -64,6 +71,10 @@ void grade_list_display_all(GradeList* list);
 void grade_list_display_student_grades(GradeList* list, int student_id);
 void grade_list_display_course_grades(GradeList* list, int course_id);
 
+// Filtered scan, as student_list_next_where
+typedef int (*GradePredicate)(const Grade* grade, const void* context);
+Grade* grade_list_next_where(GradeList* list, int* cursor, GradePredicate where, const void* context);
+
 // Grade calculations
 float calculate_student_gpa(GradeList* list, int student_id);
 float calculate_course_average(GradeList* list, int course_id);
@@ -0,0 +1,42 @@
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Space-Saving heavy-hitters sketch: tracks at most `capacity` keys in
+// fixed memory. Every key seen more than total / capacity times is kept,
+// and a kept key's count overestimates its true count by at most `error`.
+// Counters sit in a min-heap so the smallest one can be evicted in
+// O(log capacity); a hash index finds a key's counter.
+
+#define HEAVY_HITTERS_DEFAULT_CAPACITY 256
+
+typedef struct {
+    long long key;
+    long long count;
+    long long error;            // Upper bound on the overestimate
+} HeavyHitter;
+
+typedef struct {
+    HeavyHitter* heap;          // Min-heap on count
+    int* slots;                 // Hash slots -> heap position, -1 empty
+    int slot_mask;
+    int capacity;
+    int size;
+    long long total;
+} HeavyHitters;
+
+HeavyHitters* heavy_hitters_create(int capacity);
+void heavy_hitters_destroy(HeavyHitters* sketch);
+void heavy_hitters_reset(HeavyHitters* sketch);
+int heavy_hitters_add(HeavyHitters* sketch, long long key, long long weight);
+int heavy_hitters_merge(HeavyHitters* dst, const HeavyHitters* src);   // dst keeps its capacity
+long long heavy_hitters_estimate(const HeavyHitters* sketch, long long key);
+long long heavy_hitters_total(const HeavyHitters* sketch);
+
+// Copies up to max_items counters into out, highest count first; returns
+// how many were written
+int heavy_hitters_top(const HeavyHitters* sketch, HeavyHitter* out, int max_items);
+
+#endif // HEAVY_HITTERS_H
@@ -0,0 +1,124 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "config.h"
+#include "change_notify.h"
+#include "student.h"
+#include "grade.h"
+#include "attendance.h"
+#include "club.h"
+
+// Write-ahead journal for list mutations. The journal subscribes to
+// change_notify and appends one compact binary record per add, remove or
+// edit on the lists it follows: a frame (length, CRC-32) around a varint
+// sequence number, the entity and change type, and the record's fields
+// (strings without their padding; only the id for a remove).
+//
+// A writer thread group-commits what has been appended with one write and
+// one fdatasync per batch. With sync_commits set, the mutating thread
+// waits until its record is durable, and concurrent mutators share the
+// same fsync.
+//
+// A checkpoint writes every followed list into <path>.snap (atomically)
+// and starts an empty log; one runs automatically once the log passes
+// checkpoint_bytes. Replay rebuilds a list from the snapshot and then
+// applies the log. Records hold whole rows and are applied as upserts, so
+// replaying records the snapshot already covers is harmless. A torn tail
+// is truncated at the first bad frame when the journal is opened.
+
+#define JOURNAL_DEFAULT_FLUSH_MS 5
+#define JOURNAL_DEFAULT_CHECKPOINT_BYTES (4 * 1024 * 1024)
+#define JOURNAL_BUFFER_INITIAL 4096
+#define JOURNAL_MAX_OPEN 4
+
+typedef struct {
+    int flush_interval_ms;              // Longest a record waits for its batch
+    int sync_commits;                   // 1: mutators wait for durability
+    long checkpoint_bytes;              // Automatic checkpoint threshold, 0 = never
+} JournalConfig;
+
+typedef struct {
+    unsigned long long records;
+    unsigned long long bytes;
+    unsigned long long batches;
+    unsigned long long fsyncs;
+    unsigned long long checkpoints;
+    unsigned long long replayed;
+} JournalStats;
+
+typedef struct Journal {
+    char path[512];
+    char snapshot_path[520];
+    JournalConfig config;
+
+    // Lists followed; events from other lists are ignored
+    StudentList* students;
+    GradeList* grades;
+    AttendanceList* attendance;
+    ClubList* clubs;
+    MembershipList* memberships;
+
+    int fd;                             // Log, opened for append
+    long log_bytes;
+    unsigned long long base_lsn;        // Covered by the snapshot
+
+    // Group commit: appends fill `pending`; the writer swaps it with
+    // `writing`, writes and syncs it without holding `lock`
+    pthread_mutex_t lock;
+    pthread_mutex_t io_lock;            // Held while the log file is written or replaced
+    pthread_cond_t work;
+    pthread_cond_t durable;
+    unsigned char* pending;
+    size_t pending_used;
+    size_t pending_size;
+    unsigned char* writing;
+    size_t writing_size;
+    unsigned long long next_lsn;
+    unsigned long long pending_lsn;     // Last lsn in `pending`
+    unsigned long long durable_lsn;
+    int waiters;
+    int replaying;                      // Replays in progress; they hold off checkpoints
+    int stopping;
+    int failed;
+    int writer_started;
+    pthread_t writer;
+
+    JournalStats stats;
+} Journal;
+
+void journal_config_default(JournalConfig* config);
+
+// Opens (or creates) the log at path and starts the writer. Any list may
+// be NULL. Nothing is replayed until journal_replay is called, or for
+// students, until student_list_ensure_loaded runs.
+Journal* journal_open(const char* path, const JournalConfig* config, StudentList* students, GradeList* grades,
+                      AttendanceList* attendance, ClubList* clubs, MembershipList* memberships);
+// Flushes, syncs and closes; does not checkpoint
+void journal_close(Journal* journal);
+
+// Replays the snapshot and log into every followed list that is loaded
+int journal_replay(Journal* journal);
+// Replays into one list, through whichever open journal follows it;
+// 1 when there is none
+int journal_replay_list(EntityType entity, void* list);
+
+// Appends a record outside the change events, e.g. for rows edited in
+// place; does not wait, so follow a batch with journal_sync
+int journal_append(Journal* journal, EntityType entity, ChangeType type, const void* record);
+// Waits until everything appended so far is durable
+int journal_sync(Journal* journal);
+// Snapshots the followed lists under their locks and starts a new log;
+// waits for lists other threads are editing
+int journal_checkpoint(Journal* journal);
+
+void journal_get_stats(Journal* journal, JournalStats* stats);
+void display_journal_stats(Journal* journal);
+
+// Times `edits` student edits journaled against a full CSV save of
+// `students` students per edit, in scratch_dir
+void journal_benchmark(const char* scratch_dir, int students, int edits);
+
+#endif // JOURNAL_H
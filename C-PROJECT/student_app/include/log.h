@@ -47,6 +47,7 @@ typedef struct {
     char log_filename[256];
     int auto_rotate;
     int compress_old_logs;
+    int drop_when_full;         // 0: a logging thread waits while its ring is full
 } LogConfig;
 
 // Log management functions
@@ -113,18 +114,28 @@ LogList* log_filter_by_date_range(LogList* list, time_t start_date, time_t end_d
 LogList* log_filter_by_keyword(LogList* list, const char* keyword);
 
 // Log analysis
+#define LOG_STATS_TOP_USERS 5
+
 typedef struct {
     int total_entries;
     int entries_by_level[5];
     int entries_by_hour[24];
     int entries_by_day[7];
     int most_active_user;
-    int most_logged_module;
+    int most_logged_module;                     // Module id, see log_async_module_name
     time_t first_entry;
     time_t last_entry;
+    int top_users[LOG_STATS_TOP_USERS];         // Most active first
+    int top_user_entries[LOG_STATS_TOP_USERS];  // Upper bounds when streamed
+    int top_user_count;
+    int files_scanned;
 } LogStatistics;
 
 LogStatistics* calculate_log_statistics(LogList* list);
+// Streams `log_file` and its rotated copies (log_file.N), one file per
+// thread, without loading them. Only the last `days` days are counted
+// (0 for all); threads <= 0 picks one per CPU.
+LogStatistics* calculate_log_statistics_from_files(const char* log_file, int days, int threads);
 void display_log_statistics(LogStatistics* stats);
 void free_log_statistics(LogStatistics* stats);
 
@@ -140,6 +151,8 @@ int log_list_save_to_file(LogList* list, const char* filename);
 int log_list_load_from_file(LogList* list, const char* filename);
 int log_export_to_csv(LogList* list, const char* filename);
 int log_export_to_json(LogList* list, const char* filename);
+int log_export_file_to_csv(const char* log_file, const char* filename);     // Streams, no LogList
+int log_export_file_to_json(const char* log_file, const char* filename);
 
 // Log rotation and cleanup
 int log_rotate_file(const char* log_file, int max_size);
@@ -198,6 +211,80 @@ int log_validate_user_id(int user_id);
 #define LOG_MODULE_UI "UI"
 #define LOG_MODULE_CONFIG "CONFIG"
 
+// Module ids, in the same order as the LOG_MODULE_* names above. Modules
+// registered at runtime by name share LOG_MODULE_ID_OTHER for enablement.
+typedef enum {
+    LOG_MODULE_ID_SYSTEM = 0,
+    LOG_MODULE_ID_AUTH,
+    LOG_MODULE_ID_STUDENT,
+    LOG_MODULE_ID_GRADE,
+    LOG_MODULE_ID_ATTENDANCE,
+    LOG_MODULE_ID_CLUB,
+    LOG_MODULE_ID_BACKUP,
+    LOG_MODULE_ID_FILE,
+    LOG_MODULE_ID_UI,
+    LOG_MODULE_ID_CONFIG,
+    LOG_MODULE_ID_COUNT,
+    LOG_MODULE_ID_OTHER = 31
+} LogModuleId;
+
+#define LOG_MODULE_MASK_ALL 0xFFFFFFFFu
+
+// Per-level bitmask of enabled modules; all zero until log_init
+extern unsigned int log_enabled_modules[5];
+
+int log_set_module_enabled(LogModuleId module, int enabled);
+int log_set_module_mask(unsigned int mask);
+unsigned int log_get_module_mask(void);
+int log_site_emit(LogLevel level, LogModuleId module, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Build-time minimum level: 0 debug, 1 info, 2 warning, 3 error, 4 critical.
+// Sites below it compile to nothing; production builds pass -DLOG_COMPILE_MIN_LEVEL=1.
+#ifndef LOG_COMPILE_MIN_LEVEL
+#define LOG_COMPILE_MIN_LEVEL 0
+#endif
+
+// Enabled sites cost one load and one predictable branch; the arguments are
+// only evaluated when the level and module are switched on. The format must
+// be a string literal.
+#define LOG_SITE(level, module, format, ...) \
+    do { \
+        if (__builtin_expect((log_enabled_modules[(level)] >> (module)) & 1u, 0)) { \
+            log_site_emit((level), (module), "" format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Compiled-out sites still type-check their arguments but never evaluate them
+#define LOG_SITE_DISABLED(module, format, ...) \
+    ((void)sizeof(module), (void)sizeof(printf("" format, ##__VA_ARGS__)))
+
+#if LOG_COMPILE_MIN_LEVEL <= 0
+#define LOG_DEBUG(module, format, ...) LOG_SITE(LOG_LEVEL_DEBUG, module, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(module, format, ...) LOG_SITE_DISABLED(module, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_MIN_LEVEL <= 1
+#define LOG_INFO(module, format, ...) LOG_SITE(LOG_LEVEL_INFO, module, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(module, format, ...) LOG_SITE_DISABLED(module, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_MIN_LEVEL <= 2
+#define LOG_WARNING(module, format, ...) LOG_SITE(LOG_LEVEL_WARNING, module, format, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(module, format, ...) LOG_SITE_DISABLED(module, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_MIN_LEVEL <= 3
+#define LOG_ERROR(module, format, ...) LOG_SITE(LOG_LEVEL_ERROR, module, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(module, format, ...) LOG_SITE_DISABLED(module, format, ##__VA_ARGS__)
+#endif
+
+#define LOG_CRITICAL(module, format, ...) LOG_SITE(LOG_LEVEL_CRITICAL, module, format, ##__VA_ARGS__)
+
 // Log level strings
 #define LOG_LEVEL_DEBUG_STR "DEBUG"
 #define LOG_LEVEL_INFO_STR "INFO"
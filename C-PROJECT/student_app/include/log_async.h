@@ -0,0 +1,113 @@
+#ifndef LOG_ASYNC_H
+#define LOG_ASYNC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "config.h"
+#include "log.h"
+
+// Asynchronous logging backend. Callers capture a compact binary record
+// (timestamp, level, module id, format and raw arguments) into a per-thread
+// single-producer ring; one background thread formats, encrypts, batches,
+// writes and rotates.
+
+#define LOG_ASYNC_SLOT_SIZE 256             // Bytes per record slot
+#define LOG_ASYNC_MAX_ARGS 8
+#define LOG_ASYNC_DEFAULT_RING_SLOTS 1024   // Per thread, power of two
+#define LOG_ASYNC_DEFAULT_FLUSH_MS 20
+#define LOG_ASYNC_MAX_MODULES 64
+
+// What a producer does when its ring is full. Without an explicit
+// LogAsyncConfig the policy comes from LogConfig.drop_when_full, which
+// defaults to blocking so audit records are not lost. Either way a ring
+// that reaches half full wakes the writer at once.
+typedef enum {
+    LOG_OVERFLOW_DROP = 0,      // Count the record as dropped and return at once
+    LOG_OVERFLOW_BLOCK = 1      // Wake the writer and sleep until it has drained
+} LogOverflowPolicy;
+
+typedef struct {
+    int ring_slots;
+    LogOverflowPolicy overflow_policy;
+    int flush_interval_ms;
+} LogAsyncConfig;
+
+// Argument kinds captured at the call site
+typedef enum {
+    LOG_ARG_SIGNED = 0,
+    LOG_ARG_UNSIGNED,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,     // Copied into the record payload
+    LOG_ARG_POINTER
+} LogArgType;
+
+typedef union {
+    long long i;
+    unsigned long long u;
+    double d;
+    const void* p;
+    struct {
+        unsigned short offset;
+        unsigned short length;
+    } s;
+} LogArg;
+
+// Record flags
+#define LOG_RECORD_STATIC_FORMAT 0x01   // `format` points at a string literal
+#define LOG_RECORD_PREFORMATTED 0x02    // Payload holds the finished message
+#define LOG_RECORD_TRUNCATED 0x04
+
+#define LOG_RECORD_HEADER_SIZE (8 + 8 + 4 + LOG_ASYNC_MAX_ARGS + LOG_ASYNC_MAX_ARGS * 8 + 4)
+
+typedef struct {
+    long long timestamp_ns;     // CLOCK_REALTIME
+    const char* format;
+    unsigned char level;
+    unsigned char module;
+    unsigned char arg_count;
+    unsigned char flags;
+    unsigned char arg_types[LOG_ASYNC_MAX_ARGS];
+    unsigned short payload_used;
+    unsigned short format_offset;   // Copied format, when not static
+    LogArg args[LOG_ASYNC_MAX_ARGS];
+    char payload[LOG_ASYNC_SLOT_SIZE - LOG_RECORD_HEADER_SIZE];
+} LogRecord;
+
+typedef struct {
+    unsigned long long records_pushed;
+    unsigned long long records_dropped;
+    unsigned long long records_written;
+    unsigned long long bytes_written;
+    unsigned long long batches_written;
+    unsigned long long rotations;
+    int active_rings;
+} LogAsyncStats;
+
+// Backend lifecycle (log_init / log_cleanup call these). Other threads may
+// still be logging during log_async_stop: calls already under way finish and
+// are written, later ones return 0.
+int log_async_start(const LogConfig* config, const LogAsyncConfig* async_config);
+void log_async_stop(void);
+int log_async_is_running(void);
+void log_async_flush(void);
+void log_async_set_min_level(LogLevel level);
+
+// Encrypted output: AES-256-GCM per batch. Set the key before log_init.
+int log_async_set_encryption_key(const unsigned char* key, int key_size);
+int log_async_decrypt_file(const char* input_file, const char* output_file, const unsigned char* key);
+
+// Call-site capture
+int log_async_push(LogLevel level, int module_id, int static_format, const char* format, ...);
+int log_async_vpush(LogLevel level, int module_id, int static_format, const char* format, va_list args);
+
+// Module names are interned to small ids; the LOG_MODULE_* names come first
+int log_async_module_id(const char* module);
+const char* log_async_module_name(int module_id);
+
+void log_async_get_stats(LogAsyncStats* stats);
+
+// Benchmark: caller-side latency of `messages` pushes
+void log_async_benchmark(long messages);
+
+#endif // LOG_ASYNC_H
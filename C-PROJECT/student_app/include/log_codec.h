@@ -0,0 +1,118 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "log.h"
+
+// Compact log encoding. Entries are grouped into self-contained blocks:
+//
+//   block  = [varint entries][varint strings][strings][zigzag first timestamp][rows]
+//   string = [varint length][bytes]         module names and usernames, interned
+//   row    = [level | ip kind << 3][zigzag timestamp delta][varint module]
+//            [zigzag user id][varint username][ip][varint length][message]
+//
+// An IPv4 address packs into 4 bytes. On disk each block is framed as
+// [u32 raw size][u32 stored size][u8 codec][payload], optionally LZ
+// compressed, after a "SLOG" file header.
+
+#define LOG_CODEC_MAGIC "SLOG"
+#define LOG_CODEC_VERSION 1
+#define LOG_CODEC_BLOCK_ENTRIES 4096
+#define LOG_CODEC_DICT_SLOTS 16384          // Power of two, above 2 * block entries
+
+// Block payload codecs
+#define LOG_CODEC_RAW 0
+#define LOG_CODEC_LZ 1
+
+// Where a LogReader is getting its entries from
+typedef enum {
+    LOG_FORMAT_COMPACT = 0,
+    LOG_FORMAT_TEXT = 1         // "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] [MODULE] message" lines
+} LogFileFormat;
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} LogBuffer;
+
+// Builds one block in memory
+typedef struct {
+    LogBuffer strings;
+    LogBuffer rows;
+    int string_count;
+    int* string_offsets;            // Start of each string's bytes in `strings`
+    int* string_lengths;
+    int string_capacity;
+    int slots[LOG_CODEC_DICT_SLOTS];    // Hash slots -> string index, -1 empty
+    int count;
+    long long first_timestamp;
+    long long last_timestamp;
+} LogBlockEncoder;
+
+// Walks the entries of one raw block
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+    int remaining;
+    int string_count;
+    const unsigned char** strings;
+    int* string_lengths;
+    int string_capacity;
+    long long timestamp;
+} LogBlockDecoder;
+
+typedef struct {
+    FILE* file;
+    int compress;
+    LogBlockEncoder encoder;
+    LogBuffer block;
+    LogBuffer frame;
+    long long entries;
+    long long raw_bytes;            // Encoded size before compression
+    long long stored_bytes;         // Bytes written, headers included
+} LogWriter;
+
+typedef struct {
+    FILE* file;
+    LogFileFormat format;
+    LogBuffer raw;
+    LogBuffer stored;
+    LogBlockDecoder decoder;
+    char line[LOG_MAX_MESSAGE_LENGTH + 128];
+} LogReader;
+
+// In-memory blocks
+void log_block_encoder_init(LogBlockEncoder* encoder);
+void log_block_encoder_free(LogBlockEncoder* encoder);
+void log_block_encoder_reset(LogBlockEncoder* encoder);
+int log_block_encoder_add(LogBlockEncoder* encoder, const LogEntry* entry);
+int log_block_encoder_finish(LogBlockEncoder* encoder, LogBuffer* out);     // Appends the block, then resets
+
+void log_block_decoder_init(LogBlockDecoder* decoder);
+void log_block_decoder_free(LogBlockDecoder* decoder);
+int log_block_decoder_open(LogBlockDecoder* decoder, const unsigned char* data, size_t size);
+int log_block_decoder_next(LogBlockDecoder* decoder, LogEntry* entry);    // 0 at the end of the block
+
+void log_buffer_free(LogBuffer* buffer);
+
+// Files
+LogWriter* log_writer_open(const char* filename, int compress);
+int log_writer_append(LogWriter* writer, const LogEntry* entry);
+int log_writer_close(LogWriter* writer);        // Flushes; returns 0 if any write failed
+
+LogReader* log_reader_open(const char* filename);   // Compact or text log files
+int log_reader_next(LogReader* reader, LogEntry* entry);
+void log_reader_close(LogReader* reader);
+
+// Rewrite a text or compact log file as compressed compact encoding
+int log_codec_compress_file(const char* input_file, const char* output_file);
+int log_codec_is_compact_file(const char* filename);
+
+// Benchmark: bytes per entry as LogEntry, text lines, compact and compressed
+void log_codec_benchmark(long entries);
+
+#endif // LOG_CODEC_H
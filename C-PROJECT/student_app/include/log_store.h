@@ -0,0 +1,153 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "config.h"
+#include "log.h"
+
+// Append-only log store. Entries go into segments of LOG_STORE_SEGMENT_ROWS;
+// a full segment is sorted by timestamp and sealed, which builds its indexes:
+// a sparse timestamp index, level and module row sets, and user and keyword
+// posting lists. Queries return cursors that walk the matching rows without
+// copying entries.
+
+#define LOG_STORE_SEGMENT_ROWS 65536
+#define LOG_STORE_FENCE_INTERVAL 128        // One timestamp fence per 128 rows
+#define LOG_STORE_ARRAY_LIMIT 4096          // Row sets above this become bitmaps
+#define LOG_STORE_MAX_MODULES 64
+// Modules first seen after the other ids are taken all share the last one
+#define LOG_STORE_OVERFLOW_MODULE (LOG_STORE_MAX_MODULES - 1)
+#define LOG_STORE_OVERFLOW_NAME "OTHER"
+#define LOG_STORE_MAX_KEYWORD_TOKENS 8
+
+// Compact row as kept in a segment; strings live in the segment arena
+typedef struct {
+    long long timestamp;
+    int user_id;
+    unsigned int text_offset;       // username\0ip\0message\0
+    unsigned short message_length;
+    unsigned char level;
+    unsigned char module;
+} LogStoreRecord;
+
+// Rows of one segment: a sorted array when sparse, a bitmap when dense
+typedef struct {
+    int count;
+    int capacity;
+    unsigned short* rows;
+    unsigned long long* bits;
+} LogRowSet;
+
+// Open addressing map from a 64-bit key (user id, token hash) to a row set
+typedef struct {
+    unsigned long long* keys;
+    int* values;                    // -1 when the slot is empty
+    int capacity;
+    int size;
+} LogKeyMap;
+
+typedef struct {
+    LogStoreRecord* records;
+    int count;
+    char* arena;
+    size_t arena_size;
+    size_t arena_capacity;
+    long long min_timestamp;
+    long long max_timestamp;
+    int in_order;                   // Appended in timestamp order so far
+    int sealed;
+
+    // Built when sealed
+    long long* fences;
+    int fence_count;
+    LogRowSet levels[5];
+    LogRowSet modules[LOG_STORE_MAX_MODULES];
+    LogKeyMap users;
+    LogKeyMap tokens;
+    LogRowSet* sets;                // Posting lists referenced by users and tokens
+    unsigned short* postings;       // Row arrays of the sparse posting lists
+    int set_count;
+    int set_capacity;
+} LogStoreSegment;
+
+typedef struct {
+    LogStoreSegment** segments;
+    int segment_count;
+    int segment_capacity;
+    long long total_entries;
+    char module_names[LOG_STORE_MAX_MODULES][LOG_MAX_MODULE_LENGTH];
+    int module_count;
+    long long module_overflow;      // Entries stored under LOG_STORE_OVERFLOW_MODULE
+    pthread_rwlock_t lock;
+} LogStore;
+
+// Query: unset fields match everything. Keyword search matches whole words,
+// case-insensitively; several words must all appear.
+typedef struct {
+    int level;                      // LogLevel, or -1
+    char module[LOG_MAX_MODULE_LENGTH];
+    int user_id;                    // -1 for any user
+    time_t start_date;              // 0 for no lower bound
+    time_t end_date;                // 0 for no upper bound (inclusive)
+    char keyword[LOG_MAX_MESSAGE_LENGTH];
+} LogQuery;
+
+// Borrowed view of one entry; valid until the next append to the store
+typedef struct {
+    long long timestamp;
+    LogLevel level;
+    const char* module;
+    int user_id;
+    const char* username;
+    const char* ip_address;
+    const char* message;
+} LogRecordView;
+
+typedef struct {
+    LogStore* store;
+    LogQuery query;
+    int module_id;                  // -1 any, -2 unknown module (matches nothing)
+    unsigned long long tokens[LOG_STORE_MAX_KEYWORD_TOKENS];
+    char token_text[LOG_STORE_MAX_KEYWORD_TOKENS][64];
+    int token_count;
+    int segment;
+    int row;
+    int row_end;
+    int use_bits;
+    unsigned long long* bits;       // Matching rows of the current sealed segment
+    long long returned;
+} LogCursor;
+
+// Store management
+LogStore* log_store_create(void);
+void log_store_destroy(LogStore* store);
+int log_store_append(LogStore* store, const LogEntry* entry);
+int log_store_append_fields(LogStore* store, time_t timestamp, LogLevel level, const char* module,
+                            int user_id, const char* username, const char* ip_address, const char* message);
+int log_store_append_list(LogStore* store, const LogList* list);
+int log_store_seal(LogStore* store);
+long long log_store_count(LogStore* store);
+long long log_store_module_overflow(LogStore* store);
+
+// Queries
+void log_query_init(LogQuery* query);
+LogCursor* log_store_query(LogStore* store, const LogQuery* query);
+LogCursor* log_store_filter_by_level(LogStore* store, LogLevel level);
+LogCursor* log_store_filter_by_module(LogStore* store, const char* module);    // Overflowed names match all OTHER rows
+LogCursor* log_store_filter_by_user(LogStore* store, int user_id);
+LogCursor* log_store_filter_by_date_range(LogStore* store, time_t start_date, time_t end_date);
+LogCursor* log_store_filter_by_keyword(LogStore* store, const char* keyword);
+
+// Cursors
+int log_cursor_next(LogCursor* cursor, LogRecordView* view);
+int log_cursor_next_entry(LogCursor* cursor, LogEntry* entry);
+long long log_cursor_count(LogCursor* cursor);   // Remaining matches; consumes the cursor
+void log_cursor_destroy(LogCursor* cursor);
+
+// Benchmark: build a store of `entries` synthetic entries and time queries
+void log_store_benchmark(long entries);
+
+#endif // LOG_STORE_H
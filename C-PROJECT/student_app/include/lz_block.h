@@ -0,0 +1,25 @@
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Byte-oriented LZ77 block codec producing the LZ4 block format: sequences
+// of [token][literal length][literals][2-byte offset][match length]. Fast
+// enough to run inline with writing, and each block decodes on its own.
+
+#define LZ_BLOCK_MAX_INPUT (64 * 1024 * 1024)
+#define LZ_BLOCK_HASH_BITS 12
+
+// Worst-case compressed size for `size` input bytes
+int lz_block_bound(int size);
+
+// Returns the number of bytes written to dst, or -1 when dst is too small
+// or the input too large
+int lz_block_compress(const unsigned char* src, int src_size, unsigned char* dst, int dst_capacity);
+
+// Returns the number of bytes written to dst, or -1 when the input is
+// malformed or does not fit in dst
+int lz_block_decompress(const unsigned char* src, int src_size, unsigned char* dst, int dst_capacity);
+
+#endif // LZ_BLOCK_H
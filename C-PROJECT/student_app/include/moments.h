@@ -0,0 +1,59 @@
+#ifndef MOMENTS_H
+#define MOMENTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+
+// Mergeable running mean and sum of squared deviations (Welford / Chan)
+typedef struct {
+    long long n;
+    double mean;
+    double m2;
+} StatsMoments;
+
+// Joint moments of two series, for covariance and correlation
+typedef struct {
+    long long n;
+    double mean_x;
+    double mean_y;
+    double m2_x;
+    double m2_y;
+    double c_xy;
+} StatsComoments;
+
+// Inputs are reduced in fixed blocks that are merged in block order, so the
+// result is the same whatever the thread count or instruction set used.
+#define MOMENTS_BLOCK_SIZE 4096
+#define MOMENTS_PARALLEL_THRESHOLD 262144
+#define MOMENTS_MAX_THREADS 64
+
+// Accumulators
+void stats_moments_init(StatsMoments* m);
+void stats_moments_add(StatsMoments* m, double x);
+void stats_moments_merge(StatsMoments* into, const StatsMoments* from);
+double stats_moments_variance(const StatsMoments* m);   // Population variance
+double stats_moments_stddev(const StatsMoments* m);
+
+void stats_comoments_init(StatsComoments* c);
+void stats_comoments_add(StatsComoments* c, double x, double y);
+void stats_comoments_merge(StatsComoments* into, const StatsComoments* from);
+double stats_comoments_covariance(const StatsComoments* c);
+double stats_comoments_correlation(const StatsComoments* c);
+
+// Array kernels (AVX2 when the CPU has it, scalar otherwise)
+void stats_moments_accumulate(StatsMoments* m, const float* values, int count);
+void stats_comoments_accumulate(StatsComoments* c, const float* x, const float* y, int count);
+
+// Block-parallel reductions; threads <= 0 picks the number of online CPUs
+int stats_moments_compute(const float* values, int count, int threads, StatsMoments* out);
+int stats_comoments_compute(const float* x, const float* y, int count, int threads, StatsComoments* out);
+
+// Kernel selection
+int stats_moments_simd_enabled(void);
+void stats_moments_force_scalar(int force);
+
+// Benchmark: correlation over `count` rows, scalar and SIMD, 1 and N threads
+void moments_benchmark(int count);
+
+#endif // MOMENTS_H
@@ -0,0 +1,98 @@
+#ifndef PERMISSION_H
+#define PERMISSION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "auth.h"
+#include "student.h"
+#include "grade.h"
+#include "attendance.h"
+
+// Role-based permissions. What each UserRole may do is a constant table
+// of one bitmask per role, indexed by role and tested with a shift and an
+// AND, so UI code asks session_can(session, PERM_GRADE_EDIT) instead of
+// combining session_is_* checks by hand.
+//
+// A second table marks the grants that only cover records the user owns:
+// a teacher's are the courses with Course.teacher_id equal to their user
+// id (and the students, grades and attendance in them), a student's are
+// their own record, grades and attendance. A PermissionScope resolves
+// that ownership once per session, and the permission_next_* scans apply
+// it inside the list walk.
+
+typedef enum {
+    PERM_STUDENT_VIEW = 0,
+    PERM_STUDENT_CREATE,
+    PERM_STUDENT_EDIT,
+    PERM_STUDENT_DELETE,
+    PERM_GRADE_VIEW,
+    PERM_GRADE_EDIT,
+    PERM_ATTENDANCE_VIEW,
+    PERM_ATTENDANCE_MARK,
+    PERM_COURSE_VIEW,
+    PERM_COURSE_EDIT,
+    PERM_CLUB_VIEW,
+    PERM_CLUB_EDIT,
+    PERM_REPORT_VIEW,
+    PERM_USER_MANAGE,
+    PERM_LOG_VIEW,
+    PERM_BACKUP_RUN,
+    PERM_ACTION_COUNT
+} PermissionAction;
+
+#define PERMISSION_ROLE_SLOTS 4         // UserRole values are 1..3
+#define PERMISSION_BIT(action) (1u << (action))
+
+// Indexed by UserRole; slot 0 grants nothing
+extern const unsigned int permission_granted[PERMISSION_ROLE_SLOTS];
+extern const unsigned int permission_scoped[PERMISSION_ROLE_SLOTS];
+
+#define PERMISSION_ROW(table, role) \
+    ((unsigned int)(role) < PERMISSION_ROLE_SLOTS ? (table)[(unsigned int)(role)] : 0u)
+#define PERMISSION_ALLOWS(role, action) ((PERMISSION_ROW(permission_granted, role) & PERMISSION_BIT(action)) != 0)
+
+int permission_allows(UserRole role, PermissionAction action);
+// 1 when the role's grant for action is limited to owned records
+int permission_is_scoped(UserRole role, PermissionAction action);
+// The role's grant for a valid session; ownership is not considered
+int session_can(const Session* session, PermissionAction action);
+const char* permission_action_name(PermissionAction action);
+void permission_display_table(void);
+
+// Ownership resolved for one session
+typedef struct {
+    int user_id;
+    UserRole role;
+    unsigned int granted;               // 0 for an invalid session
+    unsigned int scoped;
+    int* course_ids;                    // Courses taught, sorted
+    char (*course_names)[MAX_COURSE_LENGTH];    // Their names and codes
+    int course_count;
+    int own_student_id;                 // Student record of a student user, or -1
+} PermissionScope;
+
+// users resolves a student user's email to their Student record in
+// students; courses gives a teacher's courses. Any may be NULL, which
+// leaves the corresponding scoped grants matching nothing.
+PermissionScope* permission_scope_create(const Session* session, UserList* users, const CourseList* courses,
+                                         StudentList* students);
+void permission_scope_destroy(PermissionScope* scope);
+
+// Whether the scope may perform action on one record
+int permission_scope_can(const PermissionScope* scope, PermissionAction action);
+int permission_scope_can_student(const PermissionScope* scope, PermissionAction action, const Student* student);
+int permission_scope_can_grade(const PermissionScope* scope, PermissionAction action, const Grade* grade);
+int permission_scope_can_attendance(const PermissionScope* scope, PermissionAction action,
+                                    const AttendanceRecord* record);
+
+// Walk the records action is permitted on; start with *cursor = 0 and
+// call until NULL. An unscoped grant walks the whole list unfiltered and
+// a missing one returns NULL at once.
+Student* permission_next_student(const PermissionScope* scope, PermissionAction action, StudentList* list,
+                                 int* cursor);
+Grade* permission_next_grade(const PermissionScope* scope, PermissionAction action, GradeList* list, int* cursor);
+AttendanceRecord* permission_next_attendance(const PermissionScope* scope, PermissionAction action,
+                                             AttendanceList* list, int* cursor);
+
+#endif // PERMISSION_H
@@ -0,0 +1,52 @@
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+
+#define QUANTILE_DEFAULT_K 200          // Rank error around 1.65/k at the default
+#define QUANTILE_MIN_LEVEL_CAPACITY 8
+#define QUANTILE_MAX_LEVELS 48
+
+// One compactor of the sketch: items at level h each stand for 2^h inputs
+typedef struct {
+    float* items;
+    int count;
+    int capacity;
+} QuantileLevel;
+
+// KLL streaming quantile sketch. Memory stays around 3k floats whatever the
+// number of inputs, and sketches built separately (per course, per term)
+// can be merged into one.
+typedef struct {
+    int k;
+    int level_count;
+    QuantileLevel levels[QUANTILE_MAX_LEVELS];
+    long long n;
+    float min_value;
+    float max_value;
+    unsigned int seed;
+} QuantileSketch;
+
+// Sketch management
+QuantileSketch* quantile_sketch_create(int k);
+void quantile_sketch_destroy(QuantileSketch* sketch);
+void quantile_sketch_reset(QuantileSketch* sketch);
+
+// Feeding and merging
+int quantile_sketch_add(QuantileSketch* sketch, float value);
+int quantile_sketch_add_array(QuantileSketch* sketch, const float* values, int count);
+int quantile_sketch_merge(QuantileSketch* into, const QuantileSketch* from);
+
+// Queries: q in [0, 1]; rank returns the estimated fraction of inputs <= value
+float quantile_sketch_query(const QuantileSketch* sketch, float q);
+float quantile_sketch_rank(const QuantileSketch* sketch, float value);
+long long quantile_sketch_count(const QuantileSketch* sketch);
+
+// Exact selection: reorders values so that values[k] is the k-th smallest,
+// with nothing larger before it and nothing smaller after it
+float quantile_select_nth(float* values, int count, int k);
+
+#endif // QUANTILE_H
@@ -0,0 +1,65 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "config.h"
+
+// Token-bucket rate limiter over a fixed-size table. Each key (a username,
+// an IP address in LogEntry.ip_address form, ...) gets a bucket holding up
+// to `capacity` tokens that refills at `refill_per_second`; an attempt
+// takes one token and is refused when none is left. Refill is computed
+// lazily from the time of the last attempt, so idle keys cost nothing.
+//
+// Buckets are 16 bytes, four to a 64-byte group; a key lives in the group
+// its hash selects. The hash is SipHash under a random per-limiter key, so
+// nobody can pick keys that land in the group of a username they want to
+// unlock. When a group is full a bucket that has refilled completely is
+// dropped first (it holds nothing), then the one idle longest, so memory
+// stays fixed however many keys an attacker invents. New keys start full,
+// so an evicted key that was still refilling gets its attempts back;
+// callers bound that by only limiting keys they can vouch for (auth.c
+// gives buckets to existing accounts, not to every username tried) and by
+// sizing the table above the number of such keys. Timestamps are 32-bit
+// milliseconds, so a bucket idle for more than ~49 days refills late;
+// such buckets are the first to be replaced.
+
+#define RATE_LIMITER_GROUP_SIZE 4
+#define RATE_LIMITER_LOCKS 64
+#define RATE_LIMITER_MILLI 1000             // Tokens are kept in thousandths
+
+typedef struct {
+    unsigned long long key_hash;            // 0 marks a free bucket
+    unsigned int tokens;                    // Thousandths of a token
+    unsigned int last;                      // Milliseconds, limiter clock
+} RateBucket;
+
+typedef struct {
+    RateBucket* buckets;
+    int group_count;                        // Power of two
+    unsigned int capacity;                  // Thousandths
+    unsigned int refill_per_second;         // Thousandths
+    unsigned long long hash_key[2];         // SipHash key, random per limiter
+    pthread_mutex_t locks[RATE_LIMITER_LOCKS];
+    long long (*clock)(void);               // Milliseconds; monotonic by default
+    _Atomic long long allowed;
+    _Atomic long long refused;
+    _Atomic long long evictions;
+} RateLimiter;
+
+// buckets is rounded up to whole groups and a power of two
+RateLimiter* rate_limiter_create(int buckets, double capacity, double refill_per_second);
+void rate_limiter_destroy(RateLimiter* limiter);
+
+// Takes a token for `key`; 1 when allowed, 0 when throttled
+int rate_limiter_allow(RateLimiter* limiter, const char* key);
+// Tokens `key` has now, without taking one
+double rate_limiter_available(RateLimiter* limiter, const char* key);
+// Refills `key` completely, e.g. after a successful login
+void rate_limiter_reset(RateLimiter* limiter, const char* key);
+
+void display_rate_limiter_stats(const RateLimiter* limiter, const char* name);
+
+#endif // RATE_LIMITER_H
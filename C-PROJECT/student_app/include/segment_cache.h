@@ -0,0 +1,81 @@
+#ifndef SEGMENT_CACHE_H
+#define SEGMENT_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "config.h"
+#include "crypto_stream.h"
+
+// Bounded LRU cache of decrypted stream segments, so repeated record
+// fetches from one encrypted file pay the AES cost once. Entries are keyed
+// by (file, segment, generation): the file is its path, the generation the
+// random file id every stream header carries, which changes on each
+// rewrite. Seeing a new generation for a path drops that path's entries.
+// Each entry also carries a tag of the key that authenticated it (HMAC of
+// the key under a per-cache random secret), and only a reader holding the
+// same key is served from it; any other key misses and has to decrypt.
+//
+// Plaintext lives in one arena locked into RAM (kept out of swap and core
+// dumps where the system allows) and each slot is wiped with
+// secure_memory_clear when evicted, invalidated or destroyed.
+
+#define SEGMENT_CACHE_DEFAULT_SLOTS 256     // 16 MB of 64 KB segments
+#define SEGMENT_CACHE_MAX_FILES 64          // Generations remembered
+#define SEGMENT_CACHE_KEY_TAG_SIZE 16
+
+typedef struct {
+    unsigned long long path_hash;
+    unsigned char generation[16];
+    unsigned char key_tag[SEGMENT_CACHE_KEY_TAG_SIZE];
+    long long segment;
+    int length;                             // -1 when the slot is free
+    int prev;                               // LRU list, most recent at head
+    int next;
+    int hash_next;                          // Bucket chain
+} SegmentCacheEntry;
+
+typedef struct {
+    unsigned long long path_hash;
+    unsigned char generation[16];
+    int in_use;
+} SegmentCacheFile;
+
+typedef struct {
+    int slot_count;
+    int slot_size;                          // Largest segment cached
+    unsigned char* arena;                   // slot_count * slot_size
+    size_t arena_size;
+    int locked;                             // mlock succeeded
+    unsigned char key_secret[CRYPTO_SHA256_SIZE];   // For the key tags
+    SegmentCacheEntry* entries;
+    int* buckets;
+    int bucket_count;
+    int lru_head;
+    int lru_tail;
+    int free_head;                          // Free slots, chained through next
+    SegmentCacheFile files[SEGMENT_CACHE_MAX_FILES];
+    int next_file;                          // Round-robin replacement
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long invalidations;
+    pthread_mutex_t lock;
+} SegmentCache;
+
+// slot_count <= 0 and slot_size <= 0 pick the defaults. Files whose
+// segments exceed slot_size are read straight through.
+SegmentCache* segment_cache_create(int slot_count, int slot_size);
+void segment_cache_destroy(SegmentCache* cache);
+
+// Like crypto_stream_pread, served from the cache where possible. filename
+// must be the path `reader` was opened from.
+long long segment_cache_pread(SegmentCache* cache, CryptoStreamReader* reader, const char* filename,
+                              void* out, size_t size, long long offset);
+// Drops every cached segment of a file, e.g. after rewriting it
+void segment_cache_invalidate(SegmentCache* cache, const char* filename);
+void segment_cache_clear(SegmentCache* cache);
+
+void display_segment_cache_stats(const SegmentCache* cache);
+
+#endif // SEGMENT_CACHE_H
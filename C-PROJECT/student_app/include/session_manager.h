@@ -0,0 +1,89 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "config.h"
+#include "auth.h"
+
+// Central session table. Sessions are found by a random 128-bit token
+// through a hash table split into lock stripes, so validate, touch and
+// revoke on different sessions rarely contend. A session expires after
+// idle_timeout seconds without a touch or absolute_timeout seconds after
+// login, whichever comes first.
+//
+// Validation checks the deadline itself, so it is exact and O(1). Memory
+// for abandoned sessions is reclaimed by a hierarchical timing wheel per
+// stripe (SESSION_WHEEL_LEVELS levels of 64 one-second slots), advanced a
+// little on each operation that takes the stripe's lock. Touches do not
+// move a session in the wheel; when its slot comes round it is re-filed
+// under its current deadline if it is still alive. Stretches where the
+// lower levels are empty are skipped in one step.
+
+#define SESSION_STRIPES 64
+#define SESSION_WHEEL_LEVELS 4
+#define SESSION_WHEEL_BITS 6
+#define SESSION_WHEEL_SLOTS (1 << SESSION_WHEEL_BITS)
+#define SESSION_STRIPE_MIN_BUCKETS 16
+#define SESSION_DEFAULT_IDLE_TIMEOUT (30 * 60)
+#define SESSION_DEFAULT_ABSOLUTE_TIMEOUT (12 * 60 * 60)
+// Wheel ticks one operation may advance before leaving the rest to the next
+#define SESSION_SWEEP_BUDGET 64
+
+typedef struct SessionEntry {
+    unsigned char token[16];
+    Session session;
+    long long created;                      // Manager clock, seconds
+    long long last_seen;
+    long long wheel_deadline;               // Deadline the entry is filed under
+    struct SessionEntry* bucket_next;
+    struct SessionEntry* wheel_prev;
+    struct SessionEntry* wheel_next;
+    struct SessionEntry** wheel_slot;       // Head of the slot list it is in
+    int wheel_level;
+} SessionEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    SessionEntry** buckets;
+    int bucket_count;
+    int count;
+    SessionEntry* wheel[SESSION_WHEEL_LEVELS][SESSION_WHEEL_SLOTS];
+    int wheel_counts[SESSION_WHEEL_LEVELS]; // Entries per level, to skip empty stretches
+    long long wheel_now;                    // Last tick processed
+    long long expired;
+    long long revoked;
+} SessionStripe;
+
+typedef struct {
+    SessionStripe stripes[SESSION_STRIPES];
+    int idle_timeout;
+    int absolute_timeout;
+    long long (*clock)(void);               // Seconds; monotonic by default
+} SessionManager;
+
+// Timeouts <= 0 use the defaults
+SessionManager* session_manager_create(int idle_timeout, int absolute_timeout);
+void session_manager_destroy(SessionManager* manager);
+
+// Issues a token for an authenticated user and fills session, token included
+int session_manager_open(SessionManager* manager, const User* user, Session* session);
+// 1 when the token names a live session; copies it to session (may be NULL).
+// Does not extend the idle timeout.
+int session_manager_validate(SessionManager* manager, const char* token, Session* session);
+// Validates and restarts the idle timeout
+int session_manager_touch(SessionManager* manager, const char* token);
+int session_manager_revoke(SessionManager* manager, const char* token);
+// Revokes every session of a user; returns how many
+int session_manager_revoke_user(SessionManager* manager, int user_id);
+// Brings every stripe's wheel up to date; returns the sessions expired
+int session_manager_sweep(SessionManager* manager);
+int session_manager_count(SessionManager* manager);
+
+// Opens `sessions` sessions and times `operations` validate/touch calls on
+// `threads` threads
+void session_manager_benchmark(int sessions, int operations, int threads);
+
+#endif // SESSION_MANAGER_H
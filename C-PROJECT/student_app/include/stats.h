@@ -11,6 +11,7 @@
 #include "grade.h"
 #include "attendance.h"
 #include "club.h"
+#include "quantile.h"
 
 // General statistics structure
 typedef struct {
@@ -102,6 +103,29 @@ ClubStats* calculate_club_stats(ClubList* clubs, MembershipList* memberships);
 void display_club_stats(ClubStats* stats);
 void free_club_stats(ClubStats* stats);
 
+// Combined statistics, computed with one sweep per list (lists run in parallel)
+typedef struct {
+    SystemStats system;
+    StudentStats students;
+    GradeStats grades;
+    AttendanceStats attendance;
+    ClubStats clubs;
+} StatsBundle;
+
+StatsBundle* calculate_all_stats(StudentList* students, CourseList* courses,
+                                 GradeList* grades, AttendanceList* attendance,
+                                 ClubList* clubs, MembershipList* memberships);
+void free_all_stats(StatsBundle* stats);
+
+// Ranking and bucketing helpers shared by the statistics engines
+void calculate_student_rankings(StudentList* students, int* top_ids, int* bottom_ids, int count);
+void stats_rank_insert(int* ids, float* keys, int* filled, int capacity,
+                       int id, float key, int highest_first);
+int stats_rank_better(float key, int id, float other_key, int other_id, int highest_first);
+int stats_age_bucket(int age);
+int stats_gpa_bucket(float gpa);
+int stats_category_index(const char* category);
+
 // Top performers analysis
 typedef struct {
     int student_id;
@@ -174,12 +198,20 @@ void display_trend_analysis(TrendAnalysis* trends);
 void free_trend_analysis(TrendAnalysis* trends);
 
 // Statistical calculations
+// Mean, standard deviation (population) and Pearson correlation are single
+// pass, block-parallel reductions (see moments.h).
+// calculate_median and calculate_percentile (0-100, linear interpolation) select
+// in O(n) and leave `values` reordered; copy the array first if order matters.
 float calculate_mean(float* values, int count);
 float calculate_median(float* values, int count);
 float calculate_standard_deviation(float* values, int count);
 float calculate_percentile(float* values, int count, float percentile);
 float calculate_correlation(float* x_values, float* y_values, int count);
 
+// Streaming grade distribution (course_id 0 = all courses); merge the
+// sketches of several courses or terms with quantile_sketch_merge
+QuantileSketch* calculate_grade_sketch(GradeList* grades, int course_id);
+
 // Report generation
 int generate_comprehensive_report(SystemStats* sys_stats, StudentStats* student_stats,
                                 GradeStats* grade_stats, AttendanceStats* attendance_stats,
@@ -237,4 +269,12 @@ int is_attendance_poor(float attendance_rate);
 #define ATTENDANCE_ANALYSIS_COUNT 15
 #define CLUB_POPULARITY_COUNT 10
 
+// Histogram buckets
+#define STATS_AGE_BUCKET_START 18   // age_distribution[i]: ages 18+2i and 19+2i, last bucket open
+#define STATS_AGE_BUCKET_WIDTH 2
+#define STATS_CATEGORY_OTHER 9      // clubs_by_category index for unknown categories
+
+// Below this many records in total the fused sweeps run on the calling thread
+#define STATS_PARALLEL_THRESHOLD 10000
+
 #endif // STATS_H
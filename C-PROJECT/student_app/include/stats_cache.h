@@ -0,0 +1,75 @@
+#ifndef STATS_CACHE_H
+#define STATS_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "config.h"
+#include "stats.h"
+#include "counter_map.h"
+#include "change_notify.h"
+
+// Materialized statistics kept up to date from list change events.
+// Counters, histograms and rankings are adjusted per mutation so that
+// reading a snapshot is a fixed-size copy.
+typedef struct {
+    // Lists the cache follows; events from other lists are ignored
+    StudentList* students;
+    CourseList* courses;
+    GradeList* grades;
+    AttendanceList* attendance;
+    ClubList* clubs;
+    MembershipList* memberships;
+
+    StatsBundle current;
+
+    // Student state
+    double age_sum;
+    double gpa_sum;
+    NameCountList student_courses;
+    float top_keys[10];
+    float bottom_keys[10];
+    int top_filled;
+    int bottom_filled;
+    int rankings_dirty;
+
+    // Grade state
+    double grade_points_sum;
+    CounterMap grades_by_student;   // count, sum of grade points
+    CounterMap grades_by_course;    // count, sum of numeric grades
+    int grade_students;             // Students with at least one grade
+    int grade_extremes_dirty;
+
+    // Attendance state
+    CounterMap attendance_by_student;   // counted days, attended days
+    CounterMap attendance_by_day;
+    int attendance_days;
+    int month_total[12];
+    int month_attended[12];
+
+    // Club state
+    CounterMap members_by_club;
+    CounterMap clubs_by_student;
+
+    unsigned long generation;   // Number of changes applied
+    pthread_mutex_t lock;
+} StatsCache;
+
+// Cache management
+StatsCache* stats_cache_create(StudentList* students, CourseList* courses,
+                               GradeList* grades, AttendanceList* attendance,
+                               ClubList* clubs, MembershipList* memberships);
+void stats_cache_destroy(StatsCache* cache);
+int stats_cache_rebuild(StatsCache* cache);
+
+// Reading
+void stats_cache_snapshot(StatsCache* cache, StatsBundle* snapshot);
+unsigned long stats_cache_generation(StatsCache* cache);
+
+// Compare the cached statistics with a full recomputation; 1 when they agree
+int stats_cache_verify(StatsCache* cache);
+
+#define STATS_CACHE_FLOAT_TOLERANCE 0.0005f
+
+#endif // STATS_CACHE_H
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include "config.h"
 
 // Student structure
@@ -23,15 +24,37 @@ typedef struct {
     int is_active;
 } Student;
 
-// Student list structure
+struct Journal;
+
+// Student list structure.
+//
+// Dirty tracking: every mutation bumps `generation`; a save records it in
+// `saved_generation`, so a list whose two counters match is clean and
+// student_list_auto_save does nothing. dirty_bits has one bit per slot of
+// `students` for records that changed since the last save and are not yet
+// anywhere durable: with a journal following the list (journal.h), edits
+// made through the list functions are journaled as they happen, so only
+// records edited in place and reported with student_list_mark_dirty are
+// marked; without one, every changed record is.
+//
+// `lock` (recursive) is held by the list functions that change or save the
+// list, so the autosave thread (autosave.h) never saves a half-made edit.
+// Code that edits records in place holds it too, via student_list_lock.
 typedef struct {
     Student* students;
     int count;
     int capacity;
-    int is_loaded; s          // Flag to track if data is loaded in memory
+    int is_loaded;           // Flag to track if data is loaded in memory
     char filename[256];      // Source filename for encrypted storage
     int auto_save_enabled;   // Flag for automatic saving
     time_t last_save_time;   // Timestamp of last save
+    unsigned long generation;
+    unsigned long saved_generation;
+    unsigned long* dirty_bits;
+    int dirty_slots;         // Bits allocated in dirty_bits
+    int dirty_count;         // Bits set
+    struct Journal* journal; // Set while a journal follows the list
+    pthread_mutex_t lock;
 } StudentList;
 
 // Function declarations
@@ -39,6 +62,7 @@ StudentList* student_list_create(void);
 void student_list_destroy(StudentList* list);
 int student_list_add(StudentList* list, Student student);
 int student_list_remove(StudentList* list, int student_id);
+int student_list_update(StudentList* list, Student student);
 Student* student_list_find_by_id(StudentList* list, int student_id);
 Student* student_list_find_by_name(StudentList* list, const char* first_name, const char* last_name);
 Student* student_list_find_by_email(StudentList* list, const char* email);
@@ -52,6 +76,13 @@ void student_list_sort_by_gpa(StudentList* list);
 int student_list_get_count(StudentList* list);
 Student* student_list_get_student(StudentList* list, int index);
 
+// Filtered scans: the predicate runs inside the scan, so callers walk the
+// matching records in place instead of filtering a copy. Start with
+// *cursor = 0 and call until NULL; a NULL predicate matches every record.
+typedef int (*StudentPredicate)(const Student* student, const void* context);
+Student* student_list_next_where(StudentList* list, int* cursor, StudentPredicate where, const void* context);
+int student_list_count_where(StudentList* list, StudentPredicate where, const void* context);
+
 // File management functions for encrypted storage
 int student_list_ensure_loaded(StudentList* list);
 int student_list_save_and_unload(StudentList* list);
@@ -59,6 +90,14 @@ int student_list_auto_save(StudentList* list);
 int student_list_is_loaded(StudentList* list);
 void student_list_set_filename(StudentList* list, const char* filename);
 
+// Dirty tracking
+void student_list_lock(StudentList* list);
+void student_list_unlock(StudentList* list);
+// Reports a record edited in place through a pointer from the list
+int student_list_mark_dirty(StudentList* list, int student_id);
+int student_list_is_dirty(StudentList* list);
+unsigned long student_list_get_generation(StudentList* list);
+
 // Student validation functions
 int student_validate_email(const char* email);
 int student_validate_phone(const char* phone);
@@ -0,0 +1,53 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+
+// Returns > 0 when a ranks ahead of b, < 0 when behind, 0 when equal.
+// Use a total order (e.g. break ties on id) so results are deterministic.
+typedef int (*TopKCompare)(const void* a, const void* b);
+
+// Builds the ranked item for one input element; returns 0 to skip the element
+typedef int (*TopKProject)(const void* element, void* item, void* user_data);
+
+// Bounded heap keeping the k best items seen; the worst kept item is at the root
+typedef struct {
+    unsigned char* items;
+    unsigned char* scratch;
+    size_t item_size;
+    int k;
+    int count;
+    TopKCompare compare;
+} TopK;
+
+// Heap management
+TopK* topk_create(int k, size_t item_size, TopKCompare compare);
+void topk_destroy(TopK* topk);
+void topk_reset(TopK* topk);
+
+// O(log k) per offered item
+int topk_offer(TopK* topk, const void* item);
+int topk_merge(TopK* into, const TopK* from);
+const void* topk_worst(const TopK* topk);
+int topk_count(const TopK* topk);
+
+// Copy the kept items to out, best first; returns the number written and empties the heap
+int topk_finish(TopK* topk, void* out);
+
+// Select the k best items of an array in O(n log k). With threads > 1 each
+// thread fills its own heap over a slice and the heaps are merged.
+int topk_select(const void* base, int count, size_t element_size,
+                TopKProject project, void* user_data,
+                int k, size_t item_size, TopKCompare compare,
+                void* out, int threads);
+
+// Benchmark: top-k of n students by GPA against sorting the whole array
+void topk_benchmark(int student_count, int k, int threads);
+
+#define TOPK_MAX_THREADS 64
+#define TOPK_PARALLEL_THRESHOLD 100000   // Smaller inputs are selected on one thread
+
+#endif // TOPK_H
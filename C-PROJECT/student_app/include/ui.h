@@ -12,6 +12,7 @@
 #include "attendance.h"
 #include "club.h"
 #include "stats.h"
+#include "stats_cache.h"
 
 // UI window types
 typedef enum {
@@ -39,6 +40,8 @@ typedef struct {
     ClubList* clubs;
     MembershipList* memberships;
     CourseList* courses;
+    StatsCache* stats_cache;       // Materialized statistics, NULL to recompute on refresh
+    StatsBundle* dashboard_stats;  // Latest statistics shown by the statistics window
     UIWindowType current_window_type;
     int is_dark_theme;
     char current_language[10];
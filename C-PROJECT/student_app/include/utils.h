@@ -101,6 +101,30 @@ int utils_file_get_directory(const char* path, char* directory, size_t size);
 char* utils_file_read_all(const char* filename);
 int utils_file_write_all(const char* filename, const char* content);
 int utils_file_append(const char* filename, const char* content);
+int utils_file_remove_tree(const char* path);
+
+// Atomic saves: write through the stream from utils_file_open_atomic, then
+// utils_file_commit_atomic renames it over the target, so readers and
+// backup snapshots only ever see a whole old or whole new file, and a
+// crash after the commit returns cannot bring the old one back (the
+// directory is synced too). Commits wait while a snapshot holds
+// utils_file_snapshot_lock.
+FILE* utils_file_open_atomic(const char* filename, char* temp_path, size_t temp_size);
+int utils_file_commit_atomic(FILE* file, const char* temp_path, const char* filename);
+void utils_file_abort_atomic(FILE* file, const char* temp_path);
+int utils_file_sync_directory(const char* filename);
+void utils_file_snapshot_lock(void);
+void utils_file_snapshot_unlock(void);
+
+// Files written in place (the journal, the log) are registered so a
+// snapshot copies them instead of linking them; each append holds
+// utils_file_append_begin/end so the copy falls between whole writes.
+#define UTILS_MAX_APPENDED_FILES 16
+int utils_file_register_appended(const char* filename);
+void utils_file_unregister_appended(const char* filename);
+int utils_file_is_appended(const char* filename);
+void utils_file_append_begin(void);
+void utils_file_append_end(void);
 
 // Memory utilities
 void* utils_memory_allocate(size_t size);
@@ -0,0 +1,283 @@
+#include "attendance.h"
+#include "config.h"
+#include "calendar.h"
+#include "change_notify.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+AttendanceList* attendance_list_create(void) {
+    AttendanceList* list = (AttendanceList*)malloc(sizeof(AttendanceList));
+    if (list == NULL) {
+        printf("Error: Failed to create attendance list\n");
+        return NULL;
+    }
+    list->capacity = 16;
+    list->count = 0;
+    list->records = (AttendanceRecord*)malloc(sizeof(AttendanceRecord) * list->capacity);
+    if (list->records == NULL) {
+        printf("Error: Failed to allocate memory for attendance records\n");
+        free(list);
+        return NULL;
+    }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&list->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return list;
+}
+
+void attendance_list_destroy(AttendanceList* list) {
+    if (list == NULL) {
+        return;
+    }
+    if (list->records != NULL) {
+        free(list->records);
+    }
+    pthread_mutex_destroy(&list->lock);
+    free(list);
+}
+
+void attendance_list_lock(AttendanceList* list) {
+    if (list != NULL) {
+        pthread_mutex_lock(&list->lock);
+    }
+}
+
+void attendance_list_unlock(AttendanceList* list) {
+    if (list != NULL) {
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+static int attendance_list_add_locked(AttendanceList* list, AttendanceRecord record) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return 0;
+    }
+
+    if (list->count >= list->capacity) {
+        int new_capacity = list->capacity * 2;
+        AttendanceRecord* new_records = (AttendanceRecord*)realloc(list->records, sizeof(AttendanceRecord) * new_capacity);
+        if (new_records == NULL) {
+            printf("Error: Unable to allocate more memory for attendance records\n");
+            return 0;
+        }
+        list->records = new_records;
+        list->capacity = new_capacity;
+    }
+
+    list->records[list->count++] = record;
+    change_notify_publish(ENTITY_ATTENDANCE, CHANGE_ADD, list, NULL, &list->records[list->count - 1]);
+    return 1;
+}
+
+int attendance_list_add(AttendanceList* list, AttendanceRecord record) {
+    attendance_list_lock(list);
+    int ok = attendance_list_add_locked(list, record);
+    attendance_list_unlock(list);
+    return ok;
+}
+
+static int attendance_list_remove_locked(AttendanceList* list, int record_id) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->records[i].id == record_id) {
+            AttendanceRecord removed = list->records[i];
+            for (int j = i; j < list->count - 1; j++) {
+                list->records[j] = list->records[j + 1];
+            }
+            list->count--;
+            change_notify_publish(ENTITY_ATTENDANCE, CHANGE_REMOVE, list, &removed, NULL);
+            return 1;
+        }
+    }
+
+    printf("Error: Attendance record with ID %d not found\n", record_id);
+    return 0;
+}
+
+int attendance_list_remove(AttendanceList* list, int record_id) {
+    attendance_list_lock(list);
+    int ok = attendance_list_remove_locked(list, record_id);
+    attendance_list_unlock(list);
+    return ok;
+}
+
+static int attendance_list_update_locked(AttendanceList* list, AttendanceRecord record) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->records[i].id == record.id) {
+            AttendanceRecord previous = list->records[i];
+            list->records[i] = record;
+            change_notify_publish(ENTITY_ATTENDANCE, CHANGE_EDIT, list, &previous, &list->records[i]);
+            return 1;
+        }
+    }
+
+    printf("Error: Attendance record with ID %d not found\n", record.id);
+    return 0;
+}
+
+int attendance_list_update(AttendanceList* list, AttendanceRecord record) {
+    attendance_list_lock(list);
+    int ok = attendance_list_update_locked(list, record);
+    attendance_list_unlock(list);
+    return ok;
+}
+
+AttendanceRecord* attendance_list_find_by_id(AttendanceList* list, int record_id) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return NULL;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->records[i].id == record_id) {
+            return &list->records[i];
+        }
+    }
+    return NULL;
+}
+
+AttendanceRecord* attendance_list_find_by_student_date(AttendanceList* list, int student_id, time_t date) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return NULL;
+    }
+
+    // Records match on the school day, not on the exact timestamp
+    long day_number = calendar_day_number(date);
+    for (int i = 0; i < list->count; i++) {
+        if (list->records[i].student_id == student_id &&
+            calendar_day_number(list->records[i].date) == day_number) {
+            return &list->records[i];
+        }
+    }
+    return NULL;
+}
+
+AttendanceRecord* attendance_list_find_by_course_date(AttendanceList* list, int course_id, time_t date) {
+    if (list == NULL || list->records == NULL) {
+        printf("Error: Invalid attendance list\n");
+        return NULL;
+    }
+
+    long day_number = calendar_day_number(date);
+    for (int i = 0; i < list->count; i++) {
+        if (list->records[i].course_id == course_id &&
+            calendar_day_number(list->records[i].date) == day_number) {
+            return &list->records[i];
+        }
+    }
+    return NULL;
+}
+
+AttendanceRecord* attendance_list_next_where(AttendanceList* list, int* cursor, AttendancePredicate where,
+                                             const void* context) {
+    if (list == NULL || list->records == NULL || cursor == NULL) {
+        return NULL;
+    }
+    while (*cursor >= 0 && *cursor < list->count) {
+        AttendanceRecord* record = &list->records[(*cursor)++];
+        if (where == NULL || where(record, context)) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+// Date Validation: attendance can only be taken on a past or current school day
+int attendance_validate_date(time_t date) {
+    if (date <= 0) {
+        printf("Invalid date\n");
+        return 0;
+    }
+    if (calendar_day_number(date) > calendar_day_number(time(NULL))) {
+        printf("Attendance cannot be recorded for a future date\n");
+        return 0;
+    }
+    if (!calendar_is_school_day(date)) {
+        printf("Attendance can only be recorded on a school day\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int update_attendance_locked(AttendanceList* list, int record_id, int new_status, const char* reason) {
+    AttendanceRecord* record = attendance_list_find_by_id(list, record_id);
+    if (record == NULL) {
+        printf("Error: Attendance record with ID %d not found\n", record_id);
+        return 0;
+    }
+    if (new_status < ATTENDANCE_ABSENT || new_status > ATTENDANCE_EXCUSED) {
+        printf("Error: Invalid attendance status %d\n", new_status);
+        return 0;
+    }
+
+    AttendanceRecord previous = *record;
+    record->status = new_status;
+    if (reason != NULL) {
+        strncpy(record->reason, reason, sizeof(record->reason) - 1);
+        record->reason[sizeof(record->reason) - 1] = '\0';
+    }
+    record->recorded_time = time(NULL);
+    change_notify_publish(ENTITY_ATTENDANCE, CHANGE_EDIT, list, &previous, record);
+    return 1;
+}
+
+int update_attendance(AttendanceList* list, int record_id, int new_status, const char* reason) {
+    attendance_list_lock(list);
+    int ok = update_attendance_locked(list, record_id, new_status, reason);
+    attendance_list_unlock(list);
+    return ok;
+}
+
+int excuse_absence(AttendanceList* list, int record_id, const char* reason) {
+    return update_attendance(list, record_id, ATTENDANCE_EXCUSED, reason);
+}
+
+time_t get_today_date(void) {
+    return calendar_day_start(calendar_day_number(time(NULL)));
+}
+
+// Next school day (today included) falling on the given weekday, 0=Sunday
+time_t get_class_date(int course_id, int day_of_week) {
+    (void)course_id;
+    if (day_of_week < 0 || day_of_week > 6) {
+        printf("Error: Invalid day of week %d\n", day_of_week);
+        return 0;
+    }
+
+    long today = calendar_day_number(time(NULL));
+    // Look ahead one full year so long holiday periods are skipped
+    for (long day = today; day < today + 366; day++) {
+        int flags = calendar_day_flags_by_number(day);
+        if ((flags & CALENDAR_WEEKDAY_MASK) == day_of_week && (flags & CALENDAR_FLAG_SCHOOL_DAY)) {
+            return calendar_day_start(day);
+        }
+    }
+    return 0;
+}
+
+int is_weekend(time_t date) {
+    return calendar_is_weekend(date);
+}
+
+int is_holiday(time_t date) {
+    return calendar_is_holiday(date);
+}
+
+int get_days_between_dates(time_t start_date, time_t end_date) {
+    return calendar_days_between(start_date, end_date);
+}
@@ -0,0 +1,277 @@
+#include "autosave.h"
+#include "log.h"
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+typedef struct {
+    StudentList* list;
+    unsigned long seen_generation;
+    int pending;                    // Edits seen since the last save
+    long long first_change_ms;
+    long long last_change_ms;
+} AutosaveWatch;
+
+// Autosave state, all guarded by autosave_lock. Saves run with it held,
+// so autosave_unwatch cannot return while its list is being saved.
+static pthread_mutex_t autosave_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t autosave_wake;
+static pthread_t autosave_thread;
+static int autosave_started = 0;
+static int autosave_stop_requested = 0;
+static AutosaveConfig autosave_config;
+static AutosaveWatch autosave_watches[AUTOSAVE_MAX_LISTS];
+static int autosave_watch_count = 0;
+static AutosaveMetrics autosave_metrics;
+
+static long long autosave_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void autosave_config_default(AutosaveConfig* config) {
+    if (config == NULL) {
+        return;
+    }
+    config->quiet_ms = AUTOSAVE_DEFAULT_QUIET_MS;
+    config->max_delay_ms = AUTOSAVE_DEFAULT_MAX_DELAY_MS;
+}
+
+// ---- Watched lists ----
+
+static int autosave_find(const StudentList* list) {
+    for (int i = 0; i < autosave_watch_count; i++) {
+        if (autosave_watches[i].list == list) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int autosave_watch(StudentList* list) {
+    if (list == NULL) {
+        printf("Error: Invalid student list (NULL pointer)\n");
+        return 0;
+    }
+    pthread_mutex_lock(&autosave_lock);
+    if (autosave_find(list) >= 0) {
+        pthread_mutex_unlock(&autosave_lock);
+        return 1;
+    }
+    if (autosave_watch_count == AUTOSAVE_MAX_LISTS) {
+        pthread_mutex_unlock(&autosave_lock);
+        printf("Error: Autosave already watches %d lists\n", AUTOSAVE_MAX_LISTS);
+        return 0;
+    }
+    AutosaveWatch* watch = &autosave_watches[autosave_watch_count++];
+    memset(watch, 0, sizeof(*watch));
+    watch->list = list;
+    // Edits made before watching are picked up on the first tick
+    watch->seen_generation = list->saved_generation;
+    autosave_metrics.lists = autosave_watch_count;
+    pthread_mutex_unlock(&autosave_lock);
+    return 1;
+}
+
+int autosave_unwatch(StudentList* list) {
+    pthread_mutex_lock(&autosave_lock);
+    int index = autosave_find(list);
+    if (index >= 0) {
+        autosave_watches[index] = autosave_watches[--autosave_watch_count];
+        autosave_metrics.lists = autosave_watch_count;
+    }
+    pthread_mutex_unlock(&autosave_lock);
+    return index >= 0;
+}
+
+// ---- Thread ----
+
+// Called with autosave_lock held
+static void autosave_save(AutosaveWatch* watch, int forced) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ok = student_list_auto_save(watch->list);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // A list with auto-save disabled or not loaded stays dirty; wait for
+    // the next edit instead of retrying every tick
+    watch->pending = 0;
+    if (!ok && student_list_is_dirty(watch->list)) {
+        autosave_metrics.failures++;
+        LOG_WARNING(LOG_MODULE_ID_STUDENT, "Autosave of %s did not complete", watch->list->filename);
+        return;
+    }
+    autosave_metrics.saves++;
+    autosave_metrics.forced += forced != 0;
+    autosave_metrics.last_save_ms =
+        (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6;
+    autosave_metrics.last_save = time(NULL);
+}
+
+// Notes new edits and saves the lists whose burst is over; returns the
+// number of lists still pending
+static int autosave_tick(long long now) {
+    int pending = 0;
+    for (int i = 0; i < autosave_watch_count; i++) {
+        AutosaveWatch* watch = &autosave_watches[i];
+        unsigned long generation = student_list_get_generation(watch->list);
+        if (generation != watch->seen_generation) {
+            autosave_metrics.edits += generation - watch->seen_generation;
+            watch->seen_generation = generation;
+            watch->last_change_ms = now;
+            if (!watch->pending) {
+                watch->first_change_ms = now;
+                watch->pending = 1;
+            }
+        }
+        if (!watch->pending) {
+            continue;
+        }
+        int quiet = now - watch->last_change_ms >= autosave_config.quiet_ms;
+        int overdue = now - watch->first_change_ms >= autosave_config.max_delay_ms;
+        if (quiet || overdue) {
+            autosave_save(watch, !quiet);
+        }
+        pending += watch->pending;
+    }
+    autosave_metrics.pending = pending;
+    return pending;
+}
+
+static void* autosave_thread_main(void* arg) {
+    (void)arg;
+    // Sample often enough to see the end of a burst within a fraction of
+    // quiet_ms
+    int tick_ms = autosave_config.quiet_ms / 4;
+    if (tick_ms < AUTOSAVE_MIN_TICK_MS) tick_ms = AUTOSAVE_MIN_TICK_MS;
+    if (tick_ms > AUTOSAVE_MAX_TICK_MS) tick_ms = AUTOSAVE_MAX_TICK_MS;
+
+    pthread_mutex_lock(&autosave_lock);
+    while (!autosave_stop_requested) {
+        autosave_tick(autosave_now_ms());
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += tick_ms / 1000;
+        deadline.tv_nsec += (long)(tick_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!autosave_stop_requested &&
+               pthread_cond_timedwait(&autosave_wake, &autosave_lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+
+    // Final save of everything still pending or changed since the last tick
+    for (int i = 0; i < autosave_watch_count; i++) {
+        AutosaveWatch* watch = &autosave_watches[i];
+        unsigned long generation = student_list_get_generation(watch->list);
+        autosave_metrics.edits += generation - watch->seen_generation;
+        watch->seen_generation = generation;
+        if (watch->pending || student_list_is_dirty(watch->list)) {
+            autosave_save(watch, 0);
+        }
+    }
+    autosave_metrics.pending = 0;
+    pthread_mutex_unlock(&autosave_lock);
+    return NULL;
+}
+
+int autosave_start(const AutosaveConfig* config) {
+    AutosaveConfig defaults;
+    autosave_config_default(&defaults);
+    if (config == NULL) {
+        config = &defaults;
+    }
+    if (config->quiet_ms <= 0 || config->max_delay_ms < config->quiet_ms) {
+        printf("Error: Invalid autosave delays (quiet %d ms, max %d ms)\n", config->quiet_ms, config->max_delay_ms);
+        return 0;
+    }
+    pthread_mutex_lock(&autosave_lock);
+    if (autosave_started) {
+        pthread_mutex_unlock(&autosave_lock);
+        printf("Error: Autosave is already running\n");
+        return 0;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&autosave_wake, &attr);
+    pthread_condattr_destroy(&attr);
+    autosave_config = *config;
+    autosave_stop_requested = 0;
+    if (pthread_create(&autosave_thread, NULL, autosave_thread_main, NULL) != 0) {
+        pthread_cond_destroy(&autosave_wake);
+        pthread_mutex_unlock(&autosave_lock);
+        printf("Error: Failed to start autosave\n");
+        return 0;
+    }
+    autosave_started = 1;
+    autosave_metrics.running = 1;
+    pthread_mutex_unlock(&autosave_lock);
+    LOG_INFO(LOG_MODULE_ID_STUDENT, "Autosave started (quiet %d ms, max delay %d ms)",
+             config->quiet_ms, config->max_delay_ms);
+    return 1;
+}
+
+int autosave_stop(void) {
+    pthread_mutex_lock(&autosave_lock);
+    if (!autosave_started) {
+        pthread_mutex_unlock(&autosave_lock);
+        return 0;
+    }
+    autosave_stop_requested = 1;
+    pthread_cond_signal(&autosave_wake);
+    pthread_mutex_unlock(&autosave_lock);
+    pthread_join(autosave_thread, NULL);
+
+    pthread_mutex_lock(&autosave_lock);
+    pthread_cond_destroy(&autosave_wake);
+    autosave_started = 0;
+    autosave_stop_requested = 0;
+    autosave_metrics.running = 0;
+    pthread_mutex_unlock(&autosave_lock);
+    return 1;
+}
+
+int is_autosave_running(void) {
+    pthread_mutex_lock(&autosave_lock);
+    int running = autosave_started;
+    pthread_mutex_unlock(&autosave_lock);
+    return running;
+}
+
+// ---- Metrics ----
+
+int autosave_get_metrics(AutosaveMetrics* metrics) {
+    if (metrics == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&autosave_lock);
+    *metrics = autosave_metrics;
+    pthread_mutex_unlock(&autosave_lock);
+    return 1;
+}
+
+void display_autosave_status(void) {
+    AutosaveMetrics m;
+    autosave_get_metrics(&m);
+    char when[32] = "-";
+    if (m.last_save != 0) {
+        struct tm tm;
+        localtime_r(&m.last_save, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+
+    printf("\n=== AUTOSAVE ===\n");
+    printf("Autosave:         %s, %d lists watched, %d pending\n", m.running ? "running" : "stopped",
+           m.lists, m.pending);
+    printf("Edits seen:       %llu\n", m.edits);
+    printf("Saves:            %llu (%llu forced by the max delay, %llu failed)\n", m.saves, m.forced, m.failures);
+    if (m.saves > 0) {
+        printf("Edits per save:   %.1f\n", (double)m.edits / (double)m.saves);
+        printf("Last save:        %s, %.2f ms\n", when, m.last_save_ms);
+    }
+}
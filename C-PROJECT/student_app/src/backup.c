@@ -0,0 +1,527 @@
+#define _GNU_SOURCE     // O_DIRECT
+#include "backup.h"
+#include "chunk_store.h"
+#include "backup_pipeline.h"
+#include "backup_verify.h"
+#include "crypto.h"
+#include "log.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define BACKUP_READ_SIZE (1024 * 1024)
+#define BACKUP_IO_ALIGN 4096
+// Uncut bytes (under CHUNK_MAX_SIZE) plus alignment padding plus one read
+#define BACKUP_BUFFER_SIZE (BACKUP_IO_ALIGN + CHUNK_MAX_SIZE + BACKUP_READ_SIZE)
+
+// State shared by one backup run
+typedef struct {
+    ChunkStore* store;
+    BackupPipeline* pipeline;
+    BackupManifest* previous;       // Latest manifest, for incremental runs
+    BackupStats* stats;
+    const BackupOptions* options;
+    struct timespec started;        // For the read rate limit
+    char skip_path[PATH_MAX];       // The backup directory, when inside the source
+    unsigned char* buffer;
+} BackupRun;
+
+static void backup_manifest_path(const char* backup_dir, const char* backup_name, char* path, size_t size) {
+    snprintf(path, size, "%s/%s%s", backup_dir, backup_name, MANIFEST_EXTENSION);
+}
+
+// A file whose size and mtime match the previous backup keeps its chunk
+// list without being read, as long as its chunks are all still stored
+static const ManifestFile* backup_reusable_file(BackupRun* run, const char* path, const struct stat* st) {
+    const ManifestFile* old = backup_manifest_find_file(run->previous, path);
+    if (old == NULL || old->size != (long long)st->st_size || old->mtime != (long long)st->st_mtime) {
+        return NULL;
+    }
+    for (int i = 0; i < old->chunk_count; i++) {
+        if (!chunk_store_contains(run->store, &old->chunks[i])) {
+            return NULL;
+        }
+    }
+    return old;
+}
+
+// Sleeps until the bytes read so far fit under the configured rate
+static void backup_throttle(BackupRun* run) {
+    if (run->options->max_read_rate <= 0) {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (double)(now.tv_sec - run->started.tv_sec) + (double)(now.tv_nsec - run->started.tv_nsec) / 1e9;
+    double due = (double)run->stats->bytes_read / (double)run->options->max_read_rate;
+    if (due > elapsed) {
+        double wait = due - elapsed;
+        struct timespec pause = { (time_t)wait, (long)((wait - (double)(time_t)wait) * 1e9) };
+        nanosleep(&pause, NULL);
+    }
+}
+
+// O_DIRECT reads must start at aligned offsets; when one is refused the
+// file falls back to buffered reads, advised as sequential
+static ssize_t backup_read(int fd, unsigned char* buffer, size_t size, int* direct) {
+    for (;;) {
+        ssize_t got = read(fd, buffer, size);
+        if (got >= 0 || errno != EINVAL || !*direct) {
+            return got;
+        }
+        *direct = 0;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+// Reads the file once and hands its chunks to the pipeline in order
+static BackupResult backup_chunk_file(BackupRun* run, const char* source_path) {
+    int direct = run->options->direct_io;
+    int fd = open(source_path, O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fd < 0 && direct && errno == EINVAL) {
+        // Filesystems such as tmpfs do not support O_DIRECT
+        direct = 0;
+        fd = open(source_path, O_RDONLY);
+    }
+    if (fd < 0) {
+        printf("Error: Cannot read %s\n", source_path);
+        return errno == EACCES ? BACKUP_ERROR_PERMISSION : BACKUP_ERROR_COPY_FILE;
+    }
+    if (!direct) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // Uncut bytes are kept just below an aligned offset, so every read
+    // lands on an aligned address
+    int start = 0, have = 0, eof = 0;
+    BackupResult result = BACKUP_SUCCESS;
+    while (result == BACKUP_SUCCESS) {
+        if (!eof) {
+            ssize_t got = backup_read(fd, run->buffer + start + have, BACKUP_READ_SIZE, &direct);
+            if (got < 0) {
+                printf("Error: Cannot read %s\n", source_path);
+                result = BACKUP_ERROR_COPY_FILE;
+                break;
+            }
+            eof = got == 0;
+            have += (int)got;
+            run->stats->bytes_read += got;
+            backup_throttle(run);
+            if (run->options->progress != NULL &&
+                !run->options->progress(run->stats->files, run->stats->bytes_read, run->options->progress_data)) {
+                printf("Error: Backup cancelled\n");
+                result = BACKUP_ERROR_COPY_FILE;
+                break;
+            }
+        }
+
+        int pos = 0;
+        for (;;) {
+            int length = chunk_next_boundary(run->buffer + start + pos, have - pos, eof);
+            if (length == 0) {
+                break;
+            }
+            if (!backup_pipeline_add_chunk(run->pipeline, run->buffer + start + pos, length)) {
+                result = BACKUP_ERROR_COPY_FILE;    // The pipeline holds the actual error
+                break;
+            }
+            pos += length;
+        }
+        if (eof) {
+            break;
+        }
+        int left = have - pos;
+        int pad = (BACKUP_IO_ALIGN - left % BACKUP_IO_ALIGN) % BACKUP_IO_ALIGN;
+        memmove(run->buffer + pad, run->buffer + start + pos, (size_t)left);
+        start = pad;
+        have = left;
+    }
+    close(fd);
+    return result;
+}
+
+static BackupResult backup_walk(BackupRun* run, const char* source_dir, const char* relative) {
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "%s%s%s", source_dir, relative[0] != '\0' ? "/" : "", relative);
+    DIR* dir = opendir(dir_path);
+    if (dir == NULL) {
+        printf("Error: Cannot open %s\n", dir_path);
+        return errno == EACCES ? BACKUP_ERROR_PERMISSION : BACKUP_ERROR_INVALID_PATH;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    struct dirent* item;
+    char path[PATH_MAX];
+    char child[MAX_BACKUP_PATH_LENGTH];
+    while (result == BACKUP_SUCCESS && (item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(child, sizeof(child), "%s%s%s", relative, relative[0] != '\0' ? "/" : "", item->d_name) >= (int)sizeof(child) ||
+            strchr(item->d_name, '\n') != NULL) {
+            printf("Warning: Skipping %s/%s\n", dir_path, item->d_name);
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", source_dir, child);
+
+        struct stat st;
+        if (lstat(path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            char resolved[PATH_MAX];
+            if (run->skip_path[0] != '\0' && realpath(path, resolved) != NULL && strcmp(resolved, run->skip_path) == 0) {
+                continue;
+            }
+            result = backup_walk(run, source_dir, child);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        const ManifestFile* reuse = run->previous != NULL ? backup_reusable_file(run, child, &st) : NULL;
+        run->stats->files++;
+        if (!backup_pipeline_begin_file(run->pipeline, child, (long long)st.st_size, (long long)st.st_mtime,
+                                        (unsigned int)(st.st_mode & 07777), reuse)) {
+            result = BACKUP_ERROR_COPY_FILE;
+        } else if (reuse != NULL) {
+            run->stats->files_reused++;
+        } else {
+            result = backup_chunk_file(run, path);
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+void backup_options_init(BackupOptions* options) {
+    if (options == NULL) {
+        return;
+    }
+    memset(options, 0, sizeof(BackupOptions));
+    options->compress = 1;
+}
+
+BackupResult create_chunked_backup(const char* backup_name, const char* source_dir, const char* backup_dir,
+                                   const BackupOptions* options, BackupStats* stats) {
+    if (backup_name == NULL || source_dir == NULL || backup_dir == NULL || backup_name[0] == '\0' ||
+        strchr(backup_name, '/') != NULL || strlen(backup_name) >= MAX_BACKUP_NAME_LENGTH) {
+        printf("Error: Invalid backup arguments\n");
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    BackupOptions defaults;
+    if (options == NULL) {
+        backup_options_init(&defaults);
+        options = &defaults;
+    }
+
+    BackupStats local;
+    if (stats == NULL) stats = &local;
+    memset(stats, 0, sizeof(BackupStats));
+
+    BackupRun run;
+    memset(&run, 0, sizeof(run));
+    run.stats = stats;
+    run.options = options;
+    clock_gettime(CLOCK_MONOTONIC, &run.started);
+    run.store = chunk_store_open(backup_dir);
+    if (run.store == NULL) {
+        return BACKUP_ERROR_CREATE_DIR;
+    }
+    chunk_store_set_options(run.store, options->compress, options->encrypt ? options->key : NULL);
+    if (realpath(backup_dir, run.skip_path) == NULL) {
+        run.skip_path[0] = '\0';
+    }
+    BackupManifest* manifest = backup_manifest_create(backup_name,
+                                                      options->incremental ? BACKUP_TYPE_INCREMENTAL : BACKUP_TYPE_FULL);
+    if (manifest != NULL) {
+        manifest->compressed = options->compress != 0;
+        manifest->encrypted = options->encrypt != 0;
+        if (!chunk_store_key_id(run.store, manifest->key_id)) {
+            backup_manifest_destroy(manifest);
+            manifest = NULL;
+        }
+    }
+    run.previous = options->incremental && manifest != NULL ? backup_manifest_load_latest(backup_dir) : NULL;
+    // Chunk addresses differ between plain and keyed stores and between
+    // keys, so chunk lists only carry over between backups made the same
+    // way; an encrypted manifest without a key id is never reused
+    if (run.previous != NULL && (run.previous->encrypted != (options->encrypt != 0) ||
+                                 strcmp(run.previous->key_id, manifest->key_id) != 0)) {
+        backup_manifest_destroy(run.previous);
+        run.previous = NULL;
+    }
+    if (posix_memalign((void**)&run.buffer, BACKUP_IO_ALIGN, BACKUP_BUFFER_SIZE) != 0) {
+        run.buffer = NULL;
+    }
+    run.pipeline = manifest != NULL ? backup_pipeline_create(run.store, manifest, stats, options->threads) : NULL;
+
+    BackupResult result = BACKUP_ERROR_COPY_FILE;
+    if (run.pipeline != NULL && run.buffer != NULL) {
+        result = backup_walk(&run, source_dir, "");
+        BackupResult pipeline_result = backup_pipeline_finish(run.pipeline);
+        if (pipeline_result != BACKUP_SUCCESS) {
+            result = pipeline_result;
+        }
+    }
+    // Every chunk the manifest names is durable before the manifest is
+    if (result == BACKUP_SUCCESS && !chunk_store_sync(run.store)) {
+        result = BACKUP_ERROR_COPY_FILE;
+    }
+    if (result == BACKUP_SUCCESS) {
+        char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH];
+        // The tree goes first so a saved manifest always has one
+        MerkleTree* tree = merkle_tree_from_manifest(manifest);
+        snprintf(path, sizeof(path), "%s/%s%s", backup_dir, backup_name, MERKLE_EXTENSION);
+        if (tree == NULL || !merkle_tree_save(tree, path)) {
+            result = BACKUP_ERROR_COPY_FILE;
+        }
+        merkle_tree_destroy(tree);
+        backup_manifest_path(backup_dir, backup_name, path, sizeof(path));
+        if (result == BACKUP_SUCCESS && !backup_manifest_save(manifest, path)) {
+            result = BACKUP_ERROR_COPY_FILE;
+        }
+    }
+
+    if (result == BACKUP_SUCCESS) {
+        log_backup_created(backup_name);
+    }
+    backup_pipeline_destroy(run.pipeline);
+    free(run.buffer);
+    backup_manifest_destroy(run.previous);
+    backup_manifest_destroy(manifest);
+    chunk_store_close(run.store);
+    return result;
+}
+
+BackupResult create_full_backup(const char* backup_name, const char* source_dir, const char* backup_dir) {
+    return create_chunked_backup(backup_name, source_dir, backup_dir, NULL, NULL);
+}
+
+BackupResult create_incremental_backup(const char* backup_name, const char* source_dir, const char* backup_dir) {
+    BackupOptions options;
+    backup_options_init(&options);
+    options.incremental = 1;
+    return create_chunked_backup(backup_name, source_dir, backup_dir, &options, NULL);
+}
+
+// ---- Restore ----
+
+static int backup_make_parents(const char* path) {
+    char buffer[PATH_MAX];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char* p = buffer + 1; *p != '\0'; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buffer, 0700) != 0 && errno != EEXIST) {
+            return 0;
+        }
+        *p = '/';
+    }
+    return 1;
+}
+
+// A manifest path must stay inside the directory it is restored into: it
+// is relative, and no component is empty, "." or ".."
+static int backup_safe_path(const char* path) {
+    const char* part = path;
+    for (;;) {
+        size_t length = strcspn(part, "/");
+        if (length == 0 || (length == 1 && part[0] == '.') || (length == 2 && strncmp(part, "..", 2) == 0)) {
+            return 0;
+        }
+        if (part[length] == '\0') {
+            return 1;
+        }
+        part += length + 1;
+    }
+}
+
+// Rebuilds one file from its chunks into a temporary name, then renames it
+// over the target so a failed restore leaves the old file in place
+static BackupResult backup_restore_entry(ChunkStore* store, const ManifestFile* file, const char* target,
+                                         unsigned char* buffer) {
+    if (!backup_safe_path(file->path)) {
+        printf("Error: Refusing to restore %s outside the restore directory\n", file->path);
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    if (!backup_make_parents(target)) {
+        printf("Error: Cannot create directories for %s\n", target);
+        return BACKUP_ERROR_CREATE_DIR;
+    }
+
+    char temp[PATH_MAX + 16];
+    snprintf(temp, sizeof(temp), "%s.restore", target);
+    FILE* output = fopen(temp, "wb");
+    if (output == NULL) {
+        printf("Error: Cannot write %s\n", temp);
+        return errno == EACCES ? BACKUP_ERROR_PERMISSION : BACKUP_ERROR_COPY_FILE;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    for (int i = 0; i < file->chunk_count && result == BACKUP_SUCCESS; i++) {
+        if (!chunk_store_get(store, &file->chunks[i], buffer)) {
+            result = BACKUP_ERROR_COPY_FILE;
+        } else if (fwrite(buffer, 1, file->chunks[i].length, output) != file->chunks[i].length) {
+            result = errno == ENOSPC ? BACKUP_ERROR_DISK_FULL : BACKUP_ERROR_COPY_FILE;
+        }
+    }
+    if (fclose(output) != 0 && result == BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_COPY_FILE;
+    }
+    if (result != BACKUP_SUCCESS || rename(temp, target) != 0) {
+        remove(temp);
+        return result != BACKUP_SUCCESS ? result : BACKUP_ERROR_COPY_FILE;
+    }
+
+    chmod(target, (mode_t)file->mode);
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = (time_t)file->mtime;
+    times[0].tv_usec = times[1].tv_usec = 0;
+    utimes(target, times);
+    return BACKUP_SUCCESS;
+}
+
+static BackupManifest* backup_load_named(const char* backup_name, const char* backup_dir) {
+    char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH];
+    backup_manifest_path(backup_dir, backup_name, path, sizeof(path));
+    return backup_manifest_load(path);
+}
+
+// Opens the store a manifest was written to, with the key when it is
+// encrypted
+static ChunkStore* backup_open_store(const BackupManifest* manifest, const char* backup_dir, const unsigned char* key) {
+    if (manifest->encrypted && key == NULL) {
+        printf("Error: Backup %s is encrypted; a key is required\n", manifest->name);
+        return NULL;
+    }
+    ChunkStore* store = chunk_store_open(backup_dir);
+    if (store != NULL) {
+        chunk_store_set_options(store, manifest->compressed, manifest->encrypted ? key : NULL);
+    }
+    // Manifests from before key ids carry none; their chunks still fail
+    // authentication under a wrong key
+    char key_id[CHUNK_KEY_ID_SIZE * 2 + 1];
+    if (store != NULL && manifest->key_id[0] != '\0' &&
+        (!chunk_store_key_id(store, key_id) || strcmp(key_id, manifest->key_id) != 0)) {
+        printf("Error: Backup %s was made with a different key\n", manifest->name);
+        chunk_store_close(store);
+        return NULL;
+    }
+    return store;
+}
+
+BackupResult restore_chunked_backup(const char* backup_name, const char* backup_dir, const char* restore_dir,
+                                    const unsigned char* key) {
+    if (backup_name == NULL || backup_dir == NULL || restore_dir == NULL) {
+        printf("Error: Invalid restore arguments\n");
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    BackupManifest* manifest = backup_load_named(backup_name, backup_dir);
+    if (manifest == NULL) {
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    ChunkStore* store = backup_open_store(manifest, backup_dir, key);
+    unsigned char* buffer = (unsigned char*)malloc(CHUNK_MAX_SIZE);
+    BackupResult result = store != NULL && buffer != NULL ? BACKUP_SUCCESS
+                          : manifest->encrypted && key == NULL ? BACKUP_ERROR_ENCRYPT : BACKUP_ERROR_COPY_FILE;
+
+    // Checked for every file before any is written, so a tampered
+    // manifest restores nothing
+    for (int i = 0; i < manifest->file_count && result == BACKUP_SUCCESS; i++) {
+        if (!backup_safe_path(manifest->files[i].path)) {
+            printf("Error: Backup %s names a path outside the restore directory: %s\n", backup_name,
+                   manifest->files[i].path);
+            result = BACKUP_ERROR_INVALID_PATH;
+        }
+    }
+    char target[PATH_MAX];
+    for (int i = 0; i < manifest->file_count && result == BACKUP_SUCCESS; i++) {
+        if (snprintf(target, sizeof(target), "%s/%s", restore_dir, manifest->files[i].path) >= (int)sizeof(target)) {
+            result = BACKUP_ERROR_INVALID_PATH;
+            break;
+        }
+        result = backup_restore_entry(store, &manifest->files[i], target, buffer);
+    }
+
+    if (result == BACKUP_SUCCESS) {
+        log_backup_restored(backup_name);
+    }
+    free(buffer);
+    chunk_store_close(store);
+    backup_manifest_destroy(manifest);
+    return result;
+}
+
+BackupResult restore_backup(const char* backup_name, const char* backup_dir, const char* restore_dir) {
+    return restore_chunked_backup(backup_name, backup_dir, restore_dir, NULL);
+}
+
+BackupResult restore_file_from_backup(const char* backup_name, const char* file_path, const char* backup_dir,
+                                      const char* restore_path) {
+    if (backup_name == NULL || file_path == NULL || backup_dir == NULL || restore_path == NULL) {
+        printf("Error: Invalid restore arguments\n");
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    BackupManifest* manifest = backup_load_named(backup_name, backup_dir);
+    if (manifest == NULL) {
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    ManifestFile* file = backup_manifest_find_file(manifest, file_path);
+    if (file == NULL) {
+        printf("Error: %s is not in backup %s\n", file_path, backup_name);
+        backup_manifest_destroy(manifest);
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+
+    ChunkStore* store = backup_open_store(manifest, backup_dir, NULL);
+    unsigned char* buffer = (unsigned char*)malloc(CHUNK_MAX_SIZE);
+    BackupResult result = store != NULL && buffer != NULL
+                          ? backup_restore_entry(store, file, restore_path, buffer)
+                          : BACKUP_ERROR_COPY_FILE;
+    free(buffer);
+    chunk_store_close(store);
+    backup_manifest_destroy(manifest);
+    return result;
+}
+
+// ---- Utility functions ----
+
+// The manifest checksum covers every file's chunk digests, which the
+// backup computed while storing them, so no extra pass over the data
+int calculate_backup_checksum(const char* backup_path, char* checksum) {
+    if (backup_path == NULL || checksum == NULL) {
+        return 0;
+    }
+    BackupManifest* manifest = backup_manifest_load(backup_path);
+    if (manifest == NULL) {
+        return 0;
+    }
+    int ok = backup_manifest_checksum(manifest, checksum);
+    backup_manifest_destroy(manifest);
+    return ok;
+}
+
+const char* backup_result_to_string(BackupResult result) {
+    switch (result) {
+        case BACKUP_SUCCESS: return "Success";
+        case BACKUP_ERROR_CREATE_DIR: return "Cannot create directory";
+        case BACKUP_ERROR_COPY_FILE: return "File copy failed";
+        case BACKUP_ERROR_COMPRESS: return "Compression failed";
+        case BACKUP_ERROR_ENCRYPT: return "Encryption failed";
+        case BACKUP_ERROR_DISK_FULL: return "Disk full";
+        case BACKUP_ERROR_PERMISSION: return "Permission denied";
+        case BACKUP_ERROR_INVALID_PATH: return "Invalid path";
+        default: return "Unknown error";
+    }
+}
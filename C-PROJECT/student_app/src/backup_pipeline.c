@@ -0,0 +1,347 @@
+#include "backup_pipeline.h"
+#include "utils.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+static PipelineJob* pipeline_job(BackupPipeline* pipeline, long long seq) {
+    return &pipeline->jobs[seq % pipeline->window];
+}
+
+// Keeps the first error; later ones are usually consequences of it
+static void pipeline_fail(BackupPipeline* pipeline, BackupResult error) {
+    if (pipeline->result == BACKUP_SUCCESS) {
+        pipeline->result = error;
+    }
+}
+
+// Hashes a chunk and, unless it is already stored, compresses and
+// encrypts it into the job's blob. Runs on any number of workers.
+static void* pipeline_worker(void* arg) {
+    BackupPipeline* pipeline = (BackupPipeline*)arg;
+    EVP_CIPHER_CTX* ctx = pipeline->store->encrypt ? EVP_CIPHER_CTX_new() : NULL;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;) {
+        while (pipeline->encode_seq == pipeline->submit_seq && !pipeline->finishing) {
+            pthread_cond_wait(&pipeline->job_queued, &pipeline->lock);
+        }
+        if (pipeline->encode_seq == pipeline->submit_seq) {
+            break;
+        }
+        long long seq = pipeline->encode_seq++;
+        PipelineJob* job = pipeline_job(pipeline, seq);
+        job->state = PIPELINE_JOB_ENCODING;
+        int skip = job->is_file || pipeline->result != BACKUP_SUCCESS;
+        pthread_mutex_unlock(&pipeline->lock);
+
+        if (!skip) {
+            if (pipeline->store->encrypt && ctx == NULL) {
+                job->error = BACKUP_ERROR_ENCRYPT;
+            } else if (!chunk_store_address(pipeline->store, job->data, (int)job->ref.length, &job->ref)) {
+                job->error = BACKUP_ERROR_COPY_FILE;
+            } else if (!chunk_store_contains(pipeline->store, &job->ref)) {
+                job->blob_size = chunk_store_encode(pipeline->store, ctx, &job->ref, job->data, job->blob);
+                if (job->blob_size == 0) {
+                    job->error = pipeline->store->encrypt ? BACKUP_ERROR_ENCRYPT : BACKUP_ERROR_COMPRESS;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        job->state = PIPELINE_JOB_READY;
+        if (seq == pipeline->write_seq) {
+            pthread_cond_signal(&pipeline->job_ready);
+        }
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    EVP_CIPHER_CTX_free(ctx);
+    return NULL;
+}
+
+// Applies one finished job to the store and manifest. Only the writer
+// thread runs this, so the manifest needs no lock of its own.
+static BackupResult pipeline_write_job(BackupPipeline* pipeline, PipelineJob* job, ManifestFile** current) {
+    if (job->is_file) {
+        ManifestFile* file = backup_manifest_add_file(pipeline->manifest, job->path);
+        if (file == NULL) {
+            return BACKUP_ERROR_COPY_FILE;
+        }
+        file->size = job->size;
+        file->mtime = job->mtime;
+        file->mode = job->mode;
+        *current = file;
+        if (job->reuse != NULL) {
+            for (int i = 0; i < job->reuse->chunk_count; i++) {
+                if (!manifest_file_add_chunk(file, &job->reuse->chunks[i])) {
+                    return BACKUP_ERROR_COPY_FILE;
+                }
+            }
+            pipeline->stats->chunks += job->reuse->chunk_count;
+        }
+        return BACKUP_SUCCESS;
+    }
+
+    if (job->error != BACKUP_SUCCESS) {
+        return job->error;
+    }
+    if (*current == NULL) {
+        return BACKUP_ERROR_COPY_FILE;
+    }
+    // The same chunk may have been encoded twice within the window; the
+    // first copy written wins
+    if (job->blob_size > 0 && !chunk_store_contains(pipeline->store, &job->ref)) {
+        errno = 0;
+        if (!chunk_store_write_blob(pipeline->store, &job->ref, job->blob, job->blob_size)) {
+            return errno == ENOSPC ? BACKUP_ERROR_DISK_FULL : BACKUP_ERROR_COPY_FILE;
+        }
+        pipeline->stats->new_chunks++;
+        pipeline->stats->new_bytes += job->ref.length;
+        pipeline->stats->stored_bytes += job->blob_size;
+    }
+    if (!manifest_file_add_chunk(*current, &job->ref)) {
+        return BACKUP_ERROR_COPY_FILE;
+    }
+    pipeline->stats->chunks++;
+    return BACKUP_SUCCESS;
+}
+
+static void* pipeline_writer(void* arg) {
+    BackupPipeline* pipeline = (BackupPipeline*)arg;
+    ManifestFile* current = NULL;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;) {
+        while (!(pipeline->write_seq < pipeline->submit_seq &&
+                 pipeline_job(pipeline, pipeline->write_seq)->state == PIPELINE_JOB_READY) &&
+               !(pipeline->finishing && pipeline->write_seq == pipeline->submit_seq)) {
+            pthread_cond_wait(&pipeline->job_ready, &pipeline->lock);
+        }
+        if (pipeline->write_seq == pipeline->submit_seq) {
+            break;
+        }
+        PipelineJob* job = pipeline_job(pipeline, pipeline->write_seq);
+        int failed = pipeline->result != BACKUP_SUCCESS;
+        pthread_mutex_unlock(&pipeline->lock);
+
+        BackupResult result = failed ? BACKUP_SUCCESS : pipeline_write_job(pipeline, job, &current);
+
+        pthread_mutex_lock(&pipeline->lock);
+        if (result != BACKUP_SUCCESS) {
+            pipeline_fail(pipeline, result);
+        }
+        job->state = PIPELINE_JOB_FREE;
+        pipeline->write_seq++;
+        pthread_cond_signal(&pipeline->slot_free);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+BackupPipeline* backup_pipeline_create(ChunkStore* store, BackupManifest* manifest, BackupStats* stats, int threads) {
+    if (store == NULL || manifest == NULL || stats == NULL) {
+        printf("Error: Invalid backup pipeline arguments\n");
+        return NULL;
+    }
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > BACKUP_PIPELINE_MAX_THREADS) {
+        threads = BACKUP_PIPELINE_MAX_THREADS;
+    }
+
+    BackupPipeline* pipeline = (BackupPipeline*)calloc(1, sizeof(BackupPipeline));
+    if (pipeline == NULL) {
+        printf("Error: Failed to create backup pipeline\n");
+        return NULL;
+    }
+    pipeline->store = store;
+    pipeline->manifest = manifest;
+    pipeline->stats = stats;
+    pipeline->result = BACKUP_SUCCESS;
+    // Enough slots to keep every worker busy while the writer catches up
+    pipeline->window = threads * 4 > BACKUP_PIPELINE_MIN_WINDOW ? threads * 4 : BACKUP_PIPELINE_MIN_WINDOW;
+    pipeline->jobs = (PipelineJob*)calloc((size_t)pipeline->window, sizeof(PipelineJob));
+    int ok = pipeline->jobs != NULL;
+    for (int i = 0; ok && i < pipeline->window; i++) {
+        pipeline->jobs[i].data = (unsigned char*)malloc(CHUNK_MAX_SIZE);
+        pipeline->jobs[i].blob = (unsigned char*)malloc(CHUNK_BLOB_BOUND);
+        ok = pipeline->jobs[i].data != NULL && pipeline->jobs[i].blob != NULL;
+    }
+    if (!ok) {
+        printf("Error: Failed to allocate backup pipeline\n");
+        backup_pipeline_destroy(pipeline);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->slot_free, NULL);
+    pthread_cond_init(&pipeline->job_queued, NULL);
+    pthread_cond_init(&pipeline->job_ready, NULL);
+    pipeline->started = 1;
+    if (pthread_create(&pipeline->writer, NULL, pipeline_writer, pipeline) != 0) {
+        printf("Error: Failed to start backup writer\n");
+        pipeline->started = 0;
+        backup_pipeline_destroy(pipeline);
+        return NULL;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pipeline->workers[i], NULL, pipeline_worker, pipeline) != 0) {
+            break;
+        }
+        pipeline->worker_count++;
+    }
+    if (pipeline->worker_count == 0) {
+        printf("Error: Failed to start backup workers\n");
+        backup_pipeline_destroy(pipeline);
+        return NULL;
+    }
+    return pipeline;
+}
+
+void backup_pipeline_destroy(BackupPipeline* pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+    if (pipeline->started) {
+        backup_pipeline_finish(pipeline);
+        pthread_mutex_destroy(&pipeline->lock);
+        pthread_cond_destroy(&pipeline->slot_free);
+        pthread_cond_destroy(&pipeline->job_queued);
+        pthread_cond_destroy(&pipeline->job_ready);
+    }
+    for (int i = 0; pipeline->jobs != NULL && i < pipeline->window; i++) {
+        free(pipeline->jobs[i].data);
+        free(pipeline->jobs[i].blob);
+    }
+    free(pipeline->jobs);
+    free(pipeline);
+}
+
+// Waits for a free slot; returns NULL once the pipeline has failed
+static PipelineJob* pipeline_acquire(BackupPipeline* pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->submit_seq - pipeline->write_seq >= pipeline->window && pipeline->result == BACKUP_SUCCESS) {
+        pthread_cond_wait(&pipeline->slot_free, &pipeline->lock);
+    }
+    PipelineJob* job = pipeline->result == BACKUP_SUCCESS ? pipeline_job(pipeline, pipeline->submit_seq) : NULL;
+    pthread_mutex_unlock(&pipeline->lock);
+    return job;
+}
+
+static void pipeline_submit(BackupPipeline* pipeline, PipelineJob* job) {
+    pthread_mutex_lock(&pipeline->lock);
+    job->state = PIPELINE_JOB_QUEUED;
+    pipeline->submit_seq++;
+    pthread_cond_signal(&pipeline->job_queued);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+int backup_pipeline_begin_file(BackupPipeline* pipeline, const char* path, long long size, long long mtime,
+                               unsigned int mode, const ManifestFile* reuse) {
+    if (pipeline == NULL || path == NULL || pipeline->finishing) {
+        return 0;
+    }
+    PipelineJob* job = pipeline_acquire(pipeline);
+    if (job == NULL) {
+        return 0;
+    }
+    job->is_file = 1;
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    job->size = size;
+    job->mtime = mtime;
+    job->mode = mode;
+    job->reuse = reuse;
+    job->error = BACKUP_SUCCESS;
+    pipeline_submit(pipeline, job);
+    return 1;
+}
+
+int backup_pipeline_add_chunk(BackupPipeline* pipeline, const unsigned char* data, int size) {
+    if (pipeline == NULL || data == NULL || size < 0 || size > CHUNK_MAX_SIZE || pipeline->finishing) {
+        return 0;
+    }
+    PipelineJob* job = pipeline_acquire(pipeline);
+    if (job == NULL) {
+        return 0;
+    }
+    job->is_file = 0;
+    memcpy(job->data, data, (size_t)size);
+    job->ref.length = (unsigned int)size;
+    job->blob_size = 0;
+    job->error = BACKUP_SUCCESS;
+    pipeline_submit(pipeline, job);
+    return 1;
+}
+
+BackupResult backup_pipeline_finish(BackupPipeline* pipeline) {
+    if (pipeline == NULL) {
+        return BACKUP_ERROR_COPY_FILE;
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    int joined = pipeline->finishing;
+    pipeline->finishing = 1;
+    pthread_cond_broadcast(&pipeline->job_queued);
+    pthread_cond_broadcast(&pipeline->job_ready);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    if (!joined) {
+        for (int i = 0; i < pipeline->worker_count; i++) {
+            pthread_join(pipeline->workers[i], NULL);
+        }
+        // Workers are gone, so every submitted job is ready for the writer
+        pthread_join(pipeline->writer, NULL);
+    }
+    return pipeline->result;
+}
+
+// ---- Benchmark ----
+
+static void pipeline_benchmark_run(const char* source_dir, const char* store_dir, int threads) {
+    BackupOptions options;
+    backup_options_init(&options);
+    options.encrypt = 1;
+    options.threads = threads;
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        options.key[i] = (unsigned char)(i * 7 + 1);
+    }
+
+    BackupStats stats;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    BackupResult result = create_chunked_backup("benchmark", source_dir, store_dir, &options, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    utils_file_remove_tree(store_dir);
+
+    if (result != BACKUP_SUCCESS) {
+        printf("%2d worker(s): %s\n", threads, backup_result_to_string(result));
+        return;
+    }
+    printf("%2d worker(s): %8.2f s %8.1f MB/s  %lld chunks, %lld new, %.1f MB stored\n", threads, seconds,
+           (double)stats.bytes_read / 1048576.0 / (seconds > 0 ? seconds : 1e-9), stats.chunks, stats.new_chunks,
+           (double)stats.stored_bytes / 1048576.0);
+}
+
+void backup_pipeline_benchmark(const char* source_dir, const char* scratch_dir, int threads) {
+    if (source_dir == NULL || scratch_dir == NULL) {
+        printf("Error: Invalid benchmark parameters\n");
+        return;
+    }
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    char store_dir[MAX_BACKUP_PATH_LENGTH];
+    snprintf(store_dir, sizeof(store_dir), "%s/pipeline_benchmark", scratch_dir);
+    printf("\n=== BACKUP PIPELINE BENCHMARK (%s, compressed + encrypted) ===\n", source_dir);
+    pipeline_benchmark_run(source_dir, store_dir, 1);
+    if (threads > 1) {
+        pipeline_benchmark_run(source_dir, store_dir, threads);
+    }
+}
@@ -0,0 +1,517 @@
+#include "backup_scheduler.h"
+#include "utils.h"
+#include "log.h"
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+// Scheduler state; the schedules, requests and metrics are guarded by
+// auto_backup_lock, runs are serialised by auto_backup_run_lock
+static pthread_mutex_t auto_backup_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t auto_backup_run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t auto_backup_thread;
+static int auto_backup_started = 0;
+static int auto_backup_timer_fd = -1;
+static int auto_backup_event_fd = -1;
+static int auto_backup_stop_requested = 0;
+static int auto_backup_manual_requested = 0;
+static AutoBackupConfig auto_backup_config;
+static BackupSchedule auto_backup_schedules[AUTO_BACKUP_MAX_SCHEDULES];
+static int auto_backup_schedule_count = 0;
+static time_t auto_backup_last_fire = 0;
+static AutoBackupMetrics auto_backup_metrics;
+
+static double auto_backup_elapsed_ms(const struct timespec* t0, const struct timespec* t1) {
+    return (double)(t1->tv_sec - t0->tv_sec) * 1e3 + (double)(t1->tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+static void auto_backup_wake(void) {
+    uint64_t one = 1;
+    if (auto_backup_event_fd >= 0 && write(auto_backup_event_fd, &one, sizeof(one)) < 0) {
+        printf("Error: Cannot wake the backup scheduler\n");
+    }
+}
+
+// ---- Configuration and schedules ----
+
+AutoBackupConfig* auto_backup_config_create(void) {
+    AutoBackupConfig* config = (AutoBackupConfig*)calloc(1, sizeof(AutoBackupConfig));
+    if (config == NULL) {
+        printf("Error: Failed to create auto backup config\n");
+        return NULL;
+    }
+    config->enabled = 1;
+    config->interval_hours = 24;
+    config->max_backups = MAX_AUTO_BACKUPS;
+    config->compress_backups = 1;
+    snprintf(config->backup_dir, sizeof(config->backup_dir), "%s", BACKUP_DIR);
+    snprintf(config->source_dir, sizeof(config->source_dir), "%s", DATA_DIR);
+    return config;
+}
+
+void auto_backup_config_destroy(AutoBackupConfig* config) {
+    if (config == NULL) {
+        return;
+    }
+    memset(config->key, 0, sizeof(config->key));
+    free(config);
+}
+
+BackupSchedule* backup_schedule_create(int hour, int minute, int day_of_week, int day_of_month) {
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || day_of_week < -1 || day_of_week > 6 ||
+        day_of_month < 0 || day_of_month > 31) {
+        printf("Error: Invalid backup schedule\n");
+        return NULL;
+    }
+    BackupSchedule* schedule = (BackupSchedule*)malloc(sizeof(BackupSchedule));
+    if (schedule == NULL) {
+        printf("Error: Failed to create backup schedule\n");
+        return NULL;
+    }
+    schedule->hour = hour;
+    schedule->minute = minute;
+    schedule->day_of_week = day_of_week;
+    schedule->day_of_month = day_of_month;
+    return schedule;
+}
+
+void backup_schedule_destroy(BackupSchedule* schedule) {
+    free(schedule);
+}
+
+static int backup_schedule_matches_day(const BackupSchedule* schedule, const struct tm* tm) {
+    return (schedule->day_of_week < 0 || tm->tm_wday == schedule->day_of_week) &&
+           (schedule->day_of_month == 0 || tm->tm_mday == schedule->day_of_month);
+}
+
+int is_backup_time(BackupSchedule* schedule) {
+    if (schedule == NULL) {
+        return 0;
+    }
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return tm.tm_hour == schedule->hour && tm.tm_min == schedule->minute && backup_schedule_matches_day(schedule, &tm);
+}
+
+time_t backup_schedule_next(const BackupSchedule* schedule, time_t after) {
+    if (schedule == NULL) {
+        return 0;
+    }
+    struct tm base;
+    localtime_r(&after, &base);
+    // Every day-of-month occurs within a year; mktime normalises the date
+    for (int day = 0; day <= 366; day++) {
+        struct tm probe = base;
+        probe.tm_mday = base.tm_mday + day;
+        probe.tm_hour = schedule->hour;
+        probe.tm_min = schedule->minute;
+        probe.tm_sec = 0;
+        probe.tm_isdst = -1;
+        time_t t = mktime(&probe);
+        if (t > after && backup_schedule_matches_day(schedule, &probe)) {
+            return t;
+        }
+    }
+    return 0;
+}
+
+// Adds the schedule to the scheduler, starting it with `config` if needed
+int schedule_backup(BackupSchedule* schedule, AutoBackupConfig* config) {
+    if (schedule == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&auto_backup_lock);
+    int added = auto_backup_schedule_count < AUTO_BACKUP_MAX_SCHEDULES;
+    if (added) {
+        auto_backup_schedules[auto_backup_schedule_count++] = *schedule;
+    }
+    int running = auto_backup_started;
+    pthread_mutex_unlock(&auto_backup_lock);
+    if (!added) {
+        printf("Error: Too many backup schedules\n");
+        return 0;
+    }
+    if (running) {
+        auto_backup_wake();
+        return 1;
+    }
+    return config != NULL ? start_auto_backup(config) : 1;
+}
+
+// ---- Snapshot ----
+
+typedef struct {
+    char skip[2][PATH_MAX];         // Backup and snapshot directories
+    int files;
+    long long bytes;
+} SnapshotWalk;
+
+static int auto_backup_copy_file(const char* source, const char* target) {
+    FILE* in = fopen(source, "rb");
+    FILE* out = in != NULL ? fopen(target, "wb") : NULL;
+    char buffer[65536];
+    size_t got;
+    int ok = in != NULL && out != NULL;
+    while (ok && (got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        ok = fwrite(buffer, 1, got, out) == got;
+    }
+    if (in != NULL) fclose(in);
+    if (out != NULL && fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+// Hard links every regular file into the snapshot. Saves replace files by
+// rename, so the links keep the versions current at this moment. Files
+// appended in place (journal, log) would keep growing through a link, so
+// they are copied; the caller holds the snapshot lock, which keeps their
+// writers out until the copy is done.
+static int auto_backup_link_tree(SnapshotWalk* walk, const char* source, const char* target) {
+    DIR* dir = opendir(source);
+    if (dir == NULL) {
+        printf("Error: Cannot open %s\n", source);
+        return 0;
+    }
+    int ok = 1;
+    struct dirent* item;
+    char from[PATH_MAX], to[PATH_MAX], resolved[PATH_MAX];
+    while (ok && (item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(from, sizeof(from), "%s/%s", source, item->d_name);
+        snprintf(to, sizeof(to), "%s/%s", target, item->d_name);
+        struct stat st;
+        if (lstat(from, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (realpath(from, resolved) != NULL &&
+                (strcmp(resolved, walk->skip[0]) == 0 || strcmp(resolved, walk->skip[1]) == 0)) {
+                continue;
+            }
+            ok = (mkdir(to, 0700) == 0 || errno == EEXIST) && auto_backup_link_tree(walk, from, to);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)) {
+            continue;
+        }
+        // Across a mount point linking fails and the file is copied instead
+        int appended = utils_file_is_appended(from);
+        if ((appended || link(from, to) != 0) && !auto_backup_copy_file(from, to)) {
+            printf("Error: Cannot snapshot %s\n", from);
+            ok = 0;
+        }
+        walk->files++;
+        walk->bytes += (long long)st.st_size;
+    }
+    closedir(dir);
+    return ok;
+}
+
+// ---- Runs ----
+
+static int auto_backup_progress(int files, long long bytes_read, void* user_data) {
+    (void)user_data;
+    pthread_mutex_lock(&auto_backup_lock);
+    auto_backup_metrics.files_done = files;
+    auto_backup_metrics.bytes_done = bytes_read;
+    int keep_going = !auto_backup_stop_requested;
+    pthread_mutex_unlock(&auto_backup_lock);
+    return keep_going;
+}
+
+BackupResult auto_backup_run_once(AutoBackupConfig* config) {
+    if (config == NULL || config->source_dir[0] == '\0' || config->backup_dir[0] == '\0') {
+        printf("Error: Invalid auto backup config\n");
+        return BACKUP_ERROR_INVALID_PATH;
+    }
+    pthread_mutex_lock(&auto_backup_run_lock);
+
+    char name[MAX_BACKUP_NAME_LENGTH];
+    time_t start = time(NULL);
+    struct tm tm;
+    localtime_r(&start, &tm);
+    strftime(name, sizeof(name), BACKUP_NAME_FORMAT, &tm);
+
+    pthread_mutex_lock(&auto_backup_lock);
+    auto_backup_metrics.phase = AUTO_BACKUP_SNAPSHOT;
+    snprintf(auto_backup_metrics.current_backup, sizeof(auto_backup_metrics.current_backup), "%s", name);
+    auto_backup_metrics.files_total = auto_backup_metrics.files_done = 0;
+    auto_backup_metrics.bytes_total = auto_backup_metrics.bytes_done = 0;
+    auto_backup_metrics.last_start = start;
+    pthread_mutex_unlock(&auto_backup_lock);
+
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    BackupResult result = BACKUP_SUCCESS;
+    char snapshot[PATH_MAX];
+    snprintf(snapshot, sizeof(snapshot), "%s/%s", config->source_dir, AUTO_BACKUP_SNAPSHOT_DIR);
+    utils_file_remove_tree(snapshot);       // Left over from an interrupted run
+    if (mkdir(config->backup_dir, 0700) != 0 && errno != EEXIST) {
+        result = BACKUP_ERROR_CREATE_DIR;
+    } else if (mkdir(snapshot, 0700) != 0) {
+        printf("Error: Cannot create snapshot %s\n", snapshot);
+        result = BACKUP_ERROR_CREATE_DIR;
+    }
+
+    SnapshotWalk walk;
+    memset(&walk, 0, sizeof(walk));
+    if (result == BACKUP_SUCCESS) {
+        if (realpath(config->backup_dir, walk.skip[0]) == NULL) walk.skip[0][0] = '\0';
+        if (realpath(snapshot, walk.skip[1]) == NULL) walk.skip[1][0] = '\0';
+        // Saves wait for the links so the snapshot is consistent across files
+        utils_file_snapshot_lock();
+        int linked = auto_backup_link_tree(&walk, config->source_dir, snapshot);
+        utils_file_snapshot_unlock();
+        if (!linked) result = BACKUP_ERROR_COPY_FILE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    BackupStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (result == BACKUP_SUCCESS) {
+        pthread_mutex_lock(&auto_backup_lock);
+        auto_backup_metrics.phase = AUTO_BACKUP_RUNNING;
+        auto_backup_metrics.files_total = walk.files;
+        auto_backup_metrics.bytes_total = walk.bytes;
+        pthread_mutex_unlock(&auto_backup_lock);
+
+        BackupOptions options;
+        backup_options_init(&options);
+        BackupManifest* latest = backup_manifest_load_latest(config->backup_dir);
+        options.incremental = latest != NULL;
+        backup_manifest_destroy(latest);
+        options.compress = config->compress_backups;
+        options.encrypt = config->encrypt_backups;
+        memcpy(options.key, config->key, sizeof(options.key));
+        options.max_read_rate = (long long)config->max_read_mb_per_sec * 1024 * 1024;
+        options.direct_io = 1;
+        options.progress = auto_backup_progress;
+        result = create_chunked_backup(name, snapshot, config->backup_dir, &options, &stats);
+        memset(options.key, 0, sizeof(options.key));
+    }
+    utils_file_remove_tree(snapshot);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    double duration_ms = auto_backup_elapsed_ms(&t0, &t2);
+    pthread_mutex_lock(&auto_backup_lock);
+    auto_backup_metrics.phase = AUTO_BACKUP_IDLE;
+    auto_backup_metrics.runs++;
+    if (result != BACKUP_SUCCESS) auto_backup_metrics.failures++;
+    auto_backup_metrics.last_result = result;
+    auto_backup_metrics.last_snapshot_ms = auto_backup_elapsed_ms(&t0, &t1);
+    auto_backup_metrics.last_duration_ms = duration_ms;
+    auto_backup_metrics.last_rate_mb_s = duration_ms > 0 ? (double)stats.bytes_read / 1048576.0 / (duration_ms / 1e3) : 0;
+    auto_backup_metrics.last_stats = stats;
+    pthread_mutex_unlock(&auto_backup_lock);
+
+    // Failed runs also wait a full interval rather than retrying at once
+    config->last_backup_time = start;
+    pthread_mutex_unlock(&auto_backup_run_lock);
+    if (result != BACKUP_SUCCESS) {
+        printf("Error: Auto backup %s failed: %s\n", name, backup_result_to_string(result));
+    }
+    return result;
+}
+
+// ---- Scheduler thread ----
+
+// Earliest due time, 0 when nothing is due; called with auto_backup_lock held
+static time_t auto_backup_next_due(time_t now) {
+    time_t after = now > auto_backup_last_fire ? now : auto_backup_last_fire;
+    time_t next = 0;
+    for (int i = 0; i < auto_backup_schedule_count; i++) {
+        time_t t = backup_schedule_next(&auto_backup_schedules[i], after);
+        if (t != 0 && (next == 0 || t < next)) next = t;
+    }
+    if (auto_backup_schedule_count == 0 && auto_backup_config.interval_hours > 0) {
+        next = auto_backup_config.last_backup_time != 0
+               ? auto_backup_config.last_backup_time + (time_t)auto_backup_config.interval_hours * 3600
+               : now;
+    }
+    return next;
+}
+
+static void* auto_backup_thread_main(void* arg) {
+    (void)arg;
+    struct pollfd fds[2];
+    fds[0].fd = auto_backup_timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = auto_backup_event_fd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        pthread_mutex_lock(&auto_backup_lock);
+        if (auto_backup_stop_requested) {
+            pthread_mutex_unlock(&auto_backup_lock);
+            break;
+        }
+        int manual = auto_backup_manual_requested;
+        auto_backup_manual_requested = 0;
+        time_t next = auto_backup_next_due(time(NULL));
+        auto_backup_metrics.next_run = next;
+        pthread_mutex_unlock(&auto_backup_lock);
+
+        if (manual) {
+            auto_backup_run_once(&auto_backup_config);
+            continue;
+        }
+
+        // Absolute wall-clock deadline; a clock change cancels the timer
+        // so the due time is worked out again
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = next;
+        if (timerfd_settime(auto_backup_timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, NULL) != 0) {
+            printf("Error: Cannot arm the backup timer\n");
+            break;
+        }
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        uint64_t value;
+        if (fds[1].revents & POLLIN) {
+            if (read(auto_backup_event_fd, &value, sizeof(value)) < 0) {
+                continue;
+            }
+        }
+        if ((fds[0].revents & POLLIN) && read(auto_backup_timer_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+            auto_backup_run_once(&auto_backup_config);
+            pthread_mutex_lock(&auto_backup_lock);
+            auto_backup_last_fire = next;
+            pthread_mutex_unlock(&auto_backup_lock);
+        }
+    }
+    return NULL;
+}
+
+int start_auto_backup(AutoBackupConfig* config) {
+    if (config == NULL || !config->enabled) {
+        printf("Error: Auto backup is not enabled\n");
+        return 0;
+    }
+    pthread_mutex_lock(&auto_backup_lock);
+    if (auto_backup_started) {
+        pthread_mutex_unlock(&auto_backup_lock);
+        printf("Error: Auto backup is already running\n");
+        return 0;
+    }
+    auto_backup_timer_fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    auto_backup_event_fd = eventfd(0, EFD_CLOEXEC);
+    auto_backup_config = *config;
+    auto_backup_stop_requested = 0;
+    auto_backup_manual_requested = 0;
+    auto_backup_last_fire = 0;
+    int ok = auto_backup_timer_fd >= 0 && auto_backup_event_fd >= 0 &&
+             pthread_create(&auto_backup_thread, NULL, auto_backup_thread_main, NULL) == 0;
+    if (!ok) {
+        if (auto_backup_timer_fd >= 0) close(auto_backup_timer_fd);
+        if (auto_backup_event_fd >= 0) close(auto_backup_event_fd);
+        auto_backup_timer_fd = auto_backup_event_fd = -1;
+        pthread_mutex_unlock(&auto_backup_lock);
+        printf("Error: Failed to start auto backup\n");
+        return 0;
+    }
+    auto_backup_started = 1;
+    auto_backup_metrics.running = 1;
+    pthread_mutex_unlock(&auto_backup_lock);
+    return 1;
+}
+
+// Cancels a run in progress at its next read and waits for the thread
+int stop_auto_backup(void) {
+    pthread_mutex_lock(&auto_backup_lock);
+    if (!auto_backup_started) {
+        pthread_mutex_unlock(&auto_backup_lock);
+        return 0;
+    }
+    auto_backup_stop_requested = 1;
+    pthread_mutex_unlock(&auto_backup_lock);
+    auto_backup_wake();
+    pthread_join(auto_backup_thread, NULL);
+
+    pthread_mutex_lock(&auto_backup_lock);
+    close(auto_backup_timer_fd);
+    close(auto_backup_event_fd);
+    auto_backup_timer_fd = auto_backup_event_fd = -1;
+    auto_backup_started = 0;
+    auto_backup_stop_requested = 0;
+    auto_backup_metrics.running = 0;
+    auto_backup_metrics.next_run = 0;
+    memset(auto_backup_config.key, 0, sizeof(auto_backup_config.key));
+    pthread_mutex_unlock(&auto_backup_lock);
+    return 1;
+}
+
+int is_auto_backup_running(void) {
+    pthread_mutex_lock(&auto_backup_lock);
+    int running = auto_backup_started;
+    pthread_mutex_unlock(&auto_backup_lock);
+    return running;
+}
+
+// Queues a run on the scheduler thread when it is running, otherwise
+// runs it here
+int trigger_manual_backup(AutoBackupConfig* config) {
+    pthread_mutex_lock(&auto_backup_lock);
+    int running = auto_backup_started;
+    if (running) auto_backup_manual_requested = 1;
+    pthread_mutex_unlock(&auto_backup_lock);
+    if (running) {
+        auto_backup_wake();
+        return 1;
+    }
+    return auto_backup_run_once(config) == BACKUP_SUCCESS;
+}
+
+// ---- Metrics ----
+
+int auto_backup_get_metrics(AutoBackupMetrics* metrics) {
+    if (metrics == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&auto_backup_lock);
+    *metrics = auto_backup_metrics;
+    pthread_mutex_unlock(&auto_backup_lock);
+    return 1;
+}
+
+void display_auto_backup_status(void) {
+    AutoBackupMetrics m;
+    auto_backup_get_metrics(&m);
+    static const char* phases[] = { "idle", "snapshot", "running" };
+    char when[32] = "-";
+    if (m.next_run != 0) {
+        struct tm tm;
+        localtime_r(&m.next_run, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M", &tm);
+    }
+
+    printf("\n=== AUTO BACKUP ===\n");
+    printf("Scheduler:        %s, next run %s\n", m.running ? "running" : "stopped", when);
+    printf("Phase:            %s", phases[m.phase]);
+    if (m.phase != AUTO_BACKUP_IDLE) {
+        printf(" (%s: %d/%d files, %.1f/%.1f MB)", m.current_backup, m.files_done, m.files_total,
+               (double)m.bytes_done / 1048576.0, (double)m.bytes_total / 1048576.0);
+    }
+    printf("\n");
+    printf("Runs:             %d (%d failed)\n", m.runs, m.failures);
+    if (m.runs > 0) {
+        printf("Last result:      %s\n", backup_result_to_string(m.last_result));
+        printf("Last snapshot:    %.1f ms\n", m.last_snapshot_ms);
+        printf("Last duration:    %.1f ms (%.1f MB/s read)\n", m.last_duration_ms, m.last_rate_mb_s);
+        printf("Last backup:      %d files (%d unchanged), %lld new chunks, %.1f MB stored\n",
+               m.last_stats.files, m.last_stats.files_reused, m.last_stats.new_chunks,
+               (double)m.last_stats.stored_bytes / 1048576.0);
+    }
+}
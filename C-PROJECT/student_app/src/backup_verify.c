@@ -0,0 +1,795 @@
+#include "backup_verify.h"
+#include "crypto.h"
+#include "utils.h"
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MERKLE_MAGIC "MRKL"
+#define MERKLE_VERSION 1
+#define VERIFY_READ_SIZE (1024 * 1024)
+#define VERIFY_MAX_RANGES 8
+
+// ---- Trees ----
+
+static MerkleTree* merkle_tree_alloc(int block_count) {
+    MerkleTree* tree = (MerkleTree*)calloc(1, sizeof(MerkleTree));
+    if (tree == NULL) {
+        printf("Error: Failed to create Merkle tree\n");
+        return NULL;
+    }
+    tree->block_count = block_count;
+    int size = block_count;
+    for (;;) {
+        tree->level_offsets[tree->level_count] = tree->node_count;
+        tree->level_sizes[tree->level_count] = size;
+        tree->level_count++;
+        tree->node_count += size;
+        if (size == 1) break;
+        size = (size + 1) / 2;
+    }
+    tree->nodes = (unsigned char(*)[CRYPTO_SHA256_SIZE])malloc((size_t)tree->node_count * CRYPTO_SHA256_SIZE);
+    if (tree->nodes == NULL) {
+        printf("Error: Failed to allocate Merkle tree\n");
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+static unsigned char* merkle_node(const MerkleTree* tree, int level, int index) {
+    return tree->nodes[tree->level_offsets[level] + index];
+}
+
+static int merkle_hash_block(const ChunkRef* const* refs, int count, unsigned char* digest) {
+    unsigned char buffer[1 + MERKLE_BLOCK_CHUNKS * (CRYPTO_SHA256_SIZE + 4)];
+    size_t used = 0;
+    buffer[used++] = 0x00;
+    for (int i = 0; i < count; i++) {
+        memcpy(buffer + used, refs[i]->digest, CRYPTO_SHA256_SIZE);
+        used += CRYPTO_SHA256_SIZE;
+        unsigned int length = refs[i]->length;
+        buffer[used++] = (unsigned char)length;
+        buffer[used++] = (unsigned char)(length >> 8);
+        buffer[used++] = (unsigned char)(length >> 16);
+        buffer[used++] = (unsigned char)(length >> 24);
+    }
+    return crypto_sha256(buffer, used, digest);
+}
+
+static int merkle_block_chunks(long long count, int block) {
+    long long left = count - (long long)block * MERKLE_BLOCK_CHUNKS;
+    return left < MERKLE_BLOCK_CHUNKS ? (int)(left > 0 ? left : 0) : MERKLE_BLOCK_CHUNKS;
+}
+
+static int merkle_tree_build_upper(MerkleTree* tree) {
+    unsigned char pair[1 + 2 * CRYPTO_SHA256_SIZE];
+    pair[0] = 0x01;
+    for (int level = 1; level < tree->level_count; level++) {
+        int below = tree->level_sizes[level - 1];
+        for (int i = 0; i < tree->level_sizes[level]; i++) {
+            if (2 * i + 1 >= below) {
+                memcpy(merkle_node(tree, level, i), merkle_node(tree, level - 1, 2 * i), CRYPTO_SHA256_SIZE);
+                continue;
+            }
+            memcpy(pair + 1, merkle_node(tree, level - 1, 2 * i), CRYPTO_SHA256_SIZE);
+            memcpy(pair + 1 + CRYPTO_SHA256_SIZE, merkle_node(tree, level - 1, 2 * i + 1), CRYPTO_SHA256_SIZE);
+            if (!crypto_sha256(pair, sizeof(pair), merkle_node(tree, level, i))) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+MerkleTree* merkle_tree_build(const ChunkRef* const* refs, long long count) {
+    if ((refs == NULL && count > 0) || count < 0 ||
+        (count + MERKLE_BLOCK_CHUNKS - 1) / MERKLE_BLOCK_CHUNKS > INT_MAX) {
+        printf("Error: Invalid Merkle tree input\n");
+        return NULL;
+    }
+    // An empty backup still has one (empty) block, so every tree has a root
+    int block_count = count > 0 ? (int)((count + MERKLE_BLOCK_CHUNKS - 1) / MERKLE_BLOCK_CHUNKS) : 1;
+    MerkleTree* tree = merkle_tree_alloc(block_count);
+    if (tree == NULL) {
+        return NULL;
+    }
+    int ok = 1;
+    for (int b = 0; ok && b < block_count; b++) {
+        ok = merkle_hash_block(refs + (long long)b * MERKLE_BLOCK_CHUNKS, merkle_block_chunks(count, b),
+                               merkle_node(tree, 0, b));
+    }
+    if (!ok || !merkle_tree_build_upper(tree)) {
+        merkle_tree_destroy(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+// Every chunk reference of the backup, files in manifest order
+static const ChunkRef** backup_manifest_refs(const BackupManifest* manifest, long long* count) {
+    long long total = 0;
+    for (int i = 0; i < manifest->file_count; i++) {
+        total += manifest->files[i].chunk_count;
+    }
+    const ChunkRef** refs = (const ChunkRef**)malloc(sizeof(ChunkRef*) * (size_t)(total > 0 ? total : 1));
+    if (refs == NULL) {
+        printf("Error: Failed to list backup chunks\n");
+        return NULL;
+    }
+    long long n = 0;
+    for (int i = 0; i < manifest->file_count; i++) {
+        for (int j = 0; j < manifest->files[i].chunk_count; j++) {
+            refs[n++] = &manifest->files[i].chunks[j];
+        }
+    }
+    *count = total;
+    return refs;
+}
+
+MerkleTree* merkle_tree_from_manifest(const BackupManifest* manifest) {
+    if (manifest == NULL) {
+        return NULL;
+    }
+    long long count = 0;
+    const ChunkRef** refs = backup_manifest_refs(manifest, &count);
+    if (refs == NULL) {
+        return NULL;
+    }
+    MerkleTree* tree = merkle_tree_build(refs, count);
+    free(refs);
+    return tree;
+}
+
+void merkle_tree_destroy(MerkleTree* tree) {
+    if (tree == NULL) {
+        return;
+    }
+    free(tree->nodes);
+    free(tree);
+}
+
+static void merkle_put_u32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static unsigned int merkle_get_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+}
+
+// File: "MRKL" u32 version, u32 block count, then every node, leaves first
+int merkle_tree_save(const MerkleTree* tree, const char* filename) {
+    if (tree == NULL || filename == NULL) {
+        return 0;
+    }
+    char temp[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH + 32];
+    FILE* file = utils_file_open_atomic(filename, temp, sizeof(temp));
+    if (file == NULL) {
+        printf("Error: Cannot write %s\n", temp);
+        return 0;
+    }
+    unsigned char header[12];
+    memcpy(header, MERKLE_MAGIC, 4);
+    merkle_put_u32(header + 4, MERKLE_VERSION);
+    merkle_put_u32(header + 8, (unsigned int)tree->block_count);
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+             fwrite(tree->nodes, CRYPTO_SHA256_SIZE, (size_t)tree->node_count, file) == (size_t)tree->node_count;
+    if (!ok) {
+        utils_file_abort_atomic(file, temp);
+    }
+    if (!ok || !utils_file_commit_atomic(file, temp, filename)) {
+        printf("Error: Failed to save %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+MerkleTree* merkle_tree_load(const char* filename) {
+    if (filename == NULL) {
+        return NULL;
+    }
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char header[12];
+    MerkleTree* tree = NULL;
+    if (fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, MERKLE_MAGIC, 4) == 0 &&
+        merkle_get_u32(header + 4) == MERKLE_VERSION && merkle_get_u32(header + 8) > 0 &&
+        merkle_get_u32(header + 8) <= INT_MAX) {
+        tree = merkle_tree_alloc((int)merkle_get_u32(header + 8));
+    }
+    if (tree != NULL && fread(tree->nodes, CRYPTO_SHA256_SIZE, (size_t)tree->node_count, file) != (size_t)tree->node_count) {
+        merkle_tree_destroy(tree);
+        tree = NULL;
+    }
+    fclose(file);
+    if (tree == NULL) {
+        printf("Error: Invalid Merkle tree %s\n", filename);
+    }
+    return tree;
+}
+
+const unsigned char* merkle_tree_root(const MerkleTree* tree) {
+    return tree != NULL ? merkle_node(tree, tree->level_count - 1, 0) : NULL;
+}
+
+int merkle_tree_equal(const MerkleTree* a, const MerkleTree* b) {
+    return a != NULL && b != NULL && a->block_count == b->block_count &&
+           memcmp(merkle_tree_root(a), merkle_tree_root(b), CRYPTO_SHA256_SIZE) == 0;
+}
+
+static void merkle_diff_node(const MerkleTree* a, const MerkleTree* b, int level, int index,
+                             int* blocks, int max_blocks, int* found) {
+    if (memcmp(merkle_node(a, level, index), merkle_node(b, level, index), CRYPTO_SHA256_SIZE) == 0) {
+        return;
+    }
+    if (level == 0) {
+        if (*found < max_blocks) blocks[*found] = index;
+        (*found)++;
+        return;
+    }
+    merkle_diff_node(a, b, level - 1, 2 * index, blocks, max_blocks, found);
+    if (2 * index + 1 < a->level_sizes[level - 1]) {
+        merkle_diff_node(a, b, level - 1, 2 * index + 1, blocks, max_blocks, found);
+    }
+}
+
+int merkle_tree_diff(const MerkleTree* a, const MerkleTree* b, int* blocks, int max_blocks) {
+    if (a == NULL || b == NULL || (blocks == NULL && max_blocks > 0)) {
+        return -1;
+    }
+    int found = 0;
+    if (a->block_count == b->block_count) {
+        merkle_diff_node(a, b, a->level_count - 1, 0, blocks, max_blocks, &found);
+        return found;
+    }
+    // Different shapes: compare the common leaves, the rest all differ
+    int common = a->block_count < b->block_count ? a->block_count : b->block_count;
+    int total = a->block_count > b->block_count ? a->block_count : b->block_count;
+    for (int i = 0; i < total; i++) {
+        if (i < common && memcmp(merkle_node(a, 0, i), merkle_node(b, 0, i), CRYPTO_SHA256_SIZE) == 0) {
+            continue;
+        }
+        if (found < max_blocks) blocks[found] = i;
+        found++;
+    }
+    return found;
+}
+
+// ---- Parallel verification ----
+
+typedef struct VerifyTask VerifyTask;
+typedef int (*VerifyItemFunction)(VerifyTask* task, int index, unsigned char* buffer, VerifyReport* local);
+
+struct VerifyTask {
+    ChunkStore* store;                  // Opened for the backup's key, or plain
+    ChunkStore* keyed_store;            // Scrub: for encrypted chunks, NULL without a key
+    const ChunkRef** refs;              // Blocks: the backup's chunks
+    long long ref_count;
+    const MerkleTree* tree;             // Blocks: expected leaves
+    char (*names)[CRYPTO_SHA256_SIZE * 2 + 1];   // Scrub: chunk addresses
+    VerifyItemFunction verify;
+    int next;
+    int end;
+    pthread_mutex_t lock;
+    VerifyReport report;
+};
+
+static void verify_report_merge(VerifyReport* into, const VerifyReport* from) {
+    into->blocks_checked += from->blocks_checked;
+    into->blocks_bad += from->blocks_bad;
+    into->chunks_checked += from->chunks_checked;
+    into->chunks_bad += from->chunks_bad;
+    into->bytes_checked += from->bytes_checked;
+    if (from->first_bad_block >= 0 && (into->first_bad_block < 0 || from->first_bad_block < into->first_bad_block)) {
+        into->first_bad_block = from->first_bad_block;
+    }
+}
+
+static void* verify_worker(void* arg) {
+    VerifyTask* task = (VerifyTask*)arg;
+    VerifyReport local;
+    memset(&local, 0, sizeof(local));
+    local.first_bad_block = -1;
+    unsigned char* buffer = (unsigned char*)malloc(CHUNK_MAX_SIZE);
+    for (;;) {
+        pthread_mutex_lock(&task->lock);
+        int index = buffer != NULL && task->next < task->end ? task->next++ : -1;
+        pthread_mutex_unlock(&task->lock);
+        if (index < 0) break;
+        task->verify(task, index, buffer, &local);
+    }
+    pthread_mutex_lock(&task->lock);
+    verify_report_merge(&task->report, &local);
+    pthread_mutex_unlock(&task->lock);
+    free(buffer);
+    return NULL;
+}
+
+static void verify_run(VerifyTask* task, int first, int end, int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > end - first) threads = end - first > 0 ? end - first : 1;
+    pthread_mutex_init(&task->lock, NULL);
+    task->next = first;
+    task->end = end;
+    memset(&task->report, 0, sizeof(task->report));
+    task->report.first_bad_block = -1;
+
+    pthread_t* workers = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    int started = 0;
+    for (int i = 0; workers != NULL && i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, verify_worker, task) != 0) break;
+        started++;
+    }
+    if (started == 0) {
+        verify_worker(task);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&task->lock);
+}
+
+// A block is good when its references still hash to the stored leaf and
+// every chunk reads back to its address
+static int verify_block(VerifyTask* task, int block, unsigned char* buffer, VerifyReport* local) {
+    const ChunkRef* const* refs = task->refs + (long long)block * MERKLE_BLOCK_CHUNKS;
+    int count = merkle_block_chunks(task->ref_count, block);
+    int good = 1;
+    unsigned char leaf[CRYPTO_SHA256_SIZE];
+    if (!merkle_hash_block(refs, count, leaf) || memcmp(leaf, merkle_node(task->tree, 0, block), CRYPTO_SHA256_SIZE) != 0) {
+        printf("Error: Block %d does not match the backup's Merkle tree\n", block);
+        good = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        local->chunks_checked++;
+        if (chunk_store_get(task->store, refs[i], buffer)) {
+            local->bytes_checked += refs[i]->length;
+        } else {
+            local->chunks_bad++;
+            good = 0;
+        }
+    }
+    local->blocks_checked++;
+    if (!good) {
+        local->blocks_bad++;
+        if (local->first_bad_block < 0 || block < local->first_bad_block) local->first_bad_block = block;
+    }
+    return good;
+}
+
+static void verify_path(const char* backup_dir, const char* backup_name, const char* extension, char* path, size_t size) {
+    snprintf(path, size, "%s/%s%s", backup_dir, backup_name, extension);
+}
+
+// Loads a backup's manifest and tree and opens its store. A backup saved
+// before trees existed gets one built from its manifest.
+static int verify_open(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                       BackupManifest** manifest, MerkleTree** tree, ChunkStore** store) {
+    char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH + 16];
+    verify_path(backup_dir, backup_name, MANIFEST_EXTENSION, path, sizeof(path));
+    *manifest = backup_manifest_load(path);
+    *tree = NULL;
+    *store = NULL;
+    if (*manifest == NULL) {
+        return 0;
+    }
+    if ((*manifest)->encrypted && key == NULL) {
+        printf("Error: Backup %s is encrypted; a key is required\n", backup_name);
+        return 0;
+    }
+    verify_path(backup_dir, backup_name, MERKLE_EXTENSION, path, sizeof(path));
+    *tree = access(path, F_OK) == 0 ? merkle_tree_load(path) : merkle_tree_from_manifest(*manifest);
+    *store = chunk_store_open(backup_dir);
+    if (*store != NULL) {
+        chunk_store_set_options(*store, (*manifest)->compressed, (*manifest)->encrypted ? key : NULL);
+    }
+    return *tree != NULL && *store != NULL;
+}
+
+static int verify_blocks_range(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                               const char* path, long long offset, long long length,
+                               int first_block, int block_count, int threads, VerifyReport* report) {
+    VerifyReport local;
+    if (report == NULL) report = &local;
+    memset(report, 0, sizeof(VerifyReport));
+    report->first_bad_block = -1;
+    if (backup_name == NULL || backup_dir == NULL) {
+        printf("Error: Invalid verify arguments\n");
+        return 0;
+    }
+
+    BackupManifest* manifest;
+    MerkleTree* tree;
+    ChunkStore* store;
+    VerifyTask task;
+    memset(&task, 0, sizeof(task));
+    int ok = verify_open(backup_name, backup_dir, key, &manifest, &tree, &store);
+    if (ok) {
+        task.refs = backup_manifest_refs(manifest, &task.ref_count);
+        ok = task.refs != NULL;
+    }
+    if (ok && tree->block_count != (task.ref_count > 0 ? (task.ref_count + MERKLE_BLOCK_CHUNKS - 1) / MERKLE_BLOCK_CHUNKS : 1)) {
+        printf("Error: Backup %s does not match its Merkle tree\n", backup_name);
+        ok = 0;
+    }
+
+    // A file range maps to the blocks holding its chunks
+    if (ok && path != NULL) {
+        long long first_chunk = 0;
+        const ManifestFile* file = NULL;
+        for (int i = 0; i < manifest->file_count && file == NULL; i++) {
+            if (strcmp(manifest->files[i].path, path) == 0) {
+                file = &manifest->files[i];
+            } else {
+                first_chunk += manifest->files[i].chunk_count;
+            }
+        }
+        if (file == NULL) {
+            printf("Error: %s is not in backup %s\n", path, backup_name);
+            ok = 0;
+        } else {
+            long long start = 0, lo = -1, hi = -1;
+            for (int j = 0; j < file->chunk_count; j++) {
+                long long end = start + file->chunks[j].length;
+                if (end > offset && start < offset + length) {
+                    if (lo < 0) lo = j;
+                    hi = j;
+                }
+                start = end;
+            }
+            first_block = lo >= 0 ? (int)((first_chunk + lo) / MERKLE_BLOCK_CHUNKS) : 0;
+            block_count = lo >= 0 ? (int)((first_chunk + hi) / MERKLE_BLOCK_CHUNKS) - first_block + 1 : 0;
+        }
+    }
+
+    if (ok) {
+        if (first_block < 0) first_block = 0;
+        int end = block_count < 0 || first_block + block_count > tree->block_count
+                  ? tree->block_count : first_block + block_count;
+        task.store = store;
+        task.tree = tree;
+        task.verify = verify_block;
+        verify_run(&task, first_block, end, threads);
+        verify_report_merge(report, &task.report);
+        ok = report->blocks_bad == 0;
+    }
+    free(task.refs);
+    chunk_store_close(store);
+    merkle_tree_destroy(tree);
+    backup_manifest_destroy(manifest);
+    return ok;
+}
+
+int backup_verify_blocks(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                         int first_block, int block_count, int threads, VerifyReport* report) {
+    return verify_blocks_range(backup_name, backup_dir, key, NULL, 0, 0, first_block, block_count, threads, report);
+}
+
+int backup_verify_file_range(const char* backup_name, const char* backup_dir, const unsigned char* key,
+                             const char* path, long long offset, long long length, int threads, VerifyReport* report) {
+    if (path == NULL || offset < 0 || length <= 0) {
+        printf("Error: Invalid verify range\n");
+        return 0;
+    }
+    return verify_blocks_range(backup_name, backup_dir, key, path, offset, length, 0, 0, threads, report);
+}
+
+// ---- Scrub ----
+
+static int verify_scrub_chunk(VerifyTask* task, int index, unsigned char* buffer, VerifyReport* local) {
+    ChunkRef ref;
+    char path[MAX_BACKUP_PATH_LENGTH + 80];
+    unsigned char header[CHUNK_HEADER_SIZE];
+    const char* name = task->names[index];
+    snprintf(path, sizeof(path), "%s/%.2s/%s", task->store->root, name, name);
+    FILE* file = fopen(path, "rb");
+    int got = file != NULL ? (int)fread(header, 1, sizeof(header), file) : 0;
+    if (file != NULL) fclose(file);
+
+    local->chunks_checked++;
+    if (got != CHUNK_HEADER_SIZE || !crypto_sha256_from_hex(name, ref.digest)) {
+        printf("Error: Unreadable chunk %s\n", path);
+        local->chunks_bad++;
+        return 0;
+    }
+    ref.length = merkle_get_u32(header + 1);
+    ChunkStore* store = (header[0] & CHUNK_FLAG_ENCRYPTED) ? task->keyed_store : task->store;
+    if (store == NULL) {
+        local->chunks_checked--;        // Encrypted and no key: not checked
+        return 1;
+    }
+    if (ref.length > CHUNK_MAX_SIZE || !chunk_store_get(store, &ref, buffer)) {
+        local->chunks_bad++;
+        return 0;
+    }
+    local->bytes_checked += ref.length;
+    return 1;
+}
+
+// A backup saved before trees existed has only its manifest, which must
+// still load and build a tree, as in verify_open
+static int verify_scrub_manifest(const char* backup_dir, const char* backup_name) {
+    char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH + 16];
+    verify_path(backup_dir, backup_name, MANIFEST_EXTENSION, path, sizeof(path));
+    BackupManifest* manifest = backup_manifest_load(path);
+    verify_path(backup_dir, backup_name, MERKLE_EXTENSION, path, sizeof(path));
+    MerkleTree* stored = NULL;
+    MerkleTree* built = merkle_tree_from_manifest(manifest);
+    int ok = built != NULL;
+    if (ok && access(path, F_OK) == 0) {
+        stored = merkle_tree_load(path);
+        ok = merkle_tree_equal(stored, built);
+    }
+    if (!ok) {
+        printf("Error: Backup %s does not match its Merkle tree\n", backup_name);
+    }
+    merkle_tree_destroy(built);
+    merkle_tree_destroy(stored);
+    backup_manifest_destroy(manifest);
+    return ok;
+}
+
+int backup_verify_scrub(const char* backup_dir, const unsigned char* key, int days, int threads, VerifyReport* report) {
+    VerifyReport local;
+    if (report == NULL) report = &local;
+    memset(report, 0, sizeof(VerifyReport));
+    report->first_bad_block = -1;
+    if (backup_dir == NULL) {
+        printf("Error: Invalid scrub arguments\n");
+        return 0;
+    }
+    if (days <= 0) days = 1;
+
+    // Manifests against their trees: metadata only
+    DIR* dir = opendir(backup_dir);
+    if (dir == NULL) {
+        printf("Error: Cannot open %s\n", backup_dir);
+        return 0;
+    }
+    struct dirent* item;
+    char name[MAX_BACKUP_NAME_LENGTH];
+    size_t ext = strlen(MANIFEST_EXTENSION);
+    while ((item = readdir(dir)) != NULL) {
+        size_t length = strlen(item->d_name);
+        if (length <= ext || length - ext >= sizeof(name) ||
+            strcmp(item->d_name + length - ext, MANIFEST_EXTENSION) != 0) {
+            continue;
+        }
+        memcpy(name, item->d_name, length - ext);
+        name[length - ext] = '\0';
+        report->manifests_checked++;
+        if (!verify_scrub_manifest(backup_dir, name)) report->manifests_bad++;
+    }
+    closedir(dir);
+
+    // Today's slice of the store: the prefixes congruent to the day
+    VerifyTask task;
+    memset(&task, 0, sizeof(task));
+    task.store = chunk_store_open(backup_dir);
+    if (task.store == NULL) {
+        return 0;
+    }
+    chunk_store_set_options(task.store, 1, NULL);
+    if (key != NULL && (task.keyed_store = chunk_store_open(backup_dir)) != NULL) {
+        chunk_store_set_options(task.keyed_store, 1, key);
+    }
+    int slice = (int)((time(NULL) / 86400) % days);
+    int count = 0, capacity = 0;
+    char prefix_path[MAX_BACKUP_PATH_LENGTH + 8];
+    for (int prefix = slice; prefix < 256; prefix += days) {
+        snprintf(prefix_path, sizeof(prefix_path), "%s/%02x", task.store->root, prefix);
+        DIR* chunks = opendir(prefix_path);
+        if (chunks == NULL) continue;
+        while ((item = readdir(chunks)) != NULL) {
+            if (strlen(item->d_name) != CRYPTO_SHA256_SIZE * 2) continue;     // Skips temporaries
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 1024;
+                void* grown = realloc(task.names, sizeof(*task.names) * (size_t)capacity);
+                if (grown == NULL) break;
+                task.names = (char(*)[CRYPTO_SHA256_SIZE * 2 + 1])grown;
+            }
+            memcpy(task.names[count++], item->d_name, CRYPTO_SHA256_SIZE * 2 + 1);
+        }
+        closedir(chunks);
+    }
+
+    task.verify = verify_scrub_chunk;
+    verify_run(&task, 0, count, threads);
+    verify_report_merge(report, &task.report);
+    free(task.names);
+    chunk_store_close(task.keyed_store);
+    chunk_store_close(task.store);
+    return report->manifests_bad == 0 && report->chunks_bad == 0;
+}
+
+void display_verify_report(const VerifyReport* report) {
+    if (report == NULL) {
+        return;
+    }
+    printf("\n=== BACKUP VERIFICATION ===\n");
+    if (report->manifests_checked > 0) {
+        printf("Manifests:        %d checked, %d bad\n", report->manifests_checked, report->manifests_bad);
+    }
+    if (report->blocks_checked > 0) {
+        printf("Blocks:           %d checked, %d bad", report->blocks_checked, report->blocks_bad);
+        if (report->first_bad_block >= 0) printf(" (first %d)", report->first_bad_block);
+        printf("\n");
+    }
+    printf("Chunks:           %lld checked, %lld bad\n", report->chunks_checked, report->chunks_bad);
+    printf("Data:             %.1f MB read back\n", (double)report->bytes_checked / 1048576.0);
+}
+
+// ---- backup.h validation functions ----
+
+// Splits "<dir>/<name>.manifest" into its directory and backup name
+static int verify_split_path(const char* backup_path, char* dir, size_t dir_size, char* name, size_t name_size) {
+    const char* slash = strrchr(backup_path, '/');
+    const char* base = slash != NULL ? slash + 1 : backup_path;
+    size_t length = strlen(base);
+    size_t ext = strlen(MANIFEST_EXTENSION);
+    if (length > ext && strcmp(base + length - ext, MANIFEST_EXTENSION) == 0) {
+        length -= ext;
+    }
+    if (length == 0 || length >= name_size) {
+        printf("Error: Invalid backup path %s\n", backup_path);
+        return 0;
+    }
+    memcpy(name, base, length);
+    name[length] = '\0';
+    if (slash == NULL) {
+        snprintf(dir, dir_size, ".");
+    } else {
+        snprintf(dir, dir_size, "%.*s", (int)(slash - backup_path), backup_path);
+    }
+    return 1;
+}
+
+// Reads back every chunk of the backup, in parallel over blocks
+int validate_backup_integrity(const char* backup_path) {
+    char dir[MAX_BACKUP_PATH_LENGTH], name[MAX_BACKUP_NAME_LENGTH];
+    if (backup_path == NULL || !verify_split_path(backup_path, dir, sizeof(dir), name, sizeof(name))) {
+        return 0;
+    }
+    return backup_verify_blocks(name, dir, NULL, 0, -1, 0, NULL);
+}
+
+// Checks the manifest against the expected checksum and its Merkle tree;
+// no chunk data is read
+int verify_backup_checksum(const char* backup_path, const char* expected_checksum) {
+    char dir[MAX_BACKUP_PATH_LENGTH], name[MAX_BACKUP_NAME_LENGTH];
+    char checksum[CRYPTO_SHA256_SIZE * 2 + 1];
+    if (backup_path == NULL || expected_checksum == NULL ||
+        !verify_split_path(backup_path, dir, sizeof(dir), name, sizeof(name))) {
+        return 0;
+    }
+    char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH + 16];
+    verify_path(dir, name, MANIFEST_EXTENSION, path, sizeof(path));
+    if (!calculate_backup_checksum(path, checksum) || strcasecmp(checksum, expected_checksum) != 0) {
+        printf("Error: Backup %s does not match the expected checksum\n", name);
+        return 0;
+    }
+    return verify_scrub_manifest(dir, name);
+}
+
+// Chunks one source file the way the backup did and lists its chunk addresses
+static ChunkRef* compare_chunk_source(ChunkStore* store, const char* path, unsigned char* buffer, int* count) {
+    FILE* input = fopen(path, "rb");
+    if (input == NULL) {
+        return NULL;
+    }
+    int capacity = 64, n = 0, have = 0, eof = 0;
+    ChunkRef* refs = (ChunkRef*)malloc(sizeof(ChunkRef) * capacity);
+    while (refs != NULL) {
+        if (!eof) {
+            size_t got = fread(buffer + have, 1, VERIFY_READ_SIZE, input);
+            eof = got == 0;
+            have += (int)got;
+        }
+        int pos = 0, length;
+        while (refs != NULL && (length = chunk_next_boundary(buffer + pos, have - pos, eof)) > 0) {
+            if (n == capacity) {
+                capacity *= 2;
+                ChunkRef* grown = (ChunkRef*)realloc(refs, sizeof(ChunkRef) * capacity);
+                if (grown == NULL) {
+                    free(refs);
+                    refs = NULL;
+                    break;
+                }
+                refs = grown;
+            }
+            chunk_store_address(store, buffer + pos, length, &refs[n++]);
+            pos += length;
+        }
+        if (eof || refs == NULL) break;
+        memmove(buffer, buffer + pos, (size_t)(have - pos));
+        have -= pos;
+    }
+    fclose(input);
+    *count = n;
+    return refs;
+}
+
+static int compare_file(ChunkStore* store, const ManifestFile* file, const char* source_path, unsigned char* buffer) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", source_path, file->path);
+    int count = 0;
+    ChunkRef* refs = compare_chunk_source(store, path, buffer, &count);
+    if (refs == NULL) {
+        printf("Missing:  %s\n", file->path);
+        return 0;
+    }
+
+    const ChunkRef** source = (const ChunkRef**)malloc(sizeof(ChunkRef*) * (size_t)(count > 0 ? count : 1));
+    const ChunkRef** backup = (const ChunkRef**)malloc(sizeof(ChunkRef*) * (size_t)(file->chunk_count > 0 ? file->chunk_count : 1));
+    for (int i = 0; source != NULL && i < count; i++) source[i] = &refs[i];
+    for (int i = 0; backup != NULL && i < file->chunk_count; i++) backup[i] = &file->chunks[i];
+    MerkleTree* a = source != NULL ? merkle_tree_build(source, count) : NULL;
+    MerkleTree* b = backup != NULL ? merkle_tree_build(backup, file->chunk_count) : NULL;
+
+    int blocks[VERIFY_MAX_RANGES];
+    int found = merkle_tree_diff(a, b, blocks, VERIFY_MAX_RANGES);
+    if (found > 0) {
+        printf("Changed:  %s (%d block%s differ", file->path, found, found == 1 ? "" : "s");
+        // Byte ranges of the differing blocks in the source file
+        for (int k = 0; k < found && k < VERIFY_MAX_RANGES; k++) {
+            long long start = 0, end = 0;
+            for (int i = 0; i < count; i++) {
+                if (i < blocks[k] * MERKLE_BLOCK_CHUNKS) start += refs[i].length;
+                if (i < (blocks[k] + 1) * MERKLE_BLOCK_CHUNKS) end += refs[i].length;
+            }
+            printf("%s [%lld, %lld)", k == 0 ? ":" : ",", start, end);
+        }
+        printf("%s)\n", found > VERIFY_MAX_RANGES ? ", ..." : "");
+    } else if (found < 0) {
+        printf("Error: Cannot compare %s\n", file->path);
+    }
+    merkle_tree_destroy(a);
+    merkle_tree_destroy(b);
+    free(source);
+    free(backup);
+    free(refs);
+    return found == 0;
+}
+
+// Re-chunks each source file and compares its chunk tree with the
+// backup's top-down; returns 1 when every file matches
+int compare_backup_with_source(const char* backup_path, const char* source_path) {
+    if (backup_path == NULL || source_path == NULL) {
+        printf("Error: Invalid compare arguments\n");
+        return 0;
+    }
+    BackupManifest* manifest = backup_manifest_load(backup_path);
+    if (manifest == NULL) {
+        return 0;
+    }
+    if (manifest->encrypted) {
+        // Keyed chunk addresses cannot be recomputed without the key
+        printf("Error: Backup %s is encrypted; restore it to compare\n", manifest->name);
+        backup_manifest_destroy(manifest);
+        return 0;
+    }
+    ChunkStore store;
+    memset(&store, 0, sizeof(store));
+    unsigned char* buffer = (unsigned char*)malloc(VERIFY_READ_SIZE + CHUNK_MAX_SIZE);
+    int same = buffer != NULL;
+    for (int i = 0; buffer != NULL && i < manifest->file_count; i++) {
+        if (!compare_file(&store, &manifest->files[i], source_path, buffer)) same = 0;
+    }
+    free(buffer);
+    backup_manifest_destroy(manifest);
+    return same;
+}
@@ -0,0 +1,500 @@
+#include "calendar.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CALENDAR_SECONDS_PER_DAY 86400L
+#define CALENDAR_YEAR_COUNT (CALENDAR_MAX_YEAR - CALENDAR_MIN_YEAR + 1)
+
+typedef struct {
+    int year;   // 0 for a holiday that repeats every year
+    int month;
+    int day;
+} CalendarHoliday;
+
+typedef struct {
+    int start_month;
+    int start_day;
+    int end_month;
+    int end_day;
+} CalendarTerm;
+
+// Tables built under one holiday and term configuration, one per year,
+// published once and read without locking afterwards. A configuration change
+// swaps in a fresh cache; the old one is retired, not freed, because readers
+// may still hold its tables, and calendar_cleanup releases it.
+typedef struct CalendarCache {
+    _Atomic(AcademicCalendar*) years[CALENDAR_YEAR_COUNT];
+    unsigned long generation;
+    struct CalendarCache* retired_next;
+} CalendarCache;
+
+static CalendarCache calendar_initial_cache;
+static _Atomic(CalendarCache*) calendar_current = &calendar_initial_cache;
+static CalendarCache* calendar_retired = NULL;
+static unsigned long calendar_generation = 0;
+static pthread_mutex_t calendar_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Each thread remembers its last table, so threads working on different
+// years do not keep rewriting one shared pointer
+static __thread const AcademicCalendar* calendar_last_used;
+static __thread unsigned long calendar_last_generation;
+
+static CalendarHoliday calendar_holidays[CALENDAR_MAX_HOLIDAYS];
+static int calendar_holiday_count = 0;
+static CalendarTerm calendar_terms[CALENDAR_MAX_TERMS];
+static int calendar_term_count = 0;
+
+static long floor_div(long long value, long divisor) {
+    long long q = value / divisor;
+    if ((value % divisor) != 0 && ((value < 0) != (divisor < 0))) {
+        q--;
+    }
+    return (long)q;
+}
+
+long calendar_days_from_civil(int year, int month, int day) {
+    // Howard Hinnant's days_from_civil
+    long y = year - (month <= 2);
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void calendar_civil_from_days(long day_number, int* year, int* month, int* day) {
+    long z = day_number + 719468;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    int d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    int m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    long y = yoe + era * 400 + (m <= 2);
+
+    if (year) *year = (int)y;
+    if (month) *month = m;
+    if (day) *day = d;
+}
+
+int calendar_day_of_year(long day_number) {
+    int year;
+    calendar_civil_from_days(day_number, &year, NULL, NULL);
+    return (int)(day_number - calendar_days_from_civil(year, 1, 1)) + 1;
+}
+
+// Used while no holidays or terms have been configured
+static const CalendarHoliday calendar_default_holidays[] = {
+    {0, 1, 1}, {0, 5, 1}, {0, 12, 25}
+};
+static const CalendarTerm calendar_default_terms[] = {
+    {9, 1, 6, 30}   // September 1st through June 30th
+};
+
+static int calendar_holiday_matches(int year, int month, int day) {
+    const CalendarHoliday* holidays = calendar_holidays;
+    int count = calendar_holiday_count;
+    if (count == 0) {
+        holidays = calendar_default_holidays;
+        count = (int)(sizeof(calendar_default_holidays) / sizeof(calendar_default_holidays[0]));
+    }
+
+    for (int i = 0; i < count; i++) {
+        const CalendarHoliday* h = &holidays[i];
+        if (h->month == month && h->day == day && (h->year == 0 || h->year == year)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int calendar_term_matches(int month, int day) {
+    const CalendarTerm* terms = calendar_terms;
+    int count = calendar_term_count;
+    if (count == 0) {
+        terms = calendar_default_terms;
+        count = (int)(sizeof(calendar_default_terms) / sizeof(calendar_default_terms[0]));
+    }
+
+    int md = month * 100 + day;
+    for (int i = 0; i < count; i++) {
+        const CalendarTerm* t = &terms[i];
+        int start = t->start_month * 100 + t->start_day;
+        int end = t->end_month * 100 + t->end_day;
+        if (start <= end) {
+            if (md >= start && md <= end) return 1;
+        } else if (md >= start || md <= end) {
+            // Term wraps around the new year
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static AcademicCalendar* calendar_build(int year) {
+    AcademicCalendar* cal = (AcademicCalendar*)malloc(sizeof(AcademicCalendar));
+    if (cal == NULL) {
+        printf("Error: Failed to allocate academic calendar for %d\n", year);
+        return NULL;
+    }
+    memset(cal, 0, sizeof(AcademicCalendar));
+
+    cal->year = year;
+    cal->first_day_number = calendar_days_from_civil(year, 1, 1);
+    cal->day_count = (int)(calendar_days_from_civil(year + 1, 1, 1) - cal->first_day_number);
+
+    for (int i = 0; i <= cal->day_count; i++) {
+        // mktime normalizes the overflowing day of month and resolves DST
+        struct tm tm_date = {0};
+        tm_date.tm_year = year - 1900;
+        tm_date.tm_mon = 0;
+        tm_date.tm_mday = 1 + i;
+        tm_date.tm_isdst = -1;
+        cal->day_start[i] = mktime(&tm_date);
+    }
+
+    int school_days = 0;
+    for (int i = 0; i < cal->day_count; i++) {
+        long day_number = cal->first_day_number + i;
+        int month, day;
+        calendar_civil_from_days(day_number, NULL, &month, &day);
+
+        // 1970-01-01 was a Thursday
+        int weekday = (int)(((day_number % 7) + 11) % 7);
+        unsigned char flags = (unsigned char)weekday;
+        if (weekday == 0 || weekday == 6) flags |= CALENDAR_FLAG_WEEKEND;
+        if (calendar_holiday_matches(year, month, day)) flags |= CALENDAR_FLAG_HOLIDAY;
+        if (calendar_term_matches(month, day)) flags |= CALENDAR_FLAG_TERM;
+        if ((flags & CALENDAR_FLAG_TERM) && !(flags & (CALENDAR_FLAG_WEEKEND | CALENDAR_FLAG_HOLIDAY))) {
+            flags |= CALENDAR_FLAG_SCHOOL_DAY;
+        }
+
+        cal->day_flags[i] = flags;
+        cal->school_days_before[i] = school_days;
+        if (flags & CALENDAR_FLAG_SCHOOL_DAY) school_days++;
+    }
+    cal->school_days_before[cal->day_count] = school_days;
+
+    return cal;
+}
+
+static const AcademicCalendar* calendar_cache_year(CalendarCache* cache, int year) {
+    if (year < CALENDAR_MIN_YEAR || year > CALENDAR_MAX_YEAR) {
+        return NULL;
+    }
+
+    int slot = year - CALENDAR_MIN_YEAR;
+    AcademicCalendar* cal = atomic_load_explicit(&cache->years[slot], memory_order_acquire);
+    if (cal != NULL) {
+        return cal;
+    }
+
+    pthread_mutex_lock(&calendar_lock);
+    cal = atomic_load_explicit(&cache->years[slot], memory_order_relaxed);
+    if (cal == NULL) {
+        cal = calendar_build(year);
+        if (cal != NULL) {
+            atomic_store_explicit(&cache->years[slot], cal, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&calendar_lock);
+    return cal;
+}
+
+const AcademicCalendar* calendar_get_year(int year) {
+    return calendar_cache_year(atomic_load_explicit(&calendar_current, memory_order_acquire), year);
+}
+
+// Find the table and day index holding a timestamp; NULL when out of range
+static const AcademicCalendar* calendar_lookup(time_t date, int* index) {
+    CalendarCache* cache = atomic_load_explicit(&calendar_current, memory_order_acquire);
+    const AcademicCalendar* cal = calendar_last_used;
+
+    if (cal == NULL || calendar_last_generation != cache->generation ||
+        date < cal->day_start[0] || date >= cal->day_start[cal->day_count]) {
+        // Local offsets are under one day, so the UTC year is this year or a neighbour
+        int year;
+        calendar_civil_from_days(floor_div((long long)date, CALENDAR_SECONDS_PER_DAY), &year, NULL, NULL);
+        cal = calendar_cache_year(cache, year);
+        if (cal != NULL && date < cal->day_start[0]) {
+            cal = calendar_cache_year(cache, year - 1);
+        } else if (cal != NULL && date >= cal->day_start[cal->day_count]) {
+            cal = calendar_cache_year(cache, year + 1);
+        }
+        if (cal == NULL) {
+            return NULL;
+        }
+        calendar_last_used = cal;
+        calendar_last_generation = cache->generation;
+    }
+
+    // Days are 86400s except around DST changes, so the guess is off by at most one
+    long i = (long)((date - cal->day_start[0]) / CALENDAR_SECONDS_PER_DAY);
+    if (i >= cal->day_count) i = cal->day_count - 1;
+    while (i > 0 && date < cal->day_start[i]) i--;
+    while (i + 1 < cal->day_count && date >= cal->day_start[i + 1]) i++;
+
+    *index = (int)i;
+    return cal;
+}
+
+long calendar_day_number(time_t date) {
+    int index;
+    const AcademicCalendar* cal = calendar_lookup(date, &index);
+    if (cal != NULL) {
+        return cal->first_day_number + index;
+    }
+
+    // Outside the cached range: fall back to the C library
+    struct tm tm_date;
+    if (localtime_r(&date, &tm_date) == NULL) {
+        return floor_div((long long)date, CALENDAR_SECONDS_PER_DAY);
+    }
+    return calendar_days_from_civil(tm_date.tm_year + 1900, tm_date.tm_mon + 1, tm_date.tm_mday);
+}
+
+time_t calendar_day_start(long day_number) {
+    int year, month, day;
+    calendar_civil_from_days(day_number, &year, &month, &day);
+
+    const AcademicCalendar* cal = calendar_get_year(year);
+    if (cal != NULL) {
+        return cal->day_start[day_number - cal->first_day_number];
+    }
+
+    struct tm tm_date = {0};
+    tm_date.tm_year = year - 1900;
+    tm_date.tm_mon = month - 1;
+    tm_date.tm_mday = day;
+    tm_date.tm_isdst = -1;
+    return mktime(&tm_date);
+}
+
+int calendar_day_flags(time_t date) {
+    int index;
+    const AcademicCalendar* cal = calendar_lookup(date, &index);
+    if (cal != NULL) {
+        return cal->day_flags[index];
+    }
+    return calendar_day_flags_by_number(calendar_day_number(date));
+}
+
+int calendar_day_flags_by_number(long day_number) {
+    int year;
+    calendar_civil_from_days(day_number, &year, NULL, NULL);
+
+    const AcademicCalendar* cal = calendar_get_year(year);
+    if (cal != NULL) {
+        return cal->day_flags[day_number - cal->first_day_number];
+    }
+
+    // Out of range years still get weekday and weekend information
+    int weekday = (int)(((day_number % 7) + 11) % 7);
+    return weekday | ((weekday == 0 || weekday == 6) ? CALENDAR_FLAG_WEEKEND : 0);
+}
+
+int calendar_weekday(time_t date) {
+    return calendar_day_flags(date) & CALENDAR_WEEKDAY_MASK;
+}
+
+int calendar_is_weekend(time_t date) {
+    return (calendar_day_flags(date) & CALENDAR_FLAG_WEEKEND) != 0;
+}
+
+int calendar_is_holiday(time_t date) {
+    return (calendar_day_flags(date) & CALENDAR_FLAG_HOLIDAY) != 0;
+}
+
+int calendar_is_term_day(time_t date) {
+    return (calendar_day_flags(date) & CALENDAR_FLAG_TERM) != 0;
+}
+
+int calendar_is_school_day(time_t date) {
+    return (calendar_day_flags(date) & CALENDAR_FLAG_SCHOOL_DAY) != 0;
+}
+
+int calendar_days_between(time_t start_date, time_t end_date) {
+    return (int)(calendar_day_number(end_date) - calendar_day_number(start_date));
+}
+
+// School days in [start_day, end_day), summed from the per-year prefix tables
+static long calendar_count_school_days(long start_day, long end_day) {
+    long total = 0;
+    long day = start_day;
+
+    while (day < end_day) {
+        int year;
+        calendar_civil_from_days(day, &year, NULL, NULL);
+        const AcademicCalendar* cal = calendar_get_year(year);
+        long year_end = calendar_days_from_civil(year + 1, 1, 1);
+        long stop = end_day < year_end ? end_day : year_end;
+
+        if (cal != NULL) {
+            total += cal->school_days_before[stop - cal->first_day_number] -
+                     cal->school_days_before[day - cal->first_day_number];
+        }
+        day = stop;
+    }
+    return total;
+}
+
+int calendar_school_days_between(time_t start_date, time_t end_date) {
+    long start_day = calendar_day_number(start_date);
+    long end_day = calendar_day_number(end_date);
+
+    if (end_day >= start_day) {
+        return (int)calendar_count_school_days(start_day, end_day);
+    }
+    return -(int)calendar_count_school_days(end_day, start_day);
+}
+
+int calendar_add_holiday(int month, int day) {
+    return calendar_add_holiday_date(0, month, day);
+}
+
+int calendar_add_holiday_date(int year, int month, int day) {
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        printf("Error: Invalid holiday date %d-%d\n", month, day);
+        return 0;
+    }
+
+    pthread_mutex_lock(&calendar_lock);
+    if (calendar_holiday_count >= CALENDAR_MAX_HOLIDAYS) {
+        pthread_mutex_unlock(&calendar_lock);
+        printf("Error: Holiday table is full\n");
+        return 0;
+    }
+    calendar_holidays[calendar_holiday_count++] = (CalendarHoliday){year, month, day};
+    pthread_mutex_unlock(&calendar_lock);
+
+    calendar_reset();
+    return 1;
+}
+
+int calendar_add_term(int start_month, int start_day, int end_month, int end_day) {
+    if (start_month < 1 || start_month > 12 || end_month < 1 || end_month > 12 ||
+        start_day < 1 || start_day > 31 || end_day < 1 || end_day > 31) {
+        printf("Error: Invalid term range\n");
+        return 0;
+    }
+
+    pthread_mutex_lock(&calendar_lock);
+    if (calendar_term_count >= CALENDAR_MAX_TERMS) {
+        pthread_mutex_unlock(&calendar_lock);
+        printf("Error: Term table is full\n");
+        return 0;
+    }
+    calendar_terms[calendar_term_count++] = (CalendarTerm){start_month, start_day, end_month, end_day};
+    pthread_mutex_unlock(&calendar_lock);
+
+    calendar_reset();
+    return 1;
+}
+
+void calendar_clear_configuration(void) {
+    pthread_mutex_lock(&calendar_lock);
+    calendar_holiday_count = 0;
+    calendar_term_count = 0;
+    pthread_mutex_unlock(&calendar_lock);
+
+    calendar_reset();
+}
+
+// Start from empty tables. Lookups already running finish on the old cache,
+// which stays allocated until calendar_cleanup.
+void calendar_reset(void) {
+    CalendarCache* fresh = (CalendarCache*)calloc(1, sizeof(CalendarCache));
+    if (fresh == NULL) {
+        printf("Error: Failed to allocate calendar cache\n");
+        return;
+    }
+
+    pthread_mutex_lock(&calendar_lock);
+    fresh->generation = ++calendar_generation;
+    CalendarCache* old = atomic_exchange_explicit(&calendar_current, fresh, memory_order_acq_rel);
+    old->retired_next = calendar_retired;
+    calendar_retired = old;
+    pthread_mutex_unlock(&calendar_lock);
+}
+
+static void calendar_cache_free_tables(CalendarCache* cache) {
+    for (int i = 0; i < CALENDAR_YEAR_COUNT; i++) {
+        free(atomic_exchange_explicit(&cache->years[i], NULL, memory_order_relaxed));
+    }
+}
+
+void calendar_cleanup(void) {
+    pthread_mutex_lock(&calendar_lock);
+    while (calendar_retired != NULL) {
+        CalendarCache* next = calendar_retired->retired_next;
+        calendar_cache_free_tables(calendar_retired);
+        if (calendar_retired != &calendar_initial_cache) {
+            free(calendar_retired);
+        }
+        calendar_retired = next;
+    }
+    // The current cache stays published, empty, under a new generation so
+    // tables remembered by this thread are not used again
+    CalendarCache* current = atomic_load_explicit(&calendar_current, memory_order_relaxed);
+    calendar_cache_free_tables(current);
+    current->generation = ++calendar_generation;
+    pthread_mutex_unlock(&calendar_lock);
+}
+
+static double calendar_elapsed_ns(struct timespec* start, struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+void calendar_benchmark(long iterations) {
+    if (iterations <= 0) {
+        printf("Error: Invalid iteration count\n");
+        return;
+    }
+
+    time_t base = calendar_day_start(calendar_days_from_civil(2020, 1, 1));
+    long span = 10L * 365 * CALENDAR_SECONDS_PER_DAY;
+    unsigned long long seed = 88172645463325252ULL;
+    long school_days = 0;
+    long weekend_days = 0;
+    struct timespec start, end;
+
+    // Warm the tables so the build cost is not measured
+    calendar_is_school_day(base);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        time_t date = base + (time_t)(seed % (unsigned long long)span);
+        int flags = calendar_day_flags(date);
+        school_days += (flags & CALENDAR_FLAG_SCHOOL_DAY) != 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double table_ns = calendar_elapsed_ns(&start, &end);
+
+    seed = 88172645463325252ULL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        time_t date = base + (time_t)(seed % (unsigned long long)span);
+        struct tm tm_date;
+        localtime_r(&date, &tm_date);
+        weekend_days += (tm_date.tm_wday == 0 || tm_date.tm_wday == 6);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double libc_ns = calendar_elapsed_ns(&start, &end);
+
+    printf("\n=== CALENDAR BENCHMARK (%ld dates) ===\n", iterations);
+    printf("Calendar table: %8.1f ms  (%6.1f ns/date, %ld school days)\n",
+           table_ns / 1e6, table_ns / iterations, school_days);
+    printf("localtime_r:    %8.1f ms  (%6.1f ns/date, %ld weekend days)\n",
+           libc_ns / 1e6, libc_ns / iterations, weekend_days);
+    if (table_ns > 0) {
+        printf("Speedup:        %8.1fx\n", libc_ns / table_ns);
+    }
+}
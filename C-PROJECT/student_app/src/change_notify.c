@@ -0,0 +1,81 @@
+#include "change_notify.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef struct {
+    ChangeListener listener;
+    void* user_data;
+} ChangeSubscription;
+
+static ChangeSubscription change_subscriptions[CHANGE_NOTIFY_MAX_LISTENERS];
+static int change_subscription_count = 0;
+static pthread_mutex_t change_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int change_notify_subscribe(ChangeListener listener, void* user_data) {
+    if (listener == NULL) {
+        printf("Error: Invalid change listener\n");
+        return 0;
+    }
+
+    pthread_mutex_lock(&change_lock);
+    if (change_subscription_count >= CHANGE_NOTIFY_MAX_LISTENERS) {
+        pthread_mutex_unlock(&change_lock);
+        printf("Error: Too many change listeners\n");
+        return 0;
+    }
+    change_subscriptions[change_subscription_count].listener = listener;
+    change_subscriptions[change_subscription_count].user_data = user_data;
+    change_subscription_count++;
+    pthread_mutex_unlock(&change_lock);
+    return 1;
+}
+
+int change_notify_unsubscribe(ChangeListener listener, void* user_data) {
+    pthread_mutex_lock(&change_lock);
+    for (int i = 0; i < change_subscription_count; i++) {
+        if (change_subscriptions[i].listener == listener &&
+            change_subscriptions[i].user_data == user_data) {
+            for (int j = i; j < change_subscription_count - 1; j++) {
+                change_subscriptions[j] = change_subscriptions[j + 1];
+            }
+            change_subscription_count--;
+            pthread_mutex_unlock(&change_lock);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(&change_lock);
+    return 0;
+}
+
+int change_notify_has_listeners(void) {
+    return change_subscription_count > 0;
+}
+
+void change_notify_publish(EntityType entity, ChangeType type, const void* list,
+                           const void* old_record, const void* new_record) {
+    // Nothing subscribed: keep list mutations free of any locking
+    if (change_subscription_count == 0) {
+        return;
+    }
+
+    ChangeEvent event;
+    event.entity = entity;
+    event.type = type;
+    event.list = list;
+    event.old_record = old_record;
+    event.new_record = new_record;
+
+    ChangeSubscription subscriptions[CHANGE_NOTIFY_MAX_LISTENERS];
+    pthread_mutex_lock(&change_lock);
+    int count = change_subscription_count;
+    for (int i = 0; i < count; i++) {
+        subscriptions[i] = change_subscriptions[i];
+    }
+    pthread_mutex_unlock(&change_lock);
+
+    for (int i = 0; i < count; i++) {
+        subscriptions[i].listener(&event, subscriptions[i].user_data);
+    }
+}
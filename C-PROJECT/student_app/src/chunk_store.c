@@ -0,0 +1,609 @@
+#include "chunk_store.h"
+#include "crypto.h"
+#include "config.h"
+#include "lz_block.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+// FastCDC masks for an 8 KB average: harder to match below the average
+// size, easier above it, which narrows the chunk size distribution
+#define CHUNK_MASK_SMALL 0x0003590703530000ULL
+#define CHUNK_MASK_LARGE 0x0000d90003530000ULL
+
+#define MANIFEST_VERSION 1
+
+// ---- Chunking ----
+
+// The table fixes where chunks are cut; changing it would stop new
+// backups from sharing chunks with old ones
+static unsigned long long chunk_gear[256];
+static pthread_once_t chunk_gear_once = PTHREAD_ONCE_INIT;
+
+static void chunk_gear_init(void) {
+    unsigned long long state = 0x5EED0F5C0DE5EEDULL;
+    for (int i = 0; i < 256; i++) {
+        state += 0x9E3779B97F4A7C15ULL;
+        unsigned long long z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        chunk_gear[i] = z ^ (z >> 31);
+    }
+}
+
+int chunk_next_boundary(const unsigned char* data, int size, int final) {
+    if (data == NULL || size <= 0) {
+        return 0;
+    }
+    if (size <= CHUNK_MIN_SIZE) {
+        return final ? size : 0;
+    }
+    pthread_once(&chunk_gear_once, chunk_gear_init);
+
+    int normal = size < CHUNK_AVG_SIZE ? size : CHUNK_AVG_SIZE;
+    int limit = size < CHUNK_MAX_SIZE ? size : CHUNK_MAX_SIZE;
+    unsigned long long hash = 0;
+    int i = CHUNK_MIN_SIZE;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + chunk_gear[data[i]];
+        if ((hash & CHUNK_MASK_SMALL) == 0) return i + 1;
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + chunk_gear[data[i]];
+        if ((hash & CHUNK_MASK_LARGE) == 0) return i + 1;
+    }
+    if (limit == CHUNK_MAX_SIZE) {
+        return CHUNK_MAX_SIZE;
+    }
+    return final ? size : 0;
+}
+
+// ---- Chunk store ----
+
+static int chunk_make_dir(const char* path) {
+    if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+        return 0;
+    }
+    return 1;
+}
+
+static void chunk_store_path(const ChunkStore* store, const ChunkRef* ref, char* path, size_t size, char* dir, size_t dir_size) {
+    char hex[CRYPTO_SHA256_SIZE * 2 + 1];
+    crypto_sha256_to_hex(ref->digest, hex);
+    if (dir != NULL) {
+        snprintf(dir, dir_size, "%s/%.2s", store->root, hex);
+    }
+    snprintf(path, size, "%s/%.2s/%s", store->root, hex, hex);
+}
+
+ChunkStore* chunk_store_open(const char* backup_dir) {
+    if (backup_dir == NULL) {
+        printf("Error: Backup directory is NULL\n");
+        return NULL;
+    }
+    ChunkStore* store = (ChunkStore*)calloc(1, sizeof(ChunkStore));
+    if (store == NULL) {
+        printf("Error: Failed to create chunk store\n");
+        return NULL;
+    }
+    snprintf(store->root, sizeof(store->root), "%s/%s", backup_dir, CHUNK_DIR_NAME);
+    if (!chunk_make_dir(backup_dir) || !chunk_make_dir(store->root)) {
+        printf("Error: Cannot create chunk store in %s\n", backup_dir);
+        free(store);
+        return NULL;
+    }
+    return store;
+}
+
+void chunk_store_close(ChunkStore* store) {
+    free(store);
+}
+
+int chunk_store_set_options(ChunkStore* store, int compress, const unsigned char* key) {
+    if (store == NULL) {
+        return 0;
+    }
+    store->compress = compress;
+    store->encrypt = key != NULL;
+    if (key != NULL) {
+        memcpy(store->key, key, AES_KEY_SIZE);
+    } else {
+        memset(store->key, 0, AES_KEY_SIZE);
+    }
+    return 1;
+}
+
+int chunk_store_contains(ChunkStore* store, const ChunkRef* ref) {
+    char path[MAX_BACKUP_PATH_LENGTH + 80];
+    struct stat st;
+    chunk_store_path(store, ref, path, sizeof(path), NULL, 0);
+    return stat(path, &st) == 0;
+}
+
+// A hash of an HMAC under the key, so the id is not the address of any
+// chunk and tells nothing about the key
+int chunk_store_key_id(const ChunkStore* store, char* key_id) {
+    static const char label[] = "chunk store key id";
+    if (store == NULL || key_id == NULL) {
+        return 0;
+    }
+    key_id[0] = '\0';
+    if (!store->encrypt) {
+        return 1;
+    }
+    unsigned char mac[CRYPTO_SHA256_SIZE];
+    unsigned char digest[CRYPTO_SHA256_SIZE];
+    if (!crypto_hmac_sha256(store->key, AES_KEY_SIZE, label, sizeof(label), mac) ||
+        !crypto_sha256(mac, sizeof(mac), digest)) {
+        return 0;
+    }
+    for (int i = 0; i < CHUNK_KEY_ID_SIZE; i++) {
+        snprintf(key_id + i * 2, 3, "%02x", digest[i]);
+    }
+    return 1;
+}
+
+int chunk_store_address(ChunkStore* store, const unsigned char* data, int size, ChunkRef* ref) {
+    if (store == NULL || data == NULL || size < 0 || ref == NULL) {
+        return 0;
+    }
+    ref->length = (unsigned int)size;
+    if (store->encrypt) {
+        return crypto_hmac_sha256(store->key, AES_KEY_SIZE, data, (size_t)size, ref->digest);
+    }
+    return crypto_sha256(data, (size_t)size, ref->digest);
+}
+
+int chunk_store_encode(ChunkStore* store, EVP_CIPHER_CTX* ctx, const ChunkRef* ref, const unsigned char* data,
+                       unsigned char* blob) {
+    if (store == NULL || ref == NULL || data == NULL || blob == NULL || ref->length > CHUNK_MAX_SIZE ||
+        (store->encrypt && ctx == NULL)) {
+        return 0;
+    }
+
+    int length = (int)ref->length;
+    unsigned char flags = 0;
+    unsigned char* payload = blob + CHUNK_HEADER_SIZE + (store->encrypt ? CHUNK_NONCE_SIZE : 0);
+    int payload_size = length;
+    if (store->compress && length > 0) {
+        int compressed = lz_block_compress(data, length, payload, lz_block_bound(length));
+        if (compressed > 0 && compressed < length) {
+            flags |= CHUNK_FLAG_COMPRESSED;
+            payload_size = compressed;
+        }
+    }
+    if (!(flags & CHUNK_FLAG_COMPRESSED)) {
+        memcpy(payload, data, (size_t)length);
+    }
+
+    if (store->encrypt) {
+        unsigned char* nonce = blob + CHUNK_HEADER_SIZE;
+        int out_length = 0, final_length = 0;
+        if (RAND_bytes(nonce, CHUNK_NONCE_SIZE) != 1 ||
+            EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CHUNK_NONCE_SIZE, NULL) != 1 ||
+            EVP_EncryptInit_ex(ctx, NULL, NULL, store->key, nonce) != 1 ||
+            EVP_EncryptUpdate(ctx, NULL, &out_length, ref->digest, CRYPTO_SHA256_SIZE) != 1 ||
+            EVP_EncryptUpdate(ctx, payload, &out_length, payload, payload_size) != 1 ||
+            EVP_EncryptFinal_ex(ctx, payload + out_length, &final_length) != 1 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, CHUNK_TAG_SIZE, payload + payload_size) != 1) {
+            printf("Error: Failed to encrypt chunk\n");
+            return 0;
+        }
+        flags |= CHUNK_FLAG_ENCRYPTED;
+        payload_size += CHUNK_NONCE_SIZE + CHUNK_TAG_SIZE;
+    }
+
+    blob[0] = flags;
+    blob[1] = (unsigned char)length;
+    blob[2] = (unsigned char)(length >> 8);
+    blob[3] = (unsigned char)(length >> 16);
+    blob[4] = (unsigned char)(length >> 24);
+    return CHUNK_HEADER_SIZE + payload_size;
+}
+
+// New chunks are synced under a temporary name and renamed into place, so
+// a crash never leaves a partial chunk under a valid address
+int chunk_store_write_blob(ChunkStore* store, const ChunkRef* ref, const unsigned char* blob, int size) {
+    char path[MAX_BACKUP_PATH_LENGTH + 80];
+    char dir[MAX_BACKUP_PATH_LENGTH + 8];
+    char temp[MAX_BACKUP_PATH_LENGTH + 100];
+    chunk_store_path(store, ref, path, sizeof(path), dir, sizeof(dir));
+    if (!chunk_make_dir(dir)) {
+        printf("Error: Cannot create %s\n", dir);
+        return 0;
+    }
+    snprintf(temp, sizeof(temp), "%s.tmp%ld", path, (long)getpid());
+
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL) {
+        printf("Error: Cannot write chunk %s\n", temp);
+        return 0;
+    }
+    int ok = fwrite(blob, 1, (size_t)size, file) == (size_t)size && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || rename(temp, path) != 0) {
+        printf("Error: Failed to store chunk %s\n", path);
+        remove(temp);
+        return 0;
+    }
+    store->dirty_dirs[ref->digest[0]] = 1;
+    return 1;
+}
+
+static int chunk_sync_dir(const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+int chunk_store_sync(ChunkStore* store) {
+    if (store == NULL) {
+        return 0;
+    }
+    char dir[MAX_BACKUP_PATH_LENGTH + 8];
+    int ok = 1;
+    for (int prefix = 0; prefix < 256; prefix++) {
+        if (store->dirty_dirs[prefix]) {
+            snprintf(dir, sizeof(dir), "%s/%02x", store->root, prefix);
+            ok &= chunk_sync_dir(dir);
+            store->dirty_dirs[prefix] = 0;
+        }
+    }
+    // New prefix directories are entries of the root
+    ok &= chunk_sync_dir(store->root);
+    if (!ok) {
+        printf("Error: Could not sync chunk store %s\n", store->root);
+    }
+    return ok;
+}
+
+// Stores the chunk unless a chunk with the same address is already there
+int chunk_store_put(ChunkStore* store, const unsigned char* data, int size, ChunkRef* ref, int* was_new) {
+    if (was_new != NULL) *was_new = 0;
+    if (size > CHUNK_MAX_SIZE || !chunk_store_address(store, data, size, ref)) {
+        return 0;
+    }
+    if (chunk_store_contains(store, ref)) {
+        return 1;
+    }
+
+    unsigned char* blob = (unsigned char*)malloc(CHUNK_BLOB_BOUND);
+    EVP_CIPHER_CTX* ctx = store->encrypt ? EVP_CIPHER_CTX_new() : NULL;
+    int blob_size = blob != NULL && (!store->encrypt || ctx != NULL) ? chunk_store_encode(store, ctx, ref, data, blob) : 0;
+    int ok = blob_size > 0 && chunk_store_write_blob(store, ref, blob, blob_size);
+    EVP_CIPHER_CTX_free(ctx);
+    free(blob);
+    if (ok && was_new != NULL) *was_new = 1;
+    return ok;
+}
+
+int chunk_store_get(ChunkStore* store, const ChunkRef* ref, unsigned char* buffer) {
+    if (store == NULL || ref == NULL || buffer == NULL || ref->length > CHUNK_MAX_SIZE) {
+        return 0;
+    }
+    char path[MAX_BACKUP_PATH_LENGTH + 80];
+    chunk_store_path(store, ref, path, sizeof(path), NULL, 0);
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Error: Missing chunk %s\n", path);
+        return 0;
+    }
+    unsigned char* blob = (unsigned char*)malloc(CHUNK_BLOB_BOUND);
+    int size = blob != NULL ? (int)fread(blob, 1, CHUNK_BLOB_BOUND, file) : 0;
+    fclose(file);
+
+    int ok = size >= CHUNK_HEADER_SIZE;
+    unsigned char flags = ok ? blob[0] : 0;
+    unsigned int length = ok ? (unsigned int)blob[1] | (unsigned int)blob[2] << 8 |
+                               (unsigned int)blob[3] << 16 | (unsigned int)blob[4] << 24 : 0;
+    unsigned char* payload = blob + CHUNK_HEADER_SIZE;
+    int payload_size = size - CHUNK_HEADER_SIZE;
+    ok = ok && length == ref->length;
+
+    if (ok && (flags & CHUNK_FLAG_ENCRYPTED)) {
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        int out_length = 0, final_length = 0;
+        payload_size -= CHUNK_NONCE_SIZE + CHUNK_TAG_SIZE;
+        ok = store->encrypt && ctx != NULL && payload_size >= 0 &&
+             EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CHUNK_NONCE_SIZE, NULL) == 1 &&
+             EVP_DecryptInit_ex(ctx, NULL, NULL, store->key, payload) == 1 &&
+             EVP_DecryptUpdate(ctx, NULL, &out_length, ref->digest, CRYPTO_SHA256_SIZE) == 1 &&
+             EVP_DecryptUpdate(ctx, payload + CHUNK_NONCE_SIZE, &out_length, payload + CHUNK_NONCE_SIZE, payload_size) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, CHUNK_TAG_SIZE,
+                                 payload + CHUNK_NONCE_SIZE + payload_size) == 1 &&
+             EVP_DecryptFinal_ex(ctx, payload + CHUNK_NONCE_SIZE + out_length, &final_length) == 1;
+        EVP_CIPHER_CTX_free(ctx);
+        payload += CHUNK_NONCE_SIZE;
+    }
+    if (ok && (flags & CHUNK_FLAG_COMPRESSED)) {
+        ok = lz_block_decompress(payload, payload_size, buffer, (int)length) == (int)length;
+    } else if (ok) {
+        ok = payload_size == (int)length;
+        if (ok) memcpy(buffer, payload, length);
+    }
+    free(blob);
+
+    ChunkRef check;
+    if (!ok || !chunk_store_address(store, buffer, (int)length, &check) ||
+        memcmp(check.digest, ref->digest, CRYPTO_SHA256_SIZE) != 0) {
+        printf("Error: Corrupt chunk %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// ---- Manifests ----
+
+BackupManifest* backup_manifest_create(const char* name, const char* type) {
+    BackupManifest* manifest = (BackupManifest*)calloc(1, sizeof(BackupManifest));
+    if (manifest == NULL) {
+        printf("Error: Failed to create backup manifest\n");
+        return NULL;
+    }
+    if (name != NULL) strncpy(manifest->name, name, sizeof(manifest->name) - 1);
+    strncpy(manifest->type, type != NULL ? type : BACKUP_TYPE_FULL, sizeof(manifest->type) - 1);
+    manifest->created = time(NULL);
+    return manifest;
+}
+
+void backup_manifest_destroy(BackupManifest* manifest) {
+    if (manifest == NULL) {
+        return;
+    }
+    for (int i = 0; i < manifest->file_count; i++) {
+        free(manifest->files[i].chunks);
+    }
+    free(manifest->files);
+    free(manifest);
+}
+
+ManifestFile* backup_manifest_add_file(BackupManifest* manifest, const char* path) {
+    if (manifest == NULL || path == NULL) {
+        return NULL;
+    }
+    if (manifest->file_count == manifest->file_capacity) {
+        int capacity = manifest->file_capacity > 0 ? manifest->file_capacity * 2 : 16;
+        ManifestFile* files = (ManifestFile*)realloc(manifest->files, sizeof(ManifestFile) * capacity);
+        if (files == NULL) {
+            printf("Error: Failed to grow backup manifest\n");
+            return NULL;
+        }
+        manifest->files = files;
+        manifest->file_capacity = capacity;
+    }
+    ManifestFile* file = &manifest->files[manifest->file_count++];
+    memset(file, 0, sizeof(ManifestFile));
+    strncpy(file->path, path, sizeof(file->path) - 1);
+    return file;
+}
+
+int manifest_file_add_chunk(ManifestFile* file, const ChunkRef* ref) {
+    if (file == NULL || ref == NULL) {
+        return 0;
+    }
+    if (file->chunk_count == file->chunk_capacity) {
+        int capacity = file->chunk_capacity > 0 ? file->chunk_capacity * 2 : 8;
+        ChunkRef* chunks = (ChunkRef*)realloc(file->chunks, sizeof(ChunkRef) * capacity);
+        if (chunks == NULL) {
+            printf("Error: Failed to grow chunk list\n");
+            return 0;
+        }
+        file->chunks = chunks;
+        file->chunk_capacity = capacity;
+    }
+    file->chunks[file->chunk_count++] = *ref;
+    return 1;
+}
+
+ManifestFile* backup_manifest_find_file(BackupManifest* manifest, const char* path) {
+    if (manifest == NULL || path == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < manifest->file_count; i++) {
+        if (strcmp(manifest->files[i].path, path) == 0) {
+            return &manifest->files[i];
+        }
+    }
+    return NULL;
+}
+
+// Text format, one record per line:
+//   MANIFEST 1 / NAME n / TYPE t / CREATED epoch / COMPRESSED 0|1 / ENCRYPTED 0|1
+//   FILE size mtime mode chunks path
+//   C digest length            (one per chunk of the preceding FILE)
+//   END
+int backup_manifest_save(BackupManifest* manifest, const char* filename) {
+    if (manifest == NULL || filename == NULL) {
+        printf("Error: Invalid arguments to backup_manifest_save\n");
+        return 0;
+    }
+
+    char temp[MAX_BACKUP_PATH_LENGTH + 32];
+    FILE* file = utils_file_open_atomic(filename, temp, sizeof(temp));
+    if (file == NULL) {
+        printf("Error: Cannot write manifest %s\n", filename);
+        return 0;
+    }
+
+    char hex[CRYPTO_SHA256_SIZE * 2 + 1];
+    fprintf(file, "MANIFEST %d\nNAME %s\nTYPE %s\nCREATED %lld\nCOMPRESSED %d\nENCRYPTED %d\n", MANIFEST_VERSION,
+            manifest->name, manifest->type, (long long)manifest->created, manifest->compressed, manifest->encrypted);
+    if (manifest->key_id[0] != '\0') {
+        fprintf(file, "KEY %s\n", manifest->key_id);
+    }
+    for (int i = 0; i < manifest->file_count; i++) {
+        ManifestFile* entry = &manifest->files[i];
+        fprintf(file, "FILE %lld %lld %o %d %s\n", entry->size, entry->mtime, entry->mode,
+                entry->chunk_count, entry->path);
+        for (int c = 0; c < entry->chunk_count; c++) {
+            crypto_sha256_to_hex(entry->chunks[c].digest, hex);
+            fprintf(file, "C %s %u\n", hex, entry->chunks[c].length);
+        }
+    }
+    fprintf(file, "END\n");
+
+    if (ferror(file)) {
+        utils_file_abort_atomic(file, temp);
+        printf("Error: Failed to save manifest %s\n", filename);
+        return 0;
+    }
+    if (!utils_file_commit_atomic(file, temp, filename)) {
+        printf("Error: Failed to save manifest %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+BackupManifest* backup_manifest_load(const char* filename) {
+    if (filename == NULL) {
+        printf("Error: Manifest file name is NULL\n");
+        return NULL;
+    }
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error: Cannot open manifest %s\n", filename);
+        return NULL;
+    }
+
+    BackupManifest* manifest = backup_manifest_create(NULL, NULL);
+    char line[MAX_BACKUP_PATH_LENGTH + 128];
+    int version = 0, ended = 0, ok = manifest != NULL;
+    ManifestFile* current = NULL;
+    while (ok && !ended && fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strncmp(line, "C ", 2) == 0) {
+            char hex[CRYPTO_SHA256_SIZE * 2 + 1];
+            ChunkRef ref;
+            ok = current != NULL && sscanf(line + 2, "%64s %u", hex, &ref.length) == 2 &&
+                 ref.length <= CHUNK_MAX_SIZE && crypto_sha256_from_hex(hex, ref.digest) &&
+                 manifest_file_add_chunk(current, &ref);
+        } else if (strncmp(line, "FILE ", 5) == 0) {
+            long long size, mtime;
+            unsigned int mode;
+            int chunks, offset = 0;
+            ok = sscanf(line + 5, "%lld %lld %o %d %n", &size, &mtime, &mode, &chunks, &offset) == 4 && offset > 0;
+            current = ok ? backup_manifest_add_file(manifest, line + 5 + offset) : NULL;
+            if (current != NULL) {
+                current->size = size;
+                current->mtime = mtime;
+                current->mode = mode;
+            }
+            ok = current != NULL;
+        } else if (strncmp(line, "MANIFEST ", 9) == 0) {
+            version = atoi(line + 9);
+        } else if (strncmp(line, "NAME ", 5) == 0) {
+            // A name or type that does not fit means the manifest is not ours
+            ok = (size_t)snprintf(manifest->name, sizeof(manifest->name), "%s", line + 5) < sizeof(manifest->name);
+        } else if (strncmp(line, "TYPE ", 5) == 0) {
+            ok = (size_t)snprintf(manifest->type, sizeof(manifest->type), "%s", line + 5) < sizeof(manifest->type);
+        } else if (strncmp(line, "CREATED ", 8) == 0) {
+            manifest->created = (time_t)atoll(line + 8);
+        } else if (strncmp(line, "COMPRESSED ", 11) == 0) {
+            manifest->compressed = atoi(line + 11);
+        } else if (strncmp(line, "ENCRYPTED ", 10) == 0) {
+            manifest->encrypted = atoi(line + 10);
+        } else if (strncmp(line, "KEY ", 4) == 0) {
+            ok = (size_t)snprintf(manifest->key_id, sizeof(manifest->key_id), "%s", line + 4) < sizeof(manifest->key_id);
+        } else if (strcmp(line, "END") == 0) {
+            ended = 1;
+        }
+    }
+    fclose(file);
+
+    if (!ok || !ended || version != MANIFEST_VERSION) {
+        printf("Error: Invalid manifest %s\n", filename);
+        backup_manifest_destroy(manifest);
+        return NULL;
+    }
+    return manifest;
+}
+
+// SHA-256 over every path, size and chunk digest, in manifest order
+int backup_manifest_checksum(BackupManifest* manifest, char* checksum) {
+    if (manifest == NULL || checksum == NULL) {
+        return 0;
+    }
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    if (ctx == NULL || EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) != 1) {
+        EVP_MD_CTX_free(ctx);
+        return 0;
+    }
+    for (int i = 0; i < manifest->file_count; i++) {
+        ManifestFile* entry = &manifest->files[i];
+        EVP_DigestUpdate(ctx, entry->path, strlen(entry->path) + 1);
+        EVP_DigestUpdate(ctx, &entry->size, sizeof(entry->size));
+        for (int c = 0; c < entry->chunk_count; c++) {
+            EVP_DigestUpdate(ctx, entry->chunks[c].digest, CRYPTO_SHA256_SIZE);
+        }
+    }
+    unsigned char digest[CRYPTO_SHA256_SIZE];
+    int ok = EVP_DigestFinal_ex(ctx, digest, NULL) == 1;
+    EVP_MD_CTX_free(ctx);
+    if (ok) {
+        crypto_sha256_to_hex(digest, checksum);
+    }
+    return ok;
+}
+
+// Reads just the CREATED line of a manifest
+static time_t backup_manifest_created(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    char line[MAX_BACKUP_PATH_LENGTH];
+    time_t created = 0;
+    for (int i = 0; i < 4 && fgets(line, sizeof(line), file) != NULL; i++) {
+        if (strncmp(line, "CREATED ", 8) == 0) {
+            created = (time_t)atoll(line + 8);
+            break;
+        }
+    }
+    fclose(file);
+    return created;
+}
+
+BackupManifest* backup_manifest_load_latest(const char* backup_dir) {
+    if (backup_dir == NULL) {
+        return NULL;
+    }
+    DIR* dir = opendir(backup_dir);
+    if (dir == NULL) {
+        return NULL;
+    }
+
+    char best[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH] = "";
+    char path[MAX_BACKUP_PATH_LENGTH + MAX_BACKUP_NAME_LENGTH];
+    time_t best_time = 0;
+    size_t extension = strlen(MANIFEST_EXTENSION);
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        size_t length = strlen(item->d_name);
+        if (length <= extension || strcmp(item->d_name + length - extension, MANIFEST_EXTENSION) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", backup_dir, item->d_name);
+        time_t created = backup_manifest_created(path);
+        if (best[0] == '\0' || created > best_time || (created == best_time && strcmp(path, best) > 0)) {
+            strcpy(best, path);
+            best_time = created;
+        }
+    }
+    closedir(dir);
+    return best[0] != '\0' ? backup_manifest_load(best) : NULL;
+}
@@ -1,5 +1,6 @@
 #include "student.h"
 #include "config.h"
+#include "utils.h"
 #include "crypto.h"
 #include "ui.h"
 #include "file_manager.h"
@@ -8,6 +9,8 @@
 #include "attendance.h"
 #include "grade.h"
 #include "club.h"
+#include "change_notify.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +32,11 @@ ClubList* club_list_create(void){
     list->clubs = clubs;
     list->count = 0;
     list->capacity = MAX_CLUBS;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&list->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
     return list;    
 
 }
@@ -39,10 +47,20 @@ void club_list_destroy(ClubList* list){
     if(list->clubs != NULL){
         free(list->clubs);
     }
+    pthread_mutex_destroy(&list->lock);
     free(list);
 }
-
-int club_list_add(ClubList* list, Club new_club){
+void club_list_lock(ClubList* list){
+    if(list != NULL){
+        pthread_mutex_lock(&list->lock);
+    }
+}
+void club_list_unlock(ClubList* list){
+    if(list != NULL){
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+static int club_list_add_locked(ClubList* list, Club new_club){
     if(list == NULL || list->clubs == NULL){
         return 0;
     }
@@ -52,24 +70,66 @@ int club_list_add(ClubList* list, Club new_club){
     }
     list->clubs[list->count] = new_club;
     list->count++;
+    LOG_DEBUG(LOG_MODULE_ID_CLUB, "Added club %d (%s), %d in list", new_club.id, new_club.name, list->count);
+    change_notify_publish(ENTITY_CLUB, CHANGE_ADD, list, NULL, &list->clubs[list->count - 1]);
     return 1;
 }
-int club_list_remove(ClubList* list, int club_id){
+
+int club_list_add(ClubList* list, Club new_club){
+    club_list_lock(list);
+    int ok = club_list_add_locked(list, new_club);
+    club_list_unlock(list);
+    return ok;
+}
+static int club_list_remove_locked(ClubList* list, int club_id){
     if(list == NULL || list->clubs == NULL){
         return 0;
     }
     for(int i = 0; i < list->count; i++){
         if(list->clubs[i].id == club_id){
+            Club removed = list->clubs[i];
             for(int j = i; j < list->count - 1; j++){
                 list->clubs[j] = list->clubs[j + 1];
             }
             memset(&list->clubs[list->count - 1], 0, sizeof(Club));
             list->count--;
+            LOG_DEBUG(LOG_MODULE_ID_CLUB, "Removed club %d (%s), %d in list", removed.id, removed.name, list->count);
+            change_notify_publish(ENTITY_CLUB, CHANGE_REMOVE, list, &removed, NULL);
             return 1;
         }
     }
     return 0;
 }
+
+int club_list_remove(ClubList* list, int club_id){
+    club_list_lock(list);
+    int ok = club_list_remove_locked(list, club_id);
+    club_list_unlock(list);
+    return ok;
+}
+static int club_list_update_locked(ClubList* list, Club club){
+    if(list == NULL || list->clubs == NULL){
+        return 0;
+    }
+    for(int i = 0; i < list->count; i++){
+        if(list->clubs[i].id == club.id){
+            Club previous = list->clubs[i];
+            list->clubs[i] = club;
+            LOG_DEBUG(LOG_MODULE_ID_CLUB, "Updated club %d: %d -> %d members", club.id,
+                      previous.member_count, club.member_count);
+            change_notify_publish(ENTITY_CLUB, CHANGE_EDIT, list, &previous, &list->clubs[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int club_list_update(ClubList* list, Club club){
+    club_list_lock(list);
+    int ok = club_list_update_locked(list, club);
+    club_list_unlock(list);
+    return ok;
+}
 Club* club_list_find_by_id(ClubList* list, int club_id){
     if(list == NULL || list->clubs == NULL){
         printf("list is null\n");
@@ -156,6 +216,11 @@ MembershipList* membership_list_create(void) {
         free(list);
         return NULL;
     }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&list->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
     return list;
 }
 
@@ -166,10 +231,23 @@ void membership_list_destroy(MembershipList* list) {
     if (list->memberships != NULL) {
         free(list->memberships);
     }
+    pthread_mutex_destroy(&list->lock);
     free(list);
 }
 
-int membership_list_add(MembershipList* list, ClubMembership membership) {
+void membership_list_lock(MembershipList* list) {
+    if (list != NULL) {
+        pthread_mutex_lock(&list->lock);
+    }
+}
+
+void membership_list_unlock(MembershipList* list) {
+    if (list != NULL) {
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+static int membership_list_add_locked(MembershipList* list, ClubMembership membership) {
     if (list == NULL || list->memberships == NULL) {
         printf("error: invalid arguments to membership_list_add\n");
         return 0;
@@ -187,10 +265,20 @@ int membership_list_add(MembershipList* list, ClubMembership membership) {
     }
     
     list->memberships[list->count++] = membership;
+    LOG_DEBUG(LOG_MODULE_ID_CLUB, "Student %d joined club %d as %s", membership.student_id,
+              membership.club_id, membership.role);
+    change_notify_publish(ENTITY_MEMBERSHIP, CHANGE_ADD, list, NULL, &list->memberships[list->count - 1]);
     return 1;
 }
 
-int membership_list_remove(MembershipList* list, int membership_id) {
+int membership_list_add(MembershipList* list, ClubMembership membership) {
+    membership_list_lock(list);
+    int ok = membership_list_add_locked(list, membership);
+    membership_list_unlock(list);
+    return ok;
+}
+
+static int membership_list_remove_locked(MembershipList* list, int membership_id) {
     if (list == NULL || list->memberships == NULL) {
         printf("error: invalid arguments to membership_list_remove\n");
         return 0;
@@ -198,17 +286,53 @@ int membership_list_remove(MembershipList* list, int membership_id) {
     
     for (int i = 0; i < list->count; i++) {
         if (list->memberships[i].id == membership_id) {
+            ClubMembership removed = list->memberships[i];
             for (int j = i; j < list->count - 1; j++) {
                 list->memberships[j] = list->memberships[j + 1];
             }
             list->count--;
+            LOG_DEBUG(LOG_MODULE_ID_CLUB, "Student %d left club %d", removed.student_id, removed.club_id);
+            change_notify_publish(ENTITY_MEMBERSHIP, CHANGE_REMOVE, list, &removed, NULL);
             return 1;
         }
     }
+    LOG_WARNING(LOG_MODULE_ID_CLUB, "Remove failed: membership %d not found", membership_id);
     printf("error: membership with id %d not found\n", membership_id);
     return 0;
 }
 
+int membership_list_remove(MembershipList* list, int membership_id) {
+    membership_list_lock(list);
+    int ok = membership_list_remove_locked(list, membership_id);
+    membership_list_unlock(list);
+    return ok;
+}
+
+static int membership_list_update_locked(MembershipList* list, ClubMembership membership) {
+    if (list == NULL || list->memberships == NULL) {
+        printf("error: invalid arguments to membership_list_update\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->memberships[i].id == membership.id) {
+            ClubMembership previous = list->memberships[i];
+            list->memberships[i] = membership;
+            change_notify_publish(ENTITY_MEMBERSHIP, CHANGE_EDIT, list, &previous, &list->memberships[i]);
+            return 1;
+        }
+    }
+    printf("error: membership with id %d not found\n", membership.id);
+    return 0;
+}
+
+int membership_list_update(MembershipList* list, ClubMembership membership) {
+    membership_list_lock(list);
+    int ok = membership_list_update_locked(list, membership);
+    membership_list_unlock(list);
+    return ok;
+}
+
 ClubMembership* membership_list_find_by_id(MembershipList* list, int membership_id) {
     if (list == NULL || list->memberships == NULL) {
         printf("error: invalid arguments to membership_list_find_by_id\n");
@@ -223,12 +347,13 @@ ClubMembership* membership_list_find_by_id(MembershipList* list, int membership_
     return NULL;
 }
 
-int club_list_save_to_file(ClubList* list, const char* filename) {
+static int club_list_save_to_file_locked(ClubList* list, const char* filename) {
     if (list == NULL || list->clubs == NULL || filename == NULL) {
         printf("error: invalid arguments to club_list_save_to_file\n");
         return 0;
     }
-    FILE* file = fopen(filename, "w");
+    char temp[512];
+    FILE* file = utils_file_open_atomic(filename, temp, sizeof(temp));
     if (!file) {
         printf("error: could not open file %s for writing\n", filename);
         return 0;
@@ -254,10 +379,21 @@ int club_list_save_to_file(ClubList* list, const char* filename) {
             cb->is_active
         );
     }
-    fclose(file);
+    if (!utils_file_commit_atomic(file, temp, filename)) {
+        printf("error: could not write file %s\n", filename);
+        return 0;
+    }
+    LOG_INFO(LOG_MODULE_ID_CLUB, "Saved %d clubs to %s", list->count, filename);
     return 1;
 }
-int club_list_load_from_file(ClubList* list, const char* filename){
+
+int club_list_save_to_file(ClubList* list, const char* filename){
+    club_list_lock(list);
+    int ok = club_list_save_to_file_locked(list, filename);
+    club_list_unlock(list);
+    return ok;
+}
+static int club_list_load_from_file_locked(ClubList* list, const char* filename){
     if(list == NULL || list->clubs == NULL || filename == NULL){
         printf("error: invalid arguments to club_list_load_from_file\n");
         return 0;
@@ -317,14 +453,23 @@ int club_list_load_from_file(ClubList* list, const char* filename){
     }
     list->count = index;
     fclose(file);
+    LOG_INFO(LOG_MODULE_ID_CLUB, "Loaded %d clubs from %s", index, filename);
     return 1;
 }
-int membership_list_save_to_file(MembershipList* list, const char* filename) {
+
+int club_list_load_from_file(ClubList* list, const char* filename){
+    club_list_lock(list);
+    int ok = club_list_load_from_file_locked(list, filename);
+    club_list_unlock(list);
+    return ok;
+}
+static int membership_list_save_to_file_locked(MembershipList* list, const char* filename) {
     if (list == NULL || list->memberships == NULL || filename == NULL) {
         printf("error: invalid arguments to membership_list_save_to_file\n");
         return 0;
     }
-    FILE* file = fopen(filename, "w");
+    char temp[512];
+    FILE* file = utils_file_open_atomic(filename, temp, sizeof(temp));
     if (file == NULL) {
         printf("error: could not open file %s for writing\n", filename);
         return 0;
@@ -341,10 +486,21 @@ int membership_list_save_to_file(MembershipList* list, const char* filename) {
             mmbsh->is_active
         );
     }
-    fclose(file);
+    if (!utils_file_commit_atomic(file, temp, filename)) {
+        printf("error: could not write file %s\n", filename);
+        return 0;
+    }
+    LOG_INFO(LOG_MODULE_ID_CLUB, "Saved %d memberships to %s", list->count, filename);
     return 1;
 }
-int membership_list_load_from_file(MembershipList* list, const char* filename){
+
+int membership_list_save_to_file(MembershipList* list, const char* filename) {
+    membership_list_lock(list);
+    int ok = membership_list_save_to_file_locked(list, filename);
+    membership_list_unlock(list);
+    return ok;
+}
+static int membership_list_load_from_file_locked(MembershipList* list, const char* filename){
     if (list == NULL || list->memberships == NULL || filename == NULL) {
         printf("error: invalid arguments to membership_list_load_from_file\n");
         return 0;
@@ -393,9 +549,17 @@ int membership_list_load_from_file(MembershipList* list, const char* filename){
     }
     list->count = index;
     fclose(file);
+    LOG_INFO(LOG_MODULE_ID_CLUB, "Loaded %d memberships from %s", index, filename);
     return 1;
 }
 
+int membership_list_load_from_file(MembershipList* list, const char* filename) {
+    membership_list_lock(list);
+    int ok = membership_list_load_from_file_locked(list, filename);
+    membership_list_unlock(list);
+    return ok;
+}
+
 // Improved version, fixing many critical issues and aligning with your structures.
 
 // Function to create a new club (asks user for input)
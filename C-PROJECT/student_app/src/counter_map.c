@@ -0,0 +1,158 @@
+#include "counter_map.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int counter_map_hash(int key) {
+    unsigned int h = (unsigned int)key;
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return h;
+}
+
+int counter_map_init(CounterMap* map, int expected) {
+    int capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    map->slots = (Counter*)malloc(sizeof(Counter) * capacity);
+    if (map->slots == NULL) {
+        printf("Error: Failed to allocate counter map\n");
+        map->capacity = 0;
+        map->size = 0;
+        return 0;
+    }
+    for (int i = 0; i < capacity; i++) {
+        map->slots[i].key = COUNTER_MAP_EMPTY_KEY;
+    }
+    map->capacity = capacity;
+    map->size = 0;
+    return 1;
+}
+
+void counter_map_free(CounterMap* map) {
+    if (map == NULL) {
+        return;
+    }
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->size = 0;
+}
+
+static int counter_map_grow(CounterMap* map) {
+    CounterMap bigger;
+    if (!counter_map_init(&bigger, map->capacity)) {
+        return 0;
+    }
+    unsigned int mask = (unsigned int)bigger.capacity - 1;
+    for (int i = 0; i < map->capacity; i++) {
+        if (map->slots[i].key == COUNTER_MAP_EMPTY_KEY) continue;
+        unsigned int pos = counter_map_hash(map->slots[i].key) & mask;
+        while (bigger.slots[pos].key != COUNTER_MAP_EMPTY_KEY) {
+            pos = (pos + 1) & mask;
+        }
+        bigger.slots[pos] = map->slots[i];
+        bigger.size++;
+    }
+    free(map->slots);
+    *map = bigger;
+    return 1;
+}
+
+// Find or insert the counter for a key; NULL only on allocation failure
+Counter* counter_map_get(CounterMap* map, int key) {
+    if (map->slots == NULL) {
+        if (!counter_map_init(map, 8)) return NULL;
+    } else if ((map->size + 1) * 2 > map->capacity) {
+        if (!counter_map_grow(map)) return NULL;
+    }
+
+    unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int pos = counter_map_hash(key) & mask;
+    while (map->slots[pos].key != COUNTER_MAP_EMPTY_KEY) {
+        if (map->slots[pos].key == key) {
+            return &map->slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    Counter* counter = &map->slots[pos];
+    counter->key = key;
+    counter->count = 0;
+    counter->hits = 0;
+    counter->sum = 0.0;
+    map->size++;
+    return counter;
+}
+
+Counter* counter_map_find(const CounterMap* map, int key) {
+    if (map->slots == NULL) {
+        return NULL;
+    }
+    unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int pos = counter_map_hash(key) & mask;
+    while (map->slots[pos].key != COUNTER_MAP_EMPTY_KEY) {
+        if (map->slots[pos].key == key) {
+            return &map->slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+// Add delta to a name's count, appending the name when first seen
+int name_count_add(NameCountList* list, const char* name, int delta) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->items[i].name, name) == 0) {
+            list->items[i].count += delta;
+            return 1;
+        }
+    }
+
+    if (list->count >= list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 16;
+        NameCount* items = (NameCount*)realloc(list->items, sizeof(NameCount) * new_capacity);
+        if (items == NULL) {
+            printf("Error: Failed to grow name tally\n");
+            return 0;
+        }
+        list->items = items;
+        list->capacity = new_capacity;
+    }
+    strncpy(list->items[list->count].name, name, MAX_COURSE_LENGTH - 1);
+    list->items[list->count].name[MAX_COURSE_LENGTH - 1] = '\0';
+    list->items[list->count].count = delta;
+    list->count++;
+    return 1;
+}
+
+// Write the k largest counts in descending order, padding with zeros
+void name_count_top(const NameCountList* list, int* counts, int k) {
+    int filled = 0;
+    for (int i = 0; i < list->count; i++) {
+        int value = list->items[i].count;
+        if (value <= 0 || (filled == k && value <= counts[k - 1])) continue;
+        int pos = filled < k ? filled++ : k - 1;
+        while (pos > 0 && counts[pos - 1] < value) {
+            counts[pos] = counts[pos - 1];
+            pos--;
+        }
+        counts[pos] = value;
+    }
+    for (int i = filled; i < k; i++) {
+        counts[i] = 0;
+    }
+}
+
+void name_count_free(NameCountList* list) {
+    if (list == NULL) {
+        return;
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
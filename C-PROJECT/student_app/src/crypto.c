@@ -0,0 +1,317 @@
+#include "crypto.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <pthread.h>
+#include <time.h>
+
+// ---- SHA-256 ----
+
+int crypto_sha256(const void* data, size_t size, unsigned char* digest) {
+    if ((data == NULL && size > 0) || digest == NULL) {
+        return 0;
+    }
+    unsigned int length = 0;
+    if (EVP_Digest(data, size, digest, &length, EVP_sha256(), NULL) != 1 || length != CRYPTO_SHA256_SIZE) {
+        printf("Error: SHA-256 failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+int crypto_hmac_sha256(const unsigned char* key, int key_size, const void* data, size_t size, unsigned char* digest) {
+    if (key == NULL || key_size <= 0 || (data == NULL && size > 0) || digest == NULL) {
+        return 0;
+    }
+    unsigned int length = 0;
+    if (HMAC(EVP_sha256(), key, key_size, (const unsigned char*)data, size, digest, &length) == NULL ||
+        length != CRYPTO_SHA256_SIZE) {
+        printf("Error: HMAC-SHA-256 failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+void crypto_sha256_to_hex(const unsigned char* digest, char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < CRYPTO_SHA256_SIZE; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 15];
+    }
+    hex[CRYPTO_SHA256_SIZE * 2] = '\0';
+}
+
+static int crypto_hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int crypto_sha256_from_hex(const char* hex, unsigned char* digest) {
+    if (hex == NULL || digest == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < CRYPTO_SHA256_SIZE; i++) {
+        int high = crypto_hex_value(hex[i * 2]);
+        int low = high >= 0 ? crypto_hex_value(hex[i * 2 + 1]) : -1;
+        if (low < 0) {
+            return 0;
+        }
+        digest[i] = (unsigned char)(high << 4 | low);
+    }
+    return 1;
+}
+
+// ---- Password hashing ----
+
+static PasswordPolicy password_policy = {
+    PASSWORD_KDF_PBKDF2, PASSWORD_DEFAULT_ITERATIONS, PASSWORD_DEFAULT_SCRYPT_LOG_N, 8, 1
+};
+static pthread_mutex_t password_policy_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void password_policy_default(PasswordPolicy* policy) {
+    if (policy == NULL) {
+        return;
+    }
+    policy->kdf = PASSWORD_KDF_PBKDF2;
+    policy->iterations = PASSWORD_DEFAULT_ITERATIONS;
+    policy->scrypt_log_n = PASSWORD_DEFAULT_SCRYPT_LOG_N;
+    policy->scrypt_r = 8;
+    policy->scrypt_p = 1;
+}
+
+static int password_policy_valid(const PasswordPolicy* policy) {
+    if (policy->kdf == PASSWORD_KDF_PBKDF2) {
+        return policy->iterations >= PASSWORD_MIN_ITERATIONS && policy->iterations <= 9999999;
+    }
+    if (policy->kdf == PASSWORD_KDF_SCRYPT) {
+        return policy->scrypt_log_n >= 10 && policy->scrypt_log_n <= 24 &&
+               policy->scrypt_r >= 1 && policy->scrypt_r <= 64 &&
+               policy->scrypt_p >= 1 && policy->scrypt_p <= 16;
+    }
+    return 0;
+}
+
+void password_policy_set(const PasswordPolicy* policy) {
+    if (policy == NULL || !password_policy_valid(policy)) {
+        printf("Error: Invalid password policy\n");
+        return;
+    }
+    pthread_mutex_lock(&password_policy_lock);
+    password_policy = *policy;
+    pthread_mutex_unlock(&password_policy_lock);
+}
+
+void password_policy_get(PasswordPolicy* policy) {
+    if (policy == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&password_policy_lock);
+    *policy = password_policy;
+    pthread_mutex_unlock(&password_policy_lock);
+}
+
+// Formats the hash prefix, e.g. "$p2$600000$", for a policy
+static int password_hash_prefix(const PasswordPolicy* policy, char* prefix, size_t size) {
+    int n = policy->kdf == PASSWORD_KDF_PBKDF2
+        ? snprintf(prefix, size, "$p2$%d$", policy->iterations)
+        : snprintf(prefix, size, "$s1$%d.%d.%d$", policy->scrypt_log_n, policy->scrypt_r, policy->scrypt_p);
+    return n > 0 && (size_t)n < size;
+}
+
+// Reads a stored hash's prefix back into a policy; returns the digest part
+static const char* password_hash_parse(const char* hash, PasswordPolicy* policy) {
+    int consumed = 0;
+    memset(policy, 0, sizeof(*policy));
+    if (sscanf(hash, "$p2$%d$%n", &policy->iterations, &consumed) == 1 && consumed > 0) {
+        policy->kdf = PASSWORD_KDF_PBKDF2;
+    } else if (sscanf(hash, "$s1$%d.%d.%d$%n", &policy->scrypt_log_n, &policy->scrypt_r, &policy->scrypt_p,
+                      &consumed) == 3 && consumed > 0) {
+        policy->kdf = PASSWORD_KDF_SCRYPT;
+    } else {
+        return NULL;
+    }
+    return password_policy_valid(policy) ? hash + consumed : NULL;
+}
+
+static int password_derive(const char* password, const char* salt, const PasswordPolicy* policy,
+                           unsigned char* digest) {
+    size_t salt_length = strlen(salt);
+    if (policy->kdf == PASSWORD_KDF_PBKDF2) {
+        return PKCS5_PBKDF2_HMAC(password, (int)strlen(password), (const unsigned char*)salt, (int)salt_length,
+                                 policy->iterations, EVP_sha256(), CRYPTO_SHA256_SIZE, digest) == 1;
+    }
+    uint64_t n = (uint64_t)1 << policy->scrypt_log_n;
+    uint64_t max_memory = 128 * n * (uint64_t)policy->scrypt_r * (uint64_t)(policy->scrypt_p + 1) + (1 << 20);
+    return EVP_PBE_scrypt(password, strlen(password), (const unsigned char*)salt, salt_length, n,
+                          (uint64_t)policy->scrypt_r, (uint64_t)policy->scrypt_p, max_memory,
+                          digest, CRYPTO_SHA256_SIZE) == 1;
+}
+
+int password_hash_with_policy(const char* password, const char* salt, const PasswordPolicy* policy, char* hash) {
+    if (password == NULL || salt == NULL || policy == NULL || hash == NULL || !password_policy_valid(policy)) {
+        return 0;
+    }
+    char prefix[32];
+    unsigned char digest[CRYPTO_SHA256_SIZE];
+    unsigned char encoded[48];
+    if (!password_hash_prefix(policy, prefix, sizeof(prefix)) || !password_derive(password, salt, policy, digest)) {
+        printf("Error: Password hashing failed\n");
+        return 0;
+    }
+    int length = EVP_EncodeBlock(encoded, digest, CRYPTO_SHA256_SIZE);
+    while (length > 0 && encoded[length - 1] == '=') {
+        length--;
+    }
+    encoded[length] = '\0';
+    secure_memory_clear(digest, sizeof(digest));
+    int n = snprintf(hash, PASSWORD_HASH_SIZE, "%s%s", prefix, (const char*)encoded);
+    if (n < 0 || n >= PASSWORD_HASH_SIZE) {
+        hash[0] = '\0';
+        printf("Error: Password hash does not fit in %d characters\n", PASSWORD_HASH_SIZE - 1);
+        return 0;
+    }
+    return 1;
+}
+
+static int password_policy_same(const PasswordPolicy* a, const PasswordPolicy* b) {
+    if (a->kdf != b->kdf) {
+        return 0;
+    }
+    return a->kdf == PASSWORD_KDF_PBKDF2
+        ? a->iterations == b->iterations
+        : a->scrypt_log_n == b->scrypt_log_n && a->scrypt_r == b->scrypt_r && a->scrypt_p == b->scrypt_p;
+}
+
+int password_hash_verify(const char* password, const char* salt, const char* hash, int* needs_rehash) {
+    if (needs_rehash != NULL) {
+        *needs_rehash = 0;
+    }
+    if (password == NULL || salt == NULL || hash == NULL) {
+        return 0;
+    }
+    char computed[PASSWORD_HASH_SIZE];
+    PasswordPolicy stored;
+    int match;
+    if (hash[0] != '$') {
+        // Version 0: hex SHA-256 over salt then password
+        size_t salt_length = strlen(salt), password_length = strlen(password);
+        char* input = (char*)malloc(salt_length + password_length + 1);
+        unsigned char digest[CRYPTO_SHA256_SIZE];
+        if (input == NULL) {
+            return 0;
+        }
+        memcpy(input, salt, salt_length);
+        memcpy(input + salt_length, password, password_length);
+        int ok = crypto_sha256(input, salt_length + password_length, digest);
+        secure_memory_clear(input, salt_length + password_length);
+        free(input);
+        if (!ok) {
+            return 0;
+        }
+        crypto_sha256_to_hex(digest, computed);
+        stored.kdf = PASSWORD_KDF_LEGACY_SHA256;
+        match = strlen(hash) == CRYPTO_SHA256_SIZE * 2 &&
+                CRYPTO_memcmp(computed, hash, CRYPTO_SHA256_SIZE * 2) == 0;
+    } else {
+        if (password_hash_parse(hash, &stored) == NULL ||
+            !password_hash_with_policy(password, salt, &stored, computed)) {
+            return 0;
+        }
+        size_t length = strlen(computed);
+        match = strlen(hash) == length && CRYPTO_memcmp(computed, hash, length) == 0;
+    }
+    secure_memory_clear(computed, sizeof(computed));
+
+    if (match && needs_rehash != NULL) {
+        PasswordPolicy current;
+        password_policy_get(&current);
+        *needs_rehash = !password_policy_same(&stored, &current);
+    }
+    return match;
+}
+
+static double password_time_hash(const PasswordPolicy* policy) {
+    char hash[PASSWORD_HASH_SIZE];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ok = password_hash_with_policy("calibration-password", "00112233445566778899aabbccddeeff", policy, hash);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ok ? (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6 : -1.0;
+}
+
+int password_policy_calibrate(PasswordKdf kdf, double target_ms, PasswordPolicy* policy) {
+    if (policy == NULL || target_ms <= 0 || (kdf != PASSWORD_KDF_PBKDF2 && kdf != PASSWORD_KDF_SCRYPT)) {
+        printf("Error: Invalid calibration parameters\n");
+        return 0;
+    }
+    password_policy_default(policy);
+    policy->kdf = kdf;
+
+    if (kdf == PASSWORD_KDF_SCRYPT) {
+        // Cost doubles per step; stop at the first N reaching the target
+        for (policy->scrypt_log_n = 12; policy->scrypt_log_n < 20; policy->scrypt_log_n++) {
+            double ms = password_time_hash(policy);
+            if (ms < 0) return 0;
+            if (ms >= target_ms) break;
+        }
+        return 1;
+    }
+
+    // PBKDF2 is linear in the iterations: scale from a sample, then once
+    // more from the scaled run
+    policy->iterations = 20000;
+    for (int round = 0; round < 2; round++) {
+        double ms = password_time_hash(policy);
+        if (ms <= 0) return 0;
+        double scaled = (double)policy->iterations * target_ms / ms;
+        if (scaled < PASSWORD_MIN_ITERATIONS) scaled = PASSWORD_MIN_ITERATIONS;
+        if (scaled > 9999000) scaled = 9999000;
+        policy->iterations = ((int)scaled + 999) / 1000 * 1000;
+    }
+    return 1;
+}
+
+void hash_password_with_salt(const char* password, const char* salt, char* hash) {
+    PasswordPolicy policy;
+    password_policy_get(&policy);
+    if (!password_hash_with_policy(password, salt, &policy, hash) && hash != NULL) {
+        hash[0] = '\0';
+    }
+}
+
+int verify_password_hash(const char* password, const char* hash, const char* salt) {
+    return password_hash_verify(password, salt, hash, NULL);
+}
+
+void generate_password_salt(char* salt) {
+    static const char digits[] = "0123456789abcdef";
+    unsigned char bytes[(PASSWORD_SALT_SIZE - 1) / 2];
+    if (salt == NULL) {
+        return;
+    }
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+        printf("Error: Failed to generate salt\n");
+        salt[0] = '\0';
+        return;
+    }
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        salt[i * 2] = digits[bytes[i] >> 4];
+        salt[i * 2 + 1] = digits[bytes[i] & 15];
+    }
+    salt[sizeof(bytes) * 2] = '\0';
+}
+
+// ---- Utility ----
+
+void secure_memory_clear(void* ptr, size_t size) {
+    if (ptr != NULL && size > 0) {
+        OPENSSL_cleanse(ptr, size);
+    }
+}
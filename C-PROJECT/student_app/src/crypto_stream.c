@@ -0,0 +1,353 @@
+#include "crypto_stream.h"
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define CRYPTO_STREAM_AAD_SIZE (CRYPTO_STREAM_HEADER_SIZE + 9)
+
+static void crypto_stream_put_u32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static unsigned int crypto_stream_get_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+}
+
+static void crypto_stream_aad(const unsigned char* header, long long index, int last, unsigned char* aad) {
+    memcpy(aad, header, CRYPTO_STREAM_HEADER_SIZE);
+    unsigned long long v = (unsigned long long)index;
+    for (int i = 0; i < 8; i++) {
+        aad[CRYPTO_STREAM_HEADER_SIZE + i] = (unsigned char)(v >> (8 * i));
+    }
+    aad[CRYPTO_STREAM_HEADER_SIZE + 8] = (unsigned char)(last != 0);
+}
+
+// ---- Segments ----
+
+int crypto_stream_header_init(unsigned char* header, int segment_size) {
+    memcpy(header, CRYPTO_STREAM_MAGIC, 4);
+    header[4] = CRYPTO_STREAM_VERSION;
+    header[5] = header[6] = header[7] = 0;
+    crypto_stream_put_u32(header + 8, (unsigned int)segment_size);
+    return RAND_bytes(header + 12, 16) == 1;
+}
+
+int crypto_stream_header_parse(const unsigned char* header, int* segment_size) {
+    if (memcmp(header, CRYPTO_STREAM_MAGIC, 4) != 0 || header[4] != CRYPTO_STREAM_VERSION) {
+        return 0;
+    }
+    unsigned int size = crypto_stream_get_u32(header + 8);
+    if (size < CRYPTO_STREAM_MIN_SEGMENT || size > CRYPTO_STREAM_MAX_SEGMENT) {
+        return 0;
+    }
+    *segment_size = (int)size;
+    return 1;
+}
+
+int crypto_stream_seal_segment(EVP_CIPHER_CTX* ctx, const unsigned char* key, const unsigned char* header,
+                               long long index, int last, const unsigned char* plain, int length,
+                               unsigned char* out) {
+    unsigned char aad[CRYPTO_STREAM_AAD_SIZE];
+    unsigned char* nonce = out;
+    unsigned char* body = out + CRYPTO_STREAM_NONCE_SIZE;
+    int out_length = 0, final_length = 0;
+    crypto_stream_aad(header, index, last, aad);
+    // A context keeps its cipher and key between calls; only the nonce
+    // changes, so a NULL key skips the key schedule entirely
+    const EVP_CIPHER* cipher = EVP_CIPHER_CTX_cipher(ctx) == NULL ? EVP_aes_256_gcm() : NULL;
+    return RAND_bytes(nonce, CRYPTO_STREAM_NONCE_SIZE) == 1 &&
+           EVP_EncryptInit_ex(ctx, cipher, NULL, key, nonce) == 1 &&
+           EVP_EncryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+           EVP_EncryptUpdate(ctx, body, &out_length, plain, length) == 1 &&
+           EVP_EncryptFinal_ex(ctx, body + out_length, &final_length) == 1 &&
+           EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, CRYPTO_STREAM_TAG_SIZE, body + length) == 1;
+}
+
+int crypto_stream_open_segment(EVP_CIPHER_CTX* ctx, const unsigned char* key, const unsigned char* header,
+                               long long index, int last, const unsigned char* sealed, int length,
+                               unsigned char* out) {
+    unsigned char aad[CRYPTO_STREAM_AAD_SIZE];
+    const unsigned char* nonce = sealed;
+    const unsigned char* body = sealed + CRYPTO_STREAM_NONCE_SIZE;
+    int out_length = 0, final_length = 0;
+    crypto_stream_aad(header, index, last, aad);
+    const EVP_CIPHER* cipher = EVP_CIPHER_CTX_cipher(ctx) == NULL ? EVP_aes_256_gcm() : NULL;
+    return EVP_DecryptInit_ex(ctx, cipher, NULL, key, nonce) == 1 &&
+           EVP_DecryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+           EVP_DecryptUpdate(ctx, out, &out_length, body, length) == 1 &&
+           EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, CRYPTO_STREAM_TAG_SIZE, (void*)(body + length)) == 1 &&
+           EVP_DecryptFinal_ex(ctx, out + out_length, &final_length) == 1;
+}
+
+// ---- Writing ----
+
+CryptoStreamWriter* crypto_stream_writer_create(FILE* file, const unsigned char* key, int segment_size) {
+    if (file == NULL || key == NULL) {
+        printf("Error: Invalid arguments to crypto_stream_writer_create\n");
+        return NULL;
+    }
+    if (segment_size <= 0) {
+        segment_size = CRYPTO_STREAM_DEFAULT_SEGMENT;
+    }
+    if (segment_size < CRYPTO_STREAM_MIN_SEGMENT || segment_size > CRYPTO_STREAM_MAX_SEGMENT) {
+        printf("Error: Invalid segment size %d\n", segment_size);
+        return NULL;
+    }
+
+    CryptoStreamWriter* writer = (CryptoStreamWriter*)calloc(1, sizeof(CryptoStreamWriter));
+    if (writer == NULL) {
+        printf("Error: Failed to create encrypted stream\n");
+        return NULL;
+    }
+    writer->file = file;
+    writer->segment_size = segment_size;
+    writer->ctx = EVP_CIPHER_CTX_new();
+    writer->plain = (unsigned char*)malloc((size_t)segment_size);
+    writer->sealed = (unsigned char*)malloc((size_t)segment_size + CRYPTO_STREAM_OVERHEAD);
+    memcpy(writer->key, key, AES_KEY_SIZE);
+
+    if (writer->ctx == NULL || writer->plain == NULL || writer->sealed == NULL ||
+        !crypto_stream_header_init(writer->header, segment_size) ||
+        fwrite(writer->header, 1, CRYPTO_STREAM_HEADER_SIZE, file) != CRYPTO_STREAM_HEADER_SIZE) {
+        printf("Error: Failed to start encrypted stream\n");
+        crypto_stream_writer_destroy(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+static int crypto_stream_seal(CryptoStreamWriter* writer, int last) {
+    if (!crypto_stream_seal_segment(writer->ctx, writer->key, writer->header, writer->index, last,
+                                    writer->plain, writer->used, writer->sealed)) {
+        printf("Error: Failed to encrypt stream segment\n");
+        return 0;
+    }
+    size_t size = (size_t)writer->used + CRYPTO_STREAM_OVERHEAD;
+    if (fwrite(writer->sealed, 1, size, writer->file) != size) {
+        printf("Error: Failed to write stream segment\n");
+        return 0;
+    }
+    writer->index++;
+    writer->used = 0;
+    return 1;
+}
+
+int crypto_stream_writer_write(CryptoStreamWriter* writer, const void* data, size_t size) {
+    if (writer == NULL || (data == NULL && size > 0) || writer->failed) {
+        return 0;
+    }
+    const unsigned char* p = (const unsigned char*)data;
+    while (size > 0) {
+        // A full segment is sealed only once more data arrives, so the
+        // last segment is always the one finish seals
+        if (writer->used == writer->segment_size && !crypto_stream_seal(writer, 0)) {
+            writer->failed = 1;
+            return 0;
+        }
+        size_t room = (size_t)(writer->segment_size - writer->used);
+        size_t take = size < room ? size : room;
+        memcpy(writer->plain + writer->used, p, take);
+        writer->used += (int)take;
+        writer->bytes += (long long)take;
+        p += take;
+        size -= take;
+    }
+    return 1;
+}
+
+int crypto_stream_writer_finish(CryptoStreamWriter* writer) {
+    if (writer == NULL || writer->failed) {
+        return 0;
+    }
+    if (!crypto_stream_seal(writer, 1)) {
+        writer->failed = 1;
+        return 0;
+    }
+    writer->failed = 1;         // Nothing may follow the last segment
+    return fflush(writer->file) == 0;
+}
+
+void crypto_stream_writer_destroy(CryptoStreamWriter* writer) {
+    if (writer == NULL) {
+        return;
+    }
+    EVP_CIPHER_CTX_free(writer->ctx);
+    if (writer->plain != NULL) {
+        secure_memory_clear(writer->plain, (size_t)writer->segment_size);
+    }
+    secure_memory_clear(writer->key, sizeof(writer->key));
+    free(writer->plain);
+    free(writer->sealed);
+    free(writer);
+}
+
+// ---- Reading ----
+
+CryptoStreamReader* crypto_stream_reader_open(const char* filename, const unsigned char* key) {
+    if (filename == NULL || key == NULL) {
+        printf("Error: Invalid arguments to crypto_stream_reader_open\n");
+        return NULL;
+    }
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("Error: Cannot open %s\n", filename);
+        return NULL;
+    }
+    CryptoStreamReader* reader = (CryptoStreamReader*)calloc(1, sizeof(CryptoStreamReader));
+    if (reader == NULL) {
+        fclose(file);
+        printf("Error: Failed to open encrypted stream\n");
+        return NULL;
+    }
+    reader->file = file;
+    reader->cached_segment = -1;
+    memcpy(reader->key, key, AES_KEY_SIZE);
+
+    struct stat st;
+    unsigned char* header = reader->header;
+    int segment_size = 0;
+    int ok = fstat(fileno(file), &st) == 0 &&
+             fread(header, 1, CRYPTO_STREAM_HEADER_SIZE, file) == CRYPTO_STREAM_HEADER_SIZE &&
+             crypto_stream_header_parse(header, &segment_size);
+
+    // Every segment but the last is full, so the file size gives the layout
+    long long body = ok ? (long long)st.st_size - CRYPTO_STREAM_HEADER_SIZE : 0;
+    long long stride = (long long)segment_size + CRYPTO_STREAM_OVERHEAD;
+    if (ok) {
+        reader->segment_size = segment_size;
+        reader->segment_count = (body + stride - 1) / stride;
+        long long last = body - (reader->segment_count - 1) * stride - CRYPTO_STREAM_OVERHEAD;
+        ok = reader->segment_count > 0 && last >= 0;
+        reader->plaintext_size = (reader->segment_count - 1) * (long long)segment_size + last;
+    }
+    if (ok) {
+        reader->ctx = EVP_CIPHER_CTX_new();
+        reader->plain = (unsigned char*)malloc((size_t)segment_size);
+        reader->sealed = (unsigned char*)malloc((size_t)stride);
+        ok = reader->ctx != NULL && reader->plain != NULL && reader->sealed != NULL;
+    }
+    if (!ok) {
+        printf("Error: %s is not a valid encrypted stream\n", filename);
+        crypto_stream_reader_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+void crypto_stream_reader_close(CryptoStreamReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->file != NULL) fclose(reader->file);
+    EVP_CIPHER_CTX_free(reader->ctx);
+    if (reader->plain != NULL) {
+        secure_memory_clear(reader->plain, (size_t)reader->segment_size);
+    }
+    secure_memory_clear(reader->key, sizeof(reader->key));
+    free(reader->plain);
+    free(reader->sealed);
+    free(reader);
+}
+
+int crypto_stream_read_segment(CryptoStreamReader* reader, long long index, unsigned char* out) {
+    if (reader == NULL || out == NULL || index < 0 || index >= reader->segment_count) {
+        return -1;
+    }
+    if (index == reader->cached_segment) {
+        memcpy(out, reader->plain, (size_t)reader->cached_length);
+        return reader->cached_length;
+    }
+
+    int last = index == reader->segment_count - 1;
+    int length = last ? (int)(reader->plaintext_size - index * (long long)reader->segment_size) : reader->segment_size;
+    size_t size = (size_t)length + CRYPTO_STREAM_OVERHEAD;
+    off_t offset = (off_t)(CRYPTO_STREAM_HEADER_SIZE + index * ((long long)reader->segment_size + CRYPTO_STREAM_OVERHEAD));
+    if (fseeko(reader->file, offset, SEEK_SET) != 0 || fread(reader->sealed, 1, size, reader->file) != size) {
+        printf("Error: Cannot read stream segment %lld\n", index);
+        return -1;
+    }
+
+    reader->cached_segment = -1;
+    if (!crypto_stream_open_segment(reader->ctx, reader->key, reader->header, index, last,
+                                    reader->sealed, length, reader->plain)) {
+        printf("Error: Stream segment %lld failed authentication\n", index);
+        return -1;
+    }
+    reader->cached_segment = index;
+    reader->cached_length = length;
+    memcpy(out, reader->plain, (size_t)length);
+    return length;
+}
+
+long long crypto_stream_read_segments(CryptoStreamReader* reader, long long first, long long count,
+                                      void* out, size_t capacity) {
+    if (reader == NULL || out == NULL || first < 0 || count < 0 || first + count > reader->segment_count) {
+        return -1;
+    }
+    unsigned char* p = (unsigned char*)out;
+    long long total = 0;
+    for (long long i = first; i < first + count; i++) {
+        if ((size_t)total + (size_t)reader->segment_size > capacity && i < reader->segment_count - 1) {
+            return -1;
+        }
+        if (i == reader->segment_count - 1 &&
+            (size_t)total + (size_t)(reader->plaintext_size - i * (long long)reader->segment_size) > capacity) {
+            return -1;
+        }
+        int length = crypto_stream_read_segment(reader, i, p + total);
+        if (length < 0) {
+            return -1;
+        }
+        total += length;
+    }
+    return total;
+}
+
+long long crypto_stream_pread(CryptoStreamReader* reader, void* out, size_t size, long long offset) {
+    if (reader == NULL || (out == NULL && size > 0) || offset < 0) {
+        return -1;
+    }
+    unsigned char* p = (unsigned char*)out;
+    long long done = 0;
+    while ((size_t)done < size && offset + done < reader->plaintext_size) {
+        long long at = offset + done;
+        long long index = at / reader->segment_size;
+        int skip = (int)(at - index * reader->segment_size);
+        // Decrypt into the cache, then copy out the wanted part
+        if (index != reader->cached_segment && crypto_stream_read_segment(reader, index, reader->sealed) < 0) {
+            return -1;
+        }
+        long long take = reader->cached_length - skip;
+        if (take > (long long)size - done) take = (long long)size - done;
+        memcpy(p + done, reader->plain + skip, (size_t)take);
+        done += take;
+    }
+    return done;
+}
+
+long long crypto_stream_read(CryptoStreamReader* reader, void* out, size_t size) {
+    long long got = crypto_stream_pread(reader, out, size, reader != NULL ? reader->position : 0);
+    if (got > 0) {
+        reader->position += got;
+    }
+    return got;
+}
+
+int crypto_stream_is_stream_file(const char* filename) {
+    if (filename == NULL) {
+        return 0;
+    }
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned char magic[4];
+    int ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, CRYPTO_STREAM_MAGIC, 4) == 0;
+    fclose(file);
+    return ok;
+}
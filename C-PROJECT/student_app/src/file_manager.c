@@ -0,0 +1,123 @@
+#include "file_manager.h"
+#include "crypto_stream.h"
+#include "segment_cache.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// ---- File existence ----
+
+int file_exists(const char* filename) {
+    struct stat st;
+    return filename != NULL && stat(filename, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// ---- Encrypted file operations ----
+
+static SegmentCache* shared_segment_cache = NULL;
+static pthread_once_t shared_segment_cache_once = PTHREAD_ONCE_INIT;
+
+static void file_manager_start_segment_cache(void) {
+    shared_segment_cache = segment_cache_create(0, 0);
+}
+
+SegmentCache* file_manager_segment_cache(void) {
+    pthread_once(&shared_segment_cache_once, file_manager_start_segment_cache);
+    return shared_segment_cache;
+}
+
+FileResult write_encrypted_file(const char* filename, const char* content, size_t content_size, const unsigned char* key) {
+    if (filename == NULL || (content == NULL && content_size > 0) || key == NULL) {
+        return FILE_ERROR_INVALID_FORMAT;
+    }
+    char temp_path[512];
+    FILE* file = utils_file_open_atomic(filename, temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        return FILE_ERROR_PERMISSION_DENIED;
+    }
+    CryptoStreamWriter* writer = crypto_stream_writer_create(file, key, CRYPTO_STREAM_DEFAULT_SEGMENT);
+    int ok = writer != NULL &&
+             crypto_stream_writer_write(writer, content, content_size) &&
+             crypto_stream_writer_finish(writer);
+    crypto_stream_writer_destroy(writer);
+    if (!ok) {
+        utils_file_abort_atomic(file, temp_path);
+        return FILE_ERROR_ENCRYPTION_FAILED;
+    }
+    if (!utils_file_commit_atomic(file, temp_path, filename)) {
+        return FILE_ERROR_DISK_FULL;
+    }
+    // The new file id would miss anyway; this frees the old plaintext now
+    segment_cache_invalidate(file_manager_segment_cache(), filename);
+    return FILE_SUCCESS;
+}
+
+FileResult read_encrypted_file(const char* filename, char** content, size_t* content_size, const unsigned char* key) {
+    if (filename == NULL || content == NULL || content_size == NULL || key == NULL) {
+        return FILE_ERROR_INVALID_FORMAT;
+    }
+    *content = NULL;
+    *content_size = 0;
+    if (!file_exists(filename)) {
+        return FILE_ERROR_NOT_FOUND;
+    }
+    if (!crypto_stream_is_stream_file(filename)) {
+        return FILE_ERROR_INVALID_FORMAT;
+    }
+    CryptoStreamReader* reader = crypto_stream_reader_open(filename, key);
+    if (reader == NULL) {
+        return FILE_ERROR_CORRUPTED;
+    }
+
+    // Segments are decrypted straight into the result, so peak memory is
+    // the plaintext plus one segment. A file that fits in half the segment
+    // cache goes through it, so loading it again skips AES; a bigger one
+    // would only push every other file out.
+    size_t size = (size_t)reader->plaintext_size;
+    char* buffer = (char*)malloc(size + 1);
+    if (buffer == NULL) {
+        crypto_stream_reader_close(reader);
+        return FILE_ERROR_DISK_FULL;
+    }
+    SegmentCache* cache = file_manager_segment_cache();
+    long long got;
+    if (cache != NULL && reader->segment_count <= cache->slot_count / 2) {
+        got = segment_cache_pread(cache, reader, filename, buffer, size, 0);
+    } else {
+        got = crypto_stream_read_segments(reader, 0, reader->segment_count, buffer, size);
+    }
+    crypto_stream_reader_close(reader);
+    if (got < 0 || (size_t)got != size) {
+        secure_memory_clear(buffer, size);
+        free(buffer);
+        return FILE_ERROR_DECRYPTION_FAILED;
+    }
+    buffer[size] = '\0';
+    *content = buffer;
+    *content_size = size;
+    return FILE_SUCCESS;
+}
+
+FileResult read_encrypted_file_range(const char* filename, void* buffer, size_t size, long long offset,
+                                     size_t* read_size, const unsigned char* key) {
+    if (filename == NULL || (buffer == NULL && size > 0) || offset < 0 || read_size == NULL || key == NULL) {
+        return FILE_ERROR_INVALID_FORMAT;
+    }
+    *read_size = 0;
+    if (!file_exists(filename)) {
+        return FILE_ERROR_NOT_FOUND;
+    }
+    CryptoStreamReader* reader = crypto_stream_reader_open(filename, key);
+    if (reader == NULL) {
+        return FILE_ERROR_CORRUPTED;
+    }
+    long long got = segment_cache_pread(file_manager_segment_cache(), reader, filename, buffer, size, offset);
+    crypto_stream_reader_close(reader);
+    if (got < 0) {
+        return FILE_ERROR_DECRYPTION_FAILED;
+    }
+    *read_size = (size_t)got;
+    return FILE_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include "grade.h"
+#include "config.h"
+#include "calendar.h"
+#include "change_notify.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+GradeList* grade_list_create(void) {
+    GradeList* list = (GradeList*)malloc(sizeof(GradeList));
+    if (list == NULL) {
+        printf("Error: Failed to create grade list\n");
+        return NULL;
+    }
+    list->capacity = 16;
+    list->count = 0;
+    list->grades = (Grade*)malloc(sizeof(Grade) * list->capacity);
+    if (list->grades == NULL) {
+        printf("Error: Failed to allocate memory for grades array\n");
+        free(list);
+        return NULL;
+    }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&list->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return list;
+}
+
+void grade_list_destroy(GradeList* list) {
+    if (list == NULL) {
+        return;
+    }
+    if (list->grades != NULL) {
+        free(list->grades);
+    }
+    pthread_mutex_destroy(&list->lock);
+    free(list);
+}
+
+void grade_list_lock(GradeList* list) {
+    if (list != NULL) {
+        pthread_mutex_lock(&list->lock);
+    }
+}
+
+void grade_list_unlock(GradeList* list) {
+    if (list != NULL) {
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+static int grade_list_add_locked(GradeList* list, Grade grade) {
+    if (list == NULL || list->grades == NULL) {
+        printf("Error: Invalid grade list\n");
+        return 0;
+    }
+
+    if (list->count >= list->capacity) {
+        int new_capacity = list->capacity * 2;
+        Grade* new_grades = (Grade*)realloc(list->grades, sizeof(Grade) * new_capacity);
+        if (new_grades == NULL) {
+            printf("Error: Unable to allocate more memory for grades\n");
+            return 0;
+        }
+        list->grades = new_grades;
+        list->capacity = new_capacity;
+    }
+
+    list->grades[list->count++] = grade;
+    change_notify_publish(ENTITY_GRADE, CHANGE_ADD, list, NULL, &list->grades[list->count - 1]);
+    return 1;
+}
+
+int grade_list_add(GradeList* list, Grade grade) {
+    grade_list_lock(list);
+    int ok = grade_list_add_locked(list, grade);
+    grade_list_unlock(list);
+    return ok;
+}
+
+static int grade_list_remove_locked(GradeList* list, int grade_id) {
+    if (list == NULL || list->grades == NULL) {
+        printf("Error: Invalid grade list\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->grades[i].id == grade_id) {
+            Grade removed = list->grades[i];
+            for (int j = i; j < list->count - 1; j++) {
+                list->grades[j] = list->grades[j + 1];
+            }
+            list->count--;
+            change_notify_publish(ENTITY_GRADE, CHANGE_REMOVE, list, &removed, NULL);
+            return 1;
+        }
+    }
+
+    printf("Error: Grade with ID %d not found\n", grade_id);
+    return 0;
+}
+
+int grade_list_remove(GradeList* list, int grade_id) {
+    grade_list_lock(list);
+    int ok = grade_list_remove_locked(list, grade_id);
+    grade_list_unlock(list);
+    return ok;
+}
+
+static int grade_list_update_locked(GradeList* list, Grade grade) {
+    if (list == NULL || list->grades == NULL) {
+        printf("Error: Invalid grade list\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->grades[i].id == grade.id) {
+            Grade previous = list->grades[i];
+            list->grades[i] = grade;
+            change_notify_publish(ENTITY_GRADE, CHANGE_EDIT, list, &previous, &list->grades[i]);
+            return 1;
+        }
+    }
+
+    printf("Error: Grade with ID %d not found\n", grade.id);
+    return 0;
+}
+
+int grade_list_update(GradeList* list, Grade grade) {
+    grade_list_lock(list);
+    int ok = grade_list_update_locked(list, grade);
+    grade_list_unlock(list);
+    return ok;
+}
+
+Grade* grade_list_next_where(GradeList* list, int* cursor, GradePredicate where, const void* context) {
+    if (list == NULL || list->grades == NULL || cursor == NULL) {
+        return NULL;
+    }
+    while (*cursor >= 0 && *cursor < list->count) {
+        Grade* grade = &list->grades[(*cursor)++];
+        if (where == NULL || where(grade, context)) {
+            return grade;
+        }
+    }
+    return NULL;
+}
+
+// Dates Validation: assigned <= due, and submission (if any) not before assignment.
+// Compared on calendar days so that time of day does not matter.
+int grade_validate_dates(time_t assigned, time_t due, time_t submitted) {
+    if (assigned <= 0 || due <= 0) {
+        printf("Invalid dates: assigned and due dates are required\n");
+        return 0;
+    }
+
+    long assigned_day = calendar_day_number(assigned);
+    long due_day = calendar_day_number(due);
+    if (due_day < assigned_day) {
+        printf("Invalid dates: due date is before the assigned date\n");
+        return 0;
+    }
+
+    if (submitted > 0 && calendar_day_number(submitted) < assigned_day) {
+        printf("Invalid dates: submission is before the assigned date\n");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,247 @@
+#include "heavy_hitters.h"
+#include <string.h>
+
+static unsigned int heavy_hitters_hash(long long key) {
+    unsigned long long x = (unsigned long long)key;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    return (unsigned int)x;
+}
+
+static int heavy_hitters_find_slot(const HeavyHitters* sketch, long long key) {
+    for (unsigned int slot = heavy_hitters_hash(key) & (unsigned int)sketch->slot_mask;;
+         slot = (slot + 1) & (unsigned int)sketch->slot_mask) {
+        int position = sketch->slots[slot];
+        if (position < 0 || sketch->heap[position].key == key) {
+            return (int)slot;
+        }
+    }
+}
+
+// Linear probing delete: pull later entries of the cluster back into the gap
+static void heavy_hitters_remove_slot(HeavyHitters* sketch, int slot) {
+    unsigned int mask = (unsigned int)sketch->slot_mask;
+    unsigned int gap = (unsigned int)slot;
+    sketch->slots[gap] = -1;
+    for (unsigned int next = (gap + 1) & mask; sketch->slots[next] >= 0; next = (next + 1) & mask) {
+        unsigned int home = heavy_hitters_hash(sketch->heap[sketch->slots[next]].key) & mask;
+        // Move it when its home does not lie cyclically in (gap, next]
+        if (((next - home) & mask) >= ((next - gap) & mask)) {
+            sketch->slots[gap] = sketch->slots[next];
+            sketch->slots[next] = -1;
+            gap = next;
+        }
+    }
+}
+
+// Stores a counter at a position no hash slot points to yet
+static void heavy_hitters_set(HeavyHitters* sketch, int position, HeavyHitter item) {
+    sketch->heap[position] = item;
+    sketch->slots[heavy_hitters_find_slot(sketch, item.key)] = position;
+}
+
+// Swaps the counters at two heap positions and repoints their hash slots,
+// which the caller found while both counters were still in place
+static void heavy_hitters_swap(HeavyHitters* sketch, int a, int slot_a, int b, int slot_b) {
+    HeavyHitter item = sketch->heap[a];
+    sketch->heap[a] = sketch->heap[b];
+    sketch->heap[b] = item;
+    sketch->slots[slot_a] = b;
+    sketch->slots[slot_b] = a;
+}
+
+static void heavy_hitters_sift_down(HeavyHitters* sketch, int position) {
+    int slot = heavy_hitters_find_slot(sketch, sketch->heap[position].key);
+    for (;;) {
+        int child = position * 2 + 1;
+        if (child >= sketch->size) break;
+        if (child + 1 < sketch->size && sketch->heap[child + 1].count < sketch->heap[child].count) child++;
+        if (sketch->heap[child].count >= sketch->heap[position].count) break;
+        heavy_hitters_swap(sketch, position, slot, child, heavy_hitters_find_slot(sketch, sketch->heap[child].key));
+        position = child;
+    }
+}
+
+static void heavy_hitters_sift_up(HeavyHitters* sketch, int position) {
+    int slot = heavy_hitters_find_slot(sketch, sketch->heap[position].key);
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (sketch->heap[parent].count <= sketch->heap[position].count) break;
+        heavy_hitters_swap(sketch, position, slot, parent, heavy_hitters_find_slot(sketch, sketch->heap[parent].key));
+        position = parent;
+    }
+}
+
+HeavyHitters* heavy_hitters_create(int capacity) {
+    if (capacity <= 0) {
+        capacity = HEAVY_HITTERS_DEFAULT_CAPACITY;
+    }
+
+    HeavyHitters* sketch = (HeavyHitters*)calloc(1, sizeof(HeavyHitters));
+    if (sketch == NULL) {
+        printf("Error: Failed to create heavy hitters sketch\n");
+        return NULL;
+    }
+    int slots = 16;
+    while (slots < capacity * 2) slots *= 2;
+    sketch->heap = (HeavyHitter*)malloc(sizeof(HeavyHitter) * capacity);
+    sketch->slots = (int*)malloc(sizeof(int) * slots);
+    if (sketch->heap == NULL || sketch->slots == NULL) {
+        printf("Error: Failed to allocate heavy hitters sketch\n");
+        heavy_hitters_destroy(sketch);
+        return NULL;
+    }
+    sketch->capacity = capacity;
+    sketch->slot_mask = slots - 1;
+    heavy_hitters_reset(sketch);
+    return sketch;
+}
+
+void heavy_hitters_destroy(HeavyHitters* sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    free(sketch->heap);
+    free(sketch->slots);
+    free(sketch);
+}
+
+void heavy_hitters_reset(HeavyHitters* sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    for (int i = 0; i <= sketch->slot_mask; i++) {
+        sketch->slots[i] = -1;
+    }
+    sketch->size = 0;
+    sketch->total = 0;
+}
+
+int heavy_hitters_add(HeavyHitters* sketch, long long key, long long weight) {
+    if (sketch == NULL || weight <= 0) {
+        return 0;
+    }
+    sketch->total += weight;
+
+    int slot = heavy_hitters_find_slot(sketch, key);
+    int position = sketch->slots[slot];
+    if (position >= 0) {
+        sketch->heap[position].count += weight;
+        heavy_hitters_sift_down(sketch, position);
+        return 1;
+    }
+
+    if (sketch->size < sketch->capacity) {
+        HeavyHitter item = { key, weight, 0 };
+        position = sketch->size++;
+        sketch->heap[position] = item;
+        sketch->slots[slot] = position;
+        heavy_hitters_sift_up(sketch, position);
+        return 1;
+    }
+
+    // Evict the smallest counter; the newcomer inherits its count as error
+    HeavyHitter evicted = sketch->heap[0];
+    heavy_hitters_remove_slot(sketch, heavy_hitters_find_slot(sketch, evicted.key));
+    HeavyHitter item = { key, evicted.count + weight, evicted.count };
+    heavy_hitters_set(sketch, 0, item);
+    heavy_hitters_sift_down(sketch, 0);
+    return 1;
+}
+
+long long heavy_hitters_estimate(const HeavyHitters* sketch, long long key) {
+    if (sketch == NULL || sketch->size == 0) {
+        return 0;
+    }
+    int position = sketch->slots[heavy_hitters_find_slot(sketch, key)];
+    if (position >= 0) {
+        return sketch->heap[position].count;
+    }
+    // An untracked key can have been seen at most min-count times
+    return sketch->size == sketch->capacity ? sketch->heap[0].count : 0;
+}
+
+long long heavy_hitters_total(const HeavyHitters* sketch) {
+    return sketch != NULL ? sketch->total : 0;
+}
+
+static int heavy_hitters_compare_desc(const void* a, const void* b) {
+    const HeavyHitter* x = (const HeavyHitter*)a;
+    const HeavyHitter* y = (const HeavyHitter*)b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return x->key < y->key ? -1 : (x->key > y->key);
+}
+
+// Mergeable summaries (Agarwal et al.): a key missing from one side may
+// still have occurred there up to that side's minimum count, so it is
+// credited with that minimum. The largest `capacity` results are kept.
+int heavy_hitters_merge(HeavyHitters* dst, const HeavyHitters* src) {
+    if (dst == NULL || src == NULL) {
+        return 0;
+    }
+    if (src->size == 0) {
+        return 1;
+    }
+
+    long long dst_floor = dst->size == dst->capacity ? dst->heap[0].count : 0;
+    long long src_floor = src->size == src->capacity ? src->heap[0].count : 0;
+    int count = 0;
+    HeavyHitter* merged = (HeavyHitter*)malloc(sizeof(HeavyHitter) * (dst->size + src->size));
+    if (merged == NULL) {
+        printf("Error: Failed to merge heavy hitters\n");
+        return 0;
+    }
+
+    for (int i = 0; i < dst->size; i++) {
+        HeavyHitter item = dst->heap[i];
+        int position = src->slots[heavy_hitters_find_slot(src, item.key)];
+        if (position >= 0) {
+            item.count += src->heap[position].count;
+            item.error += src->heap[position].error;
+        } else {
+            item.count += src_floor;
+            item.error += src_floor;
+        }
+        merged[count++] = item;
+    }
+    for (int i = 0; i < src->size; i++) {
+        HeavyHitter item = src->heap[i];
+        if (dst->slots[heavy_hitters_find_slot(dst, item.key)] >= 0) {
+            continue;
+        }
+        item.count += dst_floor;
+        item.error += dst_floor;
+        merged[count++] = item;
+    }
+
+    qsort(merged, count, sizeof(HeavyHitter), heavy_hitters_compare_desc);
+    long long total = dst->total + src->total;
+    heavy_hitters_reset(dst);
+    dst->total = total;
+    int keep = count < dst->capacity ? count : dst->capacity;
+    // Descending order read backwards is a valid min-heap
+    for (int i = 0; i < keep; i++) {
+        heavy_hitters_set(dst, i, merged[keep - 1 - i]);
+    }
+    dst->size = keep;
+    free(merged);
+    return 1;
+}
+
+int heavy_hitters_top(const HeavyHitters* sketch, HeavyHitter* out, int max_items) {
+    if (sketch == NULL || out == NULL || max_items <= 0) {
+        return 0;
+    }
+    HeavyHitter* sorted = (HeavyHitter*)malloc(sizeof(HeavyHitter) * (sketch->size > 0 ? sketch->size : 1));
+    if (sorted == NULL) {
+        printf("Error: Failed to sort heavy hitters\n");
+        return 0;
+    }
+    memcpy(sorted, sketch->heap, sizeof(HeavyHitter) * sketch->size);
+    qsort(sorted, sketch->size, sizeof(HeavyHitter), heavy_hitters_compare_desc);
+    int count = sketch->size < max_items ? sketch->size : max_items;
+    memcpy(out, sorted, sizeof(HeavyHitter) * count);
+    free(sorted);
+    return count;
+}
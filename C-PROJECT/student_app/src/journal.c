@@ -0,0 +1,1151 @@
+#include "journal.h"
+#include "log.h"
+#include "utils.h"
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define JOURNAL_LOG_MAGIC "SJWL"
+#define JOURNAL_SNAPSHOT_MAGIC "SJSN"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 16          // magic, version, entity mask, 2 spare, le64 lsn
+#define JOURNAL_FRAME_SIZE 8            // le32 body length, le32 CRC-32 of the body
+#define JOURNAL_MAX_RECORD 2048         // Larger than any encoded row
+
+// ---- Record layout ----
+
+typedef enum {
+    JOURNAL_FIELD_INT = 0,              // int or int-sized enum, zigzag varint
+    JOURNAL_FIELD_TIME,                 // time_t, zigzag varint
+    JOURNAL_FIELD_FLOAT,                // 4 raw bytes
+    JOURNAL_FIELD_TEXT                  // varint length, then the bytes
+} JournalFieldKind;
+
+typedef struct {
+    unsigned short offset;
+    unsigned short size;
+    unsigned char kind;
+} JournalField;
+
+#define JF(type, field, kind) { offsetof(type, field), sizeof(((type*)0)->field), JOURNAL_FIELD_##kind }
+
+// The id comes first in every row; a remove records only that
+static const JournalField journal_student_fields[] = {
+    JF(Student, id, INT), JF(Student, first_name, TEXT), JF(Student, last_name, TEXT),
+    JF(Student, email, TEXT), JF(Student, phone, TEXT), JF(Student, address, TEXT),
+    JF(Student, age, INT), JF(Student, course, TEXT), JF(Student, year, INT),
+    JF(Student, gpa, FLOAT), JF(Student, enrollment_date, TIME), JF(Student, is_active, INT),
+};
+
+static const JournalField journal_grade_fields[] = {
+    JF(Grade, id, INT), JF(Grade, student_id, INT), JF(Grade, course_id, INT),
+    JF(Grade, course_name, TEXT), JF(Grade, grade_level, INT), JF(Grade, numeric_grade, FLOAT),
+    JF(Grade, assignment_name, TEXT), JF(Grade, date_assigned, TIME), JF(Grade, date_due, TIME),
+    JF(Grade, date_submitted, TIME), JF(Grade, is_submitted, INT), JF(Grade, is_late, INT),
+    JF(Grade, comments, TEXT), JF(Grade, teacher_id, INT),
+};
+
+static const JournalField journal_attendance_fields[] = {
+    JF(AttendanceRecord, id, INT), JF(AttendanceRecord, student_id, INT),
+    JF(AttendanceRecord, course_id, INT), JF(AttendanceRecord, date, TIME),
+    JF(AttendanceRecord, status, INT), JF(AttendanceRecord, reason, TEXT),
+    JF(AttendanceRecord, teacher_id, INT), JF(AttendanceRecord, recorded_time, TIME),
+};
+
+static const JournalField journal_club_fields[] = {
+    JF(Club, id, INT), JF(Club, name, TEXT), JF(Club, description, TEXT), JF(Club, category, TEXT),
+    JF(Club, president_id, INT), JF(Club, advisor_id, INT), JF(Club, member_count, INT),
+    JF(Club, max_members, INT), JF(Club, founded_date, TIME), JF(Club, last_meeting, TIME),
+    JF(Club, meeting_day, TEXT), JF(Club, meeting_time, TEXT), JF(Club, meeting_location, TEXT),
+    JF(Club, budget, FLOAT), JF(Club, is_active, INT),
+};
+
+static const JournalField journal_membership_fields[] = {
+    JF(ClubMembership, id, INT), JF(ClubMembership, student_id, INT), JF(ClubMembership, club_id, INT),
+    JF(ClubMembership, join_date, TIME), JF(ClubMembership, role, TEXT), JF(ClubMembership, is_active, INT),
+};
+
+#undef JF
+
+typedef struct {
+    const JournalField* fields;
+    int field_count;
+    size_t record_size;
+} JournalLayout;
+
+#define JOURNAL_LAYOUT(fields, type) { fields, (int)(sizeof(fields) / sizeof(fields[0])), sizeof(type) }
+
+static const JournalLayout journal_layouts[ENTITY_TYPE_COUNT] = {
+    [ENTITY_STUDENT] = JOURNAL_LAYOUT(journal_student_fields, Student),
+    [ENTITY_GRADE] = JOURNAL_LAYOUT(journal_grade_fields, Grade),
+    [ENTITY_ATTENDANCE] = JOURNAL_LAYOUT(journal_attendance_fields, AttendanceRecord),
+    [ENTITY_CLUB] = JOURNAL_LAYOUT(journal_club_fields, Club),
+    [ENTITY_MEMBERSHIP] = JOURNAL_LAYOUT(journal_membership_fields, ClubMembership),
+};
+
+// ---- Encoding ----
+
+static unsigned int journal_crc_table[256];
+static pthread_once_t journal_crc_once = PTHREAD_ONCE_INIT;
+
+static void journal_crc_init(void) {
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        journal_crc_table[i] = c;
+    }
+}
+
+static unsigned int journal_crc32(const unsigned char* data, size_t length) {
+    pthread_once(&journal_crc_once, journal_crc_init);
+    unsigned int c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        c = journal_crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static void journal_put_le32(unsigned char* out, unsigned int value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static unsigned int journal_get_le32(const unsigned char* in) {
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+static void journal_put_le64(unsigned char* out, unsigned long long value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static unsigned long long journal_get_le64(const unsigned char* in) {
+    unsigned long long value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | in[i];
+    }
+    return value;
+}
+
+static size_t journal_put_varint(unsigned char* out, unsigned long long value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+// 0 when the input ends inside the varint or it runs past 64 bits
+static size_t journal_get_varint(const unsigned char* in, size_t available, unsigned long long* value) {
+    unsigned long long result = 0;
+    for (size_t n = 0; n < available && n < 10; n++) {
+        result |= (unsigned long long)(in[n] & 0x7F) << (7 * n);
+        if ((in[n] & 0x80) == 0) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static unsigned long long journal_zigzag(long long value) {
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static long long journal_unzigzag(unsigned long long value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// Frames one record into out (JOURNAL_MAX_RECORD bytes); returns its size
+static size_t journal_encode(unsigned char* out, unsigned long long lsn, EntityType entity, ChangeType type,
+                             const void* record) {
+    const JournalLayout* layout = &journal_layouts[entity];
+    const unsigned char* base = (const unsigned char*)record;
+    unsigned char* body = out + JOURNAL_FRAME_SIZE;
+    size_t n = journal_put_varint(body, lsn);
+    body[n++] = (unsigned char)entity;
+    body[n++] = (unsigned char)type;
+    int fields = type == CHANGE_REMOVE ? 1 : layout->field_count;
+    for (int i = 0; i < fields; i++) {
+        const JournalField* field = &layout->fields[i];
+        const unsigned char* at = base + field->offset;
+        if (field->kind == JOURNAL_FIELD_INT) {
+            int value;
+            memcpy(&value, at, sizeof(value));
+            n += journal_put_varint(body + n, journal_zigzag(value));
+        } else if (field->kind == JOURNAL_FIELD_TIME) {
+            time_t value;
+            memcpy(&value, at, sizeof(value));
+            n += journal_put_varint(body + n, journal_zigzag((long long)value));
+        } else if (field->kind == JOURNAL_FIELD_FLOAT) {
+            memcpy(body + n, at, sizeof(float));
+            n += sizeof(float);
+        } else {
+            size_t length = strnlen((const char*)at, field->size - 1);
+            n += journal_put_varint(body + n, length);
+            memcpy(body + n, at, length);
+            n += length;
+        }
+    }
+    journal_put_le32(out, (unsigned int)n);
+    journal_put_le32(out + 4, journal_crc32(body, n));
+    return JOURNAL_FRAME_SIZE + n;
+}
+
+typedef struct {
+    unsigned long long lsn;
+    EntityType entity;
+    ChangeType type;
+    int id;
+    union {
+        Student student;
+        Grade grade;
+        AttendanceRecord attendance;
+        Club club;
+        ClubMembership membership;
+    } row;
+} JournalRecord;
+
+// Decodes one checked body; 0 when it is malformed
+static int journal_decode(const unsigned char* body, size_t length, JournalRecord* record) {
+    unsigned long long value;
+    size_t n = journal_get_varint(body, length, &record->lsn);
+    if (n == 0 || n + 2 > length || body[n] >= ENTITY_TYPE_COUNT || body[n + 1] > CHANGE_EDIT) {
+        return 0;
+    }
+    record->entity = (EntityType)body[n];
+    record->type = (ChangeType)body[n + 1];
+    n += 2;
+
+    const JournalLayout* layout = &journal_layouts[record->entity];
+    memset(&record->row, 0, sizeof(record->row));
+    unsigned char* base = (unsigned char*)&record->row;
+    int fields = record->type == CHANGE_REMOVE ? 1 : layout->field_count;
+    for (int i = 0; i < fields; i++) {
+        const JournalField* field = &layout->fields[i];
+        unsigned char* at = base + field->offset;
+        if (field->kind == JOURNAL_FIELD_FLOAT) {
+            if (n + sizeof(float) > length) return 0;
+            memcpy(at, body + n, sizeof(float));
+            n += sizeof(float);
+            continue;
+        }
+        size_t used = journal_get_varint(body + n, length - n, &value);
+        if (used == 0) return 0;
+        n += used;
+        if (field->kind == JOURNAL_FIELD_INT) {
+            int number = (int)journal_unzigzag(value);
+            memcpy(at, &number, sizeof(number));
+        } else if (field->kind == JOURNAL_FIELD_TIME) {
+            time_t when = (time_t)journal_unzigzag(value);
+            memcpy(at, &when, sizeof(when));
+        } else {
+            if (value >= field->size || n + value > length) return 0;
+            memcpy(at, body + n, (size_t)value);
+            n += (size_t)value;
+        }
+    }
+    memcpy(&record->id, base + layout->fields[0].offset, sizeof(int));
+    return n == length;
+}
+
+// Reads the next frame from file into body; 1 on a whole, checked frame,
+// 0 at the end or at a torn or corrupt frame
+static int journal_read_frame(FILE* file, unsigned char* body, size_t* length) {
+    unsigned char frame[JOURNAL_FRAME_SIZE];
+    if (fread(frame, 1, sizeof(frame), file) != sizeof(frame)) {
+        return 0;
+    }
+    size_t size = journal_get_le32(frame);
+    if (size == 0 || size > JOURNAL_MAX_RECORD - JOURNAL_FRAME_SIZE || fread(body, 1, size, file) != size ||
+        journal_crc32(body, size) != journal_get_le32(frame + 4)) {
+        return 0;
+    }
+    *length = size;
+    return 1;
+}
+
+static void journal_header_init(unsigned char* header, const char* magic, int mask, unsigned long long lsn) {
+    memset(header, 0, JOURNAL_HEADER_SIZE);
+    memcpy(header, magic, 4);
+    header[4] = JOURNAL_VERSION;
+    header[5] = (unsigned char)mask;
+    journal_put_le64(header + 8, lsn);
+}
+
+// Opens path and checks its header; NULL when it is missing or not ours
+static FILE* journal_open_file(const char* path, const char* magic, int* mask, unsigned long long* lsn) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, magic, 4) != 0 ||
+        header[4] != JOURNAL_VERSION) {
+        printf("Warning: %s is not a journal file\n", path);
+        fclose(file);
+        return NULL;
+    }
+    if (mask != NULL) *mask = header[5];
+    if (lsn != NULL) *lsn = journal_get_le64(header + 8);
+    return file;
+}
+
+// ---- Registry ----
+
+static Journal* journal_registry[JOURNAL_MAX_OPEN];
+static pthread_mutex_t journal_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The replay running on this thread; only the events it causes itself
+// are kept out of the log, other threads' mutations still go in
+static __thread const Journal* journal_replay_journal = NULL;
+static __thread int journal_replay_entity_id = -1;
+
+static const void* journal_followed_list(const Journal* journal, EntityType entity) {
+    switch (entity) {
+        case ENTITY_STUDENT: return journal->students;
+        case ENTITY_GRADE: return journal->grades;
+        case ENTITY_ATTENDANCE: return journal->attendance;
+        case ENTITY_CLUB: return journal->clubs;
+        case ENTITY_MEMBERSHIP: return journal->memberships;
+    }
+    return NULL;
+}
+
+static pthread_mutex_t* journal_list_lock(const Journal* journal, EntityType entity) {
+    switch (entity) {
+        case ENTITY_STUDENT: return journal->students != NULL ? &journal->students->lock : NULL;
+        case ENTITY_GRADE: return journal->grades != NULL ? &journal->grades->lock : NULL;
+        case ENTITY_ATTENDANCE: return journal->attendance != NULL ? &journal->attendance->lock : NULL;
+        case ENTITY_CLUB: return journal->clubs != NULL ? &journal->clubs->lock : NULL;
+        case ENTITY_MEMBERSHIP: return journal->memberships != NULL ? &journal->memberships->lock : NULL;
+    }
+    return NULL;
+}
+
+static void journal_unlock_lists(Journal* journal, int count) {
+    for (int entity = count - 1; entity >= 0; entity--) {
+        pthread_mutex_t* lock = journal_list_lock(journal, (EntityType)entity);
+        if (lock != NULL) {
+            pthread_mutex_unlock(lock);
+        }
+    }
+}
+
+// Takes every followed list's lock, always in entity order. A checkpoint
+// that starts on a mutating thread already holds one of them, and another
+// thread may hold a later one while it waits for it, so that caller only
+// tries (wait = 0) and gets 0 when a list is busy.
+static int journal_lock_lists(Journal* journal, int wait) {
+    for (int entity = 0; entity < ENTITY_TYPE_COUNT; entity++) {
+        pthread_mutex_t* lock = journal_list_lock(journal, (EntityType)entity);
+        if (lock == NULL) {
+            continue;
+        }
+        if (wait) {
+            pthread_mutex_lock(lock);
+        } else if (pthread_mutex_trylock(lock) != 0) {
+            journal_unlock_lists(journal, entity);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// ---- Group commit ----
+
+static int journal_write_all(int fd, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+static void* journal_writer_main(void* arg) {
+    Journal* journal = (Journal*)arg;
+    pthread_mutex_lock(&journal->lock);
+    for (;;) {
+        while (!journal->stopping && journal->pending_used == 0) {
+            pthread_cond_wait(&journal->work, &journal->lock);
+        }
+        if (journal->pending_used == 0) {
+            break;
+        }
+        // Without anyone waiting, let the batch fill for up to the interval
+        if (journal->waiters == 0 && !journal->stopping && journal->config.flush_interval_ms > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)journal->config.flush_interval_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&journal->work, &journal->lock, &deadline);
+            if (journal->pending_used == 0) {
+                continue;               // A checkpoint took the batch
+            }
+        }
+
+        unsigned char* batch = journal->pending;
+        size_t used = journal->pending_used;
+        size_t size = journal->pending_size;
+        unsigned long long lsn = journal->pending_lsn;
+        journal->pending = journal->writing;
+        journal->pending_size = journal->writing_size;
+        journal->pending_used = 0;
+        journal->writing = batch;
+        journal->writing_size = size;
+        pthread_mutex_unlock(&journal->lock);
+
+        pthread_mutex_lock(&journal->io_lock);
+        utils_file_append_begin();
+        int ok = journal_write_all(journal->fd, batch, used);
+        utils_file_append_end();
+        ok = ok && fdatasync(journal->fd) == 0;
+        pthread_mutex_unlock(&journal->io_lock);
+
+        pthread_mutex_lock(&journal->lock);
+        if (ok) {
+            journal->log_bytes += (long)used;
+            if (lsn > journal->durable_lsn) {
+                journal->durable_lsn = lsn;
+            }
+            journal->stats.bytes += used;
+            journal->stats.batches++;
+            journal->stats.fsyncs++;
+        } else if (!journal->failed) {
+            journal->failed = 1;
+            LOG_ERROR(LOG_MODULE_ID_FILE, "Journal write to %s failed", journal->path);
+            printf("Error: Failed to write journal %s\n", journal->path);
+        }
+        pthread_cond_broadcast(&journal->durable);
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+// Waits for lsn to be durable; called with the lock held
+static int journal_wait_durable(Journal* journal, unsigned long long lsn) {
+    journal->waiters++;
+    pthread_cond_signal(&journal->work);
+    while (journal->durable_lsn < lsn && !journal->failed) {
+        pthread_cond_wait(&journal->durable, &journal->lock);
+    }
+    journal->waiters--;
+    return journal->durable_lsn >= lsn;
+}
+
+static int journal_checkpoint_lists(Journal* journal, int wait);
+
+// may_checkpoint: the caller is a list mutation, so a due checkpoint can
+// start from here
+static int journal_append_record(Journal* journal, EntityType entity, ChangeType type, const void* row, int wait,
+                                 int may_checkpoint) {
+    if (journal_replay_journal == journal && (int)entity == journal_replay_entity_id) {
+        return 1;
+    }
+    pthread_mutex_lock(&journal->lock);
+    if (journal->failed) {
+        pthread_mutex_unlock(&journal->lock);
+        return 0;
+    }
+    if (journal->pending_used + JOURNAL_MAX_RECORD > journal->pending_size) {
+        size_t size = journal->pending_size * 2;
+        unsigned char* grown = (unsigned char*)realloc(journal->pending, size);
+        if (grown == NULL) {
+            journal->failed = 1;
+            pthread_cond_broadcast(&journal->durable);
+            pthread_mutex_unlock(&journal->lock);
+            printf("Error: Failed to grow journal buffer\n");
+            return 0;
+        }
+        journal->pending = grown;
+        journal->pending_size = size;
+    }
+    unsigned long long lsn = journal->next_lsn++;
+    journal->pending_used += journal_encode(journal->pending + journal->pending_used, lsn, entity, type, row);
+    journal->pending_lsn = lsn;
+    journal->stats.records++;
+    int ok = 1;
+    if (wait) {
+        ok = journal_wait_durable(journal, lsn);
+    } else {
+        pthread_cond_signal(&journal->work);
+    }
+    int checkpoint = may_checkpoint && journal->config.checkpoint_bytes > 0 &&
+                     journal->log_bytes + (long)journal->pending_used > journal->config.checkpoint_bytes;
+    pthread_mutex_unlock(&journal->lock);
+
+    // On the mutating thread; skipped while another thread holds a list,
+    // the next append tries again
+    if (checkpoint) {
+        journal_checkpoint_lists(journal, 0);
+    }
+    return ok;
+}
+
+static void journal_on_change(const ChangeEvent* event, void* user_data) {
+    Journal* journal = (Journal*)user_data;
+    if ((unsigned int)event->entity >= ENTITY_TYPE_COUNT || event->list == NULL ||
+        event->list != journal_followed_list(journal, event->entity)) {
+        return;
+    }
+    const void* row = event->type == CHANGE_REMOVE ? event->old_record : event->new_record;
+    if (row != NULL) {
+        journal_append_record(journal, event->entity, event->type, row, journal->config.sync_commits, 1);
+    }
+}
+
+int journal_append(Journal* journal, EntityType entity, ChangeType type, const void* record) {
+    if (journal == NULL || (unsigned int)entity >= ENTITY_TYPE_COUNT || record == NULL) {
+        return 0;
+    }
+    // Possibly another thread (the autosave one); the next change event
+    // takes care of a due checkpoint
+    return journal_append_record(journal, entity, type, record, 0, 0);
+}
+
+// ---- Lifecycle ----
+
+void journal_config_default(JournalConfig* config) {
+    if (config == NULL) {
+        return;
+    }
+    config->flush_interval_ms = JOURNAL_DEFAULT_FLUSH_MS;
+    config->sync_commits = 1;
+    config->checkpoint_bytes = JOURNAL_DEFAULT_CHECKPOINT_BYTES;
+}
+
+// Writes an empty log starting after base_lsn over path
+static int journal_reset_log(const char* path, unsigned long long base_lsn) {
+    char temp[600];
+    FILE* file = utils_file_open_atomic(path, temp, sizeof(temp));
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    journal_header_init(header, JOURNAL_LOG_MAGIC, 0, base_lsn);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        utils_file_abort_atomic(file, temp);
+        return 0;
+    }
+    return utils_file_commit_atomic(file, temp, path);
+}
+
+// Finds the end of the last whole record, cuts off anything after it and
+// returns the highest lsn seen
+static int journal_recover_log(Journal* journal, unsigned long long* last_lsn) {
+    FILE* file = journal_open_file(journal->path, JOURNAL_LOG_MAGIC, NULL, &journal->base_lsn);
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned char body[JOURNAL_MAX_RECORD];
+    size_t length;
+    long valid_end = JOURNAL_HEADER_SIZE;
+    JournalRecord record;
+    *last_lsn = journal->base_lsn;
+    while (journal_read_frame(file, body, &length) && journal_decode(body, length, &record)) {
+        valid_end = ftell(file);
+        if (record.lsn > *last_lsn) {
+            *last_lsn = record.lsn;
+        }
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    if (size > valid_end) {
+        LOG_WARNING(LOG_MODULE_ID_FILE, "Journal %s: dropped %ld bytes of torn tail", journal->path,
+                    size - valid_end);
+        printf("Warning: Journal %s ends in an incomplete record; truncating\n", journal->path);
+        if (truncate(journal->path, valid_end) != 0) {
+            return 0;
+        }
+    }
+    journal->log_bytes = valid_end;
+    return 1;
+}
+
+Journal* journal_open(const char* path, const JournalConfig* config, StudentList* students, GradeList* grades,
+                      AttendanceList* attendance, ClubList* clubs, MembershipList* memberships) {
+    if (path == NULL || strlen(path) >= sizeof(((Journal*)0)->path)) {
+        printf("Error: Invalid journal path\n");
+        return NULL;
+    }
+    Journal* journal = (Journal*)calloc(1, sizeof(Journal));
+    if (journal == NULL) {
+        printf("Error: Failed to create journal\n");
+        return NULL;
+    }
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_mutex_init(&journal->io_lock, NULL);
+    pthread_cond_init(&journal->work, NULL);
+    pthread_cond_init(&journal->durable, NULL);
+    journal->fd = -1;
+    strcpy(journal->path, path);
+    snprintf(journal->snapshot_path, sizeof(journal->snapshot_path), "%s.snap", path);
+    if (config != NULL) {
+        journal->config = *config;
+    } else {
+        journal_config_default(&journal->config);
+    }
+    journal->students = students;
+    journal->grades = grades;
+    journal->attendance = attendance;
+    journal->clubs = clubs;
+    journal->memberships = memberships;
+
+    unsigned long long last_lsn = 0;
+    unsigned long long snapshot_lsn = 0;
+    FILE* snapshot = journal_open_file(journal->snapshot_path, JOURNAL_SNAPSHOT_MAGIC, NULL, &snapshot_lsn);
+    if (snapshot != NULL) {
+        fclose(snapshot);
+    }
+    struct stat st;
+    if ((stat(path, &st) != 0 && !journal_reset_log(path, snapshot_lsn)) ||
+        !journal_recover_log(journal, &last_lsn)) {
+        printf("Error: Could not open journal %s\n", path);
+        journal_close(journal);
+        return NULL;
+    }
+    journal->next_lsn = (last_lsn > snapshot_lsn ? last_lsn : snapshot_lsn) + 1;
+    journal->durable_lsn = journal->next_lsn - 1;
+    journal->pending_size = JOURNAL_BUFFER_INITIAL;
+    journal->writing_size = JOURNAL_BUFFER_INITIAL;
+    journal->pending = (unsigned char*)malloc(journal->pending_size);
+    journal->writing = (unsigned char*)malloc(journal->writing_size);
+    journal->fd = open(path, O_WRONLY | O_APPEND);
+    if (journal->pending == NULL || journal->writing == NULL || journal->fd < 0) {
+        printf("Error: Could not open journal %s\n", path);
+        journal_close(journal);
+        return NULL;
+    }
+    // The log grows in place, so backup snapshots copy it
+    utils_file_register_appended(path);
+
+    pthread_mutex_lock(&journal_registry_lock);
+    int slot = 0;
+    while (slot < JOURNAL_MAX_OPEN && journal_registry[slot] != NULL) {
+        slot++;
+    }
+    if (slot < JOURNAL_MAX_OPEN) {
+        journal_registry[slot] = journal;
+    }
+    pthread_mutex_unlock(&journal_registry_lock);
+    if (slot == JOURNAL_MAX_OPEN) {
+        printf("Error: Too many open journals\n");
+        journal_close(journal);
+        return NULL;
+    }
+
+    if (pthread_create(&journal->writer, NULL, journal_writer_main, journal) != 0) {
+        printf("Error: Failed to start journal writer\n");
+        journal_close(journal);
+        return NULL;
+    }
+    journal->writer_started = 1;
+    if (!change_notify_subscribe(journal_on_change, journal)) {
+        journal_close(journal);
+        return NULL;
+    }
+    if (students != NULL) {
+        student_list_lock(students);
+        students->journal = journal;
+        student_list_unlock(students);
+    }
+    LOG_INFO(LOG_MODULE_ID_FILE, "Opened journal %s at lsn %llu", path, journal->next_lsn - 1);
+    return journal;
+}
+
+void journal_close(Journal* journal) {
+    if (journal == NULL) {
+        return;
+    }
+    change_notify_unsubscribe(journal_on_change, journal);
+    if (journal->students != NULL && journal->students->journal == journal) {
+        // The list's file has not seen the journaled edits, so whoever
+        // saves next has to write it out
+        student_list_lock(journal->students);
+        journal->students->journal = NULL;
+        journal->students->generation++;
+        student_list_unlock(journal->students);
+    }
+    pthread_mutex_lock(&journal->lock);
+    journal->stopping = 1;
+    pthread_cond_broadcast(&journal->work);
+    pthread_mutex_unlock(&journal->lock);
+    if (journal->writer_started) {
+        pthread_join(journal->writer, NULL);
+    }
+
+    pthread_mutex_lock(&journal_registry_lock);
+    for (int i = 0; i < JOURNAL_MAX_OPEN; i++) {
+        if (journal_registry[i] == journal) {
+            journal_registry[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&journal_registry_lock);
+
+    if (journal->fd >= 0) {
+        utils_file_unregister_appended(journal->path);
+        close(journal->fd);
+    }
+    free(journal->pending);
+    free(journal->writing);
+    pthread_cond_destroy(&journal->work);
+    pthread_cond_destroy(&journal->durable);
+    pthread_mutex_destroy(&journal->io_lock);
+    pthread_mutex_destroy(&journal->lock);
+    free(journal);
+}
+
+int journal_sync(Journal* journal) {
+    if (journal == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    int ok = journal_wait_durable(journal, journal->next_lsn - 1);
+    pthread_mutex_unlock(&journal->lock);
+    return ok;
+}
+
+// ---- Checkpoints ----
+
+static int journal_write_rows(FILE* file, EntityType entity, unsigned long long lsn, const void* rows, int count) {
+    unsigned char frame[JOURNAL_MAX_RECORD];
+    const unsigned char* row = (const unsigned char*)rows;
+    for (int i = 0; i < count; i++, row += journal_layouts[entity].record_size) {
+        size_t size = journal_encode(frame, lsn, entity, CHANGE_ADD, row);
+        if (fwrite(frame, 1, size, file) != size) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int journal_checkpoint_lists(Journal* journal, int wait) {
+    // The lists are copied under their own locks, so no edit lands half
+    // way through the snapshot; appends wait on `lock` and the writer on
+    // `io_lock` until the new snapshot and log are in place
+    if (!journal_lock_lists(journal, wait)) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    if (journal->replaying) {
+        pthread_mutex_unlock(&journal->lock);
+        journal_unlock_lists(journal, ENTITY_TYPE_COUNT);
+        return 0;
+    }
+    pthread_mutex_lock(&journal->io_lock);
+    unsigned long long lsn = journal->next_lsn - 1;
+
+    // A list that is not loaded stays with its own file and is left out
+    int mask = 0;
+    if (journal->students != NULL && journal->students->students != NULL) mask |= 1 << ENTITY_STUDENT;
+    if (journal->grades != NULL && journal->grades->grades != NULL) mask |= 1 << ENTITY_GRADE;
+    if (journal->attendance != NULL && journal->attendance->records != NULL) mask |= 1 << ENTITY_ATTENDANCE;
+    if (journal->clubs != NULL && journal->clubs->clubs != NULL) mask |= 1 << ENTITY_CLUB;
+    if (journal->memberships != NULL && journal->memberships->memberships != NULL) mask |= 1 << ENTITY_MEMBERSHIP;
+
+    char temp[600];
+    FILE* file = utils_file_open_atomic(journal->snapshot_path, temp, sizeof(temp));
+    int ok = file != NULL;
+    if (ok) {
+        unsigned char header[JOURNAL_HEADER_SIZE];
+        journal_header_init(header, JOURNAL_SNAPSHOT_MAGIC, mask, lsn);
+        ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+        if (ok && (mask & 1 << ENTITY_STUDENT))
+            ok = journal_write_rows(file, ENTITY_STUDENT, lsn, journal->students->students, journal->students->count);
+        if (ok && (mask & 1 << ENTITY_GRADE))
+            ok = journal_write_rows(file, ENTITY_GRADE, lsn, journal->grades->grades, journal->grades->count);
+        if (ok && (mask & 1 << ENTITY_ATTENDANCE))
+            ok = journal_write_rows(file, ENTITY_ATTENDANCE, lsn, journal->attendance->records,
+                                    journal->attendance->count);
+        if (ok && (mask & 1 << ENTITY_CLUB))
+            ok = journal_write_rows(file, ENTITY_CLUB, lsn, journal->clubs->clubs, journal->clubs->count);
+        if (ok && (mask & 1 << ENTITY_MEMBERSHIP))
+            ok = journal_write_rows(file, ENTITY_MEMBERSHIP, lsn, journal->memberships->memberships,
+                                    journal->memberships->count);
+        if (ok) {
+            ok = utils_file_commit_atomic(file, temp, journal->snapshot_path);
+        } else {
+            utils_file_abort_atomic(file, temp);
+        }
+    }
+
+    // Once the snapshot is durable the old log is redundant. Records the
+    // writer still holds are rewritten after the new header and skipped
+    // on replay by their lsn.
+    if (ok && journal_reset_log(journal->path, lsn)) {
+        int fd = open(journal->path, O_WRONLY | O_APPEND);
+        if (fd >= 0) {
+            close(journal->fd);
+            journal->fd = fd;
+            journal->log_bytes = JOURNAL_HEADER_SIZE;
+            journal->base_lsn = lsn;
+            journal->pending_used = 0;
+            if (journal->durable_lsn < lsn) {
+                journal->durable_lsn = lsn;
+            }
+            journal->stats.checkpoints++;
+            pthread_cond_broadcast(&journal->durable);
+        } else {
+            ok = 0;
+        }
+    } else {
+        ok = 0;
+    }
+    pthread_mutex_unlock(&journal->io_lock);
+    pthread_mutex_unlock(&journal->lock);
+    journal_unlock_lists(journal, ENTITY_TYPE_COUNT);
+
+    if (ok) {
+        LOG_INFO(LOG_MODULE_ID_FILE, "Journal %s checkpointed at lsn %llu", journal->path, lsn);
+    } else {
+        LOG_ERROR(LOG_MODULE_ID_FILE, "Journal %s checkpoint failed", journal->path);
+        printf("Error: Journal checkpoint failed for %s\n", journal->path);
+    }
+    return ok;
+}
+
+int journal_checkpoint(Journal* journal) {
+    return journal != NULL && journal_checkpoint_lists(journal, 1);
+}
+
+// ---- Replay ----
+
+// Quiet lookups: a missing id is the normal case for an add
+static Grade* journal_find_grade(GradeList* list, int id) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->grades[i].id == id) return &list->grades[i];
+    }
+    return NULL;
+}
+
+static Club* journal_find_club(ClubList* list, int id) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->clubs[i].id == id) return &list->clubs[i];
+    }
+    return NULL;
+}
+
+static ClubMembership* journal_find_membership(MembershipList* list, int id) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->memberships[i].id == id) return &list->memberships[i];
+    }
+    return NULL;
+}
+
+// Applies one record as an upsert, through the list functions so other
+// listeners see the change
+static int journal_apply(Journal* journal, const JournalRecord* record) {
+    int remove = record->type == CHANGE_REMOVE;
+    switch (record->entity) {
+        case ENTITY_STUDENT: {
+            StudentList* list = journal->students;
+            int exists = student_list_find_by_id(list, record->id) != NULL;
+            if (remove) return !exists || student_list_remove(list, record->id);
+            return exists ? student_list_update(list, record->row.student)
+                          : student_list_add(list, record->row.student);
+        }
+        case ENTITY_GRADE: {
+            GradeList* list = journal->grades;
+            int exists = journal_find_grade(list, record->id) != NULL;
+            if (remove) return !exists || grade_list_remove(list, record->id);
+            return exists ? grade_list_update(list, record->row.grade) : grade_list_add(list, record->row.grade);
+        }
+        case ENTITY_ATTENDANCE: {
+            AttendanceList* list = journal->attendance;
+            int exists = attendance_list_find_by_id(list, record->id) != NULL;
+            if (remove) return !exists || attendance_list_remove(list, record->id);
+            return exists ? attendance_list_update(list, record->row.attendance)
+                          : attendance_list_add(list, record->row.attendance);
+        }
+        case ENTITY_CLUB: {
+            ClubList* list = journal->clubs;
+            int exists = journal_find_club(list, record->id) != NULL;
+            if (remove) return !exists || club_list_remove(list, record->id);
+            return exists ? club_list_update(list, record->row.club) : club_list_add(list, record->row.club);
+        }
+        case ENTITY_MEMBERSHIP: {
+            MembershipList* list = journal->memberships;
+            int exists = journal_find_membership(list, record->id) != NULL;
+            if (remove) return !exists || membership_list_remove(list, record->id);
+            return exists ? membership_list_update(list, record->row.membership)
+                          : membership_list_add(list, record->row.membership);
+        }
+    }
+    return 0;
+}
+
+// Empties a list before the snapshot is loaded into it, publishing a
+// remove for each row (last first) so listeners such as the stats cache
+// do not count the reloaded rows twice
+#define JOURNAL_CLEAR(entity, list, rows)                                                   \
+    while ((list)->count > 0) {                                                             \
+        (list)->count--;                                                                    \
+        change_notify_publish((entity), CHANGE_REMOVE, (list), &(list)->rows[(list)->count], NULL); \
+    }
+
+static void journal_clear_list(Journal* journal, EntityType entity) {
+    switch (entity) {
+        case ENTITY_STUDENT: JOURNAL_CLEAR(entity, journal->students, students); break;
+        case ENTITY_GRADE: JOURNAL_CLEAR(entity, journal->grades, grades); break;
+        case ENTITY_ATTENDANCE: JOURNAL_CLEAR(entity, journal->attendance, records); break;
+        case ENTITY_CLUB: JOURNAL_CLEAR(entity, journal->clubs, clubs); break;
+        case ENTITY_MEMBERSHIP: JOURNAL_CLEAR(entity, journal->memberships, memberships); break;
+    }
+}
+
+#undef JOURNAL_CLEAR
+
+// Applies the entity's records from file after min_lsn; returns how many
+static long journal_apply_file(Journal* journal, FILE* file, EntityType entity, unsigned long long min_lsn) {
+    unsigned char body[JOURNAL_MAX_RECORD];
+    JournalRecord* record = (JournalRecord*)malloc(sizeof(JournalRecord));
+    size_t length;
+    long applied = 0;
+    if (record == NULL) {
+        return -1;
+    }
+    while (journal_read_frame(file, body, &length) && journal_decode(body, length, record)) {
+        if (record->entity == entity && record->lsn > min_lsn) {
+            if (!journal_apply(journal, record)) {
+                printf("Warning: Journal record %llu could not be applied\n", record->lsn);
+            }
+            applied++;
+        }
+    }
+    free(record);
+    return applied;
+}
+
+static int journal_replay_entity(Journal* journal, EntityType entity) {
+    // Whatever is still buffered has to reach the log before it is read
+    if (!journal_sync(journal)) {
+        return 0;
+    }
+    // Replaying also holds off checkpoints, so the files stay put
+    pthread_mutex_lock(&journal->lock);
+    journal->replaying++;
+    unsigned long long base_lsn = journal->base_lsn;
+    pthread_mutex_unlock(&journal->lock);
+    // The list is emptied and refilled as one edit
+    pthread_mutex_t* list_lock = journal_list_lock(journal, entity);
+    pthread_mutex_lock(list_lock);
+    journal_replay_journal = journal;
+    journal_replay_entity_id = (int)entity;
+
+    long applied = 0;
+    int mask = 0;
+    FILE* snapshot = journal_open_file(journal->snapshot_path, JOURNAL_SNAPSHOT_MAGIC, &mask, NULL);
+    if (snapshot != NULL) {
+        if (mask & (1 << entity)) {
+            journal_clear_list(journal, entity);
+            applied += journal_apply_file(journal, snapshot, entity, 0);
+        }
+        fclose(snapshot);
+    }
+    FILE* log_file = journal_open_file(journal->path, JOURNAL_LOG_MAGIC, NULL, NULL);
+    if (log_file != NULL) {
+        applied += journal_apply_file(journal, log_file, entity, base_lsn);
+        fclose(log_file);
+    }
+
+    journal_replay_journal = NULL;
+    journal_replay_entity_id = -1;
+    pthread_mutex_unlock(list_lock);
+    pthread_mutex_lock(&journal->lock);
+    journal->replaying--;
+    journal->stats.replayed += applied > 0 ? (unsigned long long)applied : 0;
+    pthread_mutex_unlock(&journal->lock);
+    LOG_DEBUG(LOG_MODULE_ID_FILE, "Journal %s: replayed %ld records for entity %d", journal->path, applied, entity);
+    return applied >= 0;
+}
+
+int journal_replay(Journal* journal) {
+    if (journal == NULL) {
+        return 0;
+    }
+    int ok = 1;
+    if (journal->students != NULL && journal->students->students != NULL)
+        ok &= journal_replay_entity(journal, ENTITY_STUDENT);
+    if (journal->grades != NULL && journal->grades->grades != NULL)
+        ok &= journal_replay_entity(journal, ENTITY_GRADE);
+    if (journal->attendance != NULL && journal->attendance->records != NULL)
+        ok &= journal_replay_entity(journal, ENTITY_ATTENDANCE);
+    if (journal->clubs != NULL && journal->clubs->clubs != NULL)
+        ok &= journal_replay_entity(journal, ENTITY_CLUB);
+    if (journal->memberships != NULL && journal->memberships->memberships != NULL)
+        ok &= journal_replay_entity(journal, ENTITY_MEMBERSHIP);
+    return ok;
+}
+
+int journal_replay_list(EntityType entity, void* list) {
+    if ((unsigned int)entity >= ENTITY_TYPE_COUNT || list == NULL) {
+        return 0;
+    }
+    Journal* journal = NULL;
+    pthread_mutex_lock(&journal_registry_lock);
+    for (int i = 0; i < JOURNAL_MAX_OPEN && journal == NULL; i++) {
+        if (journal_registry[i] != NULL && journal_followed_list(journal_registry[i], entity) == list) {
+            journal = journal_registry[i];
+        }
+    }
+    pthread_mutex_unlock(&journal_registry_lock);
+    return journal == NULL || journal_replay_entity(journal, entity);
+}
+
+// ---- Statistics ----
+
+void journal_get_stats(Journal* journal, JournalStats* stats) {
+    if (journal == NULL || stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&journal->lock);
+    *stats = journal->stats;
+    pthread_mutex_unlock(&journal->lock);
+}
+
+void display_journal_stats(Journal* journal) {
+    if (journal == NULL) {
+        return;
+    }
+    JournalStats stats;
+    journal_get_stats(journal, &stats);
+    printf("\n=== JOURNAL: %s ===\n", journal->path);
+    printf("Records:          %llu (%.1f bytes each)\n", stats.records,
+           stats.records > 0 ? (double)stats.bytes / (double)stats.records : 0.0);
+    printf("Batches:          %llu (%.1f records per fsync)\n", stats.batches,
+           stats.fsyncs > 0 ? (double)stats.records / (double)stats.fsyncs : 0.0);
+    printf("Checkpoints:      %llu\n", stats.checkpoints);
+    printf("Replayed:         %llu\n", stats.replayed);
+    printf("Log size:         %ld bytes\n", journal->log_bytes);
+}
+
+// ---- Benchmark ----
+
+static double journal_seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void journal_benchmark_fill(StudentList* list, int students) {
+    Student student;
+    memset(&student, 0, sizeof(student));
+    for (int i = 0; i < students && i < list->capacity; i++) {
+        student.id = i + 1;
+        snprintf(student.first_name, sizeof(student.first_name), "First%d", i);
+        snprintf(student.last_name, sizeof(student.last_name), "Last%d", i);
+        snprintf(student.email, sizeof(student.email), "student%d@school.edu", i);
+        strcpy(student.phone, "0600000000");
+        strcpy(student.address, "1 School Road");
+        strcpy(student.course, "Computer Science");
+        student.age = 18 + i % 10;
+        student.year = 1 + i % 4;
+        student.gpa = 2.0f + (float)(i % 20) / 10.0f;
+        student.enrollment_date = 1700000000 + i;
+        student.is_active = 1;
+        list->students[list->count++] = student;
+    }
+}
+
+void journal_benchmark(const char* scratch_dir, int students, int edits) {
+    if (scratch_dir == NULL) {
+        scratch_dir = ".";
+    }
+    if (students <= 0 || students > MAX_STUDENTS) {
+        students = MAX_STUDENTS;
+    }
+    if (edits <= 0) {
+        edits = 200;
+    }
+    char csv_path[512], journal_path[512];
+    snprintf(csv_path, sizeof(csv_path), "%s/journal_bench.csv", scratch_dir);
+    snprintf(journal_path, sizeof(journal_path), "%s/journal_bench.wal", scratch_dir);
+
+    StudentList* list = student_list_create();
+    if (list == NULL) {
+        return;
+    }
+    journal_benchmark_fill(list, students);
+    printf("\n=== JOURNAL BENCHMARK (%d students, %d edits) ===\n", list->count, edits);
+
+    // Every edit followed by a full rewrite, as student_list_auto_save does
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < edits; i++) {
+        Student student = list->students[i % list->count];
+        student.gpa = (float)(i % 40) / 10.0f;
+        student_list_update(list, student);
+        student_list_save_to_file(list, csv_path);
+    }
+    double seconds = journal_seconds_since(&start);
+    struct stat st;
+    printf("Full save per edit:  %8.3f ms/edit, %lld bytes written per edit\n", seconds * 1e3 / edits,
+           stat(csv_path, &st) == 0 ? (long long)st.st_size : 0LL);
+
+    // One appended record per edit: durable per edit, then batched
+    for (int sync = 1; sync >= 0; sync--) {
+        remove(journal_path);
+        char snapshot_path[600];
+        snprintf(snapshot_path, sizeof(snapshot_path), "%s.snap", journal_path);
+        remove(snapshot_path);
+        JournalConfig config;
+        journal_config_default(&config);
+        config.sync_commits = sync;
+        config.checkpoint_bytes = 0;
+        Journal* journal = journal_open(journal_path, &config, list, NULL, NULL, NULL, NULL);
+        if (journal == NULL) {
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < edits; i++) {
+            Student student = list->students[i % list->count];
+            student.gpa = (float)(i % 40) / 10.0f;
+            student_list_update(list, student);
+        }
+        journal_sync(journal);
+        seconds = journal_seconds_since(&start);
+        JournalStats stats;
+        journal_get_stats(journal, &stats);
+        printf("Journal, %s: %8.3f ms/edit, %.1f bytes per edit, %llu fsyncs\n",
+               sync ? "sync   " : "batched", seconds * 1e3 / edits, (double)stats.bytes / (double)edits,
+               stats.fsyncs);
+
+        if (!sync) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            journal_checkpoint(journal);
+            printf("Checkpoint:          %8.3f ms\n", journal_seconds_since(&start) * 1e3);
+
+            // Replay the log over an emptied list and check it matches
+            Student expected = list->students[(edits - 1) % list->count];
+            list->count = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            journal_replay(journal);
+            seconds = journal_seconds_since(&start);
+            Student* replayed = student_list_find_by_id(list, expected.id);
+            printf("Replay:              %8.3f ms, %d students, last edit %s\n", seconds * 1e3, list->count,
+                   replayed != NULL && replayed->gpa == expected.gpa ? "present" : "MISSING");
+            remove(snapshot_path);
+        }
+        journal_close(journal);
+        remove(journal_path);
+    }
+    remove(csv_path);
+    student_list_destroy(list);
+}
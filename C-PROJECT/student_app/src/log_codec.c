@@ -0,0 +1,774 @@
+#include "log_codec.h"
+#include "lz_block.h"
+#include "log.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define LOG_FRAME_HEADER_SIZE 9
+#define LOG_FILE_HEADER_SIZE 6
+#define LOG_IP_NONE 0
+#define LOG_IP_V4 1
+#define LOG_IP_TEXT 2
+
+// ---- Buffers and varints ----
+
+void log_buffer_free(LogBuffer* buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(LogBuffer));
+}
+
+static int log_buffer_reserve(LogBuffer* buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) {
+        return 1;
+    }
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    while (capacity < buffer->size + extra) capacity *= 2;
+    unsigned char* data = (unsigned char*)realloc(buffer->data, capacity);
+    if (data == NULL) {
+        return 0;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+static int log_buffer_append(LogBuffer* buffer, const void* data, size_t size) {
+    if (!log_buffer_reserve(buffer, size)) {
+        return 0;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return 1;
+}
+
+static int log_put_varint(LogBuffer* buffer, unsigned long long value) {
+    if (!log_buffer_reserve(buffer, 10)) {
+        return 0;
+    }
+    unsigned char* p = buffer->data + buffer->size;
+    while (value >= 0x80) {
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    buffer->size = (size_t)(p - buffer->data);
+    return 1;
+}
+
+static unsigned long long log_zigzag(long long value) {
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static long long log_unzigzag(unsigned long long value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+static int log_get_varint(const unsigned char* data, size_t size, size_t* pos, unsigned long long* value) {
+    unsigned long long result = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7) {
+        unsigned char byte = data[(*pos)++];
+        result |= (unsigned long long)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void log_put_u32(unsigned char* p, unsigned int value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned int log_get_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// "a.b.c.d" in canonical form packs into 4 bytes
+static int log_pack_ipv4(const char* text, unsigned char out[4]) {
+    unsigned int parts[4];
+    char check[16];
+    if (sscanf(text, "%3u.%3u.%3u.%3u", &parts[0], &parts[1], &parts[2], &parts[3]) != 4) {
+        return 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (parts[i] > 255) return 0;
+        out[i] = (unsigned char)parts[i];
+    }
+    snprintf(check, sizeof(check), "%u.%u.%u.%u", parts[0], parts[1], parts[2], parts[3]);
+    return strcmp(check, text) == 0;
+}
+
+// ---- Block encoder ----
+
+void log_block_encoder_init(LogBlockEncoder* encoder) {
+    memset(encoder, 0, sizeof(LogBlockEncoder));
+    for (int i = 0; i < LOG_CODEC_DICT_SLOTS; i++) {
+        encoder->slots[i] = -1;
+    }
+}
+
+void log_block_encoder_free(LogBlockEncoder* encoder) {
+    log_buffer_free(&encoder->strings);
+    log_buffer_free(&encoder->rows);
+    free(encoder->string_offsets);
+    free(encoder->string_lengths);
+    log_block_encoder_init(encoder);
+}
+
+void log_block_encoder_reset(LogBlockEncoder* encoder) {
+    encoder->strings.size = 0;
+    encoder->rows.size = 0;
+    encoder->string_count = 0;
+    encoder->count = 0;
+    for (int i = 0; i < LOG_CODEC_DICT_SLOTS; i++) {
+        encoder->slots[i] = -1;
+    }
+}
+
+// Index of `text` in the block's string table, adding it when new
+static int log_block_intern(LogBlockEncoder* encoder, const char* text, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+
+    unsigned int mask = LOG_CODEC_DICT_SLOTS - 1;
+    for (unsigned int slot = hash & mask;; slot = (slot + 1) & mask) {
+        int index = encoder->slots[slot];
+        if (index < 0) {
+            if (encoder->string_count == encoder->string_capacity) {
+                int capacity = encoder->string_capacity > 0 ? encoder->string_capacity * 2 : 64;
+                int* offsets = (int*)realloc(encoder->string_offsets, sizeof(int) * capacity);
+                if (offsets == NULL) return -1;
+                encoder->string_offsets = offsets;
+                int* lengths = (int*)realloc(encoder->string_lengths, sizeof(int) * capacity);
+                if (lengths == NULL) return -1;
+                encoder->string_lengths = lengths;
+                encoder->string_capacity = capacity;
+            }
+            if (!log_put_varint(&encoder->strings, length)) {
+                return -1;
+            }
+            index = encoder->string_count++;
+            encoder->string_offsets[index] = (int)encoder->strings.size;
+            encoder->string_lengths[index] = (int)length;
+            if (!log_buffer_append(&encoder->strings, text, length)) {
+                return -1;
+            }
+            encoder->slots[slot] = index;
+            return index;
+        }
+        if ((size_t)encoder->string_lengths[index] == length &&
+            memcmp(encoder->strings.data + encoder->string_offsets[index], text, length) == 0) {
+            return index;
+        }
+    }
+}
+
+int log_block_encoder_add(LogBlockEncoder* encoder, const LogEntry* entry) {
+    if (encoder == NULL || entry == NULL || !log_validate_level(entry->level)) {
+        return 0;
+    }
+    // Two strings per entry at most keeps the hash table under half full
+    if (encoder->count >= LOG_CODEC_BLOCK_ENTRIES) {
+        return 0;
+    }
+
+    size_t module_length = strnlen(entry->module, sizeof(entry->module));
+    size_t username_length = strnlen(entry->username, sizeof(entry->username));
+    size_t ip_length = strnlen(entry->ip_address, sizeof(entry->ip_address));
+    size_t message_length = strnlen(entry->message, sizeof(entry->message));
+    int module = log_block_intern(encoder, entry->module, module_length);
+    int username = log_block_intern(encoder, entry->username, username_length);
+    if (module < 0 || username < 0) {
+        return 0;
+    }
+
+    char ip_text[sizeof(entry->ip_address) + 1];
+    memcpy(ip_text, entry->ip_address, ip_length);
+    ip_text[ip_length] = '\0';
+    unsigned char ip[4];
+    int ip_kind = ip_length == 0 ? LOG_IP_NONE : (log_pack_ipv4(ip_text, ip) ? LOG_IP_V4 : LOG_IP_TEXT);
+
+    long long timestamp = (long long)entry->timestamp;
+    if (encoder->count == 0) {
+        encoder->first_timestamp = timestamp;
+        encoder->last_timestamp = timestamp;
+    }
+
+    LogBuffer* rows = &encoder->rows;
+    unsigned char head = (unsigned char)(entry->level | (ip_kind << 3));
+    if (!log_buffer_append(rows, &head, 1) ||
+        !log_put_varint(rows, log_zigzag(timestamp - encoder->last_timestamp)) ||
+        !log_put_varint(rows, (unsigned long long)module) ||
+        !log_put_varint(rows, log_zigzag(entry->user_id)) ||
+        !log_put_varint(rows, (unsigned long long)username)) {
+        return 0;
+    }
+    if (ip_kind == LOG_IP_V4 && !log_buffer_append(rows, ip, 4)) {
+        return 0;
+    }
+    if (ip_kind == LOG_IP_TEXT &&
+        (!log_put_varint(rows, ip_length) || !log_buffer_append(rows, entry->ip_address, ip_length))) {
+        return 0;
+    }
+    if (!log_put_varint(rows, message_length) || !log_buffer_append(rows, entry->message, message_length)) {
+        return 0;
+    }
+
+    encoder->last_timestamp = timestamp;
+    encoder->count++;
+    return 1;
+}
+
+int log_block_encoder_finish(LogBlockEncoder* encoder, LogBuffer* out) {
+    if (encoder == NULL || out == NULL) {
+        return 0;
+    }
+    int ok = log_put_varint(out, (unsigned long long)encoder->count) &&
+             log_put_varint(out, (unsigned long long)encoder->string_count) &&
+             log_buffer_append(out, encoder->strings.data, encoder->strings.size) &&
+             log_put_varint(out, log_zigzag(encoder->first_timestamp)) &&
+             log_buffer_append(out, encoder->rows.data, encoder->rows.size);
+    log_block_encoder_reset(encoder);
+    return ok;
+}
+
+// ---- Block decoder ----
+
+void log_block_decoder_init(LogBlockDecoder* decoder) {
+    memset(decoder, 0, sizeof(LogBlockDecoder));
+}
+
+void log_block_decoder_free(LogBlockDecoder* decoder) {
+    free(decoder->strings);
+    free(decoder->string_lengths);
+    log_block_decoder_init(decoder);
+}
+
+int log_block_decoder_open(LogBlockDecoder* decoder, const unsigned char* data, size_t size) {
+    unsigned long long count, string_count, first;
+    decoder->data = data;
+    decoder->size = size;
+    decoder->pos = 0;
+    decoder->remaining = 0;
+    if (!log_get_varint(data, size, &decoder->pos, &count) ||
+        !log_get_varint(data, size, &decoder->pos, &string_count) ||
+        count > LOG_CODEC_BLOCK_ENTRIES || string_count > 2 * count) {
+        return 0;
+    }
+
+    if ((int)string_count > decoder->string_capacity) {
+        int capacity = (int)string_count;
+        const unsigned char** strings = (const unsigned char**)realloc((void*)decoder->strings, sizeof(char*) * capacity);
+        if (strings == NULL) return 0;
+        decoder->strings = strings;
+        int* lengths = (int*)realloc(decoder->string_lengths, sizeof(int) * capacity);
+        if (lengths == NULL) return 0;
+        decoder->string_lengths = lengths;
+        decoder->string_capacity = capacity;
+    }
+    for (int i = 0; i < (int)string_count; i++) {
+        unsigned long long length;
+        if (!log_get_varint(data, size, &decoder->pos, &length) || length > size - decoder->pos) {
+            return 0;
+        }
+        decoder->strings[i] = data + decoder->pos;
+        decoder->string_lengths[i] = (int)length;
+        decoder->pos += length;
+    }
+    if (!log_get_varint(data, size, &decoder->pos, &first)) {
+        return 0;
+    }
+    decoder->string_count = (int)string_count;
+    decoder->timestamp = log_unzigzag(first);
+    decoder->remaining = (int)count;
+    return 1;
+}
+
+static int log_decoder_string(const LogBlockDecoder* decoder, unsigned long long index, char* out, size_t size) {
+    if (index >= (unsigned long long)decoder->string_count) {
+        return 0;
+    }
+    size_t length = (size_t)decoder->string_lengths[index];
+    if (length >= size) length = size - 1;
+    memcpy(out, decoder->strings[index], length);
+    out[length] = '\0';
+    return 1;
+}
+
+int log_block_decoder_next(LogBlockDecoder* decoder, LogEntry* entry) {
+    if (decoder == NULL || entry == NULL || decoder->remaining <= 0) {
+        return 0;
+    }
+
+    const unsigned char* data = decoder->data;
+    size_t size = decoder->size;
+    size_t* pos = &decoder->pos;
+    unsigned long long delta, module, user_id, username, length;
+    if (*pos >= size) {
+        return 0;
+    }
+    unsigned char head = data[(*pos)++];
+    if (!log_get_varint(data, size, pos, &delta) || !log_get_varint(data, size, pos, &module) ||
+        !log_get_varint(data, size, pos, &user_id) || !log_get_varint(data, size, pos, &username)) {
+        return 0;
+    }
+
+    decoder->timestamp += log_unzigzag(delta);
+    entry->timestamp = (time_t)decoder->timestamp;
+    entry->level = (LogLevel)(head & 7);
+    entry->user_id = (int)log_unzigzag(user_id);
+    if (!log_decoder_string(decoder, module, entry->module, sizeof(entry->module)) ||
+        !log_decoder_string(decoder, username, entry->username, sizeof(entry->username))) {
+        return 0;
+    }
+
+    int ip_kind = (head >> 3) & 3;
+    entry->ip_address[0] = '\0';
+    if (ip_kind == LOG_IP_V4) {
+        if (size - *pos < 4) return 0;
+        snprintf(entry->ip_address, sizeof(entry->ip_address), "%u.%u.%u.%u",
+                 data[*pos], data[*pos + 1], data[*pos + 2], data[*pos + 3]);
+        *pos += 4;
+    } else if (ip_kind == LOG_IP_TEXT) {
+        if (!log_get_varint(data, size, pos, &length) || length > size - *pos) return 0;
+        size_t n = length < sizeof(entry->ip_address) - 1 ? (size_t)length : sizeof(entry->ip_address) - 1;
+        memcpy(entry->ip_address, data + *pos, n);
+        entry->ip_address[n] = '\0';
+        *pos += length;
+    }
+
+    if (!log_get_varint(data, size, pos, &length) || length > size - *pos) {
+        return 0;
+    }
+    size_t n = length < sizeof(entry->message) - 1 ? (size_t)length : sizeof(entry->message) - 1;
+    memcpy(entry->message, data + *pos, n);
+    entry->message[n] = '\0';
+    *pos += length;
+
+    decoder->remaining--;
+    return 1;
+}
+
+// ---- Writer ----
+
+static int log_writer_flush_block(LogWriter* writer) {
+    if (writer->encoder.count == 0) {
+        return 1;
+    }
+
+    writer->block.size = 0;
+    if (!log_block_encoder_finish(&writer->encoder, &writer->block)) {
+        return 0;
+    }
+
+    int raw_size = (int)writer->block.size;
+    const unsigned char* payload = writer->block.data;
+    int stored_size = raw_size;
+    unsigned char codec = LOG_CODEC_RAW;
+    if (writer->compress) {
+        int bound = lz_block_bound(raw_size);
+        writer->frame.size = 0;
+        if (bound > 0 && log_buffer_reserve(&writer->frame, (size_t)bound)) {
+            int compressed = lz_block_compress(writer->block.data, raw_size, writer->frame.data, bound);
+            // Keep the raw block when compression does not pay
+            if (compressed > 0 && compressed < raw_size) {
+                payload = writer->frame.data;
+                stored_size = compressed;
+                codec = LOG_CODEC_LZ;
+            }
+        }
+    }
+
+    unsigned char header[LOG_FRAME_HEADER_SIZE];
+    log_put_u32(header, (unsigned int)raw_size);
+    log_put_u32(header + 4, (unsigned int)stored_size);
+    header[8] = codec;
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header) ||
+        fwrite(payload, 1, (size_t)stored_size, writer->file) != (size_t)stored_size) {
+        return 0;
+    }
+    writer->raw_bytes += raw_size;
+    writer->stored_bytes += LOG_FRAME_HEADER_SIZE + stored_size;
+    return 1;
+}
+
+LogWriter* log_writer_open(const char* filename, int compress) {
+    if (filename == NULL) {
+        printf("Error: Log file name is NULL\n");
+        return NULL;
+    }
+
+    LogWriter* writer = (LogWriter*)calloc(1, sizeof(LogWriter));
+    if (writer == NULL) {
+        printf("Error: Failed to create log writer\n");
+        return NULL;
+    }
+    writer->file = fopen(filename, "wb");
+    if (writer->file == NULL) {
+        printf("Error: Cannot open %s for writing\n", filename);
+        free(writer);
+        return NULL;
+    }
+    writer->compress = compress;
+    log_block_encoder_init(&writer->encoder);
+
+    unsigned char header[LOG_FILE_HEADER_SIZE];
+    memcpy(header, LOG_CODEC_MAGIC, 4);
+    header[4] = LOG_CODEC_VERSION;
+    header[5] = (unsigned char)(compress ? LOG_CODEC_LZ : LOG_CODEC_RAW);
+    fwrite(header, 1, sizeof(header), writer->file);
+    writer->stored_bytes = sizeof(header);
+    return writer;
+}
+
+int log_writer_append(LogWriter* writer, const LogEntry* entry) {
+    if (writer == NULL || entry == NULL) {
+        printf("Error: Invalid arguments to log_writer_append\n");
+        return 0;
+    }
+    if (writer->encoder.count >= LOG_CODEC_BLOCK_ENTRIES && !log_writer_flush_block(writer)) {
+        printf("Error: Failed to write log block\n");
+        return 0;
+    }
+    if (!log_block_encoder_add(&writer->encoder, entry)) {
+        printf("Error: Failed to encode log entry\n");
+        return 0;
+    }
+    writer->entries++;
+    return 1;
+}
+
+int log_writer_close(LogWriter* writer) {
+    if (writer == NULL) {
+        return 0;
+    }
+    int ok = log_writer_flush_block(writer);
+    if (fclose(writer->file) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("Error: Failed to write log file\n");
+    }
+    log_block_encoder_free(&writer->encoder);
+    log_buffer_free(&writer->block);
+    log_buffer_free(&writer->frame);
+    free(writer);
+    return ok;
+}
+
+// ---- Reader ----
+
+int log_codec_is_compact_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    char magic[4];
+    int compact = fread(magic, 1, 4, file) == 4 && memcmp(magic, LOG_CODEC_MAGIC, 4) == 0;
+    fclose(file);
+    return compact;
+}
+
+LogReader* log_reader_open(const char* filename) {
+    if (filename == NULL) {
+        printf("Error: Log file name is NULL\n");
+        return NULL;
+    }
+
+    LogReader* reader = (LogReader*)calloc(1, sizeof(LogReader));
+    if (reader == NULL) {
+        printf("Error: Failed to create log reader\n");
+        return NULL;
+    }
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL) {
+        printf("Error: Cannot open %s\n", filename);
+        free(reader);
+        return NULL;
+    }
+    log_block_decoder_init(&reader->decoder);
+
+    unsigned char header[LOG_FILE_HEADER_SIZE];
+    size_t got = fread(header, 1, sizeof(header), reader->file);
+    if (got == sizeof(header) && memcmp(header, LOG_CODEC_MAGIC, 4) == 0) {
+        if (header[4] != LOG_CODEC_VERSION) {
+            printf("Error: Unsupported log file version %d in %s\n", header[4], filename);
+            log_reader_close(reader);
+            return NULL;
+        }
+        reader->format = LOG_FORMAT_COMPACT;
+        return reader;
+    }
+    if (got == 0 || header[0] == '[') {
+        reader->format = LOG_FORMAT_TEXT;
+        rewind(reader->file);
+        return reader;
+    }
+
+    // Encrypted batches need log_async_decrypt_file first
+    printf("Error: %s is not a readable log file\n", filename);
+    log_reader_close(reader);
+    return NULL;
+}
+
+static int log_reader_next_block(LogReader* reader) {
+    unsigned char header[LOG_FRAME_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header)) {
+        return 0;
+    }
+    unsigned int raw_size = log_get_u32(header);
+    unsigned int stored_size = log_get_u32(header + 4);
+    unsigned char codec = header[8];
+    if (raw_size > LZ_BLOCK_MAX_INPUT || stored_size > (unsigned int)lz_block_bound((int)raw_size) ||
+        (codec != LOG_CODEC_RAW && codec != LOG_CODEC_LZ)) {
+        printf("Error: Corrupt log block header\n");
+        return 0;
+    }
+
+    LogBuffer* target = codec == LOG_CODEC_LZ ? &reader->stored : &reader->raw;
+    target->size = 0;
+    if (!log_buffer_reserve(target, stored_size) ||
+        fread(target->data, 1, stored_size, reader->file) != stored_size) {
+        printf("Error: Truncated log block\n");
+        return 0;
+    }
+    target->size = stored_size;
+
+    if (codec == LOG_CODEC_LZ) {
+        reader->raw.size = 0;
+        if (!log_buffer_reserve(&reader->raw, raw_size) ||
+            lz_block_decompress(reader->stored.data, (int)stored_size, reader->raw.data, (int)raw_size) != (int)raw_size) {
+            printf("Error: Corrupt compressed log block\n");
+            return 0;
+        }
+        reader->raw.size = raw_size;
+    }
+    if (!log_block_decoder_open(&reader->decoder, reader->raw.data, reader->raw.size)) {
+        printf("Error: Corrupt log block\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Text lines have no user column; the user shows up in the message as
+// "User <name> (ID: <id>)..." or "... by user <id>" (see log.c), so it is
+// read back from there
+static void log_parse_text_user(LogEntry* entry) {
+    const char* message = entry->message;
+    int user_id = 0;
+    int used = 0;
+    const char* id = strstr(message, " (ID: ");
+    if (strncmp(message, "User ", 5) == 0 && id != NULL) {
+        if (sscanf(id + 6, "%d%n", &user_id, &used) == 1 && id[6 + used] == ')' && user_id > 0) {
+            entry->user_id = user_id;
+            snprintf(entry->username, sizeof(entry->username), "%.*s", (int)(id - (message + 5)), message + 5);
+        }
+        return;
+    }
+    const char* by = NULL;
+    for (const char* next = strstr(message, " by user "); next != NULL; next = strstr(next + 1, " by user ")) {
+        by = next;
+    }
+    if (by != NULL && sscanf(by + 9, "%d%n", &user_id, &used) == 1 && by[9 + used] == '\0' && user_id > 0) {
+        entry->user_id = user_id;
+    }
+}
+
+// "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] [MODULE] message"
+static int log_parse_text_line(char* line, LogEntry* entry) {
+    struct tm tm_info;
+    int millis = 0;
+    memset(&tm_info, 0, sizeof(tm_info));
+    if (sscanf(line, "[%d-%d-%d %d:%d:%d.%d]", &tm_info.tm_year, &tm_info.tm_mon, &tm_info.tm_mday,
+               &tm_info.tm_hour, &tm_info.tm_min, &tm_info.tm_sec, &millis) < 6) {
+        return 0;
+    }
+    tm_info.tm_year -= 1900;
+    tm_info.tm_mon -= 1;
+    tm_info.tm_isdst = -1;
+
+    char* level = strstr(line, "] [");
+    char* level_end = level != NULL ? strchr(level + 3, ']') : NULL;
+    if (level_end == NULL || level_end[1] != ' ' || level_end[2] != '[') {
+        return 0;
+    }
+    char* module = level_end + 3;
+    char* module_end = strstr(module, "] ");
+    if (module_end == NULL) {
+        return 0;
+    }
+
+    memset(entry, 0, sizeof(LogEntry));
+    entry->timestamp = mktime(&tm_info);
+    *level_end = '\0';
+    entry->level = string_to_log_level(level + 3);
+    *module_end = '\0';
+    strncpy(entry->module, module, sizeof(entry->module) - 1);
+    char* message = module_end + 2;
+    message[strcspn(message, "\r\n")] = '\0';
+    strncpy(entry->message, message, sizeof(entry->message) - 1);
+    log_parse_text_user(entry);
+    return 1;
+}
+
+int log_reader_next(LogReader* reader, LogEntry* entry) {
+    if (reader == NULL || entry == NULL) {
+        return 0;
+    }
+
+    if (reader->format == LOG_FORMAT_TEXT) {
+        while (fgets(reader->line, sizeof(reader->line), reader->file) != NULL) {
+            size_t length = strlen(reader->line);
+            // Drop the rest of an over-long line
+            if (length > 0 && reader->line[length - 1] != '\n' && !feof(reader->file)) {
+                int c;
+                while ((c = fgetc(reader->file)) != EOF && c != '\n') {}
+            }
+            if (log_parse_text_line(reader->line, entry)) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    while (!log_block_decoder_next(&reader->decoder, entry)) {
+        if (reader->decoder.remaining > 0) {
+            printf("Error: Corrupt log entry\n");
+            return 0;
+        }
+        if (!log_reader_next_block(reader)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void log_reader_close(LogReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->file != NULL) {
+        fclose(reader->file);
+    }
+    log_block_decoder_free(&reader->decoder);
+    log_buffer_free(&reader->raw);
+    log_buffer_free(&reader->stored);
+    free(reader);
+}
+
+int log_codec_compress_file(const char* input_file, const char* output_file) {
+    if (input_file == NULL || output_file == NULL) {
+        printf("Error: Invalid arguments to log_codec_compress_file\n");
+        return 0;
+    }
+
+    LogReader* reader = log_reader_open(input_file);
+    if (reader == NULL) {
+        return 0;
+    }
+    LogWriter* writer = log_writer_open(output_file, 1);
+    if (writer == NULL) {
+        log_reader_close(reader);
+        return 0;
+    }
+
+    LogEntry entry;
+    int ok = 1;
+    while (ok && log_reader_next(reader, &entry)) {
+        ok = log_writer_append(writer, &entry);
+    }
+    log_reader_close(reader);
+    if (!log_writer_close(writer)) {
+        ok = 0;
+    }
+    if (!ok) {
+        remove(output_file);
+    }
+    return ok;
+}
+
+// ---- Benchmark ----
+
+void log_codec_benchmark(long entries) {
+    if (entries <= 0) {
+        printf("Error: Invalid benchmark parameters\n");
+        return;
+    }
+
+    static const char* modules[] = { LOG_MODULE_SYSTEM, LOG_MODULE_AUTH, LOG_MODULE_STUDENT,
+                                     LOG_MODULE_GRADE, LOG_MODULE_ATTENDANCE };
+    static const char* names[] = { "admin", "teacher1", "teacher2", "secretary", "student42" };
+    char path[] = "/tmp/log_codec_benchmarkXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Error: Cannot create benchmark file\n");
+        return;
+    }
+    close(fd);
+
+    LogWriter* writer = log_writer_open(path, 1);
+    if (writer == NULL) {
+        remove(path);
+        return;
+    }
+
+    LogEntry entry;
+    long long text_bytes = 0;
+    unsigned int seed = 17;
+    time_t timestamp = 1700000000;
+    char line[LOG_MAX_MESSAGE_LENGTH + 128];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < entries; i++) {
+        seed = seed * 1103515245u + 12345u;
+        memset(&entry, 0, sizeof(entry));
+        timestamp += (seed >> 8) % 4;
+        entry.timestamp = timestamp;
+        entry.level = (LogLevel)((seed >> 4) % 100 < 80 ? LOG_LEVEL_INFO : (seed >> 4) % 5);
+        entry.user_id = (int)((seed >> 12) % 5);
+        strcpy(entry.module, modules[(seed >> 16) % 5]);
+        strcpy(entry.username, names[entry.user_id]);
+        snprintf(entry.ip_address, sizeof(entry.ip_address), "192.168.1.%u", (seed >> 20) % 50);
+        snprintf(entry.message, sizeof(entry.message), "Student %u updated by user %d (grade %u.%u)",
+                 (seed >> 6) % 2000, entry.user_id, (seed >> 9) % 20, (seed >> 13) % 10);
+        text_bytes += snprintf(line, sizeof(line), "[2025-01-01 00:00:00.000] [%s] [%s] %s\n",
+                               log_level_to_string(entry.level), entry.module, entry.message);
+        log_writer_append(writer, &entry);
+    }
+    log_writer_flush_block(writer);
+    long long raw_bytes = writer->raw_bytes;
+    log_writer_close(writer);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double write_ms = (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    struct stat st;
+    long long file_bytes = stat(path, &st) == 0 ? (long long)st.st_size : 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    LogReader* reader = log_reader_open(path);
+    long read_count = 0;
+    while (reader != NULL && log_reader_next(reader, &entry)) read_count++;
+    log_reader_close(reader);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double read_ms = (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6;
+    remove(path);
+
+    printf("\n=== LOG ENCODING BENCHMARK (%ld entries) ===\n", entries);
+    printf("LogEntry structs:     %8.1f bytes/entry\n", (double)sizeof(LogEntry));
+    printf("Text lines:           %8.1f bytes/entry\n", (double)text_bytes / entries);
+    printf("Compact encoding:     %8.1f bytes/entry\n", (double)raw_bytes / entries);
+    printf("Compact + LZ file:    %8.1f bytes/entry (%.1fx smaller than LogEntry)\n",
+           (double)file_bytes / entries, (double)sizeof(LogEntry) * entries / (double)(file_bytes > 0 ? file_bytes : 1));
+    printf("Write: %.1f ms, read back %ld entries: %.1f ms\n", write_ms, read_count, read_ms);
+}
@@ -0,0 +1,364 @@
+#include "log.h"
+#include "log_async.h"
+#include "log_codec.h"
+#include "heavy_hitters.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define LOG_STATS_MAX_FILES 256
+#define LOG_STATS_MAX_THREADS 16
+#define LOG_STATS_PATH_LENGTH (LOG_MAX_DIRECTORY_LENGTH + LOG_MAX_FILENAME_LENGTH + 16)
+
+// Per-file partial statistics. Users are counted in a Space-Saving sketch
+// so memory stays fixed however many users a file mentions.
+typedef struct {
+    long long total;
+    long long by_level[5];
+    long long by_hour[24];
+    long long by_day[7];
+    long long by_module[LOG_ASYNC_MAX_MODULES];
+    time_t first_entry;
+    time_t last_entry;
+    HeavyHitters* users;
+    time_t since;
+
+    // Local day of the previous entry, to avoid localtime per entry
+    time_t day_start;
+    time_t day_end;
+    int weekday;
+    char last_module[LOG_MAX_MODULE_LENGTH];
+    int last_module_id;
+} LogStatsAccumulator;
+
+static int log_stats_accumulator_init(LogStatsAccumulator* acc, time_t since) {
+    memset(acc, 0, sizeof(LogStatsAccumulator));
+    acc->users = heavy_hitters_create(HEAVY_HITTERS_DEFAULT_CAPACITY);
+    acc->since = since;
+    acc->last_module_id = -1;
+    return acc->users != NULL;
+}
+
+static void log_stats_accumulator_free(LogStatsAccumulator* acc) {
+    heavy_hitters_destroy(acc->users);
+    acc->users = NULL;
+}
+
+static void log_stats_accumulator_add(LogStatsAccumulator* acc, const LogEntry* entry) {
+    time_t timestamp = entry->timestamp;
+    if (timestamp < acc->since || !log_validate_level(entry->level)) {
+        return;
+    }
+
+    int hour;
+    if (timestamp >= acc->day_start && timestamp < acc->day_end) {
+        hour = (int)((timestamp - acc->day_start) / 3600);
+    } else {
+        struct tm tm_info;
+        localtime_r(&timestamp, &tm_info);
+        hour = tm_info.tm_hour;
+        acc->weekday = tm_info.tm_wday;
+        tm_info.tm_hour = 0;
+        tm_info.tm_min = 0;
+        tm_info.tm_sec = 0;
+        tm_info.tm_isdst = -1;
+        time_t start = mktime(&tm_info);
+        tm_info.tm_mday++;
+        tm_info.tm_isdst = -1;
+        time_t end = mktime(&tm_info);
+        // Days with a DST change keep going through localtime
+        if (end - start == 86400) {
+            acc->day_start = start;
+            acc->day_end = end;
+        } else {
+            acc->day_start = acc->day_end = 0;
+        }
+    }
+
+    if (acc->total == 0 || timestamp < acc->first_entry) acc->first_entry = timestamp;
+    if (acc->total == 0 || timestamp > acc->last_entry) acc->last_entry = timestamp;
+    acc->total++;
+    acc->by_level[entry->level]++;
+    acc->by_hour[hour]++;
+    acc->by_day[acc->weekday]++;
+
+    if (acc->last_module_id < 0 || strncmp(acc->last_module, entry->module, sizeof(acc->last_module)) != 0) {
+        strncpy(acc->last_module, entry->module, sizeof(acc->last_module) - 1);
+        acc->last_module[sizeof(acc->last_module) - 1] = '\0';
+        acc->last_module_id = log_async_module_id(acc->last_module);
+    }
+    acc->by_module[acc->last_module_id]++;
+
+    // Entries without a user (system events) are not ranked
+    if (entry->user_id > 0) {
+        heavy_hitters_add(acc->users, entry->user_id, 1);
+    }
+}
+
+static void log_stats_accumulator_merge(LogStatsAccumulator* dst, const LogStatsAccumulator* src) {
+    if (src->total == 0) {
+        return;
+    }
+    if (dst->total == 0 || src->first_entry < dst->first_entry) dst->first_entry = src->first_entry;
+    if (dst->total == 0 || src->last_entry > dst->last_entry) dst->last_entry = src->last_entry;
+    dst->total += src->total;
+    for (int i = 0; i < 5; i++) dst->by_level[i] += src->by_level[i];
+    for (int i = 0; i < 24; i++) dst->by_hour[i] += src->by_hour[i];
+    for (int i = 0; i < 7; i++) dst->by_day[i] += src->by_day[i];
+    for (int i = 0; i < LOG_ASYNC_MAX_MODULES; i++) dst->by_module[i] += src->by_module[i];
+    heavy_hitters_merge(dst->users, src->users);
+}
+
+static int log_stats_clamp(long long value) {
+    return value > 0x7FFFFFFF ? 0x7FFFFFFF : (int)value;
+}
+
+static LogStatistics* log_stats_accumulator_finish(const LogStatsAccumulator* acc) {
+    LogStatistics* stats = (LogStatistics*)calloc(1, sizeof(LogStatistics));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate log statistics\n");
+        return NULL;
+    }
+
+    stats->total_entries = log_stats_clamp(acc->total);
+    for (int i = 0; i < 5; i++) stats->entries_by_level[i] = log_stats_clamp(acc->by_level[i]);
+    for (int i = 0; i < 24; i++) stats->entries_by_hour[i] = log_stats_clamp(acc->by_hour[i]);
+    for (int i = 0; i < 7; i++) stats->entries_by_day[i] = log_stats_clamp(acc->by_day[i]);
+    stats->first_entry = acc->first_entry;
+    stats->last_entry = acc->last_entry;
+
+    int best = 0;
+    for (int i = 1; i < LOG_ASYNC_MAX_MODULES; i++) {
+        if (acc->by_module[i] > acc->by_module[best]) best = i;
+    }
+    stats->most_logged_module = best;
+
+    HeavyHitter top[LOG_STATS_TOP_USERS];
+    stats->top_user_count = heavy_hitters_top(acc->users, top, LOG_STATS_TOP_USERS);
+    for (int i = 0; i < stats->top_user_count; i++) {
+        stats->top_users[i] = (int)top[i].key;
+        stats->top_user_entries[i] = log_stats_clamp(top[i].count);
+    }
+    stats->most_active_user = stats->top_user_count > 0 ? stats->top_users[0] : 0;
+    return stats;
+}
+
+LogStatistics* calculate_log_statistics(LogList* list) {
+    if (list == NULL || list->entries == NULL) {
+        printf("Error: Log list is NULL\n");
+        return NULL;
+    }
+
+    LogStatsAccumulator acc;
+    if (!log_stats_accumulator_init(&acc, 0)) {
+        return NULL;
+    }
+    for (int i = 0; i < list->count; i++) {
+        log_stats_accumulator_add(&acc, &list->entries[i]);
+    }
+    LogStatistics* stats = log_stats_accumulator_finish(&acc);
+    log_stats_accumulator_free(&acc);
+    return stats;
+}
+
+// ---- Streaming over rotated files ----
+
+typedef struct {
+    char (*paths)[LOG_STATS_PATH_LENGTH];
+    LogStatsAccumulator* partials;
+    int file_count;
+    int next_file;
+    pthread_mutex_t lock;
+} LogStatsJob;
+
+static void* log_stats_worker(void* arg) {
+    LogStatsJob* job = (LogStatsJob*)arg;
+    LogEntry entry;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next_file++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->file_count) {
+            break;
+        }
+
+        LogReader* reader = log_reader_open(job->paths[index]);
+        if (reader == NULL) {
+            continue;
+        }
+        while (log_reader_next(reader, &entry)) {
+            log_stats_accumulator_add(&job->partials[index], &entry);
+        }
+        log_reader_close(reader);
+    }
+    return NULL;
+}
+
+// log_file and every log_file.N next to it; files last written before
+// `since` cannot hold newer entries and are left out
+static int log_stats_collect_files(const char* log_file, time_t since, char (*paths)[LOG_STATS_PATH_LENGTH]) {
+    char directory[LOG_STATS_PATH_LENGTH];
+    const char* slash = strrchr(log_file, '/');
+    const char* base = slash != NULL ? slash + 1 : log_file;
+    if (slash != NULL) {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - log_file), log_file);
+        if (directory[0] == '\0') strcpy(directory, "/");
+    } else {
+        strcpy(directory, ".");
+    }
+
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        printf("Error: Cannot open log directory %s\n", directory);
+        return -1;
+    }
+
+    size_t base_length = strlen(base);
+    int count = 0;
+    struct dirent* item;
+    struct stat st;
+    while ((item = readdir(dir)) != NULL && count < LOG_STATS_MAX_FILES) {
+        const char* name = item->d_name;
+        if (strncmp(name, base, base_length) != 0) {
+            continue;
+        }
+        const char* suffix = name + base_length;
+        if (suffix[0] != '\0' &&
+            (suffix[0] != '.' || suffix[1] == '\0' || strspn(suffix + 1, "0123456789") != strlen(suffix + 1))) {
+            continue;
+        }
+        snprintf(paths[count], LOG_STATS_PATH_LENGTH, "%s/%s", directory, name);
+        if (stat(paths[count], &st) != 0 || (since > 0 && st.st_mtime < since)) {
+            continue;
+        }
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+LogStatistics* calculate_log_statistics_from_files(const char* log_file, int days, int threads) {
+    if (log_file == NULL) {
+        printf("Error: Log file name is NULL\n");
+        return NULL;
+    }
+
+    time_t since = days > 0 ? time(NULL) - (time_t)days * 86400 : 0;
+    LogStatsJob job;
+    memset(&job, 0, sizeof(job));
+    job.paths = malloc(sizeof(*job.paths) * LOG_STATS_MAX_FILES);
+    if (job.paths == NULL) {
+        printf("Error: Failed to allocate log file list\n");
+        return NULL;
+    }
+    job.file_count = log_stats_collect_files(log_file, since, job.paths);
+    if (job.file_count < 0) {
+        free(job.paths);
+        return NULL;
+    }
+
+    job.partials = (LogStatsAccumulator*)calloc(job.file_count + 1, sizeof(LogStatsAccumulator));
+    int ready = job.partials != NULL;
+    for (int i = 0; ready && i <= job.file_count; i++) {
+        ready = log_stats_accumulator_init(&job.partials[i], since);
+    }
+    if (!ready) {
+        printf("Error: Failed to allocate log statistics\n");
+        for (int i = 0; job.partials != NULL && i <= job.file_count; i++) log_stats_accumulator_free(&job.partials[i]);
+        free(job.partials);
+        free(job.paths);
+        return NULL;
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > LOG_STATS_MAX_THREADS) threads = LOG_STATS_MAX_THREADS;
+    if (threads > job.file_count) threads = job.file_count;
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_t workers[LOG_STATS_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, log_stats_worker, &job) == 0) {
+            started++;
+        }
+    }
+    log_stats_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+
+    // Merge in file order so the result does not depend on scheduling
+    LogStatsAccumulator* total = &job.partials[job.file_count];
+    for (int i = 0; i < job.file_count; i++) {
+        log_stats_accumulator_merge(total, &job.partials[i]);
+    }
+    LogStatistics* stats = log_stats_accumulator_finish(total);
+    if (stats != NULL) {
+        stats->files_scanned = job.file_count;
+    }
+
+    for (int i = 0; i <= job.file_count; i++) {
+        log_stats_accumulator_free(&job.partials[i]);
+    }
+    free(job.partials);
+    free(job.paths);
+    return stats;
+}
+
+void display_log_statistics(LogStatistics* stats) {
+    if (stats == NULL) {
+        printf("No log statistics to display\n");
+        return;
+    }
+
+    static const char* days[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    char first[32] = "-", last[32] = "-";
+    if (stats->total_entries > 0) {
+        log_format_timestamp(stats->first_entry, first, sizeof(first));
+        log_format_timestamp(stats->last_entry, last, sizeof(last));
+    }
+
+    printf("\n=== LOG STATISTICS ===\n");
+    printf("Total entries: %d", stats->total_entries);
+    if (stats->files_scanned > 0) {
+        printf(" (%d files)", stats->files_scanned);
+    }
+    printf("\nPeriod: %s to %s\n", first, last);
+
+    printf("\nBy level:\n");
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_CRITICAL; i++) {
+        printf("  %-10s %d\n", log_level_to_string((LogLevel)i), stats->entries_by_level[i]);
+    }
+    printf("\nBy hour:\n");
+    for (int i = 0; i < 24; i++) {
+        printf("  %02d:00 %-8d%s", i, stats->entries_by_hour[i], i % 4 == 3 ? "\n" : "");
+    }
+    printf("\nBy day:\n");
+    for (int i = 0; i < 7; i++) {
+        printf("  %s %d\n", days[i], stats->entries_by_day[i]);
+    }
+
+    printf("\nMost logged module: %s\n", stats->total_entries > 0 ? log_async_module_name(stats->most_logged_module) : "-");
+    if (stats->top_user_count == 0) {
+        printf("Most active user: -\n");
+        return;
+    }
+    printf("Most active users:\n");
+    for (int i = 0; i < stats->top_user_count; i++) {
+        printf("  %d. user %-8d %d entries\n", i + 1, stats->top_users[i], stats->top_user_entries[i]);
+    }
+}
+
+void free_log_statistics(LogStatistics* stats) {
+    free(stats);
+}
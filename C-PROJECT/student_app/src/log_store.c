@@ -0,0 +1,978 @@
+#include "log_store.h"
+#include "log.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOG_BITMAP_WORDS (LOG_STORE_SEGMENT_ROWS / 64)
+
+// ---- Row sets ----
+
+static void log_rowset_free(LogRowSet* set) {
+    free(set->rows);
+    free(set->bits);
+    memset(set, 0, sizeof(LogRowSet));
+}
+
+static int log_rowset_add(LogRowSet* set, int row) {
+    if (set->bits != NULL) {
+        set->bits[row >> 6] |= 1ULL << (row & 63);
+        set->count++;
+        return 1;
+    }
+    // Rows arrive in increasing order; skip a repeat of the last one
+    if (set->count > 0 && set->rows[set->count - 1] == (unsigned short)row) {
+        return 1;
+    }
+
+    if (set->count == LOG_STORE_ARRAY_LIMIT) {
+        unsigned long long* bits = (unsigned long long*)calloc(LOG_BITMAP_WORDS, sizeof(unsigned long long));
+        if (bits == NULL) {
+            return 0;
+        }
+        for (int i = 0; i < set->count; i++) {
+            bits[set->rows[i] >> 6] |= 1ULL << (set->rows[i] & 63);
+        }
+        free(set->rows);
+        set->rows = NULL;
+        set->capacity = 0;
+        set->bits = bits;
+        set->bits[row >> 6] |= 1ULL << (row & 63);
+        set->count++;
+        return 1;
+    }
+
+    if (set->count == set->capacity) {
+        int capacity = set->capacity > 0 ? set->capacity * 2 : 4;
+        unsigned short* rows = (unsigned short*)realloc(set->rows, sizeof(unsigned short) * capacity);
+        if (rows == NULL) {
+            return 0;
+        }
+        set->rows = rows;
+        set->capacity = capacity;
+    }
+    set->rows[set->count++] = (unsigned short)row;
+    return 1;
+}
+
+// words &= set
+static void log_rowset_and_into(unsigned long long* words, const LogRowSet* set) {
+    if (set->bits != NULL) {
+        for (int i = 0; i < LOG_BITMAP_WORDS; i++) {
+            words[i] &= set->bits[i];
+        }
+        return;
+    }
+
+    unsigned long long kept[LOG_BITMAP_WORDS];
+    memset(kept, 0, sizeof(kept));
+    for (int i = 0; i < set->count; i++) {
+        int row = set->rows[i];
+        kept[row >> 6] |= words[row >> 6] & (1ULL << (row & 63));
+    }
+    memcpy(words, kept, sizeof(kept));
+}
+
+// ---- Key maps ----
+
+static unsigned long long log_mix64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void log_keymap_free(LogKeyMap* map) {
+    free(map->keys);
+    free(map->values);
+    memset(map, 0, sizeof(LogKeyMap));
+}
+
+static int log_keymap_find(const LogKeyMap* map, unsigned long long key) {
+    if (map->capacity == 0) {
+        return -1;
+    }
+    int mask = map->capacity - 1;
+    for (int i = (int)(log_mix64(key) & (unsigned long long)mask);; i = (i + 1) & mask) {
+        if (map->values[i] < 0) return -1;
+        if (map->keys[i] == key) return map->values[i];
+    }
+}
+
+static int log_keymap_insert(LogKeyMap* map, unsigned long long key, int value) {
+    if ((map->size + 1) * 2 > map->capacity) {
+        int capacity = map->capacity > 0 ? map->capacity * 2 : 64;
+        unsigned long long* keys = (unsigned long long*)malloc(sizeof(unsigned long long) * capacity);
+        int* values = (int*)malloc(sizeof(int) * capacity);
+        if (keys == NULL || values == NULL) {
+            free(keys);
+            free(values);
+            return 0;
+        }
+        for (int i = 0; i < capacity; i++) values[i] = -1;
+        for (int i = 0; i < map->capacity; i++) {
+            if (map->values[i] < 0) continue;
+            int j = (int)(log_mix64(map->keys[i]) & (unsigned long long)(capacity - 1));
+            while (values[j] >= 0) j = (j + 1) & (capacity - 1);
+            keys[j] = map->keys[i];
+            values[j] = map->values[i];
+        }
+        free(map->keys);
+        free(map->values);
+        map->keys = keys;
+        map->values = values;
+        map->capacity = capacity;
+    }
+
+    int mask = map->capacity - 1;
+    int i = (int)(log_mix64(key) & (unsigned long long)mask);
+    while (map->values[i] >= 0) i = (i + 1) & mask;
+    map->keys[i] = key;
+    map->values[i] = value;
+    map->size++;
+    return 1;
+}
+
+// ---- Tokens ----
+
+// Next word of [A-Za-z0-9_] from *text; returns its length (0 at the end)
+// and its case-folded FNV-1a hash
+static int log_next_token(const char** text, unsigned long long* hash, const char** start) {
+    const char* p = *text;
+    while (*p != '\0' && !(isalnum((unsigned char)*p) || *p == '_')) p++;
+    *start = p;
+    unsigned long long h = 1469598103934665603ULL;
+    while (*p != '\0' && (isalnum((unsigned char)*p) || *p == '_')) {
+        h ^= (unsigned char)tolower((unsigned char)*p);
+        h *= 1099511628211ULL;
+        p++;
+    }
+    *text = p;
+    *hash = h;
+    return (int)(p - *start);
+}
+
+static int log_message_has_word(const char* message, const char* word) {
+    size_t length = strlen(word);
+    const char* p = message;
+    const char* start;
+    unsigned long long hash;
+    int n;
+    while ((n = log_next_token(&p, &hash, &start)) > 0) {
+        if ((size_t)n == length && strncasecmp(start, word, length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ---- Segments ----
+
+static LogStoreSegment* log_segment_create(void) {
+    LogStoreSegment* segment = (LogStoreSegment*)calloc(1, sizeof(LogStoreSegment));
+    if (segment == NULL) {
+        return NULL;
+    }
+    segment->records = (LogStoreRecord*)malloc(sizeof(LogStoreRecord) * LOG_STORE_SEGMENT_ROWS);
+    if (segment->records == NULL) {
+        free(segment);
+        return NULL;
+    }
+    segment->in_order = 1;
+    return segment;
+}
+
+static void log_segment_destroy(LogStoreSegment* segment) {
+    if (segment == NULL) {
+        return;
+    }
+    for (int i = 0; i < 5; i++) log_rowset_free(&segment->levels[i]);
+    for (int i = 0; i < LOG_STORE_MAX_MODULES; i++) log_rowset_free(&segment->modules[i]);
+    // User and token row arrays live in the shared postings pool
+    for (int i = 0; i < segment->set_count; i++) free(segment->sets[i].bits);
+    free(segment->sets);
+    free(segment->postings);
+    log_keymap_free(&segment->users);
+    log_keymap_free(&segment->tokens);
+    free(segment->fences);
+    free(segment->arena);
+    free(segment->records);
+    free(segment);
+}
+
+static int log_segment_append_text(LogStoreSegment* segment, const char* text) {
+    size_t length = strlen(text) + 1;
+    if (segment->arena_size + length > segment->arena_capacity) {
+        size_t capacity = segment->arena_capacity > 0 ? segment->arena_capacity : 1 << 20;
+        while (capacity < segment->arena_size + length) capacity *= 2;
+        char* arena = (char*)realloc(segment->arena, capacity);
+        if (arena == NULL) {
+            return 0;
+        }
+        segment->arena = arena;
+        segment->arena_capacity = capacity;
+    }
+    memcpy(segment->arena + segment->arena_size, text, length);
+    segment->arena_size += length;
+    return 1;
+}
+
+static const char* log_record_username(const LogStoreSegment* segment, const LogStoreRecord* record) {
+    return segment->arena + record->text_offset;
+}
+
+static const char* log_record_ip(const LogStoreSegment* segment, const LogStoreRecord* record) {
+    const char* username = log_record_username(segment, record);
+    return username + strlen(username) + 1;
+}
+
+static const char* log_record_message(const LogStoreSegment* segment, const LogStoreRecord* record) {
+    const char* ip = log_record_ip(segment, record);
+    return ip + strlen(ip) + 1;
+}
+
+// Id of the user or token set for `key`, adding an empty one when new.
+// While the indexes are built, capacity holds the last row counted + 1.
+static int log_segment_set_id(LogStoreSegment* segment, LogKeyMap* map, unsigned long long key) {
+    int index = log_keymap_find(map, key);
+    if (index >= 0) {
+        return index;
+    }
+    if (segment->set_count == segment->set_capacity) {
+        int capacity = segment->set_capacity > 0 ? segment->set_capacity * 2 : 256;
+        LogRowSet* sets = (LogRowSet*)realloc(segment->sets, sizeof(LogRowSet) * capacity);
+        if (sets == NULL) {
+            return -1;
+        }
+        segment->sets = sets;
+        segment->set_capacity = capacity;
+    }
+    index = segment->set_count;
+    memset(&segment->sets[index], 0, sizeof(LogRowSet));
+    if (!log_keymap_insert(map, key, index)) {
+        return -1;
+    }
+    segment->set_count++;
+    return index;
+}
+
+// Count one row into a set; returns 0 if the row was already counted
+static int log_segment_count_row(LogStoreSegment* segment, int index, int row) {
+    LogRowSet* set = &segment->sets[index];
+    if (set->capacity == row + 1) {
+        return 0;
+    }
+    set->capacity = row + 1;
+    set->count++;
+    return 1;
+}
+
+// Build the user and token posting lists in two passes: count the rows of
+// every set, then lay the sparse ones out in one shared pool so that
+// high-cardinality keys (ids, numbers) cost no allocation each.
+static int log_segment_build_postings(LogStoreSegment* segment) {
+    int ref_capacity = segment->count * 8 + 16;
+    int ref_count = 0;
+    int* refs = (int*)malloc(sizeof(int) * ref_capacity);
+    int* row_refs = (int*)malloc(sizeof(int) * (segment->count + 1));
+    if (refs == NULL || row_refs == NULL) {
+        free(refs);
+        free(row_refs);
+        return 0;
+    }
+
+    int ok = 1;
+    for (int row = 0; row < segment->count && ok; row++) {
+        LogStoreRecord* record = &segment->records[row];
+        row_refs[row] = ref_count;
+
+        int index = log_segment_set_id(segment, &segment->users, (unsigned long long)(unsigned int)record->user_id);
+        const char* p = log_record_message(segment, record);
+        const char* start;
+        unsigned long long hash;
+        while (index >= 0) {
+            if (log_segment_count_row(segment, index, row)) {
+                if (ref_count == ref_capacity) {
+                    int* grown = (int*)realloc(refs, sizeof(int) * ref_capacity * 2);
+                    if (grown == NULL) {
+                        index = -1;
+                        break;
+                    }
+                    refs = grown;
+                    ref_capacity *= 2;
+                }
+                refs[ref_count++] = index;
+            }
+            if (log_next_token(&p, &hash, &start) == 0) {
+                break;
+            }
+            index = log_segment_set_id(segment, &segment->tokens, hash);
+        }
+        ok = index >= 0;
+    }
+    row_refs[segment->count] = ref_count;
+
+    size_t pooled = 0;
+    for (int i = 0; ok && i < segment->set_count; i++) {
+        if (segment->sets[i].count <= LOG_STORE_ARRAY_LIMIT) pooled += (size_t)segment->sets[i].count;
+    }
+    segment->postings = ok ? (unsigned short*)malloc(sizeof(unsigned short) * (pooled > 0 ? pooled : 1)) : NULL;
+    ok = ok && segment->postings != NULL;
+
+    size_t offset = 0;
+    for (int i = 0; i < segment->set_count; i++) {
+        LogRowSet* set = &segment->sets[i];
+        set->capacity = 0;
+        if (!ok) {
+            set->count = 0;
+            continue;
+        }
+        if (set->count > LOG_STORE_ARRAY_LIMIT) {
+            set->bits = (unsigned long long*)calloc(LOG_BITMAP_WORDS, sizeof(unsigned long long));
+            ok = set->bits != NULL;
+        } else {
+            set->rows = segment->postings + offset;
+            offset += (size_t)set->count;
+        }
+        set->count = 0;
+    }
+
+    for (int row = 0; ok && row < segment->count; row++) {
+        for (int r = row_refs[row]; r < row_refs[row + 1]; r++) {
+            LogRowSet* set = &segment->sets[refs[r]];
+            if (set->bits != NULL) {
+                set->bits[row >> 6] |= 1ULL << (row & 63);
+                set->count++;
+            } else {
+                set->rows[set->count++] = (unsigned short)row;
+            }
+        }
+    }
+
+    free(refs);
+    free(row_refs);
+    return ok;
+}
+
+static int log_record_compare(const void* a, const void* b) {
+    const LogStoreRecord* x = (const LogStoreRecord*)a;
+    const LogStoreRecord* y = (const LogStoreRecord*)b;
+    if (x->timestamp != y->timestamp) return x->timestamp < y->timestamp ? -1 : 1;
+    // Arena offsets grow with arrival order, which keeps the sort stable
+    return x->text_offset < y->text_offset ? -1 : (x->text_offset > y->text_offset);
+}
+
+// Sort the segment by time and build its indexes; it is read-only afterwards
+static int log_segment_seal(LogStoreSegment* segment) {
+    if (segment->sealed) {
+        return 1;
+    }
+    if (!segment->in_order) {
+        qsort(segment->records, segment->count, sizeof(LogStoreRecord), log_record_compare);
+        segment->in_order = 1;
+    }
+
+    segment->fence_count = (segment->count + LOG_STORE_FENCE_INTERVAL - 1) / LOG_STORE_FENCE_INTERVAL;
+    segment->fences = (long long*)malloc(sizeof(long long) * (segment->fence_count > 0 ? segment->fence_count : 1));
+    if (segment->fences == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < segment->fence_count; i++) {
+        segment->fences[i] = segment->records[i * LOG_STORE_FENCE_INTERVAL].timestamp;
+    }
+
+    for (int row = 0; row < segment->count; row++) {
+        LogStoreRecord* record = &segment->records[row];
+        if (!log_rowset_add(&segment->levels[record->level], row) ||
+            !log_rowset_add(&segment->modules[record->module], row)) {
+            return 0;
+        }
+    }
+    if (!log_segment_build_postings(segment)) {
+        return 0;
+    }
+
+    // Release the unused tail of the arena
+    char* arena = (char*)realloc(segment->arena, segment->arena_size > 0 ? segment->arena_size : 1);
+    if (arena != NULL) {
+        segment->arena = arena;
+        segment->arena_capacity = segment->arena_size;
+    }
+    segment->sealed = 1;
+    return 1;
+}
+
+// First row with timestamp >= value, using the fences to narrow the search
+static int log_segment_lower_bound(const LogStoreSegment* segment, long long value) {
+    int lo = 0, hi = segment->fence_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (segment->fences[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    int row = lo > 0 ? (lo - 1) * LOG_STORE_FENCE_INTERVAL : 0;
+    while (row < segment->count && segment->records[row].timestamp < value) row++;
+    return row;
+}
+
+// ---- Store ----
+
+LogStore* log_store_create(void) {
+    LogStore* store = (LogStore*)calloc(1, sizeof(LogStore));
+    if (store == NULL) {
+        printf("Error: Failed to create log store\n");
+        return NULL;
+    }
+    pthread_rwlock_init(&store->lock, NULL);
+    return store;
+}
+
+void log_store_destroy(LogStore* store) {
+    if (store == NULL) {
+        return;
+    }
+    for (int i = 0; i < store->segment_count; i++) {
+        log_segment_destroy(store->segments[i]);
+    }
+    free(store->segments);
+    pthread_rwlock_destroy(&store->lock);
+    free(store);
+}
+
+static int log_store_module_id(LogStore* store, const char* module, int create) {
+    for (int i = 0; i < store->module_count; i++) {
+        if (strcmp(store->module_names[i], module) == 0) {
+            return i;
+        }
+    }
+    if (store->module_count >= LOG_STORE_OVERFLOW_MODULE) {
+        // Table full: the name is not kept, so a query for it can only
+        // narrow down to the shared overflow id
+        if (!create) {
+            return store->module_overflow > 0 ? LOG_STORE_OVERFLOW_MODULE : -1;
+        }
+        if (store->module_overflow++ == 0) {
+            strcpy(store->module_names[LOG_STORE_OVERFLOW_MODULE], LOG_STORE_OVERFLOW_NAME);
+            store->module_count = LOG_STORE_MAX_MODULES;
+            printf("Error: Log store module table is full, %s and later modules are stored as %s\n",
+                   module, LOG_STORE_OVERFLOW_NAME);
+        }
+        return LOG_STORE_OVERFLOW_MODULE;
+    }
+    if (!create) {
+        return -1;
+    }
+    strncpy(store->module_names[store->module_count], module, LOG_MAX_MODULE_LENGTH - 1);
+    return store->module_count++;
+}
+
+static LogStoreSegment* log_store_active_segment(LogStore* store) {
+    if (store->segment_count > 0) {
+        LogStoreSegment* last = store->segments[store->segment_count - 1];
+        if (!last->sealed && last->count < LOG_STORE_SEGMENT_ROWS) {
+            return last;
+        }
+        if (!last->sealed && !log_segment_seal(last)) {
+            printf("Error: Failed to seal log segment\n");
+            return NULL;
+        }
+    }
+
+    if (store->segment_count == store->segment_capacity) {
+        int capacity = store->segment_capacity > 0 ? store->segment_capacity * 2 : 16;
+        LogStoreSegment** segments = (LogStoreSegment**)realloc(store->segments, sizeof(LogStoreSegment*) * capacity);
+        if (segments == NULL) {
+            return NULL;
+        }
+        store->segments = segments;
+        store->segment_capacity = capacity;
+    }
+    LogStoreSegment* segment = log_segment_create();
+    if (segment == NULL) {
+        printf("Error: Failed to allocate log segment\n");
+        return NULL;
+    }
+    store->segments[store->segment_count++] = segment;
+    return segment;
+}
+
+int log_store_append_fields(LogStore* store, time_t timestamp, LogLevel level, const char* module,
+                            int user_id, const char* username, const char* ip_address, const char* message) {
+    if (store == NULL || !log_validate_level(level)) {
+        printf("Error: Invalid arguments to log_store_append\n");
+        return 0;
+    }
+
+    pthread_rwlock_wrlock(&store->lock);
+    LogStoreSegment* segment = log_store_active_segment(store);
+    if (segment == NULL) {
+        pthread_rwlock_unlock(&store->lock);
+        return 0;
+    }
+
+    LogStoreRecord* record = &segment->records[segment->count];
+    record->timestamp = (long long)timestamp;
+    record->level = (unsigned char)level;
+    record->module = (unsigned char)log_store_module_id(store, module != NULL ? module : LOG_MODULE_SYSTEM, 1);
+    record->user_id = user_id;
+    record->text_offset = (unsigned int)segment->arena_size;
+    const char* text = message != NULL ? message : "";
+    size_t length = strlen(text);
+    record->message_length = (unsigned short)(length < 65535 ? length : 65535);
+
+    if (!log_segment_append_text(segment, username != NULL ? username : "") ||
+        !log_segment_append_text(segment, ip_address != NULL ? ip_address : "") ||
+        !log_segment_append_text(segment, text)) {
+        pthread_rwlock_unlock(&store->lock);
+        printf("Error: Failed to store log entry\n");
+        return 0;
+    }
+
+    if (segment->count == 0 || record->timestamp < segment->min_timestamp) segment->min_timestamp = record->timestamp;
+    if (segment->count > 0 && record->timestamp < segment->max_timestamp) segment->in_order = 0;
+    if (segment->count == 0 || record->timestamp > segment->max_timestamp) segment->max_timestamp = record->timestamp;
+    segment->count++;
+    store->total_entries++;
+    pthread_rwlock_unlock(&store->lock);
+    return 1;
+}
+
+int log_store_append(LogStore* store, const LogEntry* entry) {
+    if (entry == NULL) {
+        printf("Error: Log entry is NULL\n");
+        return 0;
+    }
+    return log_store_append_fields(store, entry->timestamp, entry->level, entry->module, entry->user_id,
+                                   entry->username, entry->ip_address, entry->message);
+}
+
+int log_store_append_list(LogStore* store, const LogList* list) {
+    if (list == NULL || list->entries == NULL) {
+        printf("Error: Log list is NULL\n");
+        return 0;
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (!log_store_append(store, &list->entries[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int log_store_seal(LogStore* store) {
+    if (store == NULL) {
+        return 0;
+    }
+    pthread_rwlock_wrlock(&store->lock);
+    int result = 1;
+    if (store->segment_count > 0) {
+        result = log_segment_seal(store->segments[store->segment_count - 1]);
+    }
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+long long log_store_count(LogStore* store) {
+    if (store == NULL) {
+        return 0;
+    }
+    pthread_rwlock_rdlock(&store->lock);
+    long long count = store->total_entries;
+    pthread_rwlock_unlock(&store->lock);
+    return count;
+}
+
+long long log_store_module_overflow(LogStore* store) {
+    if (store == NULL) {
+        return 0;
+    }
+    pthread_rwlock_rdlock(&store->lock);
+    long long count = store->module_overflow;
+    pthread_rwlock_unlock(&store->lock);
+    return count;
+}
+
+// ---- Queries ----
+
+void log_query_init(LogQuery* query) {
+    memset(query, 0, sizeof(LogQuery));
+    query->level = -1;
+    query->user_id = -1;
+}
+
+LogCursor* log_store_query(LogStore* store, const LogQuery* query) {
+    if (store == NULL || query == NULL) {
+        printf("Error: Invalid arguments to log_store_query\n");
+        return NULL;
+    }
+
+    LogCursor* cursor = (LogCursor*)calloc(1, sizeof(LogCursor));
+    if (cursor == NULL) {
+        printf("Error: Failed to create log cursor\n");
+        return NULL;
+    }
+    cursor->store = store;
+    cursor->query = *query;
+    cursor->row_end = -1;
+
+    pthread_rwlock_rdlock(&store->lock);
+    cursor->module_id = -1;
+    if (query->module[0] != '\0') {
+        int id = log_store_module_id(store, query->module, 0);
+        cursor->module_id = id >= 0 ? id : -2;
+    }
+    pthread_rwlock_unlock(&store->lock);
+
+    const char* p = query->keyword;
+    const char* start;
+    unsigned long long hash;
+    int length;
+    while (cursor->token_count < LOG_STORE_MAX_KEYWORD_TOKENS &&
+           (length = log_next_token(&p, &hash, &start)) > 0) {
+        int n = length < 63 ? length : 63;
+        cursor->tokens[cursor->token_count] = hash;
+        memcpy(cursor->token_text[cursor->token_count], start, n);
+        cursor->token_text[cursor->token_count][n] = '\0';
+        cursor->token_count++;
+    }
+    return cursor;
+}
+
+LogCursor* log_store_filter_by_level(LogStore* store, LogLevel level) {
+    LogQuery query;
+    log_query_init(&query);
+    query.level = level;
+    return log_store_query(store, &query);
+}
+
+LogCursor* log_store_filter_by_module(LogStore* store, const char* module) {
+    LogQuery query;
+    log_query_init(&query);
+    if (module != NULL) strncpy(query.module, module, sizeof(query.module) - 1);
+    return log_store_query(store, &query);
+}
+
+LogCursor* log_store_filter_by_user(LogStore* store, int user_id) {
+    LogQuery query;
+    log_query_init(&query);
+    query.user_id = user_id;
+    return log_store_query(store, &query);
+}
+
+LogCursor* log_store_filter_by_date_range(LogStore* store, time_t start_date, time_t end_date) {
+    LogQuery query;
+    log_query_init(&query);
+    query.start_date = start_date;
+    query.end_date = end_date;
+    return log_store_query(store, &query);
+}
+
+LogCursor* log_store_filter_by_keyword(LogStore* store, const char* keyword) {
+    LogQuery query;
+    log_query_init(&query);
+    if (keyword != NULL) strncpy(query.keyword, keyword, sizeof(query.keyword) - 1);
+    return log_store_query(store, &query);
+}
+
+static int log_cursor_matches_words(const LogCursor* cursor, const char* message) {
+    for (int i = 0; i < cursor->token_count; i++) {
+        if (!log_message_has_word(message, cursor->token_text[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int log_cursor_matches_row(const LogCursor* cursor, const LogStoreSegment* segment, int row) {
+    const LogStoreRecord* record = &segment->records[row];
+    const LogQuery* q = &cursor->query;
+    if (q->level >= 0 && record->level != q->level) return 0;
+    if (cursor->module_id != -1 && record->module != cursor->module_id) return 0;
+    if (q->user_id >= 0 && record->user_id != q->user_id) return 0;
+    if (q->start_date != 0 && record->timestamp < (long long)q->start_date) return 0;
+    if (q->end_date != 0 && record->timestamp > (long long)q->end_date) return 0;
+    return log_cursor_matches_words(cursor, log_record_message(segment, record));
+}
+
+// Work out the candidate rows of the current segment. Sealed segments are
+// resolved with the indexes into a bitmap; the active one is scanned.
+static void log_cursor_prepare(LogCursor* cursor, const LogStoreSegment* segment) {
+    const LogQuery* q = &cursor->query;
+    cursor->row = 0;
+    cursor->row_end = 0;
+    cursor->use_bits = 0;
+
+    if (cursor->module_id == -2 ||
+        (q->start_date != 0 && segment->max_timestamp < (long long)q->start_date) ||
+        (q->end_date != 0 && segment->min_timestamp > (long long)q->end_date)) {
+        return;
+    }
+    if (!segment->sealed) {
+        cursor->row_end = segment->count;
+        return;
+    }
+
+    int lo = q->start_date != 0 ? log_segment_lower_bound(segment, (long long)q->start_date) : 0;
+    int hi = q->end_date != 0 ? log_segment_lower_bound(segment, (long long)q->end_date + 1) : segment->count;
+    if (lo >= hi) {
+        return;
+    }
+
+    if (cursor->bits == NULL) {
+        cursor->bits = (unsigned long long*)malloc(sizeof(unsigned long long) * LOG_BITMAP_WORDS);
+        if (cursor->bits == NULL) {
+            cursor->row_end = segment->count;   // Fall back to scanning
+            return;
+        }
+    }
+    unsigned long long* bits = cursor->bits;
+    memset(bits, 0, sizeof(unsigned long long) * LOG_BITMAP_WORDS);
+    for (int w = lo >> 6; w <= (hi - 1) >> 6; w++) {
+        unsigned long long mask = ~0ULL;
+        if (w == lo >> 6) mask &= ~0ULL << (lo & 63);
+        if (w == (hi - 1) >> 6 && ((hi & 63) != 0)) mask &= ~0ULL >> (64 - (hi & 63));
+        bits[w] = mask;
+    }
+
+    if (q->level >= 0) {
+        if (q->level > LOG_LEVEL_CRITICAL || segment->levels[q->level].count == 0) return;
+        log_rowset_and_into(bits, &segment->levels[q->level]);
+    }
+    if (cursor->module_id >= 0) {
+        if (segment->modules[cursor->module_id].count == 0) return;
+        log_rowset_and_into(bits, &segment->modules[cursor->module_id]);
+    }
+    if (q->user_id >= 0) {
+        int index = log_keymap_find(&segment->users, (unsigned long long)(unsigned int)q->user_id);
+        if (index < 0) return;
+        log_rowset_and_into(bits, &segment->sets[index]);
+    }
+    for (int i = 0; i < cursor->token_count; i++) {
+        int index = log_keymap_find(&segment->tokens, cursor->tokens[i]);
+        if (index < 0) return;
+        log_rowset_and_into(bits, &segment->sets[index]);
+    }
+
+    cursor->use_bits = 1;
+    cursor->row = lo;
+    cursor->row_end = hi;
+}
+
+// Next matching row of the current segment, or -1
+static int log_cursor_next_row(LogCursor* cursor, const LogStoreSegment* segment) {
+    while (cursor->row < cursor->row_end) {
+        int row = cursor->row;
+        if (cursor->use_bits) {
+            unsigned long long word = cursor->bits[row >> 6] & (~0ULL << (row & 63));
+            if (word == 0) {
+                cursor->row = ((row >> 6) + 1) << 6;
+                continue;
+            }
+            row = ((row >> 6) << 6) + __builtin_ctzll(word);
+            if (row >= cursor->row_end) {
+                break;
+            }
+            cursor->row = row + 1;
+            // Token hashes can collide; confirm the words themselves
+            if (cursor->token_count == 0 ||
+                log_cursor_matches_words(cursor, log_record_message(segment, &segment->records[row]))) {
+                return row;
+            }
+        } else {
+            cursor->row = row + 1;
+            if (log_cursor_matches_row(cursor, segment, row)) {
+                return row;
+            }
+        }
+    }
+    cursor->row = cursor->row_end;
+    return -1;
+}
+
+static void log_cursor_copy_entry(const LogRecordView* view, LogEntry* entry) {
+    memset(entry, 0, sizeof(LogEntry));
+    entry->timestamp = (time_t)view->timestamp;
+    entry->level = view->level;
+    entry->user_id = view->user_id;
+    strncpy(entry->module, view->module, sizeof(entry->module) - 1);
+    strncpy(entry->message, view->message, sizeof(entry->message) - 1);
+    strncpy(entry->username, view->username, sizeof(entry->username) - 1);
+    strncpy(entry->ip_address, view->ip_address, sizeof(entry->ip_address) - 1);
+}
+
+// Advance to the next match; fills `view` and, when given, copies into
+// `entry` while the read lock is still held
+static int log_cursor_fetch(LogCursor* cursor, LogRecordView* view, LogEntry* entry) {
+    LogStore* store = cursor->store;
+    pthread_rwlock_rdlock(&store->lock);
+    while (cursor->segment < store->segment_count) {
+        LogStoreSegment* segment = store->segments[cursor->segment];
+        if (cursor->row_end < 0) {
+            log_cursor_prepare(cursor, segment);
+        } else if (!segment->sealed && cursor->row_end < segment->count) {
+            cursor->row_end = segment->count;   // Pick up rows appended since
+        }
+
+        int row = log_cursor_next_row(cursor, segment);
+        if (row >= 0) {
+            const LogStoreRecord* record = &segment->records[row];
+            view->timestamp = record->timestamp;
+            view->level = (LogLevel)record->level;
+            view->module = store->module_names[record->module];
+            view->user_id = record->user_id;
+            view->username = log_record_username(segment, record);
+            view->ip_address = log_record_ip(segment, record);
+            view->message = log_record_message(segment, record);
+            if (entry != NULL) {
+                log_cursor_copy_entry(view, entry);
+            }
+            cursor->returned++;
+            pthread_rwlock_unlock(&store->lock);
+            return 1;
+        }
+        // A segment still being filled stays current until it is sealed
+        if (!segment->sealed && cursor->segment == store->segment_count - 1) {
+            break;
+        }
+        cursor->segment++;
+        cursor->row_end = -1;
+    }
+    pthread_rwlock_unlock(&store->lock);
+    return 0;
+}
+
+int log_cursor_next(LogCursor* cursor, LogRecordView* view) {
+    LogRecordView scratch;
+    if (cursor == NULL) {
+        return 0;
+    }
+    return log_cursor_fetch(cursor, view != NULL ? view : &scratch, NULL);
+}
+
+int log_cursor_next_entry(LogCursor* cursor, LogEntry* entry) {
+    LogRecordView view;
+    if (cursor == NULL || entry == NULL) {
+        return 0;
+    }
+    return log_cursor_fetch(cursor, &view, entry);
+}
+
+long long log_cursor_count(LogCursor* cursor) {
+    if (cursor == NULL) {
+        return 0;
+    }
+
+    long long total = 0;
+    LogStore* store = cursor->store;
+    pthread_rwlock_rdlock(&store->lock);
+    while (cursor->segment < store->segment_count) {
+        LogStoreSegment* segment = store->segments[cursor->segment];
+        if (cursor->row_end < 0) {
+            log_cursor_prepare(cursor, segment);
+        }
+        if (cursor->use_bits && cursor->token_count == 0) {
+            // Popcount the remaining candidate rows
+            for (int row = cursor->row; row < cursor->row_end;) {
+                int word = row >> 6;
+                unsigned long long bits = cursor->bits[word] & (~0ULL << (row & 63));
+                total += __builtin_popcountll(bits);
+                row = (word + 1) << 6;
+            }
+            cursor->row = cursor->row_end;
+        } else {
+            if (!segment->sealed && cursor->row_end < segment->count) {
+                cursor->row_end = segment->count;
+            }
+            while (log_cursor_next_row(cursor, segment) >= 0) {
+                total++;
+            }
+        }
+        if (!segment->sealed && cursor->segment == store->segment_count - 1) {
+            break;
+        }
+        cursor->segment++;
+        cursor->row_end = -1;
+    }
+    pthread_rwlock_unlock(&store->lock);
+    cursor->returned += total;
+    return total;
+}
+
+void log_cursor_destroy(LogCursor* cursor) {
+    if (cursor == NULL) {
+        return;
+    }
+    free(cursor->bits);
+    free(cursor);
+}
+
+// ---- Benchmark ----
+
+static double log_store_elapsed_ms(struct timespec* start, struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 + (double)(end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void log_store_benchmark(long entries) {
+    if (entries <= 0) {
+        printf("Error: Invalid benchmark parameters\n");
+        return;
+    }
+
+    static const char* modules[] = { LOG_MODULE_SYSTEM, LOG_MODULE_AUTH, LOG_MODULE_STUDENT,
+                                     LOG_MODULE_GRADE, LOG_MODULE_ATTENDANCE, LOG_MODULE_CLUB };
+    static const char* actions[] = { "login", "logout", "grade", "update", "delete", "export", "view", "backup" };
+    LogStore* store = log_store_create();
+    if (store == NULL) {
+        return;
+    }
+
+    // One year of entries, in time order
+    time_t start_time = 1700000000;
+    long long span = 365LL * 86400;
+    unsigned int seed = 99;
+    char message[128];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < entries; i++) {
+        seed = seed * 1103515245u + 12345u;
+        time_t ts = start_time + (time_t)(span * i / entries);
+        int user = (int)((seed >> 8) % 5000);
+        LogLevel level = (LogLevel)((seed >> 4) % 100 < 70 ? LOG_LEVEL_INFO : (seed >> 4) % 5);
+        snprintf(message, sizeof(message), "user %d %s record %u", user, actions[(seed >> 12) % 8], (seed >> 16) % 100000);
+        log_store_append_fields(store, ts, level, modules[(seed >> 20) % 6], user, "user", "10.0.0.1", message);
+    }
+    log_store_seal(store);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("\n=== LOG STORE BENCHMARK (%ld entries) ===\n", entries);
+    printf("Ingest + index:            %9.1f ms\n", log_store_elapsed_ms(&t0, &t1));
+
+    LogQuery queries[5];
+    const char* names[5] = { "level=ERROR", "module=AUTH, level=WARNING", "user=1234",
+                             "one week, keyword 'delete'", "keyword 'backup', user=42" };
+    for (int i = 0; i < 5; i++) log_query_init(&queries[i]);
+    queries[0].level = LOG_LEVEL_ERROR;
+    strcpy(queries[1].module, LOG_MODULE_AUTH);
+    queries[1].level = LOG_LEVEL_WARNING;
+    queries[2].user_id = 1234;
+    queries[3].start_date = start_time + 100 * 86400;
+    queries[3].end_date = start_time + 107 * 86400;
+    strcpy(queries[3].keyword, "delete");
+    strcpy(queries[4].keyword, "backup");
+    queries[4].user_id = 42;
+
+    for (int i = 0; i < 5; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        LogCursor* cursor = log_store_query(store, &queries[i]);
+        long long count = log_cursor_count(cursor);
+        log_cursor_destroy(cursor);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("%-28s %9.1f ms  %lld matches\n", names[i], log_store_elapsed_ms(&t0, &t1), count);
+    }
+
+    log_store_destroy(store);
+}
@@ -0,0 +1,177 @@
+#include "lz_block.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5      // The block always ends with this many literals
+#define LZ_MATCH_GUARD 12       // No match may start this close to the end
+#define LZ_MAX_OFFSET 65535
+
+static unsigned int lz_read32(const unsigned char* p) {
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned int lz_hash(unsigned int sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_BLOCK_HASH_BITS);
+}
+
+// Length fields past the 4-bit token continue in bytes of 255
+static unsigned char* lz_write_length(unsigned char* op, int length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+int lz_block_bound(int size) {
+    if (size < 0 || size > LZ_BLOCK_MAX_INPUT) {
+        return 0;
+    }
+    return size + size / 255 + 16;
+}
+
+static unsigned char* lz_write_sequence(unsigned char* op, const unsigned char* literals, int literal_length,
+                                        int offset, int match_length) {
+    unsigned char* token = op++;
+    *token = (unsigned char)((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) {
+        op = lz_write_length(op, literal_length - 15);
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length > 0) {
+        *op++ = (unsigned char)(offset & 0xFF);
+        *op++ = (unsigned char)(offset >> 8);
+        int extra = match_length - LZ_MIN_MATCH;
+        *token |= (unsigned char)(extra >= 15 ? 15 : extra);
+        if (extra >= 15) {
+            op = lz_write_length(op, extra - 15);
+        }
+    }
+    return op;
+}
+
+int lz_block_compress(const unsigned char* src, int src_size, unsigned char* dst, int dst_capacity) {
+    if (src == NULL || dst == NULL || src_size < 0 || src_size > LZ_BLOCK_MAX_INPUT ||
+        dst_capacity < lz_block_bound(src_size)) {
+        return -1;
+    }
+
+    int table[1 << LZ_BLOCK_HASH_BITS];
+    for (int i = 0; i < (1 << LZ_BLOCK_HASH_BITS); i++) {
+        table[i] = -1;
+    }
+
+    unsigned char* op = dst;
+    int anchor = 0;
+    int ip = 0;
+    int match_limit = src_size - LZ_MATCH_GUARD;
+    int step_counter = 1 << 6;
+
+    while (ip < match_limit) {
+        unsigned int sequence = lz_read32(src + ip);
+        unsigned int h = lz_hash(sequence);
+        int ref = table[h];
+        table[h] = ip;
+
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET || lz_read32(src + ref) != sequence) {
+            // Skip faster through data that does not compress
+            ip += step_counter++ >> 6;
+            continue;
+        }
+        step_counter = 1 << 6;
+
+        while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+            ip--;
+            ref--;
+        }
+        int length = LZ_MIN_MATCH;
+        int end_limit = src_size - LZ_LAST_LITERALS;
+        while (ip + length < end_limit && src[ref + length] == src[ip + length]) {
+            length++;
+        }
+
+        op = lz_write_sequence(op, src + anchor, ip - anchor, ip - ref, length);
+        ip += length;
+        anchor = ip;
+        if (ip - 2 < match_limit && ip >= 2) {
+            table[lz_hash(lz_read32(src + ip - 2))] = ip - 2;
+        }
+    }
+
+    op = lz_write_sequence(op, src + anchor, src_size - anchor, 0, 0);
+    return (int)(op - dst);
+}
+
+int lz_block_decompress(const unsigned char* src, int src_size, unsigned char* dst, int dst_capacity) {
+    if (src == NULL || dst == NULL || src_size <= 0 || dst_capacity < 0) {
+        return -1;
+    }
+
+    const unsigned char* ip = src;
+    const unsigned char* in_end = src + src_size;
+    unsigned char* op = dst;
+    unsigned char* out_end = dst + dst_capacity;
+
+    while (ip < in_end) {
+        unsigned int token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            unsigned int byte;
+            do {
+                if (ip >= in_end) return -1;
+                byte = *ip++;
+                literal_length += byte;
+            } while (byte == 255);
+        }
+        if (literal_length > (size_t)(in_end - ip) || literal_length > (size_t)(out_end - op)) {
+            return -1;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == in_end) {
+            break;      // Last sequence has no match
+        }
+        if (in_end - ip < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return -1;
+        }
+
+        size_t match_length = token & 15;
+        if (match_length == 15) {
+            unsigned int byte;
+            do {
+                if (ip >= in_end) return -1;
+                byte = *ip++;
+                match_length += byte;
+            } while (byte == 255);
+        }
+        match_length += LZ_MIN_MATCH;
+        if (match_length > (size_t)(out_end - op)) {
+            return -1;
+        }
+
+        const unsigned char* match = op - offset;
+        if (offset >= match_length) {
+            memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < match_length; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return (int)(op - dst);
+}
@@ -0,0 +1,489 @@
+#include "moments.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MOMENTS_HAVE_AVX2_KERNEL 1
+#endif
+
+// ---- Accumulators ----
+
+void stats_moments_init(StatsMoments* m) {
+    memset(m, 0, sizeof(StatsMoments));
+}
+
+void stats_moments_add(StatsMoments* m, double x) {
+    m->n++;
+    double delta = x - m->mean;
+    m->mean += delta / m->n;
+    m->m2 += delta * (x - m->mean);
+}
+
+void stats_moments_merge(StatsMoments* into, const StatsMoments* from) {
+    if (from->n == 0) {
+        return;
+    }
+    if (into->n == 0) {
+        *into = *from;
+        return;
+    }
+    long long n = into->n + from->n;
+    double delta = from->mean - into->mean;
+    into->mean += delta * from->n / n;
+    into->m2 += from->m2 + delta * delta * ((double)into->n * from->n / n);
+    into->n = n;
+}
+
+double stats_moments_variance(const StatsMoments* m) {
+    return m->n > 0 ? m->m2 / m->n : 0.0;
+}
+
+double stats_moments_stddev(const StatsMoments* m) {
+    return sqrt(stats_moments_variance(m));
+}
+
+void stats_comoments_init(StatsComoments* c) {
+    memset(c, 0, sizeof(StatsComoments));
+}
+
+void stats_comoments_add(StatsComoments* c, double x, double y) {
+    c->n++;
+    double dx = x - c->mean_x;
+    c->mean_x += dx / c->n;
+    double dy = y - c->mean_y;
+    c->mean_y += dy / c->n;
+    c->m2_x += dx * (x - c->mean_x);
+    c->m2_y += dy * (y - c->mean_y);
+    c->c_xy += dx * (y - c->mean_y);
+}
+
+void stats_comoments_merge(StatsComoments* into, const StatsComoments* from) {
+    if (from->n == 0) {
+        return;
+    }
+    if (into->n == 0) {
+        *into = *from;
+        return;
+    }
+    long long n = into->n + from->n;
+    double weight = (double)into->n * from->n / n;
+    double dx = from->mean_x - into->mean_x;
+    double dy = from->mean_y - into->mean_y;
+    into->mean_x += dx * from->n / n;
+    into->mean_y += dy * from->n / n;
+    into->m2_x += from->m2_x + dx * dx * weight;
+    into->m2_y += from->m2_y + dy * dy * weight;
+    into->c_xy += from->c_xy + dx * dy * weight;
+    into->n = n;
+}
+
+double stats_comoments_covariance(const StatsComoments* c) {
+    return c->n > 0 ? c->c_xy / c->n : 0.0;
+}
+
+double stats_comoments_correlation(const StatsComoments* c) {
+    if (c->m2_x <= 0.0 || c->m2_y <= 0.0) {
+        return 0.0;
+    }
+    return c->c_xy / sqrt(c->m2_x * c->m2_y);
+}
+
+// ---- Block kernels ----
+// A block is small enough to stay in cache, so it is read twice: once for the
+// mean, once for squared deviations around it. Both kernels use four double
+// lanes combined as (l0 + l1) + (l2 + l3) and the same scalar tail, so the
+// AVX2 and scalar paths give bit-identical blocks.
+
+static void moments_block_scalar(const float* v, int count, StatsMoments* out) {
+    double lane[4] = {0.0, 0.0, 0.0, 0.0};
+    int body = count & ~3;
+    for (int i = 0; i < body; i += 4) {
+        for (int l = 0; l < 4; l++) lane[l] += (double)v[i + l];
+    }
+    double sum = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    for (int i = body; i < count; i++) sum += (double)v[i];
+    double mean = sum / count;
+
+    lane[0] = lane[1] = lane[2] = lane[3] = 0.0;
+    for (int i = 0; i < body; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            double d = (double)v[i + l] - mean;
+            lane[l] += d * d;
+        }
+    }
+    double m2 = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    for (int i = body; i < count; i++) {
+        double d = (double)v[i] - mean;
+        m2 += d * d;
+    }
+
+    out->n = count;
+    out->mean = mean;
+    out->m2 = m2;
+}
+
+static void comoments_block_scalar(const float* x, const float* y, int count, StatsComoments* out) {
+    double lx[4] = {0.0, 0.0, 0.0, 0.0}, ly[4] = {0.0, 0.0, 0.0, 0.0};
+    int body = count & ~3;
+    for (int i = 0; i < body; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            lx[l] += (double)x[i + l];
+            ly[l] += (double)y[i + l];
+        }
+    }
+    double sx = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    double sy = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+    for (int i = body; i < count; i++) {
+        sx += (double)x[i];
+        sy += (double)y[i];
+    }
+    double mx = sx / count, my = sy / count;
+
+    double lxx[4] = {0.0, 0.0, 0.0, 0.0}, lyy[4] = {0.0, 0.0, 0.0, 0.0}, lxy[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int i = 0; i < body; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            double dx = (double)x[i + l] - mx;
+            double dy = (double)y[i + l] - my;
+            lxx[l] += dx * dx;
+            lyy[l] += dy * dy;
+            lxy[l] += dx * dy;
+        }
+    }
+    double sxx = (lxx[0] + lxx[1]) + (lxx[2] + lxx[3]);
+    double syy = (lyy[0] + lyy[1]) + (lyy[2] + lyy[3]);
+    double sxy = (lxy[0] + lxy[1]) + (lxy[2] + lxy[3]);
+    for (int i = body; i < count; i++) {
+        double dx = (double)x[i] - mx;
+        double dy = (double)y[i] - my;
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+
+    out->n = count;
+    out->mean_x = mx;
+    out->mean_y = my;
+    out->m2_x = sxx;
+    out->m2_y = syy;
+    out->c_xy = sxy;
+}
+
+#ifdef MOMENTS_HAVE_AVX2_KERNEL
+static double moments_hsum_avx2(__m256d v) __attribute__((target("avx2")));
+static double moments_hsum_avx2(__m256d v) {
+    double lane[4];
+    _mm256_storeu_pd(lane, v);
+    return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+}
+
+__attribute__((target("avx2")))
+static void moments_block_avx2(const float* v, int count, StatsMoments* out) {
+    int body = count & ~3;
+    __m256d acc = _mm256_setzero_pd();
+    for (int i = 0; i < body; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(v + i)));
+    }
+    double sum = moments_hsum_avx2(acc);
+    for (int i = body; i < count; i++) sum += (double)v[i];
+    double mean = sum / count;
+
+    __m256d vmean = _mm256_set1_pd(mean);
+    acc = _mm256_setzero_pd();
+    for (int i = 0; i < body; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(v + i)), vmean);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+    }
+    double m2 = moments_hsum_avx2(acc);
+    for (int i = body; i < count; i++) {
+        double d = (double)v[i] - mean;
+        m2 += d * d;
+    }
+
+    out->n = count;
+    out->mean = mean;
+    out->m2 = m2;
+}
+
+__attribute__((target("avx2")))
+static void comoments_block_avx2(const float* x, const float* y, int count, StatsComoments* out) {
+    int body = count & ~3;
+    __m256d ax = _mm256_setzero_pd(), ay = _mm256_setzero_pd();
+    for (int i = 0; i < body; i += 4) {
+        ax = _mm256_add_pd(ax, _mm256_cvtps_pd(_mm_loadu_ps(x + i)));
+        ay = _mm256_add_pd(ay, _mm256_cvtps_pd(_mm_loadu_ps(y + i)));
+    }
+    double sx = moments_hsum_avx2(ax), sy = moments_hsum_avx2(ay);
+    for (int i = body; i < count; i++) {
+        sx += (double)x[i];
+        sy += (double)y[i];
+    }
+    double mx = sx / count, my = sy / count;
+
+    __m256d vmx = _mm256_set1_pd(mx), vmy = _mm256_set1_pd(my);
+    __m256d axx = _mm256_setzero_pd(), ayy = _mm256_setzero_pd(), axy = _mm256_setzero_pd();
+    for (int i = 0; i < body; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)), vmx);
+        __m256d dy = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(y + i)), vmy);
+        axx = _mm256_add_pd(axx, _mm256_mul_pd(dx, dx));
+        ayy = _mm256_add_pd(ayy, _mm256_mul_pd(dy, dy));
+        axy = _mm256_add_pd(axy, _mm256_mul_pd(dx, dy));
+    }
+    double sxx = moments_hsum_avx2(axx), syy = moments_hsum_avx2(ayy), sxy = moments_hsum_avx2(axy);
+    for (int i = body; i < count; i++) {
+        double dx = (double)x[i] - mx;
+        double dy = (double)y[i] - my;
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+
+    out->n = count;
+    out->mean_x = mx;
+    out->mean_y = my;
+    out->m2_x = sxx;
+    out->m2_y = syy;
+    out->c_xy = sxy;
+}
+#endif
+
+// ---- Kernel dispatch ----
+
+static int moments_force_scalar = 0;
+
+int stats_moments_simd_enabled(void) {
+#ifdef MOMENTS_HAVE_AVX2_KERNEL
+    static int supported = -1;
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return supported && !moments_force_scalar;
+#else
+    return 0;
+#endif
+}
+
+void stats_moments_force_scalar(int force) {
+    moments_force_scalar = force;
+}
+
+static void moments_block(const float* v, int count, StatsMoments* out) {
+#ifdef MOMENTS_HAVE_AVX2_KERNEL
+    if (stats_moments_simd_enabled()) {
+        moments_block_avx2(v, count, out);
+        return;
+    }
+#endif
+    moments_block_scalar(v, count, out);
+}
+
+static void comoments_block(const float* x, const float* y, int count, StatsComoments* out) {
+#ifdef MOMENTS_HAVE_AVX2_KERNEL
+    if (stats_moments_simd_enabled()) {
+        comoments_block_avx2(x, y, count, out);
+        return;
+    }
+#endif
+    comoments_block_scalar(x, y, count, out);
+}
+
+void stats_moments_accumulate(StatsMoments* m, const float* values, int count) {
+    if (m == NULL || values == NULL) {
+        return;
+    }
+    for (int start = 0; start < count; start += MOMENTS_BLOCK_SIZE) {
+        int n = count - start < MOMENTS_BLOCK_SIZE ? count - start : MOMENTS_BLOCK_SIZE;
+        StatsMoments block;
+        moments_block(values + start, n, &block);
+        stats_moments_merge(m, &block);
+    }
+}
+
+void stats_comoments_accumulate(StatsComoments* c, const float* x, const float* y, int count) {
+    if (c == NULL || x == NULL || y == NULL) {
+        return;
+    }
+    for (int start = 0; start < count; start += MOMENTS_BLOCK_SIZE) {
+        int n = count - start < MOMENTS_BLOCK_SIZE ? count - start : MOMENTS_BLOCK_SIZE;
+        StatsComoments block;
+        comoments_block(x + start, y + start, n, &block);
+        stats_comoments_merge(c, &block);
+    }
+}
+
+// ---- Block-parallel reductions ----
+// Workers fill one accumulator per block; the caller then merges the blocks
+// in order, so the merge tree never depends on how blocks were shared out.
+
+typedef struct {
+    const float* x;
+    const float* y;
+    int count;
+    int first_block;
+    int last_block;
+    StatsMoments* moments;
+    StatsComoments* comoments;
+} MomentsSlice;
+
+static void* moments_run_slice(void* arg) {
+    MomentsSlice* slice = (MomentsSlice*)arg;
+    for (int b = slice->first_block; b < slice->last_block; b++) {
+        int start = b * MOMENTS_BLOCK_SIZE;
+        int n = slice->count - start < MOMENTS_BLOCK_SIZE ? slice->count - start : MOMENTS_BLOCK_SIZE;
+        if (slice->comoments != NULL) {
+            comoments_block(slice->x + start, slice->y + start, n, &slice->comoments[b]);
+        } else {
+            moments_block(slice->x + start, n, &slice->moments[b]);
+        }
+    }
+    return NULL;
+}
+
+static int moments_thread_count(int threads, int blocks) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > MOMENTS_MAX_THREADS) threads = MOMENTS_MAX_THREADS;
+    if (threads > blocks) threads = blocks;
+    return threads > 0 ? threads : 1;
+}
+
+static void moments_run_blocks(const float* x, const float* y, int count, int threads,
+                               StatsMoments* moments, StatsComoments* comoments) {
+    int blocks = (count + MOMENTS_BLOCK_SIZE - 1) / MOMENTS_BLOCK_SIZE;
+    if (count < MOMENTS_PARALLEL_THRESHOLD) threads = 1;
+    threads = moments_thread_count(threads, blocks);
+
+    MomentsSlice slices[MOMENTS_MAX_THREADS];
+    pthread_t workers[MOMENTS_MAX_THREADS];
+    int started[MOMENTS_MAX_THREADS] = {0};
+    for (int t = 0; t < threads; t++) {
+        slices[t].x = x;
+        slices[t].y = y;
+        slices[t].count = count;
+        slices[t].first_block = (int)((long long)blocks * t / threads);
+        slices[t].last_block = (int)((long long)blocks * (t + 1) / threads);
+        slices[t].moments = moments;
+        slices[t].comoments = comoments;
+    }
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&workers[t], NULL, moments_run_slice, &slices[t]) == 0;
+        if (!started[t]) {
+            moments_run_slice(&slices[t]);
+        }
+    }
+    moments_run_slice(&slices[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        }
+    }
+}
+
+int stats_moments_compute(const float* values, int count, int threads, StatsMoments* out) {
+    if (values == NULL || out == NULL || count < 0) {
+        printf("Error: Invalid arguments to stats_moments_compute\n");
+        return 0;
+    }
+    stats_moments_init(out);
+    if (count == 0) {
+        return 1;
+    }
+
+    int blocks = (count + MOMENTS_BLOCK_SIZE - 1) / MOMENTS_BLOCK_SIZE;
+    StatsMoments* partial = (StatsMoments*)malloc(sizeof(StatsMoments) * blocks);
+    if (partial == NULL) {
+        printf("Error: Failed to allocate moment blocks\n");
+        return 0;
+    }
+    moments_run_blocks(values, NULL, count, threads, partial, NULL);
+    for (int b = 0; b < blocks; b++) {
+        stats_moments_merge(out, &partial[b]);
+    }
+    free(partial);
+    return 1;
+}
+
+int stats_comoments_compute(const float* x, const float* y, int count, int threads, StatsComoments* out) {
+    if (x == NULL || y == NULL || out == NULL || count < 0) {
+        printf("Error: Invalid arguments to stats_comoments_compute\n");
+        return 0;
+    }
+    stats_comoments_init(out);
+    if (count == 0) {
+        return 1;
+    }
+
+    int blocks = (count + MOMENTS_BLOCK_SIZE - 1) / MOMENTS_BLOCK_SIZE;
+    StatsComoments* partial = (StatsComoments*)malloc(sizeof(StatsComoments) * blocks);
+    if (partial == NULL) {
+        printf("Error: Failed to allocate moment blocks\n");
+        return 0;
+    }
+    moments_run_blocks(x, y, count, threads, NULL, partial);
+    for (int b = 0; b < blocks; b++) {
+        stats_comoments_merge(out, &partial[b]);
+    }
+    free(partial);
+    return 1;
+}
+
+// ---- Benchmark ----
+
+static double moments_elapsed_ms(struct timespec* start, struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 + (double)(end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void moments_benchmark(int count) {
+    if (count <= 0) {
+        printf("Error: Invalid benchmark parameters\n");
+        return;
+    }
+
+    float* gpa = (float*)malloc(sizeof(float) * count);
+    float* attendance = (float*)malloc(sizeof(float) * count);
+    if (gpa == NULL || attendance == NULL) {
+        printf("Error: Failed to allocate benchmark data\n");
+        free(gpa);
+        free(attendance);
+        return;
+    }
+
+    unsigned int seed = 2024;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        attendance[i] = 0.5f + (float)((seed >> 8) % 5001) / 10000.0f;
+        gpa[i] = attendance[i] * 3.0f + (float)((seed >> 4) % 1000) / 1000.0f;
+    }
+
+    printf("\n=== CORRELATION BENCHMARK (%d rows, %.1f MB) ===\n", count, 2.0 * count * sizeof(float) / 1e6);
+    int simd = stats_moments_simd_enabled();
+    for (int pass = 0; pass < 4; pass++) {
+        int scalar = pass < 2;
+        int threads = pass % 2 == 0 ? 1 : 0;
+        if (!scalar && !simd) break;
+
+        stats_moments_force_scalar(scalar);
+        StatsComoments c;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        stats_comoments_compute(gpa, attendance, count, threads, &c);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = moments_elapsed_ms(&start, &end);
+        printf("%-6s %-9s r=%.12f  %8.2f ms  %6.2f GB/s\n", scalar ? "scalar" : "avx2",
+               threads == 1 ? "1 thread" : "all CPUs", stats_comoments_correlation(&c), ms,
+               2.0 * count * sizeof(float) / (ms * 1e6));
+    }
+    stats_moments_force_scalar(0);
+
+    free(gpa);
+    free(attendance);
+}
@@ -0,0 +1,240 @@
+#include "permission.h"
+#include "log.h"
+#include <string.h>
+#include <strings.h>
+
+#define P(action) PERMISSION_BIT(PERM_##action)
+
+const unsigned int permission_granted[PERMISSION_ROLE_SLOTS] = {
+    [ROLE_ADMIN] = PERMISSION_BIT(PERM_ACTION_COUNT) - 1,
+    [ROLE_TEACHER] = P(STUDENT_VIEW) | P(GRADE_VIEW) | P(GRADE_EDIT) | P(ATTENDANCE_VIEW) | P(ATTENDANCE_MARK) |
+                     P(COURSE_VIEW) | P(CLUB_VIEW) | P(REPORT_VIEW),
+    [ROLE_STUDENT] = P(STUDENT_VIEW) | P(GRADE_VIEW) | P(ATTENDANCE_VIEW) | P(COURSE_VIEW) | P(CLUB_VIEW),
+};
+
+const unsigned int permission_scoped[PERMISSION_ROLE_SLOTS] = {
+    [ROLE_TEACHER] = P(STUDENT_VIEW) | P(GRADE_VIEW) | P(GRADE_EDIT) | P(ATTENDANCE_VIEW) | P(ATTENDANCE_MARK),
+    [ROLE_STUDENT] = P(STUDENT_VIEW) | P(GRADE_VIEW) | P(ATTENDANCE_VIEW),
+};
+
+#undef P
+
+static const char* permission_action_names[PERM_ACTION_COUNT] = {
+    "view students", "create students", "edit students", "delete students",
+    "view grades", "edit grades", "view attendance", "mark attendance",
+    "view courses", "edit courses", "view clubs", "edit clubs",
+    "view reports", "manage users", "view logs", "run backups",
+};
+
+int permission_allows(UserRole role, PermissionAction action) {
+    return (unsigned int)action < PERM_ACTION_COUNT && PERMISSION_ALLOWS(role, action);
+}
+
+int permission_is_scoped(UserRole role, PermissionAction action) {
+    return (unsigned int)action < PERM_ACTION_COUNT &&
+           (PERMISSION_ROW(permission_scoped, role) & PERMISSION_BIT(action)) != 0;
+}
+
+int session_can(const Session* session, PermissionAction action) {
+    return session != NULL && session->is_valid && permission_allows(session->role, action);
+}
+
+const char* permission_action_name(PermissionAction action) {
+    return (unsigned int)action < PERM_ACTION_COUNT ? permission_action_names[action] : "unknown";
+}
+
+void permission_display_table(void) {
+    printf("\n=== PERMISSIONS ===\n");
+    printf("%-18s %-8s %-8s %-8s\n", "Action", "Admin", "Teacher", "Student");
+    for (int action = 0; action < PERM_ACTION_COUNT; action++) {
+        printf("%-18s", permission_action_names[action]);
+        for (UserRole role = ROLE_ADMIN; role <= ROLE_STUDENT; role++) {
+            const char* cell = !permission_allows(role, action) ? "-"
+                               : permission_is_scoped(role, action) ? "own" : "yes";
+            printf(" %-8s", cell);
+        }
+        printf("\n");
+    }
+}
+
+// ---- Scopes ----
+
+static int permission_compare_ids(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Collects the courses a teacher teaches; each contributes its id and
+// both its name and its code, since Student.course may hold either
+static int permission_scope_load_courses(PermissionScope* scope, const CourseList* courses) {
+    int taught = 0;
+    for (int i = 0; i < courses->count; i++) {
+        taught += courses->courses[i].teacher_id == scope->user_id;
+    }
+    if (taught == 0) {
+        return 1;
+    }
+    scope->course_ids = (int*)malloc(sizeof(int) * (size_t)taught);
+    scope->course_names = malloc(sizeof(*scope->course_names) * (size_t)taught * 2);
+    if (scope->course_ids == NULL || scope->course_names == NULL) {
+        printf("Error: Failed to allocate permission scope\n");
+        return 0;
+    }
+    int names = 0;
+    for (int i = 0; i < courses->count; i++) {
+        const Course* course = &courses->courses[i];
+        if (course->teacher_id != scope->user_id) {
+            continue;
+        }
+        scope->course_ids[scope->course_count++] = course->id;
+        snprintf(scope->course_names[names++], MAX_COURSE_LENGTH, "%s", course->name);
+        if (course->code[0] != '\0') {
+            snprintf(scope->course_names[names++], MAX_COURSE_LENGTH, "%s", course->code);
+        }
+    }
+    // Courses without a code leave empty name slots
+    for (; names < taught * 2; names++) {
+        scope->course_names[names][0] = '\0';
+    }
+    qsort(scope->course_ids, (size_t)scope->course_count, sizeof(int), permission_compare_ids);
+    return 1;
+}
+
+PermissionScope* permission_scope_create(const Session* session, UserList* users, const CourseList* courses,
+                                         StudentList* students) {
+    PermissionScope* scope = (PermissionScope*)calloc(1, sizeof(PermissionScope));
+    if (scope == NULL) {
+        printf("Error: Failed to allocate permission scope\n");
+        return NULL;
+    }
+    scope->own_student_id = -1;
+    if (session == NULL || !session->is_valid) {
+        return scope;
+    }
+    scope->user_id = session->user_id;
+    scope->role = session->role;
+    scope->granted = PERMISSION_ROW(permission_granted, session->role);
+    scope->scoped = PERMISSION_ROW(permission_scoped, session->role);
+
+    if (session->role == ROLE_TEACHER && courses != NULL && courses->courses != NULL &&
+        !permission_scope_load_courses(scope, courses)) {
+        permission_scope_destroy(scope);
+        return NULL;
+    }
+    if (session->role == ROLE_STUDENT && users != NULL && students != NULL) {
+        User* user = user_list_find_by_id(users, session->user_id);
+        Student* student = user != NULL ? student_list_find_by_email(students, user->email) : NULL;
+        if (student != NULL) {
+            scope->own_student_id = student->id;
+        } else {
+            LOG_WARNING(LOG_MODULE_ID_AUTH, "No student record for user %d", session->user_id);
+        }
+    }
+    return scope;
+}
+
+void permission_scope_destroy(PermissionScope* scope) {
+    if (scope == NULL) {
+        return;
+    }
+    free(scope->course_ids);
+    free(scope->course_names);
+    free(scope);
+}
+
+static int permission_scope_teaches(const PermissionScope* scope, int course_id) {
+    return scope->course_count > 0 && bsearch(&course_id, scope->course_ids, (size_t)scope->course_count,
+                                              sizeof(int), permission_compare_ids) != NULL;
+}
+
+static int permission_scope_teaches_named(const PermissionScope* scope, const char* course) {
+    for (int i = 0; i < scope->course_count * 2; i++) {
+        if (scope->course_names[i][0] != '\0' && strcasecmp(scope->course_names[i], course) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Ownership tests, used as scan predicates with the scope as context
+static int permission_owns_student(const Student* student, const void* context) {
+    const PermissionScope* scope = (const PermissionScope*)context;
+    if (scope->role == ROLE_TEACHER) {
+        return permission_scope_teaches_named(scope, student->course);
+    }
+    return scope->role == ROLE_STUDENT && student->id == scope->own_student_id;
+}
+
+static int permission_owns_grade(const Grade* grade, const void* context) {
+    const PermissionScope* scope = (const PermissionScope*)context;
+    if (scope->role == ROLE_TEACHER) {
+        return grade->teacher_id == scope->user_id || permission_scope_teaches(scope, grade->course_id);
+    }
+    return scope->role == ROLE_STUDENT && grade->student_id == scope->own_student_id;
+}
+
+static int permission_owns_attendance(const AttendanceRecord* record, const void* context) {
+    const PermissionScope* scope = (const PermissionScope*)context;
+    if (scope->role == ROLE_TEACHER) {
+        return record->teacher_id == scope->user_id || permission_scope_teaches(scope, record->course_id);
+    }
+    return scope->role == ROLE_STUDENT && record->student_id == scope->own_student_id;
+}
+
+int permission_scope_can(const PermissionScope* scope, PermissionAction action) {
+    return scope != NULL && (unsigned int)action < PERM_ACTION_COUNT &&
+           (scope->granted & PERMISSION_BIT(action)) != 0;
+}
+
+// 1 when granted outright, 0 when refused, -1 when ownership decides
+static int permission_scope_check(const PermissionScope* scope, PermissionAction action) {
+    if (!permission_scope_can(scope, action)) {
+        return 0;
+    }
+    return (scope->scoped & PERMISSION_BIT(action)) != 0 ? -1 : 1;
+}
+
+int permission_scope_can_student(const PermissionScope* scope, PermissionAction action, const Student* student) {
+    int check = permission_scope_check(scope, action);
+    return student != NULL && (check > 0 || (check < 0 && permission_owns_student(student, scope)));
+}
+
+int permission_scope_can_grade(const PermissionScope* scope, PermissionAction action, const Grade* grade) {
+    int check = permission_scope_check(scope, action);
+    return grade != NULL && (check > 0 || (check < 0 && permission_owns_grade(grade, scope)));
+}
+
+int permission_scope_can_attendance(const PermissionScope* scope, PermissionAction action,
+                                    const AttendanceRecord* record) {
+    int check = permission_scope_check(scope, action);
+    return record != NULL && (check > 0 || (check < 0 && permission_owns_attendance(record, scope)));
+}
+
+// ---- Filtered scans ----
+
+Student* permission_next_student(const PermissionScope* scope, PermissionAction action, StudentList* list,
+                                 int* cursor) {
+    int check = permission_scope_check(scope, action);
+    if (check == 0) {
+        return NULL;
+    }
+    return student_list_next_where(list, cursor, check < 0 ? permission_owns_student : NULL, scope);
+}
+
+Grade* permission_next_grade(const PermissionScope* scope, PermissionAction action, GradeList* list, int* cursor) {
+    int check = permission_scope_check(scope, action);
+    if (check == 0) {
+        return NULL;
+    }
+    return grade_list_next_where(list, cursor, check < 0 ? permission_owns_grade : NULL, scope);
+}
+
+AttendanceRecord* permission_next_attendance(const PermissionScope* scope, PermissionAction action,
+                                             AttendanceList* list, int* cursor) {
+    int check = permission_scope_check(scope, action);
+    if (check == 0) {
+        return NULL;
+    }
+    return attendance_list_next_where(list, cursor, check < 0 ? permission_owns_attendance : NULL, scope);
+}
@@ -0,0 +1,353 @@
+#include "quantile.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+QuantileSketch* quantile_sketch_create(int k) {
+    QuantileSketch* sketch = (QuantileSketch*)calloc(1, sizeof(QuantileSketch));
+    if (sketch == NULL) {
+        printf("Error: Failed to create quantile sketch\n");
+        return NULL;
+    }
+    sketch->k = k >= QUANTILE_MIN_LEVEL_CAPACITY ? k : QUANTILE_DEFAULT_K;
+    quantile_sketch_reset(sketch);
+    return sketch;
+}
+
+void quantile_sketch_destroy(QuantileSketch* sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    for (int i = 0; i < QUANTILE_MAX_LEVELS; i++) {
+        free(sketch->levels[i].items);
+    }
+    free(sketch);
+}
+
+void quantile_sketch_reset(QuantileSketch* sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    // Keep the level buffers for reuse
+    for (int i = 0; i < QUANTILE_MAX_LEVELS; i++) {
+        sketch->levels[i].count = 0;
+    }
+    sketch->level_count = 1;
+    sketch->n = 0;
+    sketch->min_value = 0.0f;
+    sketch->max_value = 0.0f;
+    sketch->seed = 0x9E3779B9u;
+}
+
+// Capacity shrinks by 2/3 per level below the top, so the total stays below 3k
+static int quantile_level_capacity(const QuantileSketch* sketch, int level) {
+    int depth = sketch->level_count - 1 - level;
+    double capacity = sketch->k * pow(2.0 / 3.0, depth);
+    int result = (int)ceil(capacity);
+    return result < QUANTILE_MIN_LEVEL_CAPACITY ? QUANTILE_MIN_LEVEL_CAPACITY : result;
+}
+
+static int quantile_level_push(QuantileLevel* level, float value) {
+    if (level->count == level->capacity) {
+        int new_capacity = level->capacity > 0 ? level->capacity * 2 : QUANTILE_MIN_LEVEL_CAPACITY * 2;
+        float* items = (float*)realloc(level->items, sizeof(float) * new_capacity);
+        if (items == NULL) {
+            printf("Error: Failed to grow quantile sketch\n");
+            return 0;
+        }
+        level->items = items;
+        level->capacity = new_capacity;
+    }
+    level->items[level->count++] = value;
+    return 1;
+}
+
+static int quantile_compare_floats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Halve one level: sort it and promote every other item (random phase) one level up
+static int quantile_compact_level(QuantileSketch* sketch, int h) {
+    if (h + 1 >= QUANTILE_MAX_LEVELS) {
+        return 0;
+    }
+    if (h + 1 >= sketch->level_count) {
+        sketch->level_count = h + 2;
+    }
+
+    QuantileLevel* level = &sketch->levels[h];
+    QuantileLevel* above = &sketch->levels[h + 1];
+    qsort(level->items, level->count, sizeof(float), quantile_compare_floats);
+
+    // An odd item out stays behind at this level
+    int keep = level->count % 2;
+    int pairs = level->count / 2;
+    sketch->seed = sketch->seed * 1664525u + 1013904223u;
+    int phase = (int)((sketch->seed >> 16) & 1u);
+    for (int i = 0; i < pairs; i++) {
+        if (!quantile_level_push(above, level->items[keep + 2 * i + phase])) {
+            return 0;
+        }
+    }
+    if (keep) {
+        // The leftover is the smallest item, already in place
+        level->count = 1;
+    } else {
+        level->count = 0;
+    }
+    return 1;
+}
+
+static int quantile_compress(QuantileSketch* sketch) {
+    for (;;) {
+        int total = 0;
+        int budget = 0;
+        for (int h = 0; h < sketch->level_count; h++) {
+            total += sketch->levels[h].count;
+            budget += quantile_level_capacity(sketch, h);
+        }
+        if (total <= budget) {
+            return 1;
+        }
+
+        int compacted = 0;
+        for (int h = 0; h < sketch->level_count; h++) {
+            if (sketch->levels[h].count >= quantile_level_capacity(sketch, h)) {
+                if (!quantile_compact_level(sketch, h)) {
+                    return 0;
+                }
+                compacted = 1;
+                break;
+            }
+        }
+        if (!compacted) {
+            return 1;
+        }
+    }
+}
+
+int quantile_sketch_add(QuantileSketch* sketch, float value) {
+    if (sketch == NULL || isnan(value)) {
+        return 0;
+    }
+
+    if (sketch->n == 0 || value < sketch->min_value) sketch->min_value = value;
+    if (sketch->n == 0 || value > sketch->max_value) sketch->max_value = value;
+    sketch->n++;
+
+    if (!quantile_level_push(&sketch->levels[0], value)) {
+        return 0;
+    }
+    if (sketch->levels[0].count >= quantile_level_capacity(sketch, 0)) {
+        return quantile_compress(sketch);
+    }
+    return 1;
+}
+
+int quantile_sketch_add_array(QuantileSketch* sketch, const float* values, int count) {
+    if (sketch == NULL || values == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!isnan(values[i]) && !quantile_sketch_add(sketch, values[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int quantile_sketch_merge(QuantileSketch* into, const QuantileSketch* from) {
+    if (into == NULL || from == NULL) {
+        printf("Error: Invalid arguments to quantile_sketch_merge\n");
+        return 0;
+    }
+    if (from->n == 0) {
+        return 1;
+    }
+
+    if (into->n == 0 || from->min_value < into->min_value) into->min_value = from->min_value;
+    if (into->n == 0 || from->max_value > into->max_value) into->max_value = from->max_value;
+    into->n += from->n;
+
+    if (from->level_count > into->level_count) {
+        into->level_count = from->level_count;
+    }
+    for (int h = 0; h < from->level_count; h++) {
+        const QuantileLevel* level = &from->levels[h];
+        for (int i = 0; i < level->count; i++) {
+            if (!quantile_level_push(&into->levels[h], level->items[i])) {
+                return 0;
+            }
+        }
+    }
+    return quantile_compress(into);
+}
+
+typedef struct {
+    float value;
+    long long weight;
+} QuantileWeighted;
+
+static int quantile_compare_weighted(const void* a, const void* b) {
+    float x = ((const QuantileWeighted*)a)->value;
+    float y = ((const QuantileWeighted*)b)->value;
+    return (x > y) - (x < y);
+}
+
+// Flatten the levels into value-sorted (value, weight) pairs
+static QuantileWeighted* quantile_collect(const QuantileSketch* sketch, int* count) {
+    int total = 0;
+    for (int h = 0; h < sketch->level_count; h++) {
+        total += sketch->levels[h].count;
+    }
+    QuantileWeighted* items = (QuantileWeighted*)malloc(sizeof(QuantileWeighted) * (total > 0 ? total : 1));
+    if (items == NULL) {
+        printf("Error: Failed to query quantile sketch\n");
+        return NULL;
+    }
+    int n = 0;
+    for (int h = 0; h < sketch->level_count; h++) {
+        for (int i = 0; i < sketch->levels[h].count; i++) {
+            items[n].value = sketch->levels[h].items[i];
+            items[n].weight = 1LL << h;
+            n++;
+        }
+    }
+    qsort(items, n, sizeof(QuantileWeighted), quantile_compare_weighted);
+    *count = n;
+    return items;
+}
+
+float quantile_sketch_query(const QuantileSketch* sketch, float q) {
+    if (sketch == NULL || sketch->n == 0) {
+        return 0.0f;
+    }
+    if (q <= 0.0f) return sketch->min_value;
+    if (q >= 1.0f) return sketch->max_value;
+
+    int count = 0;
+    QuantileWeighted* items = quantile_collect(sketch, &count);
+    if (items == NULL) {
+        return 0.0f;
+    }
+
+    long long total = 0;
+    for (int i = 0; i < count; i++) {
+        total += items[i].weight;
+    }
+    double target = q * (double)total;
+    float result = sketch->max_value;
+    long long seen = 0;
+    for (int i = 0; i < count; i++) {
+        seen += items[i].weight;
+        if ((double)seen >= target) {
+            result = items[i].value;
+            break;
+        }
+    }
+    free(items);
+    return result;
+}
+
+float quantile_sketch_rank(const QuantileSketch* sketch, float value) {
+    if (sketch == NULL || sketch->n == 0) {
+        return 0.0f;
+    }
+
+    long long below = 0;
+    long long total = 0;
+    for (int h = 0; h < sketch->level_count; h++) {
+        for (int i = 0; i < sketch->levels[h].count; i++) {
+            total += 1LL << h;
+            if (sketch->levels[h].items[i] <= value) below += 1LL << h;
+        }
+    }
+    return total > 0 ? (float)((double)below / total) : 0.0f;
+}
+
+long long quantile_sketch_count(const QuantileSketch* sketch) {
+    return sketch != NULL ? sketch->n : 0;
+}
+
+// ---- Exact selection (introselect) ----
+
+static void quantile_swap(float* a, float* b) {
+    float t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void quantile_sift_down(float* values, int start, int count) {
+    int root = start;
+    for (;;) {
+        int child = 2 * root + 1;
+        if (child >= count) return;
+        if (child + 1 < count && values[child + 1] > values[child]) child++;
+        if (values[root] >= values[child]) return;
+        quantile_swap(&values[root], &values[child]);
+        root = child;
+    }
+}
+
+// Fallback once quickselect has recursed too deep: heapsort the range
+static void quantile_heap_sort(float* values, int count) {
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        quantile_sift_down(values, i, count);
+    }
+    for (int end = count - 1; end > 0; end--) {
+        quantile_swap(&values[0], &values[end]);
+        quantile_sift_down(values, 0, end);
+    }
+}
+
+float quantile_select_nth(float* values, int count, int k) {
+    if (values == NULL || count <= 0) {
+        return 0.0f;
+    }
+    if (k < 0) k = 0;
+    if (k >= count) k = count - 1;
+
+    int lo = 0;
+    int hi = count - 1;
+    int depth_limit = 2;
+    for (int n = count; n > 1; n >>= 1) depth_limit += 2;
+
+    while (hi > lo) {
+        if (depth_limit-- == 0) {
+            quantile_heap_sort(values + lo, hi - lo + 1);
+            break;
+        }
+
+        // Median of three as pivot, moved to hi
+        int mid = lo + (hi - lo) / 2;
+        if (values[mid] < values[lo]) quantile_swap(&values[mid], &values[lo]);
+        if (values[hi] < values[lo]) quantile_swap(&values[hi], &values[lo]);
+        if (values[mid] < values[hi]) quantile_swap(&values[mid], &values[hi]);
+        float pivot = values[hi];
+
+        // Three-way partition: [lo, lt) < pivot, [lt, gt] == pivot, (gt, hi] > pivot
+        int lt = lo, i = lo, gt = hi;
+        while (i <= gt) {
+            if (values[i] < pivot) {
+                quantile_swap(&values[lt++], &values[i++]);
+            } else if (values[i] > pivot) {
+                quantile_swap(&values[i], &values[gt--]);
+            } else {
+                i++;
+            }
+        }
+
+        if (k < lt) {
+            hi = lt - 1;
+        } else if (k > gt) {
+            lo = gt + 1;
+        } else {
+            break;
+        }
+    }
+    return values[k];
+}
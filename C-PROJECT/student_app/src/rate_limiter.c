@@ -0,0 +1,209 @@
+#include "rate_limiter.h"
+#include <string.h>
+#include <time.h>
+#include <openssl/rand.h>
+
+static long long rate_limiter_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// ---- SipHash-2-4 ----
+
+#define RATE_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define RATE_SIPROUND(v0, v1, v2, v3) \
+    do { \
+        v0 += v1; v1 = RATE_ROTL(v1, 13); v1 ^= v0; v0 = RATE_ROTL(v0, 32); \
+        v2 += v3; v3 = RATE_ROTL(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = RATE_ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = RATE_ROTL(v1, 17); v1 ^= v2; v2 = RATE_ROTL(v2, 32); \
+    } while (0)
+
+static unsigned long long rate_limiter_siphash(const unsigned long long* k, const unsigned char* data, size_t size) {
+    unsigned long long v0 = k[0] ^ 0x736f6d6570736575ULL;
+    unsigned long long v1 = k[1] ^ 0x646f72616e646f6dULL;
+    unsigned long long v2 = k[0] ^ 0x6c7967656e657261ULL;
+    unsigned long long v3 = k[1] ^ 0x7465646279746573ULL;
+    size_t whole = size & ~(size_t)7;
+    for (size_t i = 0; i < whole; i += 8) {
+        unsigned long long m = 0;
+        for (int j = 7; j >= 0; j--) m = (m << 8) | data[i + (size_t)j];
+        v3 ^= m;
+        RATE_SIPROUND(v0, v1, v2, v3);
+        RATE_SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    unsigned long long last = (unsigned long long)(size & 0xff) << 56;
+    for (size_t j = size - whole; j > 0; j--) last |= (unsigned long long)data[whole + j - 1] << (8 * (j - 1));
+    v3 ^= last;
+    RATE_SIPROUND(v0, v1, v2, v3);
+    RATE_SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) RATE_SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef RATE_SIPROUND
+#undef RATE_ROTL
+
+static unsigned long long rate_limiter_hash(const RateLimiter* limiter, const char* key) {
+    unsigned long long h = rate_limiter_siphash(limiter->hash_key, (const unsigned char*)key, strlen(key));
+    return h != 0 ? h : 1;
+}
+
+// Tokens a bucket holds at `now`, refilled since its last attempt
+static unsigned int rate_bucket_level(const RateLimiter* limiter, const RateBucket* bucket, unsigned int now) {
+    unsigned long long elapsed = (unsigned int)(now - bucket->last);
+    unsigned long long tokens = bucket->tokens + elapsed * limiter->refill_per_second / 1000;
+    return tokens < limiter->capacity ? (unsigned int)tokens : limiter->capacity;
+}
+
+// Finds or makes the bucket for a key in its group; called with the
+// group's lock held. Replacement order: a free bucket, then one that has
+// refilled to capacity, then the one idle longest. A new key always
+// starts full, so keys an attacker floods the table with cannot throttle
+// the legitimate ones that arrive after them.
+static RateBucket* rate_limiter_bucket(RateLimiter* limiter, unsigned long long hash, unsigned int now) {
+    RateBucket* group = &limiter->buckets[(hash & (unsigned long long)(limiter->group_count - 1)) *
+                                          RATE_LIMITER_GROUP_SIZE];
+    RateBucket* victim = NULL;
+    int victim_rank = 0;                    // 3 free, 2 full, 1 refilling
+    unsigned int victim_idle = 0;
+    for (int i = 0; i < RATE_LIMITER_GROUP_SIZE; i++) {
+        RateBucket* bucket = &group[i];
+        if (bucket->key_hash == hash) {
+            return bucket;
+        }
+        int rank = bucket->key_hash == 0 ? 3 : rate_bucket_level(limiter, bucket, now) >= limiter->capacity ? 2 : 1;
+        unsigned int idle = now - bucket->last;
+        if (victim == NULL || rank > victim_rank || (rank == victim_rank && idle >= victim_idle)) {
+            victim = bucket;
+            victim_rank = rank;
+            victim_idle = idle;
+        }
+    }
+    if (victim_rank < 3) {
+        atomic_fetch_add(&limiter->evictions, 1);
+    }
+    victim->key_hash = hash;
+    victim->tokens = limiter->capacity;
+    victim->last = now;
+    return victim;
+}
+
+static pthread_mutex_t* rate_limiter_lock(RateLimiter* limiter, unsigned long long hash) {
+    return &limiter->locks[(hash & (unsigned long long)(limiter->group_count - 1)) % RATE_LIMITER_LOCKS];
+}
+
+RateLimiter* rate_limiter_create(int buckets, double capacity, double refill_per_second) {
+    if (buckets <= 0 || capacity < 1 || refill_per_second <= 0) {
+        printf("Error: Invalid rate limiter parameters\n");
+        return NULL;
+    }
+    RateLimiter* limiter = (RateLimiter*)calloc(1, sizeof(RateLimiter));
+    if (limiter == NULL) {
+        printf("Error: Failed to create rate limiter\n");
+        return NULL;
+    }
+    limiter->group_count = 1;
+    while (limiter->group_count * RATE_LIMITER_GROUP_SIZE < buckets) {
+        limiter->group_count *= 2;
+    }
+    // Aligned so a group is one cache line
+    size_t size = (size_t)limiter->group_count * RATE_LIMITER_GROUP_SIZE * sizeof(RateBucket);
+    if (posix_memalign((void**)&limiter->buckets, 64, size) != 0) {
+        printf("Error: Failed to allocate rate limiter table\n");
+        free(limiter);
+        return NULL;
+    }
+    memset(limiter->buckets, 0, size);
+    if (RAND_bytes((unsigned char*)limiter->hash_key, sizeof(limiter->hash_key)) != 1) {
+        printf("Error: Failed to seed rate limiter hash\n");
+        free(limiter->buckets);
+        free(limiter);
+        return NULL;
+    }
+    limiter->capacity = (unsigned int)(capacity * RATE_LIMITER_MILLI);
+    limiter->refill_per_second = (unsigned int)(refill_per_second * RATE_LIMITER_MILLI);
+    if (limiter->refill_per_second == 0) {
+        limiter->refill_per_second = 1;
+    }
+    limiter->clock = rate_limiter_monotonic_ms;
+    for (int i = 0; i < RATE_LIMITER_LOCKS; i++) {
+        pthread_mutex_init(&limiter->locks[i], NULL);
+    }
+    return limiter;
+}
+
+void rate_limiter_destroy(RateLimiter* limiter) {
+    if (limiter == NULL) {
+        return;
+    }
+    for (int i = 0; i < RATE_LIMITER_LOCKS; i++) {
+        pthread_mutex_destroy(&limiter->locks[i]);
+    }
+    free(limiter->buckets);
+    free(limiter);
+}
+
+int rate_limiter_allow(RateLimiter* limiter, const char* key) {
+    if (limiter == NULL || key == NULL) {
+        return 0;
+    }
+    unsigned long long hash = rate_limiter_hash(limiter, key);
+    pthread_mutex_t* lock = rate_limiter_lock(limiter, hash);
+    unsigned int now = (unsigned int)limiter->clock();
+    pthread_mutex_lock(lock);
+    RateBucket* bucket = rate_limiter_bucket(limiter, hash, now);
+    unsigned int tokens = rate_bucket_level(limiter, bucket, now);
+    int allowed = tokens >= RATE_LIMITER_MILLI;
+    bucket->tokens = allowed ? tokens - RATE_LIMITER_MILLI : tokens;
+    bucket->last = now;
+    pthread_mutex_unlock(lock);
+    atomic_fetch_add(allowed ? &limiter->allowed : &limiter->refused, 1);
+    return allowed;
+}
+
+double rate_limiter_available(RateLimiter* limiter, const char* key) {
+    if (limiter == NULL || key == NULL) {
+        return 0.0;
+    }
+    unsigned long long hash = rate_limiter_hash(limiter, key);
+    pthread_mutex_t* lock = rate_limiter_lock(limiter, hash);
+    unsigned int now = (unsigned int)limiter->clock();
+    pthread_mutex_lock(lock);
+    RateBucket* bucket = rate_limiter_bucket(limiter, hash, now);
+    unsigned int tokens = rate_bucket_level(limiter, bucket, now);
+    pthread_mutex_unlock(lock);
+    return (double)tokens / RATE_LIMITER_MILLI;
+}
+
+void rate_limiter_reset(RateLimiter* limiter, const char* key) {
+    if (limiter == NULL || key == NULL) {
+        return;
+    }
+    unsigned long long hash = rate_limiter_hash(limiter, key);
+    pthread_mutex_t* lock = rate_limiter_lock(limiter, hash);
+    unsigned int now = (unsigned int)limiter->clock();
+    pthread_mutex_lock(lock);
+    RateBucket* bucket = rate_limiter_bucket(limiter, hash, now);
+    bucket->tokens = limiter->capacity;
+    bucket->last = now;
+    pthread_mutex_unlock(lock);
+}
+
+void display_rate_limiter_stats(const RateLimiter* limiter, const char* name) {
+    if (limiter == NULL) {
+        return;
+    }
+    printf("\n=== RATE LIMITER%s%s ===\n", name != NULL ? ": " : "", name != NULL ? name : "");
+    printf("Buckets:          %d\n", limiter->group_count * RATE_LIMITER_GROUP_SIZE);
+    printf("Policy:           %.1f attempts, %.3f per second\n", (double)limiter->capacity / RATE_LIMITER_MILLI,
+           (double)limiter->refill_per_second / RATE_LIMITER_MILLI);
+    printf("Allowed:          %lld\n", (long long)limiter->allowed);
+    printf("Refused:          %lld\n", (long long)limiter->refused);
+    printf("Evictions:        %lld\n", (long long)limiter->evictions);
+}
@@ -0,0 +1,323 @@
+#include "segment_cache.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#define SEGMENT_CACHE_NONE -1
+
+static unsigned long long segment_cache_hash_path(const char* path) {
+    unsigned long long h = 1469598103934665603ULL;     // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Tag binding entries to the key that decrypted them; the key itself is
+// never stored
+static int segment_cache_key_tag(const SegmentCache* cache, const unsigned char* key, unsigned char* tag) {
+    unsigned char digest[CRYPTO_SHA256_SIZE];
+    if (!crypto_hmac_sha256(cache->key_secret, sizeof(cache->key_secret), key, AES_KEY_SIZE, digest)) {
+        return 0;
+    }
+    memcpy(tag, digest, SEGMENT_CACHE_KEY_TAG_SIZE);
+    secure_memory_clear(digest, sizeof(digest));
+    return 1;
+}
+
+static int segment_cache_bucket(const SegmentCache* cache, unsigned long long path_hash, long long segment) {
+    unsigned long long h = path_hash ^ ((unsigned long long)segment * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 29;
+    return (int)(h & (unsigned long long)(cache->bucket_count - 1));
+}
+
+static unsigned char* segment_cache_slot(const SegmentCache* cache, int slot) {
+    return cache->arena + (size_t)slot * (size_t)cache->slot_size;
+}
+
+// ---- LRU list ----
+
+static void segment_cache_unlink(SegmentCache* cache, int slot) {
+    SegmentCacheEntry* entry = &cache->entries[slot];
+    if (entry->prev != SEGMENT_CACHE_NONE) cache->entries[entry->prev].next = entry->next;
+    else cache->lru_head = entry->next;
+    if (entry->next != SEGMENT_CACHE_NONE) cache->entries[entry->next].prev = entry->prev;
+    else cache->lru_tail = entry->prev;
+    entry->prev = entry->next = SEGMENT_CACHE_NONE;
+}
+
+static void segment_cache_push_front(SegmentCache* cache, int slot) {
+    SegmentCacheEntry* entry = &cache->entries[slot];
+    entry->prev = SEGMENT_CACHE_NONE;
+    entry->next = cache->lru_head;
+    if (cache->lru_head != SEGMENT_CACHE_NONE) cache->entries[cache->lru_head].prev = slot;
+    cache->lru_head = slot;
+    if (cache->lru_tail == SEGMENT_CACHE_NONE) cache->lru_tail = slot;
+}
+
+// Wipes a used slot and returns it to the free list
+static void segment_cache_release(SegmentCache* cache, int slot) {
+    SegmentCacheEntry* entry = &cache->entries[slot];
+    int* link = &cache->buckets[segment_cache_bucket(cache, entry->path_hash, entry->segment)];
+    while (*link != slot) {
+        link = &cache->entries[*link].hash_next;
+    }
+    *link = entry->hash_next;
+    segment_cache_unlink(cache, slot);
+    secure_memory_clear(segment_cache_slot(cache, slot), (size_t)entry->length);
+    entry->length = -1;
+    entry->hash_next = SEGMENT_CACHE_NONE;
+    entry->next = cache->free_head;
+    cache->free_head = slot;
+}
+
+static int segment_cache_find(const SegmentCache* cache, unsigned long long path_hash,
+                              const unsigned char* generation, const unsigned char* key_tag, long long segment) {
+    int slot = cache->buckets[segment_cache_bucket(cache, path_hash, segment)];
+    while (slot != SEGMENT_CACHE_NONE) {
+        const SegmentCacheEntry* entry = &cache->entries[slot];
+        if (entry->path_hash == path_hash && entry->segment == segment &&
+            memcmp(entry->generation, generation, sizeof(entry->generation)) == 0 &&
+            CRYPTO_memcmp(entry->key_tag, key_tag, sizeof(entry->key_tag)) == 0) {
+            return slot;
+        }
+        slot = entry->hash_next;
+    }
+    return SEGMENT_CACHE_NONE;
+}
+
+static void segment_cache_drop_path(SegmentCache* cache, unsigned long long path_hash) {
+    for (int slot = 0; slot < cache->slot_count; slot++) {
+        if (cache->entries[slot].length >= 0 && cache->entries[slot].path_hash == path_hash) {
+            segment_cache_release(cache, slot);
+            cache->invalidations++;
+        }
+    }
+}
+
+// Records the generation seen for a path, dropping the entries of an
+// older one
+static void segment_cache_note_generation(SegmentCache* cache, unsigned long long path_hash,
+                                          const unsigned char* generation) {
+    for (int i = 0; i < SEGMENT_CACHE_MAX_FILES; i++) {
+        SegmentCacheFile* file = &cache->files[i];
+        if (file->in_use && file->path_hash == path_hash) {
+            if (memcmp(file->generation, generation, sizeof(file->generation)) != 0) {
+                segment_cache_drop_path(cache, path_hash);
+                memcpy(file->generation, generation, sizeof(file->generation));
+            }
+            return;
+        }
+    }
+    SegmentCacheFile* file = &cache->files[cache->next_file];
+    cache->next_file = (cache->next_file + 1) % SEGMENT_CACHE_MAX_FILES;
+    file->in_use = 1;
+    file->path_hash = path_hash;
+    memcpy(file->generation, generation, sizeof(file->generation));
+}
+
+static void segment_cache_insert(SegmentCache* cache, unsigned long long path_hash, const unsigned char* generation,
+                                 const unsigned char* key_tag, long long segment, const unsigned char* data,
+                                 int length) {
+    if (segment_cache_find(cache, path_hash, generation, key_tag, segment) != SEGMENT_CACHE_NONE) {
+        return;
+    }
+    if (cache->free_head == SEGMENT_CACHE_NONE) {
+        segment_cache_release(cache, cache->lru_tail);
+        cache->evictions++;
+    }
+    int slot = cache->free_head;
+    SegmentCacheEntry* entry = &cache->entries[slot];
+    cache->free_head = entry->next;
+    entry->path_hash = path_hash;
+    memcpy(entry->generation, generation, sizeof(entry->generation));
+    memcpy(entry->key_tag, key_tag, sizeof(entry->key_tag));
+    entry->segment = segment;
+    entry->length = length;
+    memcpy(segment_cache_slot(cache, slot), data, (size_t)length);
+    int bucket = segment_cache_bucket(cache, path_hash, segment);
+    entry->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = slot;
+    segment_cache_push_front(cache, slot);
+}
+
+// ---- Cache ----
+
+SegmentCache* segment_cache_create(int slot_count, int slot_size) {
+    if (slot_count <= 0) {
+        slot_count = SEGMENT_CACHE_DEFAULT_SLOTS;
+    }
+    if (slot_size <= 0) {
+        slot_size = CRYPTO_STREAM_DEFAULT_SEGMENT;
+    }
+    SegmentCache* cache = (SegmentCache*)calloc(1, sizeof(SegmentCache));
+    if (cache == NULL) {
+        printf("Error: Failed to create segment cache\n");
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->slot_count = slot_count;
+    cache->slot_size = slot_size;
+    cache->bucket_count = 16;
+    while (cache->bucket_count < slot_count * 2) {
+        cache->bucket_count *= 2;
+    }
+    cache->arena_size = (size_t)slot_count * (size_t)slot_size;
+    cache->arena = (unsigned char*)mmap(NULL, cache->arena_size, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    cache->entries = (SegmentCacheEntry*)malloc((size_t)slot_count * sizeof(SegmentCacheEntry));
+    cache->buckets = (int*)malloc((size_t)cache->bucket_count * sizeof(int));
+    if (cache->arena == MAP_FAILED || cache->entries == NULL || cache->buckets == NULL ||
+        RAND_bytes(cache->key_secret, sizeof(cache->key_secret)) != 1) {
+        if (cache->arena == MAP_FAILED) cache->arena = NULL;
+        printf("Error: Failed to allocate segment cache\n");
+        segment_cache_destroy(cache);
+        return NULL;
+    }
+
+    // Locking can fail under a low RLIMIT_MEMLOCK; the cache still works,
+    // only without the guarantee against swapping
+    cache->locked = mlock(cache->arena, cache->arena_size) == 0;
+    if (!cache->locked) {
+        printf("Warning: Segment cache memory could not be locked\n");
+    }
+#ifdef MADV_DONTDUMP
+    madvise(cache->arena, cache->arena_size, MADV_DONTDUMP);
+#endif
+
+    for (int i = 0; i < cache->bucket_count; i++) {
+        cache->buckets[i] = SEGMENT_CACHE_NONE;
+    }
+    for (int i = 0; i < slot_count; i++) {
+        cache->entries[i].length = -1;
+        cache->entries[i].prev = SEGMENT_CACHE_NONE;
+        cache->entries[i].hash_next = SEGMENT_CACHE_NONE;
+        cache->entries[i].next = i + 1 < slot_count ? i + 1 : SEGMENT_CACHE_NONE;
+    }
+    cache->free_head = 0;
+    cache->lru_head = cache->lru_tail = SEGMENT_CACHE_NONE;
+    return cache;
+}
+
+void segment_cache_destroy(SegmentCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    if (cache->arena != NULL) {
+        secure_memory_clear(cache->arena, cache->arena_size);
+        if (cache->locked) {
+            munlock(cache->arena, cache->arena_size);
+        }
+        munmap(cache->arena, cache->arena_size);
+    }
+    secure_memory_clear(cache->key_secret, sizeof(cache->key_secret));
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+long long segment_cache_pread(SegmentCache* cache, CryptoStreamReader* reader, const char* filename,
+                              void* out, size_t size, long long offset) {
+    if (cache == NULL || filename == NULL || reader == NULL || reader->segment_size > cache->slot_size) {
+        return crypto_stream_pread(reader, out, size, offset);
+    }
+    if ((out == NULL && size > 0) || offset < 0) {
+        return -1;
+    }
+
+    unsigned char key_tag[SEGMENT_CACHE_KEY_TAG_SIZE];
+    if (!segment_cache_key_tag(cache, reader->key, key_tag)) {
+        return crypto_stream_pread(reader, out, size, offset);
+    }
+    unsigned long long path_hash = segment_cache_hash_path(filename);
+    const unsigned char* generation = reader->header + CRYPTO_STREAM_HEADER_SIZE - 16;
+    pthread_mutex_lock(&cache->lock);
+    segment_cache_note_generation(cache, path_hash, generation);
+    pthread_mutex_unlock(&cache->lock);
+
+    unsigned char* p = (unsigned char*)out;
+    long long done = 0;
+    while ((size_t)done < size && offset + done < reader->plaintext_size) {
+        long long at = offset + done;
+        long long index = at / reader->segment_size;
+        int skip = (int)(at - index * reader->segment_size);
+        long long take = -1;
+
+        pthread_mutex_lock(&cache->lock);
+        int slot = segment_cache_find(cache, path_hash, generation, key_tag, index);
+        if (slot != SEGMENT_CACHE_NONE) {
+            SegmentCacheEntry* entry = &cache->entries[slot];
+            take = entry->length - skip;
+            if (take > (long long)size - done) take = (long long)size - done;
+            memcpy(p + done, segment_cache_slot(cache, slot) + skip, (size_t)take);
+            segment_cache_unlink(cache, slot);
+            segment_cache_push_front(cache, slot);
+            cache->hits++;
+        } else {
+            cache->misses++;
+        }
+        pthread_mutex_unlock(&cache->lock);
+
+        if (take < 0) {
+            // Decrypt outside the lock; the reader keeps the plaintext
+            if (index != reader->cached_segment && crypto_stream_read_segment(reader, index, reader->sealed) < 0) {
+                return -1;
+            }
+            pthread_mutex_lock(&cache->lock);
+            segment_cache_insert(cache, path_hash, generation, key_tag, index, reader->plain,
+                                 reader->cached_length);
+            pthread_mutex_unlock(&cache->lock);
+            take = reader->cached_length - skip;
+            if (take > (long long)size - done) take = (long long)size - done;
+            memcpy(p + done, reader->plain + skip, (size_t)take);
+        }
+        done += take;
+    }
+    return done;
+}
+
+void segment_cache_invalidate(SegmentCache* cache, const char* filename) {
+    if (cache == NULL || filename == NULL) {
+        return;
+    }
+    unsigned long long path_hash = segment_cache_hash_path(filename);
+    pthread_mutex_lock(&cache->lock);
+    segment_cache_drop_path(cache, path_hash);
+    for (int i = 0; i < SEGMENT_CACHE_MAX_FILES; i++) {
+        if (cache->files[i].in_use && cache->files[i].path_hash == path_hash) {
+            cache->files[i].in_use = 0;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void segment_cache_clear(SegmentCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    for (int slot = 0; slot < cache->slot_count; slot++) {
+        if (cache->entries[slot].length >= 0) {
+            segment_cache_release(cache, slot);
+        }
+    }
+    memset(cache->files, 0, sizeof(cache->files));
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void display_segment_cache_stats(const SegmentCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    long long lookups = cache->hits + cache->misses;
+    printf("\n=== SEGMENT CACHE ===\n");
+    printf("Capacity:         %d x %d KB (%s)\n", cache->slot_count, cache->slot_size / 1024,
+           cache->locked ? "locked" : "not locked");
+    printf("Lookups:          %lld, %.1f%% hits\n", lookups,
+           lookups > 0 ? 100.0 * (double)cache->hits / (double)lookups : 0.0);
+    printf("Evictions:        %lld\n", cache->evictions);
+    printf("Invalidations:    %lld\n", cache->invalidations);
+}
@@ -0,0 +1,519 @@
+#include "session_manager.h"
+#include "crypto.h"
+#include <string.h>
+#include <unistd.h>
+#include <openssl/rand.h>
+
+#define SESSION_WHEEL_MASK (SESSION_WHEEL_SLOTS - 1)
+
+static long long session_monotonic_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec;
+}
+
+static void session_token_to_hex(const unsigned char* token, char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 16; i++) {
+        hex[i * 2] = digits[token[i] >> 4];
+        hex[i * 2 + 1] = digits[token[i] & 15];
+    }
+    hex[32] = '\0';
+}
+
+static int session_token_from_hex(const char* hex, unsigned char* token) {
+    if (hex == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < 32; i++) {
+        char c = hex[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) {
+            return 0;
+        }
+        if (i % 2 == 0) token[i / 2] = (unsigned char)(v << 4);
+        else token[i / 2] |= (unsigned char)v;
+    }
+    return hex[32] == '\0';
+}
+
+// Tokens are uniformly random, so their bytes index directly
+static SessionStripe* session_stripe(SessionManager* manager, const unsigned char* token) {
+    return &manager->stripes[token[0] % SESSION_STRIPES];
+}
+
+static unsigned int session_bucket(const SessionStripe* stripe, const unsigned char* token) {
+    unsigned int h = (unsigned int)token[1] | (unsigned int)token[2] << 8 |
+                     (unsigned int)token[3] << 16 | (unsigned int)token[4] << 24;
+    return h & (unsigned int)(stripe->bucket_count - 1);
+}
+
+static long long session_deadline(const SessionManager* manager, const SessionEntry* entry) {
+    long long idle = entry->last_seen + manager->idle_timeout;
+    long long absolute = entry->created + manager->absolute_timeout;
+    return idle < absolute ? idle : absolute;
+}
+
+// ---- Timing wheel ----
+
+static void session_wheel_unlink(SessionStripe* stripe, SessionEntry* entry) {
+    if (entry->wheel_slot == NULL) {
+        return;
+    }
+    stripe->wheel_counts[entry->wheel_level]--;
+    if (entry->wheel_prev != NULL) entry->wheel_prev->wheel_next = entry->wheel_next;
+    else *entry->wheel_slot = entry->wheel_next;
+    if (entry->wheel_next != NULL) entry->wheel_next->wheel_prev = entry->wheel_prev;
+    entry->wheel_prev = entry->wheel_next = NULL;
+    entry->wheel_slot = NULL;
+}
+
+// Files an entry under `deadline`: level L holds deadlines less than
+// 64^(L+1) ticks ahead, in the slot given by the deadline's L-th digit.
+// Deadlines beyond the top level are filed at its far end and re-filed
+// when they come round.
+static void session_wheel_file(SessionStripe* stripe, SessionEntry* entry, long long deadline) {
+    if (deadline < stripe->wheel_now) {
+        deadline = stripe->wheel_now + 1;
+    }
+    long long delta = deadline - stripe->wheel_now;
+    int level = 0;
+    while (level < SESSION_WHEEL_LEVELS - 1 && delta >= (1LL << (SESSION_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    long long top = 1LL << (SESSION_WHEEL_BITS * SESSION_WHEEL_LEVELS);
+    if (delta >= top) {
+        deadline = stripe->wheel_now + top - 1;
+    }
+    int slot = (int)((deadline >> (SESSION_WHEEL_BITS * level)) & SESSION_WHEEL_MASK);
+    SessionEntry** head = &stripe->wheel[level][slot];
+    entry->wheel_deadline = deadline;
+    entry->wheel_slot = head;
+    entry->wheel_level = level;
+    stripe->wheel_counts[level]++;
+    entry->wheel_prev = NULL;
+    entry->wheel_next = *head;
+    if (*head != NULL) (*head)->wheel_prev = entry;
+    *head = entry;
+}
+
+static void session_table_unlink(SessionStripe* stripe, SessionEntry* entry) {
+    SessionEntry** link = &stripe->buckets[session_bucket(stripe, entry->token)];
+    while (*link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    *link = entry->bucket_next;
+    stripe->count--;
+}
+
+static void session_entry_free(SessionStripe* stripe, SessionEntry* entry) {
+    session_wheel_unlink(stripe, entry);
+    session_table_unlink(stripe, entry);
+    secure_memory_clear(entry, sizeof(SessionEntry));
+    free(entry);
+}
+
+// Moves a higher-level slot's entries down to where they now belong
+static void session_wheel_cascade(SessionStripe* stripe, int level, int slot) {
+    SessionEntry* entry = stripe->wheel[level][slot];
+    while (entry != NULL) {
+        SessionEntry* next = entry->wheel_next;
+        session_wheel_unlink(stripe, entry);
+        session_wheel_file(stripe, entry, entry->wheel_deadline);
+        entry = next;
+    }
+}
+
+static int session_wheel_tick(SessionManager* manager, SessionStripe* stripe) {
+    long long now = ++stripe->wheel_now;
+    for (int level = 1; level < SESSION_WHEEL_LEVELS; level++) {
+        if ((now & ((1LL << (SESSION_WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        session_wheel_cascade(stripe, level, (int)((now >> (SESSION_WHEEL_BITS * level)) & SESSION_WHEEL_MASK));
+    }
+
+    int expired = 0;
+    SessionEntry* entry = stripe->wheel[0][now & SESSION_WHEEL_MASK];
+    while (entry != NULL) {
+        SessionEntry* next = entry->wheel_next;
+        session_wheel_unlink(stripe, entry);
+        long long deadline = session_deadline(manager, entry);
+        if (deadline <= now) {
+            session_entry_free(stripe, entry);
+            stripe->expired++;
+            expired++;
+        } else {
+            // Touched since it was filed
+            session_wheel_file(stripe, entry, deadline);
+        }
+        entry = next;
+    }
+    return expired;
+}
+
+// Advances a stripe's wheel towards `now`, by at most `budget` ticks
+static int session_wheel_advance(SessionManager* manager, SessionStripe* stripe, long long now, long long budget) {
+    if (stripe->count == 0) {
+        if (now > stripe->wheel_now) stripe->wheel_now = now;
+        return 0;
+    }
+    int expired = 0;
+    while (stripe->wheel_now < now && budget-- > 0) {
+        // With levels below `empty` empty, nothing happens until the
+        // next tick that cascades level `empty`
+        int empty = 0;
+        while (empty < SESSION_WHEEL_LEVELS && stripe->wheel_counts[empty] == 0) {
+            empty++;
+        }
+        if (empty > 0) {
+            long long skip_to = empty == SESSION_WHEEL_LEVELS
+                ? now
+                : stripe->wheel_now | ((1LL << (SESSION_WHEEL_BITS * empty)) - 1);
+            if (skip_to >= now) {
+                stripe->wheel_now = now;
+                break;
+            }
+            stripe->wheel_now = skip_to;
+        }
+        expired += session_wheel_tick(manager, stripe);
+    }
+    return expired;
+}
+
+// ---- Table ----
+
+static SessionEntry* session_find(SessionStripe* stripe, const unsigned char* token) {
+    for (SessionEntry* entry = stripe->buckets[session_bucket(stripe, token)]; entry != NULL;
+         entry = entry->bucket_next) {
+        if (memcmp(entry->token, token, sizeof(entry->token)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static int session_stripe_grow(SessionStripe* stripe) {
+    int bucket_count = stripe->bucket_count * 2;
+    SessionEntry** buckets = (SessionEntry**)calloc((size_t)bucket_count, sizeof(SessionEntry*));
+    if (buckets == NULL) {
+        return 0;
+    }
+    SessionEntry** old = stripe->buckets;
+    int old_count = stripe->bucket_count;
+    stripe->buckets = buckets;
+    stripe->bucket_count = bucket_count;
+    for (int i = 0; i < old_count; i++) {
+        SessionEntry* entry = old[i];
+        while (entry != NULL) {
+            SessionEntry* next = entry->bucket_next;
+            unsigned int bucket = session_bucket(stripe, entry->token);
+            entry->bucket_next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    free(old);
+    return 1;
+}
+
+// Looks a token up under the stripe lock, expiring it if it is past its
+// deadline. Returns the live entry or NULL.
+static SessionEntry* session_lookup_locked(SessionManager* manager, SessionStripe* stripe,
+                                           const unsigned char* token, long long now) {
+    session_wheel_advance(manager, stripe, now, SESSION_SWEEP_BUDGET);
+    SessionEntry* entry = session_find(stripe, token);
+    if (entry != NULL && session_deadline(manager, entry) <= now) {
+        session_entry_free(stripe, entry);
+        stripe->expired++;
+        entry = NULL;
+    }
+    return entry;
+}
+
+// ---- Manager ----
+
+SessionManager* session_manager_create(int idle_timeout, int absolute_timeout) {
+    SessionManager* manager = (SessionManager*)calloc(1, sizeof(SessionManager));
+    if (manager == NULL) {
+        printf("Error: Failed to create session manager\n");
+        return NULL;
+    }
+    manager->idle_timeout = idle_timeout > 0 ? idle_timeout : SESSION_DEFAULT_IDLE_TIMEOUT;
+    manager->absolute_timeout = absolute_timeout > 0 ? absolute_timeout : SESSION_DEFAULT_ABSOLUTE_TIMEOUT;
+    manager->clock = session_monotonic_clock;
+    long long now = manager->clock();
+    for (int i = 0; i < SESSION_STRIPES; i++) {
+        SessionStripe* stripe = &manager->stripes[i];
+        pthread_mutex_init(&stripe->lock, NULL);
+        stripe->bucket_count = SESSION_STRIPE_MIN_BUCKETS;
+        stripe->buckets = (SessionEntry**)calloc(SESSION_STRIPE_MIN_BUCKETS, sizeof(SessionEntry*));
+        stripe->wheel_now = now;
+        if (stripe->buckets == NULL) {
+            printf("Error: Failed to allocate session table\n");
+            session_manager_destroy(manager);
+            return NULL;
+        }
+    }
+    return manager;
+}
+
+void session_manager_destroy(SessionManager* manager) {
+    if (manager == NULL) {
+        return;
+    }
+    for (int i = 0; i < SESSION_STRIPES; i++) {
+        SessionStripe* stripe = &manager->stripes[i];
+        for (int b = 0; stripe->buckets != NULL && b < stripe->bucket_count; b++) {
+            SessionEntry* entry = stripe->buckets[b];
+            while (entry != NULL) {
+                SessionEntry* next = entry->bucket_next;
+                secure_memory_clear(entry, sizeof(SessionEntry));
+                free(entry);
+                entry = next;
+            }
+        }
+        free(stripe->buckets);
+        pthread_mutex_destroy(&stripe->lock);
+    }
+    free(manager);
+}
+
+int session_manager_open(SessionManager* manager, const User* user, Session* session) {
+    if (manager == NULL || user == NULL || session == NULL) {
+        printf("Error: Invalid arguments to session_manager_open\n");
+        return 0;
+    }
+    SessionEntry* entry = (SessionEntry*)calloc(1, sizeof(SessionEntry));
+    if (entry == NULL) {
+        printf("Error: Failed to allocate session\n");
+        return 0;
+    }
+    if (RAND_bytes(entry->token, sizeof(entry->token)) != 1) {
+        printf("Error: Failed to generate session token\n");
+        free(entry);
+        return 0;
+    }
+    entry->session.user_id = user->id;
+    snprintf(entry->session.username, sizeof(entry->session.username), "%s", user->username);
+    entry->session.role = user->role;
+    entry->session.login_time = time(NULL);
+    entry->session.is_valid = 1;
+    session_token_to_hex(entry->token, entry->session.token);
+
+    SessionStripe* stripe = session_stripe(manager, entry->token);
+    pthread_mutex_lock(&stripe->lock);
+    long long now = manager->clock();
+    session_wheel_advance(manager, stripe, now, SESSION_SWEEP_BUDGET);
+    entry->created = entry->last_seen = now;
+    if (stripe->count >= stripe->bucket_count) {
+        session_stripe_grow(stripe);        // A failed grow only lengthens chains
+    }
+    unsigned int bucket = session_bucket(stripe, entry->token);
+    entry->bucket_next = stripe->buckets[bucket];
+    stripe->buckets[bucket] = entry;
+    stripe->count++;
+    session_wheel_file(stripe, entry, session_deadline(manager, entry));
+    *session = entry->session;
+    pthread_mutex_unlock(&stripe->lock);
+    return 1;
+}
+
+int session_manager_validate(SessionManager* manager, const char* token, Session* session) {
+    unsigned char raw[16];
+    if (manager == NULL || !session_token_from_hex(token, raw)) {
+        return 0;
+    }
+    SessionStripe* stripe = session_stripe(manager, raw);
+    pthread_mutex_lock(&stripe->lock);
+    SessionEntry* entry = session_lookup_locked(manager, stripe, raw, manager->clock());
+    if (entry != NULL && session != NULL) {
+        *session = entry->session;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return entry != NULL;
+}
+
+int session_manager_touch(SessionManager* manager, const char* token) {
+    unsigned char raw[16];
+    if (manager == NULL || !session_token_from_hex(token, raw)) {
+        return 0;
+    }
+    SessionStripe* stripe = session_stripe(manager, raw);
+    pthread_mutex_lock(&stripe->lock);
+    long long now = manager->clock();
+    SessionEntry* entry = session_lookup_locked(manager, stripe, raw, now);
+    if (entry != NULL) {
+        entry->last_seen = now;             // The wheel catches up lazily
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return entry != NULL;
+}
+
+int session_manager_revoke(SessionManager* manager, const char* token) {
+    unsigned char raw[16];
+    if (manager == NULL || !session_token_from_hex(token, raw)) {
+        return 0;
+    }
+    SessionStripe* stripe = session_stripe(manager, raw);
+    pthread_mutex_lock(&stripe->lock);
+    SessionEntry* entry = session_find(stripe, raw);
+    if (entry != NULL) {
+        session_entry_free(stripe, entry);
+        stripe->revoked++;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return entry != NULL;
+}
+
+int session_manager_revoke_user(SessionManager* manager, int user_id) {
+    if (manager == NULL) {
+        return 0;
+    }
+    int revoked = 0;
+    for (int i = 0; i < SESSION_STRIPES; i++) {
+        SessionStripe* stripe = &manager->stripes[i];
+        pthread_mutex_lock(&stripe->lock);
+        for (int b = 0; b < stripe->bucket_count; b++) {
+            SessionEntry* entry = stripe->buckets[b];
+            while (entry != NULL) {
+                SessionEntry* next = entry->bucket_next;
+                if (entry->session.user_id == user_id) {
+                    session_entry_free(stripe, entry);
+                    stripe->revoked++;
+                    revoked++;
+                }
+                entry = next;
+            }
+        }
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return revoked;
+}
+
+int session_manager_sweep(SessionManager* manager) {
+    if (manager == NULL) {
+        return 0;
+    }
+    int expired = 0;
+    long long now = manager->clock();
+    for (int i = 0; i < SESSION_STRIPES; i++) {
+        SessionStripe* stripe = &manager->stripes[i];
+        pthread_mutex_lock(&stripe->lock);
+        expired += session_wheel_advance(manager, stripe, now, now - stripe->wheel_now);
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return expired;
+}
+
+int session_manager_count(SessionManager* manager) {
+    if (manager == NULL) {
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < SESSION_STRIPES; i++) {
+        pthread_mutex_lock(&manager->stripes[i].lock);
+        count += manager->stripes[i].count;
+        pthread_mutex_unlock(&manager->stripes[i].lock);
+    }
+    return count;
+}
+
+// ---- Benchmark ----
+
+typedef struct {
+    SessionManager* manager;
+    char (*tokens)[SESSION_TOKEN_SIZE];
+    int token_count;
+    int operations;
+    unsigned int seed;
+    int valid;
+} SessionBenchmarkWorker;
+
+static void* session_benchmark_worker(void* arg) {
+    SessionBenchmarkWorker* worker = (SessionBenchmarkWorker*)arg;
+    unsigned int x = worker->seed;
+    for (int i = 0; i < worker->operations; i++) {
+        x = x * 1103515245u + 12345u;
+        const char* token = worker->tokens[(x >> 8) % (unsigned int)worker->token_count];
+        // Mostly reads, as with page loads that check a session
+        worker->valid += (x & 15) == 0 ? session_manager_touch(worker->manager, token)
+                                       : session_manager_validate(worker->manager, token, NULL);
+    }
+    return NULL;
+}
+
+void session_manager_benchmark(int sessions, int operations, int threads) {
+    if (sessions <= 0) {
+        sessions = 10000;
+    }
+    if (operations <= 0) {
+        operations = 1000000;
+    }
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > 64) {
+        threads = 64;
+    }
+    SessionManager* manager = session_manager_create(0, 0);
+    char (*tokens)[SESSION_TOKEN_SIZE] = calloc((size_t)sessions, SESSION_TOKEN_SIZE);
+    if (manager == NULL || tokens == NULL) {
+        session_manager_destroy(manager);
+        free(tokens);
+        return;
+    }
+
+    User user;
+    memset(&user, 0, sizeof(user));
+    user.role = ROLE_STUDENT;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < sessions; i++) {
+        Session session;
+        user.id = i + 1;
+        snprintf(user.username, sizeof(user.username), "student%06d", i);
+        if (session_manager_open(manager, &user, &session)) {
+            memcpy(tokens[i], session.token, SESSION_TOKEN_SIZE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("\n=== SESSION MANAGER BENCHMARK (%d sessions) ===\n", sessions);
+    printf("Open:              %8.3f s (%.2f M/s)\n", seconds, sessions / seconds / 1e6);
+
+    SessionBenchmarkWorker workers[64];
+    pthread_t ids[64];
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (SessionBenchmarkWorker){ manager, tokens, sessions, operations / threads, 2463534242u + (unsigned int)i, 0 };
+        if (pthread_create(&ids[i], NULL, session_benchmark_worker, &workers[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    int valid = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+        valid += workers[i].valid;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    int done = started * (operations / threads);
+    printf("Validate/touch:    %8.3f s (%.2f M/s on %d thread(s), %d valid)\n", seconds, done / seconds / 1e6,
+           started, valid);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int revoked = 0;
+    for (int i = 0; i < sessions; i++) {
+        revoked += session_manager_revoke(manager, tokens[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("Revoke:            %8.3f s (%d revoked, %d left)\n", seconds, revoked, session_manager_count(manager));
+
+    session_manager_destroy(manager);
+    free(tokens);
+}
@@ -0,0 +1,902 @@
+#include "stats.h"
+#include "config.h"
+#include "calendar.h"
+#include "student.h"
+#include "grade.h"
+#include "attendance.h"
+#include "club.h"
+#include "counter_map.h"
+#include "topk.h"
+#include "moments.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Keep the best `capacity` ids ordered by key (highest first, or lowest first).
+// Ties go to the lower id so rankings do not depend on list order.
+void stats_rank_insert(int* ids, float* keys, int* filled, int capacity,
+                       int id, float key, int highest_first) {
+    int pos = *filled;
+    if (pos == capacity) {
+        if (!stats_rank_better(key, id, keys[capacity - 1], ids[capacity - 1], highest_first)) {
+            return;
+        }
+        pos = capacity - 1;
+    } else {
+        (*filled)++;
+    }
+    while (pos > 0 && stats_rank_better(key, id, keys[pos - 1], ids[pos - 1], highest_first)) {
+        ids[pos] = ids[pos - 1];
+        keys[pos] = keys[pos - 1];
+        pos--;
+    }
+    ids[pos] = id;
+    keys[pos] = key;
+}
+
+int stats_rank_better(float key, int id, float other_key, int other_id, int highest_first) {
+    if (key != other_key) {
+        return highest_first ? key > other_key : key < other_key;
+    }
+    return id < other_id;
+}
+
+// Ranked candidate for the top-k helpers: `index` points back into the source list
+typedef struct {
+    int id;
+    int index;
+    float key;
+} StatsRankItem;
+
+static int stats_rank_compare(const StatsRankItem* x, const StatsRankItem* y, int highest_first) {
+    if (stats_rank_better(x->key, x->id, y->key, y->id, highest_first)) return 1;
+    if (stats_rank_better(y->key, y->id, x->key, x->id, highest_first)) return -1;
+    return 0;
+}
+
+static int stats_rank_compare_highest(const void* a, const void* b) {
+    return stats_rank_compare((const StatsRankItem*)a, (const StatsRankItem*)b, 1);
+}
+
+static int stats_rank_compare_lowest(const void* a, const void* b) {
+    return stats_rank_compare((const StatsRankItem*)a, (const StatsRankItem*)b, 0);
+}
+
+static int stats_project_active_student(const void* element, void* item, void* user_data) {
+    const Student* s = (const Student*)element;
+    const Student* base = (const Student*)user_data;
+    if (!s->is_active) return 0;
+    StatsRankItem* rank = (StatsRankItem*)item;
+    rank->id = s->id;
+    rank->index = (int)(s - base);
+    rank->key = s->gpa;
+    return 1;
+}
+
+static int stats_thread_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (cpus > TOPK_MAX_THREADS) cpus = TOPK_MAX_THREADS;
+    return (int)cpus;
+}
+
+// Select the `count` best active students by GPA into items; returns how many were found
+static int stats_select_students(StudentList* students, StatsRankItem* items, int count, int highest_first) {
+    return topk_select(students->students, students->count, sizeof(Student),
+                       stats_project_active_student, students->students,
+                       count, sizeof(StatsRankItem),
+                       highest_first ? stats_rank_compare_highest : stats_rank_compare_lowest,
+                       items, stats_thread_count());
+}
+
+void calculate_student_rankings(StudentList* students, int* top_ids, int* bottom_ids, int count) {
+    StatsRankItem items[TOP_PERFORMERS_COUNT];
+
+    if (count > TOP_PERFORMERS_COUNT) count = TOP_PERFORMERS_COUNT;
+    memset(top_ids, 0, sizeof(int) * count);
+    memset(bottom_ids, 0, sizeof(int) * count);
+    if (students == NULL || students->students == NULL || count <= 0) {
+        return;
+    }
+
+    int found = stats_select_students(students, items, count, 1);
+    for (int i = 0; i < found; i++) top_ids[i] = items[i].id;
+    found = stats_select_students(students, items, count, 0);
+    for (int i = 0; i < found; i++) bottom_ids[i] = items[i].id;
+}
+
+int stats_age_bucket(int age) {
+    int bucket = (age - STATS_AGE_BUCKET_START) / STATS_AGE_BUCKET_WIDTH;
+    if (bucket < 0) bucket = 0;
+    if (bucket > 9) bucket = 9;
+    return bucket;
+}
+
+int stats_gpa_bucket(float gpa) {
+    if (gpa >= EXCELLENT_GPA_THRESHOLD) return 4;
+    if (gpa >= GOOD_GPA_THRESHOLD) return 3;
+    if (gpa >= AVERAGE_GPA_THRESHOLD) return 2;
+    if (gpa >= POOR_GPA_THRESHOLD) return 1;
+    return 0;
+}
+
+int stats_category_index(const char* category) {
+    static const char* categories[] = {
+        CLUB_CATEGORY_ACADEMIC, CLUB_CATEGORY_SPORTS, CLUB_CATEGORY_ARTS,
+        CLUB_CATEGORY_SERVICE, CLUB_CATEGORY_CULTURAL, CLUB_CATEGORY_TECHNOLOGY,
+        CLUB_CATEGORY_SOCIAL, CLUB_CATEGORY_RELIGIOUS
+    };
+    for (int i = 0; i < (int)(sizeof(categories) / sizeof(categories[0])); i++) {
+        if (strcmp(category, categories[i]) == 0) {
+            return i;
+        }
+    }
+    return STATS_CATEGORY_OTHER;
+}
+
+// ---- Fused sweeps: each one reads its list exactly once ----
+
+static void stats_sweep_students(StudentList* students, StudentStats* out, SystemStats* sys) {
+    memset(out, 0, sizeof(StudentStats));
+    if (students == NULL || students->students == NULL) {
+        return;
+    }
+
+    NameCountList courses = {0};
+    TopK* top = topk_create(10, sizeof(StatsRankItem), stats_rank_compare_highest);
+    TopK* bottom = topk_create(10, sizeof(StatsRankItem), stats_rank_compare_lowest);
+    double age_sum = 0.0, gpa_sum = 0.0;
+
+    for (int i = 0; i < students->count; i++) {
+        Student* s = &students->students[i];
+
+        out->total_students++;
+        if (s->is_active) {
+            sys->active_students++;
+        } else {
+            sys->inactive_students++;
+        }
+
+        if (s->year >= 1 && s->year <= 4) {
+            out->students_by_year[s->year]++;
+        }
+        name_count_add(&courses, s->course, 1);
+
+        age_sum += s->age;
+        out->age_distribution[stats_age_bucket(s->age)]++;
+        gpa_sum += s->gpa;
+        out->gpa_distribution[stats_gpa_bucket(s->gpa)] += 1.0f;
+
+        if (s->is_active) {
+            StatsRankItem item = { s->id, i, s->gpa };
+            topk_offer(top, &item);
+            topk_offer(bottom, &item);
+        }
+    }
+
+    StatsRankItem ranked[10];
+    int found = topk_finish(top, ranked);
+    for (int i = 0; i < found; i++) out->top_performers[i] = ranked[i].id;
+    found = topk_finish(bottom, ranked);
+    for (int i = 0; i < found; i++) out->struggling_students[i] = ranked[i].id;
+    topk_destroy(top);
+    topk_destroy(bottom);
+
+    if (out->total_students > 0) {
+        out->average_age = (float)(age_sum / out->total_students);
+        out->average_gpa = (float)(gpa_sum / out->total_students);
+    }
+    // students_by_course holds the 20 largest course enrollments, descending
+    name_count_top(&courses, out->students_by_course, 20);
+    name_count_free(&courses);
+    sys->total_students = out->total_students;
+}
+
+static void stats_sweep_grades(GradeList* grades, CourseList* courses, GradeStats* out, SystemStats* sys) {
+    memset(out, 0, sizeof(GradeStats));
+    if (grades == NULL || grades->grades == NULL) {
+        return;
+    }
+
+    CounterMap by_student = {0};
+    CounterMap by_course = {0};
+    double points_sum = 0.0;
+
+    for (int i = 0; i < grades->count; i++) {
+        Grade* g = &grades->grades[i];
+        float points = (float)g->grade_level;
+
+        out->total_grades++;
+        if (g->grade_level >= GRADE_F && g->grade_level <= GRADE_A) {
+            out->grades_by_level[GRADE_A - g->grade_level]++;
+        }
+        if (g->grade_level != GRADE_F) {
+            out->passing_grades++;
+        } else {
+            out->failing_grades++;
+        }
+        points_sum += points;
+
+        Counter* student = counter_map_get(&by_student, g->student_id);
+        if (student != NULL) {
+            student->count++;
+            student->sum += points;
+        }
+        Counter* course = counter_map_get(&by_course, g->course_id);
+        if (course != NULL) {
+            course->count++;
+            course->sum += g->numeric_grade;
+        }
+    }
+
+    if (out->total_grades > 0) {
+        out->average_gpa = (float)(points_sum / out->total_grades);
+        out->pass_rate = (float)out->passing_grades / out->total_grades;
+    }
+
+    // Student GPA extremes from the per-student averages
+    out->lowest_gpa = by_student.size > 0 ? 4.0f : 0.0f;
+    for (int i = 0; i < by_student.capacity; i++) {
+        Counter* c = &by_student.slots[i];
+        if (c->key == COUNTER_MAP_EMPTY_KEY || c->count == 0) continue;
+        float gpa = (float)(c->sum / c->count);
+        if (gpa > out->highest_gpa) out->highest_gpa = gpa;
+        if (gpa < out->lowest_gpa) out->lowest_gpa = gpa;
+    }
+
+    out->courses_with_grades = by_course.size;
+    if (courses != NULL && courses->courses != NULL) {
+        for (int i = 0; i < courses->count && i < 20; i++) {
+            Counter* c = counter_map_find(&by_course, courses->courses[i].id);
+            if (c != NULL && c->count > 0) {
+                out->course_averages[i] = (float)(c->sum / c->count);
+            }
+        }
+    }
+
+    counter_map_free(&by_student);
+    counter_map_free(&by_course);
+    sys->total_grades = out->total_grades;
+}
+
+static void stats_sweep_attendance(AttendanceList* attendance, AttendanceStats* out, SystemStats* sys) {
+    memset(out, 0, sizeof(AttendanceStats));
+    if (attendance == NULL || attendance->records == NULL) {
+        return;
+    }
+
+    CounterMap by_student = {0};
+    CounterMap by_day = {0};
+    int month_total[12] = {0};
+    int month_attended[12] = {0};
+
+    for (int i = 0; i < attendance->count; i++) {
+        AttendanceRecord* r = &attendance->records[i];
+        int attended = r->status == ATTENDANCE_PRESENT || r->status == ATTENDANCE_LATE;
+
+        out->total_records++;
+        switch (r->status) {
+            case ATTENDANCE_PRESENT: out->present_count++; break;
+            case ATTENDANCE_ABSENT: out->absent_count++; break;
+            case ATTENDANCE_LATE: out->late_count++; break;
+            case ATTENDANCE_EXCUSED: out->excused_count++; break;
+            default: break;
+        }
+        if (r->status == ATTENDANCE_EXCUSED) {
+            // Excused days count neither for nor against a student
+            continue;
+        }
+
+        long day_number = calendar_day_number(r->date);
+        int month;
+        calendar_civil_from_days(day_number, NULL, &month, NULL);
+        month_total[month - 1]++;
+        month_attended[month - 1] += attended;
+
+        Counter* day = counter_map_get(&by_day, (int)day_number);
+        if (day != NULL) {
+            day->count++;
+            day->hits += attended;
+        }
+        Counter* student = counter_map_get(&by_student, r->student_id);
+        if (student != NULL) {
+            student->count++;
+            student->hits += attended;
+        }
+    }
+
+    int counted = out->total_records - out->excused_count;
+    if (counted > 0) {
+        out->overall_attendance_rate = (float)(out->present_count + out->late_count) / counted;
+    }
+    if (by_day.size > 0) {
+        out->average_daily_attendance = (float)(out->present_count + out->late_count) / by_day.size;
+    }
+    for (int m = 0; m < 12; m++) {
+        if (month_total[m] > 0) {
+            out->attendance_by_month[m] = (float)month_attended[m] / month_total[m];
+        }
+    }
+    for (int i = 0; i < by_student.capacity; i++) {
+        Counter* c = &by_student.slots[i];
+        if (c->key == COUNTER_MAP_EMPTY_KEY || c->count == 0) continue;
+        if (c->hits == c->count) {
+            out->students_with_perfect_attendance++;
+        } else if ((float)c->hits / c->count < POOR_ATTENDANCE_THRESHOLD) {
+            out->students_with_poor_attendance++;
+        }
+    }
+
+    counter_map_free(&by_student);
+    counter_map_free(&by_day);
+    sys->total_attendance_records = out->total_records;
+}
+
+static void stats_sweep_clubs(ClubList* clubs, MembershipList* memberships, ClubStats* out, SystemStats* sys) {
+    memset(out, 0, sizeof(ClubStats));
+
+    CounterMap by_club = {0};
+    CounterMap by_student = {0};
+
+    if (memberships != NULL && memberships->memberships != NULL) {
+        for (int i = 0; i < memberships->count; i++) {
+            ClubMembership* m = &memberships->memberships[i];
+            out->total_memberships++;
+            if (!m->is_active) continue;
+
+            out->active_memberships++;
+            Counter* club = counter_map_get(&by_club, m->club_id);
+            if (club != NULL) club->count++;
+            Counter* student = counter_map_get(&by_student, m->student_id);
+            if (student != NULL && ++student->count == 2) {
+                out->students_in_multiple_clubs++;
+            }
+        }
+    }
+
+    if (clubs != NULL && clubs->clubs != NULL) {
+        int most = -1, least = INT_MAX;
+        for (int i = 0; i < clubs->count; i++) {
+            Club* c = &clubs->clubs[i];
+            out->total_clubs++;
+            if (c->is_active) out->active_clubs++;
+            out->clubs_by_category[stats_category_index(c->category)]++;
+
+            Counter* counter = counter_map_find(&by_club, c->id);
+            int members = counter != NULL ? counter->count : 0;
+            if (members > most) {
+                most = members;
+                out->most_popular_club_id = c->id;
+            }
+            if (members < least) {
+                least = members;
+                out->least_popular_club_id = c->id;
+            }
+        }
+        if (out->total_clubs > 0) {
+            out->average_members_per_club = (float)out->active_memberships / out->total_clubs;
+        }
+    }
+
+    counter_map_free(&by_club);
+    counter_map_free(&by_student);
+    sys->total_clubs = out->total_clubs;
+    sys->total_memberships = out->total_memberships;
+}
+
+// ---- Parallel driver ----
+
+typedef struct {
+    StudentList* students;
+    CourseList* courses;
+    GradeList* grades;
+    AttendanceList* attendance;
+    ClubList* clubs;
+    MembershipList* memberships;
+    StatsBundle* bundle;
+    SystemStats partial[4];   // One partial SystemStats per task, merged at the end
+} StatsJob;
+
+typedef struct {
+    StatsJob* job;
+    int task;
+} StatsTask;
+
+static void* stats_run_task(void* arg) {
+    StatsTask* task = (StatsTask*)arg;
+    StatsJob* job = task->job;
+    SystemStats* partial = &job->partial[task->task];
+
+    switch (task->task) {
+        case 0: stats_sweep_students(job->students, &job->bundle->students, partial); break;
+        case 1: stats_sweep_grades(job->grades, job->courses, &job->bundle->grades, partial); break;
+        case 2: stats_sweep_attendance(job->attendance, &job->bundle->attendance, partial); break;
+        case 3: stats_sweep_clubs(job->clubs, job->memberships, &job->bundle->clubs, partial); break;
+        default: break;
+    }
+    return NULL;
+}
+
+StatsBundle* calculate_all_stats(StudentList* students, CourseList* courses,
+                                 GradeList* grades, AttendanceList* attendance,
+                                 ClubList* clubs, MembershipList* memberships) {
+    StatsBundle* bundle = (StatsBundle*)calloc(1, sizeof(StatsBundle));
+    if (bundle == NULL) {
+        printf("Error: Failed to allocate statistics\n");
+        return NULL;
+    }
+
+    StatsJob job;
+    memset(&job, 0, sizeof(job));
+    job.students = students;
+    job.courses = courses;
+    job.grades = grades;
+    job.attendance = attendance;
+    job.clubs = clubs;
+    job.memberships = memberships;
+    job.bundle = bundle;
+
+    long total = 0;
+    if (students) total += students->count;
+    if (grades) total += grades->count;
+    if (attendance) total += attendance->count;
+    if (memberships) total += memberships->count;
+
+    StatsTask tasks[4];
+    pthread_t threads[4];
+    int started[4] = {0};
+    for (int i = 0; i < 4; i++) {
+        tasks[i].job = &job;
+        tasks[i].task = i;
+        // Task 0 always runs on the calling thread
+        if (i > 0 && total >= STATS_PARALLEL_THRESHOLD) {
+            started[i] = pthread_create(&threads[i], NULL, stats_run_task, &tasks[i]) == 0;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        if (!started[i]) {
+            stats_run_task(&tasks[i]);
+        }
+    }
+    for (int i = 1; i < 4; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    // Merge the partial system counters
+    SystemStats* sys = &bundle->system;
+    for (int i = 0; i < 4; i++) {
+        SystemStats* p = &job.partial[i];
+        sys->total_students += p->total_students;
+        sys->active_students += p->active_students;
+        sys->inactive_students += p->inactive_students;
+        sys->total_grades += p->total_grades;
+        sys->total_attendance_records += p->total_attendance_records;
+        sys->total_clubs += p->total_clubs;
+        sys->total_memberships += p->total_memberships;
+    }
+    sys->total_courses = courses != NULL ? courses->count : 0;
+    sys->last_updated = time(NULL);
+
+    return bundle;
+}
+
+void free_all_stats(StatsBundle* stats) {
+    free(stats);
+}
+
+// ---- Individual statistics, each a single sweep of its own inputs ----
+
+SystemStats* calculate_system_stats(StudentList* students, CourseList* courses,
+                                   GradeList* grades, AttendanceList* attendance,
+                                   ClubList* clubs, MembershipList* memberships) {
+    SystemStats* stats = (SystemStats*)calloc(1, sizeof(SystemStats));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate system statistics\n");
+        return NULL;
+    }
+
+    if (students != NULL && students->students != NULL) {
+        stats->total_students = students->count;
+        for (int i = 0; i < students->count; i++) {
+            if (students->students[i].is_active) {
+                stats->active_students++;
+            }
+        }
+        stats->inactive_students = stats->total_students - stats->active_students;
+    }
+    stats->total_courses = courses != NULL ? courses->count : 0;
+    stats->total_grades = grades != NULL ? grades->count : 0;
+    stats->total_attendance_records = attendance != NULL ? attendance->count : 0;
+    stats->total_clubs = clubs != NULL ? clubs->count : 0;
+    stats->total_memberships = memberships != NULL ? memberships->count : 0;
+    stats->last_updated = time(NULL);
+    return stats;
+}
+
+void free_system_stats(SystemStats* stats) {
+    free(stats);
+}
+
+StudentStats* calculate_student_stats(StudentList* students, GradeList* grades) {
+    (void)grades;
+    StudentStats* stats = (StudentStats*)malloc(sizeof(StudentStats));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate student statistics\n");
+        return NULL;
+    }
+    SystemStats partial = {0};
+    stats_sweep_students(students, stats, &partial);
+    return stats;
+}
+
+void free_student_stats(StudentStats* stats) {
+    free(stats);
+}
+
+GradeStats* calculate_grade_stats(GradeList* grades, CourseList* courses) {
+    GradeStats* stats = (GradeStats*)malloc(sizeof(GradeStats));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate grade statistics\n");
+        return NULL;
+    }
+    SystemStats partial = {0};
+    stats_sweep_grades(grades, courses, stats, &partial);
+    return stats;
+}
+
+void free_grade_stats(GradeStats* stats) {
+    free(stats);
+}
+
+AttendanceStats* calculate_attendance_stats(AttendanceList* attendance) {
+    AttendanceStats* stats = (AttendanceStats*)malloc(sizeof(AttendanceStats));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate attendance statistics\n");
+        return NULL;
+    }
+    SystemStats partial = {0};
+    stats_sweep_attendance(attendance, stats, &partial);
+    return stats;
+}
+
+void free_attendance_stats(AttendanceStats* stats) {
+    free(stats);
+}
+
+ClubStats* calculate_club_stats(ClubList* clubs, MembershipList* memberships) {
+    ClubStats* stats = (ClubStats*)malloc(sizeof(ClubStats));
+    if (stats == NULL) {
+        printf("Error: Failed to allocate club statistics\n");
+        return NULL;
+    }
+    SystemStats partial = {0};
+    stats_sweep_clubs(clubs, memberships, stats, &partial);
+    return stats;
+}
+
+void free_club_stats(ClubStats* stats) {
+    free(stats);
+}
+
+// ---- Top-k analyses: a bounded heap keeps only the `count` best candidates ----
+
+TopPerformer* get_top_performers(StudentList* students, GradeList* grades, int count) {
+    (void)grades;   // GPA is maintained on the student record
+    if (students == NULL || students->students == NULL) {
+        printf("Error: Student list is NULL\n");
+        return NULL;
+    }
+    if (count <= 0) count = TOP_PERFORMERS_COUNT;
+
+    // Unused trailing entries keep rank 0
+    TopPerformer* performers = (TopPerformer*)calloc(count, sizeof(TopPerformer));
+    StatsRankItem* items = (StatsRankItem*)malloc(sizeof(StatsRankItem) * count);
+    if (performers == NULL || items == NULL) {
+        printf("Error: Failed to allocate top performers\n");
+        free(performers);
+        free(items);
+        return NULL;
+    }
+
+    int found = stats_select_students(students, items, count, 1);
+    for (int i = 0; i < found; i++) {
+        Student* s = &students->students[items[i].index];
+        performers[i].student_id = s->id;
+        snprintf(performers[i].student_name, sizeof(performers[i].student_name), "%s %s",
+                 s->first_name, s->last_name);
+        performers[i].gpa = s->gpa;
+        performers[i].rank = i + 1;
+    }
+
+    free(items);
+    return performers;
+}
+
+void display_top_performers(TopPerformer* performers, int count) {
+    if (performers == NULL) {
+        printf("No top performers to display\n");
+        return;
+    }
+    printf("\n=== TOP PERFORMERS ===\n");
+    printf("%-5s %-8s %-40s %-5s\n", "Rank", "ID", "Name", "GPA");
+    for (int i = 0; i < count && performers[i].rank > 0; i++) {
+        printf("%-5d %-8d %-40s %.2f\n", performers[i].rank, performers[i].student_id,
+               performers[i].student_name, performers[i].gpa);
+    }
+}
+
+void free_top_performers(TopPerformer* performers) {
+    free(performers);
+}
+
+CoursePerformance* get_course_performance(GradeList* grades, CourseList* courses, int count) {
+    if (grades == NULL || courses == NULL || courses->courses == NULL) {
+        printf("Error: Grade or course list is NULL\n");
+        return NULL;
+    }
+    if (count <= 0) count = COURSE_ANALYSIS_COUNT;
+
+    CoursePerformance* performance = (CoursePerformance*)calloc(count, sizeof(CoursePerformance));
+    CounterMap* by_student = (CounterMap*)calloc(courses->count + 1, sizeof(CounterMap));
+    Counter* totals = (Counter*)calloc(courses->count + 1, sizeof(Counter));
+    TopK* best = topk_create(count, sizeof(StatsRankItem), stats_rank_compare_highest);
+    CounterMap course_index = {0};
+    if (performance == NULL || by_student == NULL || totals == NULL || best == NULL) {
+        printf("Error: Failed to allocate course performance\n");
+        free(performance);
+        free(by_student);
+        free(totals);
+        topk_destroy(best);
+        return NULL;
+    }
+
+    // Course id -> position in the course list
+    for (int i = 0; i < courses->count; i++) {
+        Counter* c = counter_map_get(&course_index, courses->courses[i].id);
+        if (c != NULL && c->count == 0) c->count = i + 1;
+    }
+
+    // One sweep: numeric totals per course, grade points per (course, student)
+    for (int i = 0; grades->grades != NULL && i < grades->count; i++) {
+        Grade* g = &grades->grades[i];
+        Counter* c = counter_map_find(&course_index, g->course_id);
+        if (c == NULL) continue;
+        int index = c->count - 1;
+        totals[index].count++;
+        totals[index].sum += g->numeric_grade;
+        Counter* student = counter_map_get(&by_student[index], g->student_id);
+        if (student != NULL) {
+            student->count++;
+            student->sum += (double)g->grade_level;
+        }
+    }
+
+    for (int i = 0; i < courses->count; i++) {
+        if (totals[i].count == 0) continue;
+        StatsRankItem item = { courses->courses[i].id, i, (float)(totals[i].sum / totals[i].count) };
+        topk_offer(best, &item);
+    }
+
+    StatsRankItem* ranked = (StatsRankItem*)malloc(sizeof(StatsRankItem) * count);
+    int found = ranked != NULL ? topk_finish(best, ranked) : 0;
+    for (int i = 0; i < found; i++) {
+        int index = ranked[i].index;
+        CoursePerformance* p = &performance[i];
+        p->course_id = courses->courses[index].id;
+        snprintf(p->course_name, sizeof(p->course_name), "%s", courses->courses[index].name);
+        p->average_grade = ranked[i].key;
+
+        // A student passes the course when their average grade is above F
+        CounterMap* students = &by_student[index];
+        for (int j = 0; j < students->capacity; j++) {
+            Counter* s = &students->slots[j];
+            if (s->key == COUNTER_MAP_EMPTY_KEY || s->count == 0) continue;
+            p->total_students++;
+            if (s->sum / s->count >= (double)GRADE_D) p->passing_students++;
+        }
+        p->pass_rate = p->total_students > 0 ? (float)p->passing_students / p->total_students : 0.0f;
+        p->rank = i + 1;
+    }
+
+    for (int i = 0; i < courses->count; i++) {
+        counter_map_free(&by_student[i]);
+    }
+    counter_map_free(&course_index);
+    free(by_student);
+    free(totals);
+    free(ranked);
+    topk_destroy(best);
+    return performance;
+}
+
+void display_course_performance(CoursePerformance* performance, int count) {
+    if (performance == NULL) {
+        printf("No course performance to display\n");
+        return;
+    }
+    printf("\n=== COURSE PERFORMANCE ===\n");
+    printf("%-5s %-30s %-8s %-9s %-8s %-6s\n", "Rank", "Course", "Average", "Students", "Passing", "Rate");
+    for (int i = 0; i < count && performance[i].rank > 0; i++) {
+        CoursePerformance* p = &performance[i];
+        printf("%-5d %-30s %-8.2f %-9d %-8d %.1f%%\n", p->rank, p->course_name, p->average_grade,
+               p->total_students, p->passing_students, p->pass_rate * 100.0f);
+    }
+}
+
+void free_course_performance(CoursePerformance* performance) {
+    free(performance);
+}
+
+ClubPopularity* get_club_popularity(ClubList* clubs, MembershipList* memberships, int count) {
+    if (clubs == NULL || clubs->clubs == NULL) {
+        printf("Error: Club list is NULL\n");
+        return NULL;
+    }
+    if (count <= 0) count = clubs->count;
+    if (count <= 0) return NULL;
+
+    ClubPopularity* popularity = (ClubPopularity*)calloc(count, sizeof(ClubPopularity));
+    StatsRankItem* ranked = (StatsRankItem*)malloc(sizeof(StatsRankItem) * count);
+    TopK* best = topk_create(count, sizeof(StatsRankItem), stats_rank_compare_highest);
+    if (popularity == NULL || ranked == NULL || best == NULL) {
+        printf("Error: Failed to allocate club popularity\n");
+        free(popularity);
+        free(ranked);
+        topk_destroy(best);
+        return NULL;
+    }
+
+    CounterMap by_club = {0};
+    int active_memberships = 0;
+    if (memberships != NULL && memberships->memberships != NULL) {
+        for (int i = 0; i < memberships->count; i++) {
+            ClubMembership* m = &memberships->memberships[i];
+            if (!m->is_active) continue;
+            active_memberships++;
+            Counter* c = counter_map_get(&by_club, m->club_id);
+            if (c != NULL) c->count++;
+        }
+    }
+
+    for (int i = 0; i < clubs->count; i++) {
+        Counter* c = counter_map_find(&by_club, clubs->clubs[i].id);
+        StatsRankItem item = { clubs->clubs[i].id, i, c != NULL ? (float)c->count : 0.0f };
+        topk_offer(best, &item);
+    }
+
+    int found = topk_finish(best, ranked);
+    for (int i = 0; i < found; i++) {
+        Club* club = &clubs->clubs[ranked[i].index];
+        ClubPopularity* p = &popularity[i];
+        p->club_id = club->id;
+        snprintf(p->club_name, sizeof(p->club_name), "%s", club->name);
+        snprintf(p->category, sizeof(p->category), "%s", club->category);
+        p->member_count = (int)ranked[i].key;
+        // Share of all active memberships, in percent
+        p->popularity_score = active_memberships > 0 ? 100.0f * p->member_count / active_memberships : 0.0f;
+        p->rank = i + 1;
+    }
+
+    counter_map_free(&by_club);
+    free(ranked);
+    topk_destroy(best);
+    return popularity;
+}
+
+void display_club_popularity(ClubPopularity* popularity, int count) {
+    if (popularity == NULL) {
+        printf("No club popularity to display\n");
+        return;
+    }
+    printf("\n=== CLUB POPULARITY ===\n");
+    printf("%-5s %-30s %-15s %-8s %-6s\n", "Rank", "Club", "Category", "Members", "Share");
+    for (int i = 0; i < count && popularity[i].rank > 0; i++) {
+        ClubPopularity* p = &popularity[i];
+        printf("%-5d %-30s %-15s %-8d %.1f%%\n", p->rank, p->club_name, p->category,
+               p->member_count, p->popularity_score);
+    }
+}
+
+void free_club_popularity(ClubPopularity* popularity) {
+    free(popularity);
+}
+
+// ---- Moments: block-parallel, same result for any thread count ----
+
+float calculate_mean(float* values, int count) {
+    StatsMoments m;
+    if (values == NULL || count <= 0 || !stats_moments_compute(values, count, 0, &m)) {
+        return 0.0f;
+    }
+    return (float)m.mean;
+}
+
+float calculate_standard_deviation(float* values, int count) {
+    StatsMoments m;
+    if (values == NULL || count <= 0 || !stats_moments_compute(values, count, 0, &m)) {
+        return 0.0f;
+    }
+    return (float)stats_moments_stddev(&m);
+}
+
+float calculate_correlation(float* x_values, float* y_values, int count) {
+    StatsComoments c;
+    if (x_values == NULL || y_values == NULL || count <= 1 ||
+        !stats_comoments_compute(x_values, y_values, count, 0, &c)) {
+        return 0.0f;
+    }
+    return (float)stats_comoments_correlation(&c);
+}
+
+// ---- Order statistics ----
+
+// Smallest value in values[start, count); used after a selection has left
+// everything from `start` on no smaller than values[start - 1]
+static float stats_min_from(const float* values, int start, int count) {
+    float result = values[start];
+    for (int i = start + 1; i < count; i++) {
+        if (values[i] < result) result = values[i];
+    }
+    return result;
+}
+
+float calculate_median(float* values, int count) {
+    if (values == NULL || count <= 0) {
+        return 0.0f;
+    }
+    int mid = count / 2;
+    float upper = quantile_select_nth(values, count, mid);
+    if (count % 2 == 1) {
+        return upper;
+    }
+    // Even count: the lower middle is the largest value before `mid`
+    float lower = values[0];
+    for (int i = 1; i < mid; i++) {
+        if (values[i] > lower) lower = values[i];
+    }
+    return (lower + upper) / 2.0f;
+}
+
+float calculate_percentile(float* values, int count, float percentile) {
+    if (values == NULL || count <= 0) {
+        return 0.0f;
+    }
+    if (percentile < 0.0f) percentile = 0.0f;
+    if (percentile > 100.0f) percentile = 100.0f;
+
+    double position = (double)percentile / 100.0 * (count - 1);
+    int below = (int)position;
+    double fraction = position - below;
+
+    float lower = quantile_select_nth(values, count, below);
+    if (fraction == 0.0 || below + 1 >= count) {
+        return lower;
+    }
+    float upper = stats_min_from(values, below + 1, count);
+    return (float)(lower + (upper - lower) * fraction);
+}
+
+QuantileSketch* calculate_grade_sketch(GradeList* grades, int course_id) {
+    if (grades == NULL) {
+        printf("Error: Grade list is NULL\n");
+        return NULL;
+    }
+
+    QuantileSketch* sketch = quantile_sketch_create(QUANTILE_DEFAULT_K);
+    if (sketch == NULL) {
+        return NULL;
+    }
+    for (int i = 0; grades->grades != NULL && i < grades->count; i++) {
+        Grade* g = &grades->grades[i];
+        if (course_id == 0 || g->course_id == course_id) {
+            quantile_sketch_add(sketch, g->numeric_grade);
+        }
+    }
+    return sketch;
+}
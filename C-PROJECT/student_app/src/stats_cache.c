@@ -0,0 +1,593 @@
+#include "stats_cache.h"
+#include "config.h"
+#include "stats.h"
+#include "calendar.h"
+#include "counter_map.h"
+#include "change_notify.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+
+static void stats_cache_on_change(const ChangeEvent* event, void* user_data);
+
+static int stats_cache_in_list(const int* ids, int filled, int id) {
+    for (int i = 0; i < filled; i++) {
+        if (ids[i] == id) return 1;
+    }
+    return 0;
+}
+
+// ---- Students ----
+
+static void stats_cache_rank_students(StatsCache* cache) {
+    StudentStats* st = &cache->current.students;
+    cache->top_filled = 0;
+    cache->bottom_filled = 0;
+    memset(st->top_performers, 0, sizeof(st->top_performers));
+    memset(st->struggling_students, 0, sizeof(st->struggling_students));
+
+    if (cache->students != NULL && cache->students->students != NULL) {
+        for (int i = 0; i < cache->students->count; i++) {
+            Student* s = &cache->students->students[i];
+            if (!s->is_active) continue;
+            stats_rank_insert(st->top_performers, cache->top_keys, &cache->top_filled, 10, s->id, s->gpa, 1);
+            stats_rank_insert(st->struggling_students, cache->bottom_keys, &cache->bottom_filled, 10, s->id, s->gpa, 0);
+        }
+    }
+    cache->rankings_dirty = 0;
+}
+
+static void stats_cache_apply_student(StatsCache* cache, const Student* s, int sign) {
+    StudentStats* st = &cache->current.students;
+    SystemStats* sys = &cache->current.system;
+
+    st->total_students += sign;
+    if (s->is_active) {
+        sys->active_students += sign;
+    } else {
+        sys->inactive_students += sign;
+    }
+    if (s->year >= 1 && s->year <= 4) {
+        st->students_by_year[s->year] += sign;
+    }
+    name_count_add(&cache->student_courses, s->course, sign);
+    cache->age_sum += sign * (double)s->age;
+    cache->gpa_sum += sign * (double)s->gpa;
+    st->age_distribution[stats_age_bucket(s->age)] += sign;
+    st->gpa_distribution[stats_gpa_bucket(s->gpa)] += (float)sign;
+
+    if (!s->is_active || cache->rankings_dirty) {
+        return;
+    }
+    if (sign < 0) {
+        // Losing a ranked student needs the runner-up, which only a rescan knows
+        if (stats_cache_in_list(st->top_performers, cache->top_filled, s->id) ||
+            stats_cache_in_list(st->struggling_students, cache->bottom_filled, s->id)) {
+            cache->rankings_dirty = 1;
+        }
+    } else {
+        stats_rank_insert(st->top_performers, cache->top_keys, &cache->top_filled, 10, s->id, s->gpa, 1);
+        stats_rank_insert(st->struggling_students, cache->bottom_keys, &cache->bottom_filled, 10, s->id, s->gpa, 0);
+    }
+}
+
+static void stats_cache_finish_students(StatsCache* cache) {
+    StudentStats* st = &cache->current.students;
+
+    if (cache->rankings_dirty) {
+        stats_cache_rank_students(cache);
+    }
+    if (st->total_students > 0) {
+        st->average_age = (float)(cache->age_sum / st->total_students);
+        st->average_gpa = (float)(cache->gpa_sum / st->total_students);
+    } else {
+        st->average_age = 0.0f;
+        st->average_gpa = 0.0f;
+    }
+    name_count_top(&cache->student_courses, st->students_by_course, 20);
+    cache->current.system.total_students = st->total_students;
+}
+
+// ---- Grades ----
+
+static void stats_cache_grade_extremes(StatsCache* cache) {
+    GradeStats* gs = &cache->current.grades;
+    int any = 0;
+
+    gs->highest_gpa = 0.0f;
+    gs->lowest_gpa = 4.0f;
+    for (int i = 0; i < cache->grades_by_student.capacity; i++) {
+        Counter* c = &cache->grades_by_student.slots[i];
+        if (c->key == COUNTER_MAP_EMPTY_KEY || c->count == 0) continue;
+        float gpa = (float)(c->sum / c->count);
+        if (gpa > gs->highest_gpa) gs->highest_gpa = gpa;
+        if (gpa < gs->lowest_gpa) gs->lowest_gpa = gpa;
+        any = 1;
+    }
+    if (!any) {
+        gs->lowest_gpa = 0.0f;
+    }
+    cache->grade_extremes_dirty = 0;
+}
+
+static void stats_cache_apply_grade(StatsCache* cache, const Grade* g, int sign) {
+    GradeStats* gs = &cache->current.grades;
+    float points = (float)g->grade_level;
+
+    gs->total_grades += sign;
+    if (g->grade_level >= GRADE_F && g->grade_level <= GRADE_A) {
+        gs->grades_by_level[GRADE_A - g->grade_level] += sign;
+    }
+    if (g->grade_level != GRADE_F) {
+        gs->passing_grades += sign;
+    } else {
+        gs->failing_grades += sign;
+    }
+    cache->grade_points_sum += sign * (double)points;
+
+    Counter* student = counter_map_get(&cache->grades_by_student, g->student_id);
+    if (student != NULL) {
+        int was_empty = cache->grade_students == 0;
+        if (student->count > 0) {
+            // Moving a student who holds an extreme needs a rescan of the students
+            float old_gpa = (float)(student->sum / student->count);
+            if (old_gpa == gs->highest_gpa || old_gpa == gs->lowest_gpa) {
+                cache->grade_extremes_dirty = 1;
+            }
+        } else if (sign > 0) {
+            cache->grade_students++;
+        }
+        student->count += sign;
+        student->sum += sign * (double)points;
+        if (student->count == 0) {
+            cache->grade_students--;
+            student->sum = 0.0;
+        } else if (!cache->grade_extremes_dirty) {
+            float gpa = (float)(student->sum / student->count);
+            if (was_empty) {
+                gs->highest_gpa = gpa;
+                gs->lowest_gpa = gpa;
+            } else {
+                if (gpa > gs->highest_gpa) gs->highest_gpa = gpa;
+                if (gpa < gs->lowest_gpa) gs->lowest_gpa = gpa;
+            }
+        }
+    }
+
+    Counter* course = counter_map_get(&cache->grades_by_course, g->course_id);
+    if (course != NULL) {
+        if (course->count == 0 && sign > 0) gs->courses_with_grades++;
+        course->count += sign;
+        course->sum += sign * (double)g->numeric_grade;
+        if (course->count == 0) {
+            gs->courses_with_grades--;
+            course->sum = 0.0;
+        }
+
+        if (cache->courses != NULL && cache->courses->courses != NULL) {
+            for (int i = 0; i < cache->courses->count && i < 20; i++) {
+                if (cache->courses->courses[i].id == g->course_id) {
+                    gs->course_averages[i] = course->count > 0 ? (float)(course->sum / course->count) : 0.0f;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void stats_cache_finish_grades(StatsCache* cache) {
+    GradeStats* gs = &cache->current.grades;
+
+    if (cache->grade_extremes_dirty) {
+        stats_cache_grade_extremes(cache);
+    }
+    if (gs->total_grades > 0) {
+        gs->average_gpa = (float)(cache->grade_points_sum / gs->total_grades);
+        gs->pass_rate = (float)gs->passing_grades / gs->total_grades;
+    } else {
+        gs->average_gpa = 0.0f;
+        gs->pass_rate = 0.0f;
+        gs->highest_gpa = 0.0f;
+        gs->lowest_gpa = 0.0f;
+    }
+    cache->current.system.total_grades = gs->total_grades;
+}
+
+// ---- Attendance ----
+
+// Perfect / poor classification of one student's counters: +1, -1 or 0
+static void stats_cache_classify_student(AttendanceStats* as, const Counter* c, int sign) {
+    if (c->count <= 0) return;
+    if (c->hits == c->count) {
+        as->students_with_perfect_attendance += sign;
+    } else if ((float)c->hits / c->count < POOR_ATTENDANCE_THRESHOLD) {
+        as->students_with_poor_attendance += sign;
+    }
+}
+
+static void stats_cache_apply_attendance(StatsCache* cache, const AttendanceRecord* r, int sign) {
+    AttendanceStats* as = &cache->current.attendance;
+    int attended = r->status == ATTENDANCE_PRESENT || r->status == ATTENDANCE_LATE;
+
+    as->total_records += sign;
+    switch (r->status) {
+        case ATTENDANCE_PRESENT: as->present_count += sign; break;
+        case ATTENDANCE_ABSENT: as->absent_count += sign; break;
+        case ATTENDANCE_LATE: as->late_count += sign; break;
+        case ATTENDANCE_EXCUSED: as->excused_count += sign; break;
+        default: break;
+    }
+    if (r->status == ATTENDANCE_EXCUSED) {
+        return;
+    }
+
+    long day_number = calendar_day_number(r->date);
+    int month;
+    calendar_civil_from_days(day_number, NULL, &month, NULL);
+    cache->month_total[month - 1] += sign;
+    cache->month_attended[month - 1] += sign * attended;
+    as->attendance_by_month[month - 1] = cache->month_total[month - 1] > 0 ?
+        (float)cache->month_attended[month - 1] / cache->month_total[month - 1] : 0.0f;
+
+    Counter* day = counter_map_get(&cache->attendance_by_day, (int)day_number);
+    if (day != NULL) {
+        if (day->count == 0 && sign > 0) cache->attendance_days++;
+        day->count += sign;
+        if (day->count == 0) cache->attendance_days--;
+    }
+
+    Counter* student = counter_map_get(&cache->attendance_by_student, r->student_id);
+    if (student != NULL) {
+        stats_cache_classify_student(as, student, -1);
+        student->count += sign;
+        student->hits += sign * attended;
+        stats_cache_classify_student(as, student, 1);
+    }
+}
+
+static void stats_cache_finish_attendance(StatsCache* cache) {
+    AttendanceStats* as = &cache->current.attendance;
+    int counted = as->total_records - as->excused_count;
+    int attended = as->present_count + as->late_count;
+
+    as->overall_attendance_rate = counted > 0 ? (float)attended / counted : 0.0f;
+    as->average_daily_attendance = cache->attendance_days > 0 ? (float)attended / cache->attendance_days : 0.0f;
+    cache->current.system.total_attendance_records = as->total_records;
+}
+
+// ---- Clubs and memberships ----
+
+static void stats_cache_apply_club(StatsCache* cache, const Club* c, int sign) {
+    ClubStats* cs = &cache->current.clubs;
+    cs->total_clubs += sign;
+    if (c->is_active) cs->active_clubs += sign;
+    cs->clubs_by_category[stats_category_index(c->category)] += sign;
+}
+
+static void stats_cache_apply_membership(StatsCache* cache, const ClubMembership* m, int sign) {
+    ClubStats* cs = &cache->current.clubs;
+
+    cs->total_memberships += sign;
+    if (!m->is_active) {
+        return;
+    }
+    cs->active_memberships += sign;
+
+    Counter* club = counter_map_get(&cache->members_by_club, m->club_id);
+    if (club != NULL) club->count += sign;
+
+    Counter* student = counter_map_get(&cache->clubs_by_student, m->student_id);
+    if (student != NULL) {
+        if (student->count >= 2) cs->students_in_multiple_clubs--;
+        student->count += sign;
+        if (student->count >= 2) cs->students_in_multiple_clubs++;
+    }
+}
+
+static void stats_cache_finish_clubs(StatsCache* cache) {
+    ClubStats* cs = &cache->current.clubs;
+
+    // Popularity extremes follow club list order, like the full sweep
+    cs->most_popular_club_id = 0;
+    cs->least_popular_club_id = 0;
+    if (cache->clubs != NULL && cache->clubs->clubs != NULL) {
+        int most = -1, least = INT_MAX;
+        for (int i = 0; i < cache->clubs->count; i++) {
+            Club* c = &cache->clubs->clubs[i];
+            Counter* counter = counter_map_find(&cache->members_by_club, c->id);
+            int members = counter != NULL ? counter->count : 0;
+            if (members > most) {
+                most = members;
+                cs->most_popular_club_id = c->id;
+            }
+            if (members < least) {
+                least = members;
+                cs->least_popular_club_id = c->id;
+            }
+        }
+    }
+    cs->average_members_per_club = cs->total_clubs > 0 ? (float)cs->active_memberships / cs->total_clubs : 0.0f;
+    cache->current.system.total_clubs = cs->total_clubs;
+    cache->current.system.total_memberships = cs->total_memberships;
+}
+
+// ---- Event handling ----
+
+static void stats_cache_apply(StatsCache* cache, EntityType entity, const void* record, int sign) {
+    switch (entity) {
+        case ENTITY_STUDENT: stats_cache_apply_student(cache, (const Student*)record, sign); break;
+        case ENTITY_GRADE: stats_cache_apply_grade(cache, (const Grade*)record, sign); break;
+        case ENTITY_ATTENDANCE: stats_cache_apply_attendance(cache, (const AttendanceRecord*)record, sign); break;
+        case ENTITY_CLUB: stats_cache_apply_club(cache, (const Club*)record, sign); break;
+        case ENTITY_MEMBERSHIP: stats_cache_apply_membership(cache, (const ClubMembership*)record, sign); break;
+        default: break;
+    }
+}
+
+static void stats_cache_finish(StatsCache* cache, EntityType entity) {
+    switch (entity) {
+        case ENTITY_STUDENT: stats_cache_finish_students(cache); break;
+        case ENTITY_GRADE: stats_cache_finish_grades(cache); break;
+        case ENTITY_ATTENDANCE: stats_cache_finish_attendance(cache); break;
+        case ENTITY_CLUB:
+        case ENTITY_MEMBERSHIP: stats_cache_finish_clubs(cache); break;
+        default: break;
+    }
+    cache->generation++;
+    cache->current.system.last_updated = time(NULL);
+}
+
+static const void* stats_cache_bound_list(StatsCache* cache, EntityType entity) {
+    switch (entity) {
+        case ENTITY_STUDENT: return cache->students;
+        case ENTITY_GRADE: return cache->grades;
+        case ENTITY_ATTENDANCE: return cache->attendance;
+        case ENTITY_CLUB: return cache->clubs;
+        case ENTITY_MEMBERSHIP: return cache->memberships;
+        default: return NULL;
+    }
+}
+
+static void stats_cache_on_change(const ChangeEvent* event, void* user_data) {
+    StatsCache* cache = (StatsCache*)user_data;
+    if (event->list == NULL || event->list != stats_cache_bound_list(cache, event->entity)) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    // An edit is the removal of the old record followed by the new one
+    if (event->old_record != NULL) {
+        stats_cache_apply(cache, event->entity, event->old_record, -1);
+    }
+    if (event->new_record != NULL) {
+        stats_cache_apply(cache, event->entity, event->new_record, 1);
+    }
+    stats_cache_finish(cache, event->entity);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static void stats_cache_clear(StatsCache* cache) {
+    counter_map_free(&cache->grades_by_student);
+    counter_map_free(&cache->grades_by_course);
+    counter_map_free(&cache->attendance_by_student);
+    counter_map_free(&cache->attendance_by_day);
+    counter_map_free(&cache->members_by_club);
+    counter_map_free(&cache->clubs_by_student);
+    name_count_free(&cache->student_courses);
+
+    memset(&cache->current, 0, sizeof(StatsBundle));
+    cache->age_sum = 0.0;
+    cache->gpa_sum = 0.0;
+    cache->top_filled = 0;
+    cache->bottom_filled = 0;
+    cache->rankings_dirty = 0;
+    cache->grade_points_sum = 0.0;
+    cache->grade_students = 0;
+    cache->grade_extremes_dirty = 0;
+    cache->attendance_days = 0;
+    memset(cache->month_total, 0, sizeof(cache->month_total));
+    memset(cache->month_attended, 0, sizeof(cache->month_attended));
+}
+
+// Recompute everything from the bound lists, e.g. after a bulk load from file
+int stats_cache_rebuild(StatsCache* cache) {
+    if (cache == NULL) {
+        printf("Error: Invalid statistics cache\n");
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    stats_cache_clear(cache);
+
+    if (cache->students != NULL && cache->students->students != NULL) {
+        for (int i = 0; i < cache->students->count; i++) {
+            stats_cache_apply_student(cache, &cache->students->students[i], 1);
+        }
+    }
+    if (cache->grades != NULL && cache->grades->grades != NULL) {
+        for (int i = 0; i < cache->grades->count; i++) {
+            stats_cache_apply_grade(cache, &cache->grades->grades[i], 1);
+        }
+    }
+    if (cache->attendance != NULL && cache->attendance->records != NULL) {
+        for (int i = 0; i < cache->attendance->count; i++) {
+            stats_cache_apply_attendance(cache, &cache->attendance->records[i], 1);
+        }
+    }
+    if (cache->clubs != NULL && cache->clubs->clubs != NULL) {
+        for (int i = 0; i < cache->clubs->count; i++) {
+            stats_cache_apply_club(cache, &cache->clubs->clubs[i], 1);
+        }
+    }
+    if (cache->memberships != NULL && cache->memberships->memberships != NULL) {
+        for (int i = 0; i < cache->memberships->count; i++) {
+            stats_cache_apply_membership(cache, &cache->memberships->memberships[i], 1);
+        }
+    }
+
+    stats_cache_finish_students(cache);
+    stats_cache_grade_extremes(cache);
+    stats_cache_finish_grades(cache);
+    stats_cache_finish_attendance(cache);
+    stats_cache_finish_clubs(cache);
+    cache->generation++;
+    cache->current.system.last_updated = time(NULL);
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+}
+
+StatsCache* stats_cache_create(StudentList* students, CourseList* courses,
+                               GradeList* grades, AttendanceList* attendance,
+                               ClubList* clubs, MembershipList* memberships) {
+    StatsCache* cache = (StatsCache*)calloc(1, sizeof(StatsCache));
+    if (cache == NULL) {
+        printf("Error: Failed to create statistics cache\n");
+        return NULL;
+    }
+
+    cache->students = students;
+    cache->courses = courses;
+    cache->grades = grades;
+    cache->attendance = attendance;
+    cache->clubs = clubs;
+    cache->memberships = memberships;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    if (!stats_cache_rebuild(cache) || !change_notify_subscribe(stats_cache_on_change, cache)) {
+        stats_cache_destroy(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void stats_cache_destroy(StatsCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    change_notify_unsubscribe(stats_cache_on_change, cache);
+    stats_cache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void stats_cache_snapshot(StatsCache* cache, StatsBundle* snapshot) {
+    if (cache == NULL || snapshot == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    *snapshot = cache->current;
+    pthread_mutex_unlock(&cache->lock);
+    snapshot->system.total_courses = cache->courses != NULL ? cache->courses->count : 0;
+}
+
+unsigned long stats_cache_generation(StatsCache* cache) {
+    if (cache == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&cache->lock);
+    unsigned long generation = cache->generation;
+    pthread_mutex_unlock(&cache->lock);
+    return generation;
+}
+
+// ---- Verification against a full recomputation ----
+
+static int stats_cache_check_int(const char* field, int cached, int expected) {
+    if (cached != expected) {
+        printf("Mismatch in %s: cached %d, recomputed %d\n", field, cached, expected);
+        return 0;
+    }
+    return 1;
+}
+
+static int stats_cache_check_float(const char* field, float cached, float expected) {
+    float scale = fabsf(expected) > 1.0f ? fabsf(expected) : 1.0f;
+    if (fabsf(cached - expected) > STATS_CACHE_FLOAT_TOLERANCE * scale) {
+        printf("Mismatch in %s: cached %f, recomputed %f\n", field, cached, expected);
+        return 0;
+    }
+    return 1;
+}
+
+#define CHECK_INT(field) ok &= stats_cache_check_int(#field, cached.field, expected->field)
+#define CHECK_FLOAT(field) ok &= stats_cache_check_float(#field, cached.field, expected->field)
+
+int stats_cache_verify(StatsCache* cache) {
+    if (cache == NULL) {
+        printf("Error: Invalid statistics cache\n");
+        return 0;
+    }
+
+    StatsBundle cached;
+    stats_cache_snapshot(cache, &cached);
+    StatsBundle* expected = calculate_all_stats(cache->students, cache->courses, cache->grades,
+                                                cache->attendance, cache->clubs, cache->memberships);
+    if (expected == NULL) {
+        return 0;
+    }
+
+    int ok = 1;
+    CHECK_INT(system.total_students);
+    CHECK_INT(system.active_students);
+    CHECK_INT(system.inactive_students);
+    CHECK_INT(system.total_courses);
+    CHECK_INT(system.total_grades);
+    CHECK_INT(system.total_attendance_records);
+    CHECK_INT(system.total_clubs);
+    CHECK_INT(system.total_memberships);
+
+    CHECK_INT(students.total_students);
+    CHECK_FLOAT(students.average_age);
+    CHECK_FLOAT(students.average_gpa);
+    for (int i = 0; i < 5; i++) {
+        CHECK_INT(students.students_by_year[i]);
+        CHECK_FLOAT(students.gpa_distribution[i]);
+    }
+    for (int i = 0; i < 20; i++) CHECK_INT(students.students_by_course[i]);
+    for (int i = 0; i < 10; i++) {
+        CHECK_INT(students.age_distribution[i]);
+        CHECK_INT(students.top_performers[i]);
+        CHECK_INT(students.struggling_students[i]);
+    }
+
+    CHECK_INT(grades.total_grades);
+    for (int i = 0; i < 5; i++) CHECK_INT(grades.grades_by_level[i]);
+    CHECK_FLOAT(grades.average_gpa);
+    CHECK_FLOAT(grades.highest_gpa);
+    CHECK_FLOAT(grades.lowest_gpa);
+    CHECK_INT(grades.passing_grades);
+    CHECK_INT(grades.failing_grades);
+    CHECK_FLOAT(grades.pass_rate);
+    CHECK_INT(grades.courses_with_grades);
+    for (int i = 0; i < 20; i++) CHECK_FLOAT(grades.course_averages[i]);
+
+    CHECK_INT(attendance.total_records);
+    CHECK_INT(attendance.present_count);
+    CHECK_INT(attendance.absent_count);
+    CHECK_INT(attendance.late_count);
+    CHECK_INT(attendance.excused_count);
+    CHECK_FLOAT(attendance.overall_attendance_rate);
+    CHECK_FLOAT(attendance.average_daily_attendance);
+    CHECK_INT(attendance.students_with_perfect_attendance);
+    CHECK_INT(attendance.students_with_poor_attendance);
+    for (int i = 0; i < 12; i++) CHECK_FLOAT(attendance.attendance_by_month[i]);
+
+    CHECK_INT(clubs.total_clubs);
+    CHECK_INT(clubs.active_clubs);
+    CHECK_INT(clubs.total_memberships);
+    CHECK_INT(clubs.active_memberships);
+    CHECK_FLOAT(clubs.average_members_per_club);
+    CHECK_INT(clubs.most_popular_club_id);
+    CHECK_INT(clubs.least_popular_club_id);
+    for (int i = 0; i < 10; i++) CHECK_INT(clubs.clubs_by_category[i]);
+    CHECK_INT(clubs.students_in_multiple_clubs);
+
+    free_all_stats(expected);
+    return ok;
+}
+
+#undef CHECK_INT
+#undef CHECK_FLOAT
@@ -1,5 +1,6 @@
 #include "student.h"
 #include "config.h"
+#include "utils.h"
 #include "crypto.h"
 #include "ui.h"
 #include "file.h"
@@ -9,10 +10,135 @@
 #include "attendance.h"
 #include "grade.h"
 #include "club.h"
+#include "change_notify.h"
+#include "journal.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define STUDENT_DIRTY_WORD_BITS (8 * (int)sizeof(unsigned long))
+
+// ---- Dirty tracking ----
+
+// Makes dirty_bits cover slot; 0 when it cannot grow
+static int student_list_dirty_reserve(StudentList* list, int slot) {
+    if (slot < list->dirty_slots) {
+        return 1;
+    }
+    int slots = list->dirty_slots > 0 ? list->dirty_slots : STUDENT_DIRTY_WORD_BITS;
+    while (slots <= slot) {
+        slots *= 2;
+    }
+    int words = slots / STUDENT_DIRTY_WORD_BITS;
+    int old_words = list->dirty_slots / STUDENT_DIRTY_WORD_BITS;
+    unsigned long* bits = (unsigned long*)realloc(list->dirty_bits, sizeof(unsigned long) * (size_t)words);
+    if (bits == NULL) {
+        return 0;
+    }
+    memset(bits + old_words, 0, sizeof(unsigned long) * (size_t)(words - old_words));
+    list->dirty_bits = bits;
+    list->dirty_slots = slots;
+    return 1;
+}
+
+static int student_list_dirty_test(const StudentList* list, int slot) {
+    return slot < list->dirty_slots &&
+           (list->dirty_bits[slot / STUDENT_DIRTY_WORD_BITS] >> (slot % STUDENT_DIRTY_WORD_BITS)) & 1UL;
+}
+
+static void student_list_dirty_set(StudentList* list, int slot, int dirty) {
+    if (student_list_dirty_test(list, slot) == dirty || (dirty && !student_list_dirty_reserve(list, slot))) {
+        return;
+    }
+    list->dirty_bits[slot / STUDENT_DIRTY_WORD_BITS] ^= 1UL << (slot % STUDENT_DIRTY_WORD_BITS);
+    list->dirty_count += dirty ? 1 : -1;
+}
+
+// Records a mutation of slot (-1 when no single record changed). Changes
+// made through the list functions reach a following journal by themselves;
+// others (journaled = 0) must be written out by the next save.
+static void student_list_touch(StudentList* list, int slot, int journaled) {
+    list->generation++;
+    if (slot >= 0 && (list->journal == NULL || !journaled)) {
+        student_list_dirty_set(list, slot, 1);
+    }
+}
+
+// Keeps the bits lined up with the records after slot is removed
+static void student_list_dirty_remove(StudentList* list, int slot) {
+    for (int i = slot; i < list->dirty_slots && i <= list->count; i++) {
+        student_list_dirty_set(list, i, student_list_dirty_test(list, i + 1));
+    }
+}
+
+// Sorting moves records between slots; any pending bits are widened to
+// the whole list rather than permuted
+static void student_list_reordered(StudentList* list) {
+    list->generation++;
+    if (list->dirty_count > 0) {
+        for (int i = 0; i < list->count; i++) {
+            student_list_dirty_set(list, i, 1);
+        }
+    }
+}
+
+static void student_list_mark_clean(StudentList* list) {
+    if (list->dirty_bits != NULL) {
+        memset(list->dirty_bits, 0, sizeof(unsigned long) * (size_t)(list->dirty_slots / STUDENT_DIRTY_WORD_BITS));
+    }
+    list->dirty_count = 0;
+    list->saved_generation = list->generation;
+}
+
+void student_list_lock(StudentList* list) {
+    if (list != NULL) {
+        pthread_mutex_lock(&list->lock);
+    }
+}
+
+void student_list_unlock(StudentList* list) {
+    if (list != NULL) {
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+int student_list_mark_dirty(StudentList* list, int student_id) {
+    if (list == NULL || list->students == NULL) {
+        return 0;
+    }
+    student_list_lock(list);
+    int found = 0;
+    for (int i = 0; i < list->count && !found; i++) {
+        if (list->students[i].id == student_id) {
+            student_list_touch(list, i, 0);
+            found = 1;
+        }
+    }
+    student_list_unlock(list);
+    return found;
+}
+
+int student_list_is_dirty(StudentList* list) {
+    if (list == NULL) {
+        return 0;
+    }
+    student_list_lock(list);
+    int dirty = list->generation != list->saved_generation;
+    student_list_unlock(list);
+    return dirty;
+}
+
+unsigned long student_list_get_generation(StudentList* list) {
+    if (list == NULL) {
+        return 0;
+    }
+    student_list_lock(list);
+    unsigned long generation = list->generation;
+    student_list_unlock(list);
+    return generation;
+}
+
 StudentList* student_list_create(void) {
     StudentList* list = (StudentList*)malloc(sizeof(StudentList));
     if (list == NULL) {
@@ -37,6 +163,19 @@ StudentList* student_list_create(void) {
     list->filename[0] = '\0';
     list->auto_save_enabled = 1;
     list->last_save_time = 0;
+    list->generation = 0;
+    list->saved_generation = 0;
+    list->dirty_bits = NULL;
+    list->dirty_slots = 0;
+    list->dirty_count = 0;
+    list->journal = NULL;
+
+    // Recursive: journal replay adds records from inside ensure_loaded
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&list->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
     
     return list;
 }
@@ -50,11 +189,13 @@ void student_list_destroy(StudentList* list) {
     if (list->students != NULL) {
         free(list->students);
     }
+    free(list->dirty_bits);
+    pthread_mutex_destroy(&list->lock);
     
     // Free the list structure itself
     free(list);
 }
-int student_list_add(StudentList* list, Student student){
+static int student_list_add_locked(StudentList* list, Student student){
     if (list == NULL || list->students == NULL) {
         printf("ERROR DE LISTE OR STUDENT  ");
         return 0;
@@ -65,6 +206,10 @@ int student_list_add(StudentList* list, Student student){
         }
         list->students[list->count] = student;
         list->count++;
+        student_list_touch(list, list->count - 1, 1);
+        LOG_DEBUG(LOG_MODULE_ID_STUDENT, "Added student %d (%s %s), %d in list",
+                  student.id, student.first_name, student.last_name, list->count);
+        change_notify_publish(ENTITY_STUDENT, CHANGE_ADD, list, NULL, &list->students[list->count - 1]);
         return 1;
     }
 
@@ -72,7 +217,7 @@ int student_list_add(StudentList* list, Student student){
 
 
 }
-int student_list_remove(StudentList* list, int student_id) {
+static int student_list_remove_locked(StudentList* list, int student_id) {
     if (list == NULL || list->students == NULL) {
         printf("Error: Invalid student list\n");
         return 0;
@@ -80,19 +225,67 @@ int student_list_remove(StudentList* list, int student_id) {
 
     for (int i = 0; i < list->count; i++) {
         if (list->students[i].id == student_id) {
+            Student removed = list->students[i];
             for (int j = i; j < list->count - 1; j++) {
                 list->students[j] = list->students[j + 1];
             }
 
             memset(&list->students[list->count - 1], 0, sizeof(Student));
             list->count--;
+            student_list_dirty_remove(list, i);
+            student_list_touch(list, -1, 1);
+            LOG_DEBUG(LOG_MODULE_ID_STUDENT, "Removed student %d (%s %s), %d in list",
+                      removed.id, removed.first_name, removed.last_name, list->count);
+            change_notify_publish(ENTITY_STUDENT, CHANGE_REMOVE, list, &removed, NULL);
             return 1;
         }
     }
 
+    LOG_WARNING(LOG_MODULE_ID_STUDENT, "Remove failed: student %d not found", student_id);
     printf("Error: Student with ID %d not found\n", student_id);
     return 0;
 }
+// Replace the student having the same id, so listeners see the old and new values
+static int student_list_update_locked(StudentList* list, Student student) {
+    if (list == NULL || list->students == NULL) {
+        printf("Error: Invalid student list\n");
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->students[i].id == student.id) {
+            Student previous = list->students[i];
+            list->students[i] = student;
+            student_list_touch(list, i, 1);
+            LOG_DEBUG(LOG_MODULE_ID_STUDENT, "Updated student %d: GPA %.2f -> %.2f, active %d -> %d",
+                      student.id, previous.gpa, student.gpa, previous.is_active, student.is_active);
+            change_notify_publish(ENTITY_STUDENT, CHANGE_EDIT, list, &previous, &list->students[i]);
+            return 1;
+        }
+    }
+
+    LOG_WARNING(LOG_MODULE_ID_STUDENT, "Update failed: student %d not found", student.id);
+    printf("Error: Student with ID %d not found\n", student.id);
+    return 0;
+}
+int student_list_add(StudentList* list, Student student) {
+    student_list_lock(list);
+    int ok = student_list_add_locked(list, student);
+    student_list_unlock(list);
+    return ok;
+}
+int student_list_remove(StudentList* list, int student_id) {
+    student_list_lock(list);
+    int ok = student_list_remove_locked(list, student_id);
+    student_list_unlock(list);
+    return ok;
+}
+int student_list_update(StudentList* list, Student student) {
+    student_list_lock(list);
+    int ok = student_list_update_locked(list, student);
+    student_list_unlock(list);
+    return ok;
+}
 Student* student_list_find_by_id(StudentList* list, int student_id) {
     if (list == NULL || list->students == NULL) {
         printf("Error: Invalid student list\n");
@@ -189,12 +382,13 @@ void student_list_display_student(Student* student) {
 }
 
 
-int student_list_save_to_file(StudentList* list, const char* filename) {
+static int student_list_save_to_file_locked(StudentList* list, const char* filename) {
     if (list == NULL || list->students == NULL || filename == NULL) {
         printf("Error: Invalid arguments to student_list_save_to_file\n");
         return 0;
     }
-    FILE* file = fopen(filename, "w");
+    char temp[512];
+    FILE* file = utils_file_open_atomic(filename, temp, sizeof(temp));
     if (!file) {
         printf("Error: Could not open file %s for writing\n", filename);
         return 0;
@@ -217,10 +411,23 @@ int student_list_save_to_file(StudentList* list, const char* filename) {
             s->is_active
         );
     }
-    fclose(file);
+    if (!utils_file_commit_atomic(file, temp, filename)) {
+        printf("Error: Could not write file %s\n", filename);
+        return 0;
+    }
+    LOG_INFO(LOG_MODULE_ID_STUDENT, "Saved %d students to %s", list->count, filename);
+    if (strcmp(filename, list->filename) == 0) {
+        student_list_mark_clean(list);
+    }
     return 1;
 }
-int student_list_load_from_file(StudentList* list, const char* filename){
+int student_list_save_to_file(StudentList* list, const char* filename) {
+    student_list_lock(list);
+    int ok = student_list_save_to_file_locked(list, filename);
+    student_list_unlock(list);
+    return ok;
+}
+static int student_list_load_from_file_locked(StudentList* list, const char* filename){
     if (list == NULL || filename == NULL) {
         printf("Error: Invalid arguments to student_list_load_from_file\n");
         return 0;
@@ -278,14 +485,26 @@ int student_list_load_from_file(StudentList* list, const char* filename){
     }
     list->count = index;
     fclose(file);
+    // The whole content changed; whether it matches list->filename is up
+    // to the caller (student_list_ensure_loaded marks it clean)
+    student_list_mark_clean(list);
+    list->generation++;
+    LOG_INFO(LOG_MODULE_ID_STUDENT, "Loaded %d students from %s", index, filename);
     return 1;
 }
+int student_list_load_from_file(StudentList* list, const char* filename) {
+    student_list_lock(list);
+    int ok = student_list_load_from_file_locked(list, filename);
+    student_list_unlock(list);
+    return ok;
+}
 void student_list_sort_by_name(StudentList* list) {
     if (list == NULL || list->students == NULL) {
         printf("Error: Invalid student list\n");
         return;
     }
     // Simple bubble sort by last_name, then first_name if last names equal
+    student_list_lock(list);
     for (int i = 0; i < list->count - 1; i++) {
         for (int j = 0; j < list->count - 1 - i; j++) {
             int cmp = strcmp(list->students[j].last_name, list->students[j + 1].last_name);
@@ -296,11 +515,14 @@ void student_list_sort_by_name(StudentList* list) {
             }
         }
     }
+    student_list_reordered(list);
+    student_list_unlock(list);
 }
 
 // Sort students by ID in ascending order
 void student_list_sort_by_id(StudentList* list) {
     if (list == NULL || list->students == NULL || list->count < 2) return;
+    student_list_lock(list);
     for (int i = 0; i < list->count - 1; i++) {
         for (int j = 0; j < list->count - i - 1; j++) {
             if (list->students[j].id > list->students[j + 1].id) {
@@ -310,11 +532,14 @@ void student_list_sort_by_id(StudentList* list) {
             }
         }
     }
+    student_list_reordered(list);
+    student_list_unlock(list);
 }
 
 // Sort students by GPA in descending order
 void student_list_sort_by_gpa(StudentList* list) {
     if (list == NULL || list->students == NULL || list->count < 2) return;
+    student_list_lock(list);
     for (int i = 0; i < list->count - 1; i++) {
         for (int j = 0; j < list->count - i - 1; j++) {
             if (list->students[j].gpa < list->students[j + 1].gpa) {
@@ -324,6 +549,8 @@ void student_list_sort_by_gpa(StudentList* list) {
             }
         }
     }
+    student_list_reordered(list);
+    student_list_unlock(list);
 }
 
 int student_list_get_count(StudentList* list) {
@@ -341,7 +568,27 @@ Student* student_list_get_student(StudentList* list, int index){
         return NULL;
     }
 }
-int student_list_ensure_loaded(StudentList* list){
+Student* student_list_next_where(StudentList* list, int* cursor, StudentPredicate where, const void* context) {
+    if (list == NULL || list->students == NULL || cursor == NULL) {
+        return NULL;
+    }
+    while (*cursor >= 0 && *cursor < list->count) {
+        Student* student = &list->students[(*cursor)++];
+        if (where == NULL || where(student, context)) {
+            return student;
+        }
+    }
+    return NULL;
+}
+int student_list_count_where(StudentList* list, StudentPredicate where, const void* context) {
+    int cursor = 0;
+    int count = 0;
+    while (student_list_next_where(list, &cursor, where, context) != NULL) {
+        count++;
+    }
+    return count;
+}
+static int student_list_ensure_loaded_locked(StudentList* list){
     // Check for NULL pointer
     if (list == NULL) {
         printf("Error: Invalid student list (NULL pointer)\n");
@@ -374,16 +621,33 @@ int student_list_ensure_loaded(StudentList* list){
     
     // Try to load data from file
     if (student_list_load_from_file(list, list->filename) == 0) {
+        LOG_ERROR(LOG_MODULE_ID_STUDENT, "Failed to load student data from %s", list->filename);
         printf("Error: Failed to load student data from file: %s\n", list->filename);
         return 0;
     }
+
+    // Bring the file up to date with edits journaled since it was saved
+    if (!journal_replay_list(ENTITY_STUDENT, list)) {
+        LOG_ERROR(LOG_MODULE_ID_STUDENT, "Failed to replay the journal for %s", list->filename);
+        printf("Error: Failed to replay the journal for %s\n", list->filename);
+        return 0;
+    }
+
+    // Replayed edits are already durable in the journal
+    student_list_mark_clean(list);
     
     // Mark as loaded on success
     list->is_loaded = 1;
     return 1;
 }
+int student_list_ensure_loaded(StudentList* list) {
+    student_list_lock(list);
+    int ok = student_list_ensure_loaded_locked(list);
+    student_list_unlock(list);
+    return ok;
+}
 
-int student_list_save_and_unload(StudentList* list){
+static int student_list_save_and_unload_locked(StudentList* list){
     // Check for NULL pointer
     if (list == NULL) {
         printf("Error: Invalid student list (NULL pointer)\n");
@@ -403,7 +667,8 @@ int student_list_save_and_unload(StudentList* list){
     }
 
     // Save data to file
-    if (student_list_save_to_file(list, list->filename) == 0) {
+    if (student_list_save_to_file_locked(list, list->filename) == 0) {
+        LOG_ERROR(LOG_MODULE_ID_STUDENT, "Failed to save student data to %s", list->filename);
         printf("Error: Failed to save student data to file: %s\n", list->filename);
         return 0;
     }
@@ -426,12 +691,34 @@ int student_list_save_and_unload(StudentList* list){
     
     return 1;
 }
-int student_list_auto_save(StudentList* list){
-    // Check for NULL pointer
-    if (list == NULL) {
+int student_list_save_and_unload(StudentList* list) {
+    student_list_lock(list);
+    int ok = student_list_save_and_unload_locked(list);
+    student_list_unlock(list);
+    return ok;
+}
+
+// Appends the records edited outside the list functions to the journal
+// and waits for them; the rest of the changes are already in it
+static int student_list_auto_save_journal(StudentList* list) {
+    int appended = 0;
+    for (int i = 0; i < list->count && appended < list->dirty_count; i++) {
+        if (!student_list_dirty_test(list, i)) {
+            continue;
+        }
+        if (!journal_append(list->journal, ENTITY_STUDENT, CHANGE_EDIT, &list->students[i])) {
+            return 0;
+        }
+        appended++;
+    }
+    if (!journal_sync(list->journal)) {
         return 0;
     }
-    
+    LOG_DEBUG(LOG_MODULE_ID_STUDENT, "Auto-save journaled %d edited students", appended);
+    return 1;
+}
+
+static int student_list_auto_save_locked(StudentList* list){
     // Check if auto-save is enabled
     if (list->auto_save_enabled == 0) {
         return 0;
@@ -446,17 +733,41 @@ int student_list_auto_save(StudentList* list){
     if (list->filename[0] == '\0') {
         return 0;
     }
-    
-    // Save data to file
-    if (student_list_save_to_file(list, list->filename) == 0) {
-        return 0;
+
+    // Nothing changed since the last save: no I/O at all
+    if (list->generation == list->saved_generation) {
+        return 1;
+    }
+
+    if (list->journal != NULL) {
+        if (!student_list_auto_save_journal(list)) {
+            LOG_ERROR(LOG_MODULE_ID_STUDENT, "Auto-save to the journal for %s failed", list->filename);
+            return 0;
+        }
+        student_list_mark_clean(list);
+    } else {
+        // The CSV cannot be patched in place, so any change rewrites it
+        if (student_list_save_to_file_locked(list, list->filename) == 0) {
+            LOG_ERROR(LOG_MODULE_ID_STUDENT, "Auto-save to %s failed", list->filename);
+            return 0;
+        }
+        LOG_DEBUG(LOG_MODULE_ID_STUDENT, "Auto-saved %d students", list->count);
     }
     
     // Update last save time
     list->last_save_time = time(NULL);
-    
     return 1;   
 }
+int student_list_auto_save(StudentList* list) {
+    // Check for NULL pointer
+    if (list == NULL) {
+        return 0;
+    }
+    student_list_lock(list);
+    int ok = student_list_auto_save_locked(list);
+    student_list_unlock(list);
+    return ok;
+}
 int student_list_is_loaded(StudentList* list){
     if(list == NULL){
         return 0;
@@ -0,0 +1,318 @@
+#include "topk.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define TOPK_ITEM(topk, i) ((topk)->items + (size_t)(i) * (topk)->item_size)
+
+TopK* topk_create(int k, size_t item_size, TopKCompare compare) {
+    if (k <= 0 || item_size == 0 || compare == NULL) {
+        printf("Error: Invalid arguments to topk_create\n");
+        return NULL;
+    }
+
+    TopK* topk = (TopK*)malloc(sizeof(TopK));
+    if (topk == NULL) {
+        printf("Error: Failed to create top-k heap\n");
+        return NULL;
+    }
+    topk->items = (unsigned char*)malloc(item_size * (size_t)k);
+    topk->scratch = (unsigned char*)malloc(item_size);
+    if (topk->items == NULL || topk->scratch == NULL) {
+        printf("Error: Failed to allocate top-k storage\n");
+        free(topk->items);
+        free(topk->scratch);
+        free(topk);
+        return NULL;
+    }
+    topk->item_size = item_size;
+    topk->k = k;
+    topk->count = 0;
+    topk->compare = compare;
+    return topk;
+}
+
+void topk_destroy(TopK* topk) {
+    if (topk == NULL) {
+        return;
+    }
+    free(topk->items);
+    free(topk->scratch);
+    free(topk);
+}
+
+void topk_reset(TopK* topk) {
+    if (topk != NULL) {
+        topk->count = 0;
+    }
+}
+
+static void topk_swap(TopK* topk, int a, int b) {
+    memcpy(topk->scratch, TOPK_ITEM(topk, a), topk->item_size);
+    memcpy(TOPK_ITEM(topk, a), TOPK_ITEM(topk, b), topk->item_size);
+    memcpy(TOPK_ITEM(topk, b), topk->scratch, topk->item_size);
+}
+
+// The root must be the worst item: a parent never ranks ahead of its children
+static void topk_sift_up(TopK* topk, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (topk->compare(TOPK_ITEM(topk, parent), TOPK_ITEM(topk, i)) <= 0) {
+            break;
+        }
+        topk_swap(topk, parent, i);
+        i = parent;
+    }
+}
+
+static void topk_sift_down(TopK* topk, int i, int count) {
+    for (;;) {
+        int worst = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && topk->compare(TOPK_ITEM(topk, left), TOPK_ITEM(topk, worst)) < 0) {
+            worst = left;
+        }
+        if (right < count && topk->compare(TOPK_ITEM(topk, right), TOPK_ITEM(topk, worst)) < 0) {
+            worst = right;
+        }
+        if (worst == i) {
+            return;
+        }
+        topk_swap(topk, i, worst);
+        i = worst;
+    }
+}
+
+int topk_offer(TopK* topk, const void* item) {
+    if (topk == NULL || item == NULL) {
+        return 0;
+    }
+
+    if (topk->count < topk->k) {
+        memcpy(TOPK_ITEM(topk, topk->count), item, topk->item_size);
+        topk->count++;
+        topk_sift_up(topk, topk->count - 1);
+        return 1;
+    }
+
+    // Full: only an item ranking ahead of the current worst gets in
+    if (topk->compare(item, TOPK_ITEM(topk, 0)) <= 0) {
+        return 0;
+    }
+    memcpy(TOPK_ITEM(topk, 0), item, topk->item_size);
+    topk_sift_down(topk, 0, topk->count);
+    return 1;
+}
+
+int topk_merge(TopK* into, const TopK* from) {
+    if (into == NULL || from == NULL || into->item_size != from->item_size) {
+        printf("Error: Invalid arguments to topk_merge\n");
+        return 0;
+    }
+    for (int i = 0; i < from->count; i++) {
+        topk_offer(into, from->items + (size_t)i * from->item_size);
+    }
+    return 1;
+}
+
+const void* topk_worst(const TopK* topk) {
+    if (topk == NULL || topk->count == 0) {
+        return NULL;
+    }
+    return topk->items;
+}
+
+int topk_count(const TopK* topk) {
+    return topk != NULL ? topk->count : 0;
+}
+
+int topk_finish(TopK* topk, void* out) {
+    if (topk == NULL || out == NULL) {
+        return 0;
+    }
+
+    // Repeatedly move the worst item to the back, leaving the best first
+    int total = topk->count;
+    for (int n = total; n > 1; n--) {
+        topk_swap(topk, 0, n - 1);
+        topk_sift_down(topk, 0, n - 1);
+    }
+    memcpy(out, topk->items, topk->item_size * (size_t)total);
+    topk->count = 0;
+    return total;
+}
+
+typedef struct {
+    const unsigned char* base;
+    int begin;
+    int end;
+    size_t element_size;
+    TopKProject project;
+    void* user_data;
+    TopK* heap;
+    unsigned char* item;
+} TopKSlice;
+
+static void* topk_select_slice(void* arg) {
+    TopKSlice* slice = (TopKSlice*)arg;
+    for (int i = slice->begin; i < slice->end; i++) {
+        const void* element = slice->base + (size_t)i * slice->element_size;
+        if (slice->project(element, slice->item, slice->user_data)) {
+            topk_offer(slice->heap, slice->item);
+        }
+    }
+    return NULL;
+}
+
+int topk_select(const void* base, int count, size_t element_size,
+                TopKProject project, void* user_data,
+                int k, size_t item_size, TopKCompare compare,
+                void* out, int threads) {
+    if (base == NULL || count < 0 || project == NULL || out == NULL) {
+        printf("Error: Invalid arguments to topk_select\n");
+        return 0;
+    }
+
+    if (threads < 1 || count < TOPK_PARALLEL_THRESHOLD) threads = 1;
+    if (threads > TOPK_MAX_THREADS) threads = TOPK_MAX_THREADS;
+
+    TopKSlice slices[TOPK_MAX_THREADS];
+    pthread_t workers[TOPK_MAX_THREADS];
+    int started[TOPK_MAX_THREADS] = {0};
+    int created = 0;
+    int result = 0;
+
+    for (int t = 0; t < threads; t++) {
+        slices[t].base = (const unsigned char*)base;
+        slices[t].begin = (int)((long long)count * t / threads);
+        slices[t].end = (int)((long long)count * (t + 1) / threads);
+        slices[t].element_size = element_size;
+        slices[t].project = project;
+        slices[t].user_data = user_data;
+        slices[t].heap = topk_create(k, item_size, compare);
+        slices[t].item = (unsigned char*)malloc(item_size);
+        created++;
+        if (slices[t].heap == NULL || slices[t].item == NULL) {
+            printf("Error: Failed to allocate top-k slice\n");
+            goto cleanup;
+        }
+    }
+
+    // Slice 0 runs on the calling thread
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&workers[t], NULL, topk_select_slice, &slices[t]) == 0;
+        if (!started[t]) {
+            topk_select_slice(&slices[t]);
+        }
+    }
+    topk_select_slice(&slices[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        }
+    }
+
+    for (int t = 1; t < threads; t++) {
+        topk_merge(slices[0].heap, slices[t].heap);
+    }
+    result = topk_finish(slices[0].heap, out);
+
+cleanup:
+    for (int t = 0; t < created; t++) {
+        topk_destroy(slices[t].heap);
+        free(slices[t].item);
+    }
+    return result;
+}
+
+// ---- Benchmark ----
+
+typedef struct {
+    int id;
+    float gpa;
+} TopKBenchItem;
+
+static int topk_bench_compare(const void* a, const void* b) {
+    const TopKBenchItem* x = (const TopKBenchItem*)a;
+    const TopKBenchItem* y = (const TopKBenchItem*)b;
+    if (x->gpa != y->gpa) return x->gpa > y->gpa ? 1 : -1;
+    if (x->id != y->id) return x->id < y->id ? 1 : -1;
+    return 0;
+}
+
+static int topk_bench_sort_compare(const void* a, const void* b) {
+    return -topk_bench_compare(a, b);
+}
+
+static int topk_bench_project(const void* element, void* item, void* user_data) {
+    (void)user_data;
+    memcpy(item, element, sizeof(TopKBenchItem));
+    return 1;
+}
+
+static double topk_elapsed_ms(struct timespec* start, struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 + (double)(end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void topk_benchmark(int student_count, int k, int threads) {
+    if (student_count <= 0 || k <= 0) {
+        printf("Error: Invalid benchmark parameters\n");
+        return;
+    }
+
+    TopKBenchItem* students = (TopKBenchItem*)malloc(sizeof(TopKBenchItem) * student_count);
+    TopKBenchItem* sorted = (TopKBenchItem*)malloc(sizeof(TopKBenchItem) * student_count);
+    TopKBenchItem* best = (TopKBenchItem*)malloc(sizeof(TopKBenchItem) * k);
+    if (students == NULL || sorted == NULL || best == NULL) {
+        printf("Error: Failed to allocate benchmark data\n");
+        free(students);
+        free(sorted);
+        free(best);
+        return;
+    }
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < student_count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        students[i].id = i;
+        students[i].gpa = (float)((seed >> 8) % 4001) / 1000.0f;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int found = topk_select(students, student_count, sizeof(TopKBenchItem), topk_bench_project, NULL,
+                            k, sizeof(TopKBenchItem), topk_bench_compare, best, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double heap_ms = topk_elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    topk_select(students, student_count, sizeof(TopKBenchItem), topk_bench_project, NULL,
+                k, sizeof(TopKBenchItem), topk_bench_compare, best, threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double parallel_ms = topk_elapsed_ms(&start, &end);
+
+    memcpy(sorted, students, sizeof(TopKBenchItem) * student_count);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(sorted, student_count, sizeof(TopKBenchItem), topk_bench_sort_compare);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double sort_ms = topk_elapsed_ms(&start, &end);
+
+    int same = 1;
+    for (int i = 0; i < found; i++) {
+        if (best[i].id != sorted[i].id) same = 0;
+    }
+
+    printf("\n=== TOP-K BENCHMARK (%d students, k=%d) ===\n", student_count, k);
+    printf("Bounded heap:          %8.2f ms\n", heap_ms);
+    printf("Bounded heap (%2d thr): %8.2f ms\n", threads, parallel_ms);
+    printf("Full qsort:            %8.2f ms\n", sort_ms);
+    printf("Results match:         %s\n", same ? "yes" : "NO");
+
+    free(students);
+    free(sorted);
+    free(best);
+}
@@ -0,0 +1,38 @@
+#include "ui.h"
+#include "config.h"
+#include "stats.h"
+#include "stats_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ui_statistics_window_refresh_data(UIState* state) {
+    if (state == NULL) {
+        printf("Error: Invalid UI state\n");
+        return;
+    }
+
+    // With a materialized cache the refresh is a fixed-size snapshot copy
+    if (state->stats_cache != NULL) {
+        if (state->dashboard_stats == NULL) {
+            state->dashboard_stats = (StatsBundle*)malloc(sizeof(StatsBundle));
+            if (state->dashboard_stats == NULL) {
+                printf("Error: Failed to allocate dashboard statistics\n");
+                return;
+            }
+        }
+        stats_cache_snapshot(state->stats_cache, state->dashboard_stats);
+        return;
+    }
+
+    // Otherwise a single sweep over each list feeds every panel of the dashboard
+    StatsBundle* stats = calculate_all_stats(state->students, state->courses, state->grades,
+                                             state->attendance, state->clubs, state->memberships);
+    if (stats == NULL) {
+        printf("Error: Failed to refresh statistics\n");
+        return;
+    }
+
+    free_all_stats(state->dashboard_stats);
+    state->dashboard_stats = stats;
+}
@@ -0,0 +1,255 @@
+#include "utils.h"
+#include "config.h"
+#include "calendar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Date and time utilities. Day based queries go through the cached academic
+// calendar instead of calling localtime/mktime for every date.
+
+time_t utils_date_create(int year, int month, int day) {
+    if (month < 1 || month > 12 || day < 1 || day > utils_date_days_in_month(year, month)) {
+        return (time_t)-1;
+    }
+    return calendar_day_start(calendar_days_from_civil(year, month, day));
+}
+
+int utils_date_get_year(time_t date) {
+    int year;
+    calendar_civil_from_days(calendar_day_number(date), &year, NULL, NULL);
+    return year;
+}
+
+int utils_date_get_month(time_t date) {
+    int month;
+    calendar_civil_from_days(calendar_day_number(date), NULL, &month, NULL);
+    return month;
+}
+
+int utils_date_get_day(time_t date) {
+    int day;
+    calendar_civil_from_days(calendar_day_number(date), NULL, NULL, &day);
+    return day;
+}
+
+int utils_date_get_day_of_week(time_t date) {
+    return calendar_weekday(date);
+}
+
+int utils_date_get_day_of_year(time_t date) {
+    return calendar_day_of_year(calendar_day_number(date));
+}
+
+int utils_date_is_leap_year(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int utils_date_days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12) {
+        return 0;
+    }
+    if (month == 2 && utils_date_is_leap_year(year)) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+int utils_date_days_between(time_t date1, time_t date2) {
+    return calendar_days_between(date1, date2);
+}
+
+time_t utils_date_add_days(time_t date, int days) {
+    // Keep the time of day across DST changes
+    long day_number = calendar_day_number(date);
+    time_t offset = date - calendar_day_start(day_number);
+    return calendar_day_start(day_number + days) + offset;
+}
+
+int utils_date_is_weekend(time_t date) {
+    return calendar_is_weekend(date);
+}
+
+int utils_date_is_holiday(time_t date) {
+    return calendar_is_holiday(date);
+}
+
+// File utilities
+
+// Commits and in-place appends hold this shared; a snapshot holds it
+// exclusively while it links the data files and copies the appended ones
+static pthread_rwlock_t utils_snapshot_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Resolved paths of the files written in place
+static char utils_appended_files[UTILS_MAX_APPENDED_FILES][PATH_MAX];
+static int utils_appended_count = 0;
+static pthread_mutex_t utils_appended_lock = PTHREAD_MUTEX_INITIALIZER;
+
+FILE* utils_file_open_atomic(const char* filename, char* temp_path, size_t temp_size) {
+    if (filename == NULL || temp_path == NULL ||
+        snprintf(temp_path, temp_size, "%s.tmp%ld", filename, (long)getpid()) >= (int)temp_size) {
+        return NULL;
+    }
+    return fopen(temp_path, "w");
+}
+
+// Makes a rename or create in filename's directory durable
+int utils_file_sync_directory(const char* filename) {
+    if (filename == NULL) {
+        return 0;
+    }
+    char directory[512];
+    const char* slash = strrchr(filename, '/');
+    if (slash == NULL) {
+        snprintf(directory, sizeof(directory), ".");
+    } else if (slash == filename) {
+        snprintf(directory, sizeof(directory), "/");
+    } else if (snprintf(directory, sizeof(directory), "%.*s", (int)(slash - filename), filename) >=
+               (int)sizeof(directory)) {
+        return 0;
+    }
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+int utils_file_commit_atomic(FILE* file, const char* temp_path, const char* filename) {
+    if (file == NULL || temp_path == NULL || filename == NULL) {
+        return 0;
+    }
+    int ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) ok = 0;
+    if (ok) {
+        pthread_rwlock_rdlock(&utils_snapshot_lock);
+        ok = rename(temp_path, filename) == 0;
+        pthread_rwlock_unlock(&utils_snapshot_lock);
+    }
+    if (!ok) {
+        remove(temp_path);
+        return 0;
+    }
+    // Until the directory is synced a crash can bring the old file back
+    if (!utils_file_sync_directory(filename)) {
+        printf("Error: Could not sync the directory of %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+void utils_file_abort_atomic(FILE* file, const char* temp_path) {
+    if (file != NULL) fclose(file);
+    if (temp_path != NULL) remove(temp_path);
+}
+
+// Removes a file or a whole directory tree; symlinks are removed, not followed
+int utils_file_remove_tree(const char* path) {
+    if (path == NULL) {
+        return 0;
+    }
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return remove(path) == 0;
+    }
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    int ok = 1;
+    struct dirent* item;
+    char child[4096];
+    while ((item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+        if (!utils_file_remove_tree(child)) ok = 0;
+    }
+    closedir(dir);
+    return rmdir(path) == 0 && ok;
+}
+
+void utils_file_snapshot_lock(void) {
+    pthread_rwlock_wrlock(&utils_snapshot_lock);
+}
+
+void utils_file_snapshot_unlock(void) {
+    pthread_rwlock_unlock(&utils_snapshot_lock);
+}
+
+int utils_file_register_appended(const char* filename) {
+    char resolved[PATH_MAX];
+    if (filename == NULL || realpath(filename, resolved) == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&utils_appended_lock);
+    int ok = 1;
+    int found = 0;
+    for (int i = 0; i < utils_appended_count && !found; i++) {
+        found = strcmp(utils_appended_files[i], resolved) == 0;
+    }
+    if (!found) {
+        if (utils_appended_count < UTILS_MAX_APPENDED_FILES) {
+            strcpy(utils_appended_files[utils_appended_count++], resolved);
+        } else {
+            ok = 0;
+        }
+    }
+    pthread_mutex_unlock(&utils_appended_lock);
+    if (!ok) {
+        printf("Error: Too many appended files, %s is linked into snapshots\n", filename);
+    }
+    return ok;
+}
+
+void utils_file_unregister_appended(const char* filename) {
+    char resolved[PATH_MAX];
+    if (filename == NULL || realpath(filename, resolved) == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&utils_appended_lock);
+    for (int i = 0; i < utils_appended_count; i++) {
+        if (strcmp(utils_appended_files[i], resolved) == 0) {
+            utils_appended_count--;
+            memcpy(utils_appended_files[i], utils_appended_files[utils_appended_count], PATH_MAX);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&utils_appended_lock);
+}
+
+int utils_file_is_appended(const char* filename) {
+    char resolved[PATH_MAX];
+    if (filename == NULL || realpath(filename, resolved) == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&utils_appended_lock);
+    int found = 0;
+    for (int i = 0; i < utils_appended_count && !found; i++) {
+        found = strcmp(utils_appended_files[i], resolved) == 0;
+    }
+    pthread_mutex_unlock(&utils_appended_lock);
+    return found;
+}
+
+void utils_file_append_begin(void) {
+    pthread_rwlock_rdlock(&utils_snapshot_lock);
+}
+
+void utils_file_append_end(void) {
+    pthread_rwlock_unlock(&utils_snapshot_lock);
+}
@@ -0,0 +1,41 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal checks for the tests in this directory. Each test is one
+// program built from the sources it needs, e.g. from student_app:
+//
+//   gcc -std=gnu11 -Iinclude tests/test_heavy_hitters.c src/heavy_hitters.c -o test_heavy_hitters
+//
+// (the build line for each test is at the top of its file). A test prints
+// a line per failed check and exits non-zero if any failed.
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+// Stops the current test function after the first failure, for checks
+// inside long loops
+#define REQUIRE(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+            return; \
+        } \
+    } while (0)
+
+static int test_report(const char* name) {
+    printf("%s: %s\n", name, test_failures == 0 ? "ok" : "FAILED");
+    return test_failures == 0 ? 0 : 1;
+}
+
+#endif // TEST_H
@@ -0,0 +1,46 @@
+// gcc -std=gnu11 -Iinclude tests/test_auth.c src/auth.c src/rate_limiter.c src/crypto.c src/utils.c src/calendar.c
+//     src/log.c src/log_async.c src/log_codec.c src/log_store.c src/log_stats.c src/lz_block.c
+//     src/heavy_hitters.c -lcrypto -lpthread -lm -o test_auth
+#include "test.h"
+#include "auth.h"
+#include <string.h>
+#include <unistd.h>
+
+// Every account that registers survives a save and load
+static void test_users_round_trip(void) {
+    UserList* list = user_list_create();
+    REQUIRE(list != NULL);
+    CHECK(auth_register(list, "alice", "alice@school.edu", "password1", ROLE_ADMIN));
+    CHECK(auth_register(list, "bob smith", "bob@school.edu", "password2", ROLE_TEACHER));
+    // Fields that would split or end the saved line are refused
+    CHECK(!auth_register(list, "carol,admin", "carol@school.edu", "password3", ROLE_STUDENT));
+    CHECK(!auth_register(list, "dave\n1,eve", "dave@school.edu", "password4", ROLE_STUDENT));
+    CHECK(!auth_register(list, "erin", "erin@school.edu,x", "password5", ROLE_STUDENT));
+    CHECK(!auth_register(list, "frank", "frank@school.edu\r", "password6", ROLE_STUDENT));
+    CHECK(list->count == 2);
+
+    char path[] = "/tmp/test_auth_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+    CHECK(auth_save_users(list, path));
+    UserList* loaded = user_list_create();
+    REQUIRE(loaded != NULL);
+    CHECK(auth_load_users(loaded, path));
+    CHECK(loaded->count == list->count);
+    User* bob = user_list_find_by_username(loaded, "bob smith");
+    CHECK(bob != NULL && strcmp(bob->email, "bob@school.edu") == 0 && bob->role == ROLE_TEACHER);
+    Session session;
+    memset(&session, 0, sizeof(session));
+    CHECK(auth_login(loaded, "alice", "password1", &session) == 1);
+    CHECK(session.role == ROLE_ADMIN);
+
+    remove(path);
+    user_list_destroy(loaded);
+    user_list_destroy(list);
+}
+
+int main(void) {
+    test_users_round_trip();
+    return test_report("auth");
+}
@@ -0,0 +1,215 @@
+// gcc -std=gnu11 -Iinclude tests/test_backup.c src/backup.c src/backup_pipeline.c src/backup_scheduler.c src/backup_verify.c
+//     src/chunk_store.c src/crypto.c src/crypto_stream.c src/crypto_engine.c src/segment_cache.c
+//     src/file_manager.c src/lz_block.c src/utils.c src/calendar.c src/log.c src/log_async.c src/log_codec.c
+//     src/log_store.c src/log_stats.c src/heavy_hitters.c -lcrypto -lpthread -lm -o test_backup
+#define _XOPEN_SOURCE 700
+#include "test.h"
+#include "backup.h"
+#include "chunk_store.h"
+#include "backup_scheduler.h"
+#include "utils.h"
+#include <ftw.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char test_dir[64];
+static char source_dir[96];
+static char backup_dir[96];
+static char restore_dir[96];
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+static void write_source(const char* name, size_t size) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s", source_dir, name);
+    FILE* file = fopen(path, "wb");
+    REQUIRE(file != NULL);
+    unsigned int state = (unsigned int)size;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1103515245u + 12345u;
+        fputc((int)(state >> 16), file);
+    }
+    fclose(file);
+}
+
+static int same_file(const char* name) {
+    char a[160], b[160];
+    snprintf(a, sizeof(a), "%s/%s", source_dir, name);
+    snprintf(b, sizeof(b), "%s/%s", restore_dir, name);
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    int same = fa != NULL && fb != NULL;
+    while (same) {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        same = ca == cb;
+        if (ca == EOF) break;
+    }
+    if (fa != NULL) fclose(fa);
+    if (fb != NULL) fclose(fb);
+    return same;
+}
+
+static BackupResult keyed_backup(const char* name, unsigned char fill, int incremental, BackupStats* stats) {
+    BackupOptions options;
+    backup_options_init(&options);
+    options.incremental = incremental;
+    options.encrypt = 1;
+    options.threads = 2;
+    memset(options.key, fill, sizeof(options.key));
+    return create_chunked_backup(name, source_dir, backup_dir, &options, stats);
+}
+
+// Chunks stored under one key are not reused by a backup under another
+static void test_incremental_key_change(void) {
+    BackupStats stats;
+    REQUIRE(keyed_backup("first", 0x11, 0, &stats) == BACKUP_SUCCESS);
+    REQUIRE(keyed_backup("same_key", 0x11, 1, &stats) == BACKUP_SUCCESS);
+    CHECK(stats.files == 2 && stats.files_reused == 2);
+    REQUIRE(keyed_backup("new_key", 0x22, 1, &stats) == BACKUP_SUCCESS);
+    CHECK(stats.files_reused == 0 && stats.new_chunks > 0);
+
+    unsigned char key[AES_KEY_SIZE];
+    memset(key, 0x22, sizeof(key));
+    CHECK(restore_chunked_backup("new_key", backup_dir, restore_dir, key) == BACKUP_SUCCESS);
+    CHECK(same_file("students.csv") && same_file("grades.csv"));
+    // The manifest names its key, so a wrong one is refused up front
+    memset(key, 0x11, sizeof(key));
+    CHECK(restore_chunked_backup("new_key", backup_dir, restore_dir, key) != BACKUP_SUCCESS);
+}
+
+// Rewrites the path of one file in a saved manifest, as a tampered or
+// corrupted backup would have it
+static void rename_in_manifest(const char* backup_name, const char* from, const char* to) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s%s", backup_dir, backup_name, MANIFEST_EXTENSION);
+    FILE* file = fopen(path, "r");
+    REQUIRE(file != NULL);
+    char text[65536];
+    size_t length = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    text[length] = '\0';
+    char* at = strstr(text, from);
+    REQUIRE(at != NULL);
+    file = fopen(path, "w");
+    REQUIRE(file != NULL);
+    fprintf(file, "%.*s%s%s", (int)(at - text), text, to, at + strlen(from));
+    fclose(file);
+}
+
+// A manifest path that leaves the restore directory fails the whole
+// restore before anything is written
+static void test_restore_outside(void) {
+    char absolute[128];
+    snprintf(absolute, sizeof(absolute), "%s/escaped.csv", test_dir);
+    const char* bad_paths[] = { "../escaped.csv", "sub/../../escaped.csv", absolute, "./grades.csv" };
+    char target[96], escaped[128];
+    snprintf(target, sizeof(target), "%s/clean/inner", test_dir);
+    snprintf(escaped, sizeof(escaped), "%s/clean/escaped.csv", test_dir);
+    for (int i = 0; i < 4; i++) {
+        char name[32], line[160];
+        snprintf(name, sizeof(name), "tampered%d", i);
+        REQUIRE(create_full_backup(name, source_dir, backup_dir) == BACKUP_SUCCESS);
+        snprintf(line, sizeof(line), " %s\n", bad_paths[i]);
+        rename_in_manifest(name, " grades.csv\n", line);
+        CHECK(restore_chunked_backup(name, backup_dir, target, NULL) == BACKUP_ERROR_INVALID_PATH);
+        CHECK(access(escaped, F_OK) != 0);
+    }
+    char restored[160];
+    snprintf(restored, sizeof(restored), "%s/students.csv", target);
+    CHECK(access(restored, F_OK) != 0);
+}
+
+static BackupResult auto_backup_result;
+
+static void* run_auto_backup(void* arg) {
+    auto_backup_result = auto_backup_run_once((AutoBackupConfig*)arg);
+    return NULL;
+}
+
+// A file appended in place is copied into the snapshot rather than linked,
+// so what is appended while the backup reads is not part of it
+static void test_snapshot_appended(void) {
+    char journal[160];
+    snprintf(journal, sizeof(journal), "%s/lists.wal", source_dir);
+    FILE* file = fopen(journal, "w");
+    REQUIRE(file != NULL);
+    fputs("record 1\n", file);
+    fclose(file);
+    REQUIRE(utils_file_register_appended(journal));
+    write_source("filler.bin", 2 * 1024 * 1024);
+
+    AutoBackupConfig* config = auto_backup_config_create();
+    REQUIRE(config != NULL);
+    snprintf(config->backup_dir, sizeof(config->backup_dir), "%s/auto", test_dir);
+    snprintf(config->source_dir, sizeof(config->source_dir), "%s", source_dir);
+    config->compress_backups = 0;
+    config->max_read_mb_per_sec = 2;        // Keeps the run going for about a second
+    pthread_t thread;
+    REQUIRE(pthread_create(&thread, NULL, run_auto_backup, config) == 0);
+
+    AutoBackupMetrics metrics;
+    struct timespec pause = { 0, 1000000 };
+    for (int i = 0; i < 5000; i++) {
+        auto_backup_get_metrics(&metrics);
+        if (metrics.phase == AUTO_BACKUP_RUNNING || metrics.runs > 0) break;
+        nanosleep(&pause, NULL);
+    }
+    CHECK(metrics.phase == AUTO_BACKUP_RUNNING);
+    utils_file_append_begin();
+    file = fopen(journal, "a");
+    if (file != NULL) {
+        fputs("record 2\n", file);
+        fclose(file);
+    }
+    utils_file_append_end();
+    struct stat st;
+    CHECK(stat(journal, &st) == 0 && st.st_nlink == 1);
+    pthread_join(thread, NULL);
+    CHECK(auto_backup_result == BACKUP_SUCCESS);
+
+    BackupManifest* latest = backup_manifest_load_latest(config->backup_dir);
+    REQUIRE(latest != NULL);
+    char target[128], restored[160], text[64] = "";
+    snprintf(target, sizeof(target), "%s/auto_restored", test_dir);
+    CHECK(restore_chunked_backup(latest->name, config->backup_dir, target, NULL) == BACKUP_SUCCESS);
+    snprintf(restored, sizeof(restored), "%s/lists.wal", target);
+    file = fopen(restored, "r");
+    if (file != NULL) {
+        text[fread(text, 1, sizeof(text) - 1, file)] = '\0';
+        fclose(file);
+    }
+    CHECK(strcmp(text, "record 1\n") == 0);
+
+    utils_file_unregister_appended(journal);
+    backup_manifest_destroy(latest);
+    auto_backup_config_destroy(config);
+}
+
+int main(void) {
+    snprintf(test_dir, sizeof(test_dir), "/tmp/test_backup_XXXXXX");
+    if (mkdtemp(test_dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    snprintf(source_dir, sizeof(source_dir), "%s/data", test_dir);
+    snprintf(backup_dir, sizeof(backup_dir), "%s/backups", test_dir);
+    snprintf(restore_dir, sizeof(restore_dir), "%s/restored", test_dir);
+    mkdir(source_dir, 0700);
+    mkdir(backup_dir, 0700);
+    mkdir(restore_dir, 0700);
+    write_source("students.csv", 300000);
+    write_source("grades.csv", 1000);
+    test_incremental_key_change();
+    test_restore_outside();
+    test_snapshot_appended();
+    nftw(test_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return test_report("backup");
+}
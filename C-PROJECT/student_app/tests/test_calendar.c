@@ -0,0 +1,94 @@
+// gcc -std=gnu11 -Iinclude tests/test_calendar.c src/calendar.c -lpthread -o test_calendar
+#include "test.h"
+#include "calendar.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+static time_t noon(int year, int month, int day) {
+    struct tm tm_date = {0};
+    tm_date.tm_year = year - 1900;
+    tm_date.tm_mon = month - 1;
+    tm_date.tm_mday = day;
+    tm_date.tm_hour = 12;
+    tm_date.tm_isdst = -1;
+    return mktime(&tm_date);
+}
+
+// Configuration changes show up in the next lookup
+static void test_configuration(void) {
+    calendar_clear_configuration();
+    time_t march_15 = noon(2024, 3, 15);    // A Friday
+    CHECK(calendar_is_term_day(march_15) && calendar_is_school_day(march_15));
+    CHECK(!calendar_is_holiday(march_15));
+    int week = calendar_school_days_between(noon(2024, 3, 11), noon(2024, 3, 18));
+
+    CHECK(calendar_add_holiday(3, 15));
+    CHECK(calendar_is_holiday(march_15) && !calendar_is_school_day(march_15));
+    CHECK(calendar_school_days_between(noon(2024, 3, 11), noon(2024, 3, 18)) == week - 1);
+    CHECK(calendar_is_holiday(noon(2031, 3, 15)));
+    CHECK(!calendar_is_term_day(noon(2024, 7, 15)));
+
+    CHECK(calendar_add_term(7, 1, 7, 31));
+    CHECK(calendar_is_term_day(noon(2024, 7, 15)));
+    CHECK(!calendar_is_term_day(noon(2024, 3, 15)));
+
+    calendar_clear_configuration();
+    CHECK(!calendar_is_holiday(march_15) && calendar_is_term_day(march_15));
+    CHECK(calendar_is_holiday(noon(2024, 12, 25)));
+}
+
+static atomic_int readers_stop;
+
+static void* classify_dates(void* arg) {
+    long* lookups = (long*)arg;
+    time_t start = noon(2020, 1, 1);
+    while (!atomic_load(&readers_stop)) {
+        for (int day = 0; day < 3000; day += 7) {
+            time_t date = start + (time_t)day * 86400;
+            int flags = calendar_day_flags(date);
+            // The weekday never depends on the configuration
+            if ((flags & CALENDAR_WEEKDAY_MASK) != (int)((day + 3) % 7)) {
+                (*lookups) = -1000000000L;
+            }
+            calendar_school_days_between(start, date);
+            (*lookups)++;
+        }
+    }
+    return NULL;
+}
+
+// Lookups keep running while the configuration changes under them
+static void test_reconfigure_while_reading(void) {
+    pthread_t threads[3];
+    long lookups[3] = { 0, 0, 0 };
+    atomic_store(&readers_stop, 0);
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, classify_dates, &lookups[i]);
+    }
+    for (int round = 0; round < 200; round++) {
+        if (round % CALENDAR_MAX_TERMS == 0) {
+            calendar_clear_configuration();
+        }
+        calendar_add_holiday(1 + round % 12, 1 + round % 28);
+        calendar_add_term(1 + round % 12, 1, 1 + round % 12, 28);
+        calendar_day_flags(noon(2021, 1 + round % 12, 10));
+    }
+    atomic_store(&readers_stop, 1);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(lookups[i] >= 0);
+    }
+
+    calendar_clear_configuration();
+    CHECK(calendar_is_holiday(noon(2024, 5, 1)));
+    calendar_cleanup();
+    CHECK(calendar_is_holiday(noon(2024, 5, 1)));
+    CHECK(calendar_weekday(noon(2024, 3, 15)) == 5);
+    calendar_cleanup();
+}
+
+int main(void) {
+    test_configuration();
+    test_reconfigure_while_reading();
+    return test_report("calendar");
+}
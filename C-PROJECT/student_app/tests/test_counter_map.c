@@ -0,0 +1,73 @@
+// gcc -std=gnu11 -Iinclude tests/test_counter_map.c src/counter_map.c -o test_counter_map
+#include "test.h"
+#include "counter_map.h"
+#include <string.h>
+
+// Counters survive growth and match a plain array tally, negative keys and
+// zero included
+static void test_counters(void) {
+    CounterMap map;
+    CHECK(counter_map_init(&map, 4));
+    const int keys = 5000;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < keys; i++) {
+            int key = (i * 7919) % keys - keys / 2;
+            Counter* counter = counter_map_get(&map, key);
+            REQUIRE(counter != NULL && counter->key == key);
+            counter->count++;
+            counter->sum += i;
+        }
+    }
+    CHECK(map.size == keys);
+    CHECK(map.capacity >= 2 * keys);
+    int consistent = 1;
+    for (int i = 0; i < keys; i++) {
+        int key = (i * 7919) % keys - keys / 2;
+        const Counter* counter = counter_map_find(&map, key);
+        consistent = consistent && counter != NULL && counter->count == 3 && counter->sum == 3.0 * i;
+    }
+    CHECK(consistent);
+    CHECK(counter_map_find(&map, keys) == NULL);
+    CHECK(map.size == keys);
+    counter_map_free(&map);
+
+    // A zeroed map starts on first use
+    memset(&map, 0, sizeof(map));
+    CHECK(counter_map_find(&map, 1) == NULL);
+    Counter* counter = counter_map_get(&map, 1);
+    CHECK(counter != NULL && counter->count == 0 && counter->hits == 0 && counter->sum == 0.0);
+    counter_map_free(&map);
+}
+
+// Names keep first-seen order and the top counts come out sorted
+static void test_name_counts(void) {
+    NameCountList list;
+    memset(&list, 0, sizeof(list));
+    const char* courses[] = { "Math", "Physics", "Math", "Art", "Math", "Physics", "Biology" };
+    for (int i = 0; i < 7; i++) {
+        CHECK(name_count_add(&list, courses[i], 1));
+    }
+    for (int i = 0; i < 40; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Elective %d", i);
+        CHECK(name_count_add(&list, name, i == 20 ? 0 : 1));
+    }
+    CHECK(list.count == 44);
+    CHECK(strcmp(list.items[0].name, "Math") == 0 && list.items[0].count == 3);
+    CHECK(strcmp(list.items[3].name, "Biology") == 0 && list.items[3].count == 1);
+
+    int top[3];
+    name_count_top(&list, top, 3);
+    CHECK(top[0] == 3 && top[1] == 2 && top[2] == 1);
+    int all[50];
+    name_count_top(&list, all, 50);
+    CHECK(all[42] == 1 && all[43] == 0 && all[49] == 0);
+    name_count_free(&list);
+    CHECK(list.count == 0 && list.items == NULL);
+}
+
+int main(void) {
+    test_counters();
+    test_name_counts();
+    return test_report("counter_map");
+}
@@ -0,0 +1,124 @@
+// gcc -std=gnu11 -Iinclude tests/test_heavy_hitters.c src/heavy_hitters.c -o test_heavy_hitters
+#include "test.h"
+#include "heavy_hitters.h"
+#include <unistd.h>
+
+static unsigned int test_random_state = 12345;
+
+static unsigned int test_random(void) {
+    test_random_state = test_random_state * 1103515245u + 12345u;
+    return test_random_state >> 8;
+}
+
+// Every heap position is reached by exactly one hash slot, no slot points
+// past the heap, and the heap is ordered
+static int index_consistent(const HeavyHitters* sketch) {
+    int used = 0;
+    char* seen = (char*)calloc(sketch->capacity, 1);
+    for (int i = 0; i <= sketch->slot_mask; i++) {
+        int position = sketch->slots[i];
+        if (position < 0) {
+            continue;
+        }
+        if (position >= sketch->size || seen[position]) {
+            free(seen);
+            return 0;
+        }
+        seen[position] = 1;
+        used++;
+    }
+    free(seen);
+    if (used != sketch->size) {
+        return 0;
+    }
+    for (int i = 1; i < sketch->size; i++) {
+        if (sketch->heap[(i - 1) / 2].count > sketch->heap[i].count) {
+            return 0;
+        }
+    }
+    // Each tracked key is found at its own position
+    for (int i = 0; i < sketch->size; i++) {
+        if (heavy_hitters_estimate(sketch, sketch->heap[i].key) != sketch->heap[i].count) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void test_index_past_capacity(int capacity, int keys, int steps) {
+    HeavyHitters* sketch = heavy_hitters_create(capacity);
+    REQUIRE(sketch != NULL);
+    for (int step = 0; step < steps; step++) {
+        long long key = test_random() % (unsigned int)keys;
+        REQUIRE(heavy_hitters_add(sketch, key, 1 + test_random() % 3));
+        if (!index_consistent(sketch)) {
+            printf("  capacity %d, %d keys: index corrupt at step %d\n", capacity, keys, step);
+            REQUIRE(0);
+        }
+    }
+    CHECK(sketch->size == (capacity < keys ? capacity : keys));
+    heavy_hitters_destroy(sketch);
+}
+
+static void test_bounds(void) {
+    enum { KEYS = 1000, STEPS = 50000 };
+    static long long exact[KEYS];
+    HeavyHitters* sketch = heavy_hitters_create(64);
+    REQUIRE(sketch != NULL);
+    for (int step = 0; step < STEPS; step++) {
+        // Skewed: low keys are much more frequent
+        unsigned int r = test_random() % KEYS;
+        long long key = (long long)(r * r / KEYS) % KEYS;
+        exact[key]++;
+        heavy_hitters_add(sketch, key, 1);
+    }
+    CHECK(heavy_hitters_total(sketch) == STEPS);
+    for (int i = 0; i < sketch->size; i++) {
+        const HeavyHitter* h = &sketch->heap[i];
+        CHECK(h->count >= exact[h->key]);
+        CHECK(h->count - h->error <= exact[h->key]);
+    }
+    // Keys above total / capacity must be tracked
+    for (int key = 0; key < KEYS; key++) {
+        if (exact[key] > STEPS / 64) {
+            CHECK(heavy_hitters_estimate(sketch, key) >= exact[key]);
+        }
+    }
+    HeavyHitter top[3];
+    CHECK(heavy_hitters_top(sketch, top, 3) == 3);
+    CHECK(top[0].count >= top[1].count && top[1].count >= top[2].count);
+    heavy_hitters_destroy(sketch);
+}
+
+static void test_merge(void) {
+    HeavyHitters* a = heavy_hitters_create(16);
+    HeavyHitters* b = heavy_hitters_create(16);
+    REQUIRE(a != NULL && b != NULL);
+    for (int step = 0; step < 5000; step++) {
+        heavy_hitters_add(step % 2 ? a : b, test_random() % 40, 1);
+    }
+    heavy_hitters_add(a, 1000, 500);
+    heavy_hitters_add(b, 1000, 700);
+    CHECK(heavy_hitters_merge(a, b));
+    CHECK(index_consistent(a));
+    CHECK(heavy_hitters_total(a) == 5000 + 1200);
+    CHECK(heavy_hitters_estimate(a, 1000) >= 1200);
+    // The merged sketch keeps working
+    for (int step = 0; step < 2000; step++) {
+        heavy_hitters_add(a, test_random() % 60, 1);
+        REQUIRE(index_consistent(a));
+    }
+    heavy_hitters_destroy(a);
+    heavy_hitters_destroy(b);
+}
+
+int main(void) {
+    // A corrupt index can make a probe loop forever
+    alarm(60);
+    test_index_past_capacity(8, 40, 20000);
+    test_index_past_capacity(256, 2000, 20000);
+    test_index_past_capacity(1, 5, 1000);
+    test_bounds();
+    test_merge();
+    return test_report("heavy_hitters");
+}
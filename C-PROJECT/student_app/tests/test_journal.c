@@ -0,0 +1,338 @@
+// gcc -std=gnu11 -Iinclude tests/test_journal.c src/journal.c src/change_notify.c src/student.c src/grade.c
+//     src/attendance.c src/club.c src/calendar.c src/utils.c src/file_manager.c src/crypto.c src/crypto_stream.c
+//     src/crypto_engine.c src/segment_cache.c src/log.c src/log_async.c src/log_codec.c src/log_store.c
+//     src/log_stats.c src/lz_block.c src/heavy_hitters.c -lcrypto -lpthread -lm -o test_journal
+#include "test.h"
+#include "journal.h"
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// What a listener such as the stats cache sees: rows per entity and a
+// running sum of one field, kept only from change events
+typedef struct {
+    int rows[ENTITY_TYPE_COUNT];
+    double sum[ENTITY_TYPE_COUNT];
+} Tally;
+
+static double tally_value(EntityType entity, const void* row) {
+    switch (entity) {
+        case ENTITY_STUDENT: return ((const Student*)row)->gpa;
+        case ENTITY_GRADE: return ((const Grade*)row)->numeric_grade;
+        case ENTITY_ATTENDANCE: return ((const AttendanceRecord*)row)->status;
+        case ENTITY_CLUB: return ((const Club*)row)->budget;
+        case ENTITY_MEMBERSHIP: return ((const ClubMembership*)row)->is_active;
+    }
+    return 0;
+}
+
+static void tally_on_change(const ChangeEvent* event, void* user_data) {
+    Tally* tally = (Tally*)user_data;
+    if (event->old_record != NULL) {
+        tally->sum[event->entity] -= tally_value(event->entity, event->old_record);
+    }
+    if (event->new_record != NULL) {
+        tally->sum[event->entity] += tally_value(event->entity, event->new_record);
+    }
+    tally->rows[event->entity] += event->type == CHANGE_ADD ? 1 : event->type == CHANGE_REMOVE ? -1 : 0;
+}
+
+typedef struct {
+    StudentList* students;
+    GradeList* grades;
+    AttendanceList* attendance;
+    ClubList* clubs;
+    MembershipList* memberships;
+} Lists;
+
+static void lists_create(Lists* lists) {
+    lists->students = student_list_create();
+    lists->students->is_loaded = 1;
+    lists->grades = grade_list_create();
+    lists->attendance = attendance_list_create();
+    lists->clubs = club_list_create();
+    lists->memberships = membership_list_create();
+}
+
+static void lists_destroy(Lists* lists) {
+    student_list_destroy(lists->students);
+    grade_list_destroy(lists->grades);
+    attendance_list_destroy(lists->attendance);
+    club_list_destroy(lists->clubs);
+    membership_list_destroy(lists->memberships);
+}
+
+static Journal* lists_journal(Lists* lists, const char* path, const JournalConfig* config) {
+    return journal_open(path, config, lists->students, lists->grades, lists->attendance, lists->clubs,
+                        lists->memberships);
+}
+
+// The tally matches the lists it followed
+static int tally_matches(const Tally* tally, const Lists* lists) {
+    double sum[ENTITY_TYPE_COUNT] = { 0 };
+    for (int i = 0; i < lists->students->count; i++) sum[ENTITY_STUDENT] += lists->students->students[i].gpa;
+    for (int i = 0; i < lists->grades->count; i++) sum[ENTITY_GRADE] += lists->grades->grades[i].numeric_grade;
+    for (int i = 0; i < lists->attendance->count; i++)
+        sum[ENTITY_ATTENDANCE] += lists->attendance->records[i].status;
+    for (int i = 0; i < lists->clubs->count; i++) sum[ENTITY_CLUB] += lists->clubs->clubs[i].budget;
+    for (int i = 0; i < lists->memberships->count; i++)
+        sum[ENTITY_MEMBERSHIP] += lists->memberships->memberships[i].is_active;
+    int counts[ENTITY_TYPE_COUNT] = { lists->students->count, lists->grades->count, lists->attendance->count,
+                                      lists->clubs->count, lists->memberships->count };
+    for (int e = 0; e < ENTITY_TYPE_COUNT; e++) {
+        if (tally->rows[e] != counts[e] || tally->sum[e] - sum[e] > 1e-6 || sum[e] - tally->sum[e] > 1e-6) {
+            printf("  entity %d: tally %d rows / %.2f, list %d rows / %.2f\n", e, tally->rows[e], tally->sum[e],
+                   counts[e], sum[e]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static Student make_student(int id, float gpa) {
+    Student student;
+    memset(&student, 0, sizeof(student));
+    student.id = id;
+    snprintf(student.first_name, sizeof(student.first_name), "First%d", id);
+    snprintf(student.last_name, sizeof(student.last_name), "Last");
+    snprintf(student.email, sizeof(student.email), "s%d@school.edu", id);
+    student.gpa = gpa;
+    student.is_active = 1;
+    return student;
+}
+
+static AttendanceRecord make_attendance(int id, int status) {
+    AttendanceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.id = id;
+    record.student_id = id % 7 + 1;
+    record.course_id = 2;
+    record.status = status;
+    return record;
+}
+
+static ClubMembership make_membership(int id, int active) {
+    ClubMembership membership;
+    memset(&membership, 0, sizeof(membership));
+    membership.id = id;
+    membership.student_id = id;
+    membership.club_id = 1;
+    snprintf(membership.role, sizeof(membership.role), "member");
+    membership.is_active = active;
+    return membership;
+}
+
+static void make_edits(Lists* lists, int base) {
+    for (int i = 1; i <= 20; i++) {
+        student_list_add(lists->students, make_student(base + i, 2.0f));
+        attendance_list_add(lists->attendance, make_attendance(base + i, 1));
+        membership_list_add(lists->memberships, make_membership(base + i, 1));
+    }
+    student_list_update(lists->students, make_student(base + 3, 3.5f));
+    student_list_remove(lists->students, base + 4);
+    Grade grade;
+    memset(&grade, 0, sizeof(grade));
+    grade.id = base + 1;
+    grade.student_id = base + 1;
+    grade.numeric_grade = 12.0f;
+    grade_list_add(lists->grades, grade);
+    grade.numeric_grade = 15.5f;
+    grade_list_update(lists->grades, grade);
+    Club club;
+    memset(&club, 0, sizeof(club));
+    club.id = base + 1;
+    snprintf(club.name, sizeof(club.name), "Chess");
+    club.budget = 120.0f;
+    club_list_add(lists->clubs, club);
+    update_attendance(lists->attendance, base + 5, 0, "ill");
+    attendance_list_update(lists->attendance, make_attendance(base + 6, 2));
+    attendance_list_remove(lists->attendance, base + 7);
+    membership_list_update(lists->memberships, make_membership(base + 8, 0));
+}
+
+static void test_replay(const char* dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/lists.wal", dir);
+    JournalConfig config;
+    journal_config_default(&config);
+    Tally tally;
+    memset(&tally, 0, sizeof(tally));
+    Lists lists;
+    lists_create(&lists);
+    change_notify_subscribe(tally_on_change, &tally);
+
+    Journal* journal = lists_journal(&lists, path, &config);
+    REQUIRE(journal != NULL);
+    make_edits(&lists, 0);
+    CHECK(journal_checkpoint(journal));
+    // Edits after the checkpoint are replayed from the log as upserts of
+    // rows the snapshot already holds
+    make_edits(&lists, 100);
+    update_attendance(lists.attendance, 2, 3, "excused");
+    membership_list_update(lists.memberships, make_membership(2, 0));
+    student_list_update(lists.students, make_student(2, 1.5f));
+    CHECK(journal_sync(journal));
+    CHECK(tally_matches(&tally, &lists));
+
+    // Replaying into the live lists must leave listeners in step
+    CHECK(journal_replay(journal));
+    CHECK(lists.students->count == 38 && lists.attendance->count == 38 && lists.memberships->count == 40);
+    CHECK(tally_matches(&tally, &lists));
+    CHECK(journal_replay(journal));
+    CHECK(tally_matches(&tally, &lists));
+    journal_close(journal);
+    change_notify_unsubscribe(tally_on_change, &tally);
+
+    // A fresh set of lists gets the same rows back
+    Lists fresh;
+    lists_create(&fresh);
+    journal = lists_journal(&fresh, path, &config);
+    REQUIRE(journal != NULL);
+    CHECK(journal_replay(journal));
+    CHECK(fresh.students->count == lists.students->count);
+    CHECK(fresh.grades->count == 2 && fresh.clubs->count == 2);
+    CHECK(student_list_find_by_id(fresh.students, 2)->gpa == 1.5f);
+    CHECK(attendance_list_find_by_id(fresh.attendance, 2)->status == 3);
+    CHECK(strcmp(attendance_list_find_by_id(fresh.attendance, 2)->reason, "excused") == 0);
+    CHECK(membership_list_find_by_id(fresh.memberships, 108)->is_active == 0);
+    CHECK(attendance_list_find_by_id(fresh.attendance, 107) == NULL);
+    journal_close(journal);
+
+    // A torn record at the end of the log is dropped, the rest replays
+    FILE* file = fopen(path, "ab");
+    REQUIRE(file != NULL);
+    fwrite("\x30\0\0\0torn", 1, 8, file);
+    fclose(file);
+    Lists torn;
+    lists_create(&torn);
+    journal = lists_journal(&torn, path, &config);
+    REQUIRE(journal != NULL);
+    CHECK(journal_replay(journal));
+    CHECK(torn.students->count == lists.students->count && torn.attendance->count == lists.attendance->count);
+    // and the journal keeps appending after the truncated tail
+    student_list_add(torn.students, make_student(500, 2.5f));
+    journal_close(journal);
+    Lists again;
+    lists_create(&again);
+    journal = lists_journal(&again, path, &config);
+    REQUIRE(journal != NULL);
+    CHECK(journal_replay(journal));
+    CHECK(student_list_find_by_id(again.students, 500) != NULL);
+    journal_close(journal);
+
+    lists_destroy(&lists);
+    lists_destroy(&fresh);
+    lists_destroy(&torn);
+    lists_destroy(&again);
+    remove(path);
+    char snapshot[300];
+    snprintf(snapshot, sizeof(snapshot), "%s.snap", path);
+    remove(snapshot);
+}
+
+typedef struct {
+    Lists* lists;
+    int base;
+} Editor;
+
+// Grows and shrinks the lists while the main thread checkpoints; its own
+// appends start automatic checkpoints too
+static void* edit_lists(void* arg) {
+    Editor* editor = (Editor*)arg;
+    Lists* lists = editor->lists;
+    for (int i = 1; i <= 400; i++) {
+        int id = editor->base + i;
+        membership_list_add(lists->memberships, make_membership(id, 1));
+        attendance_list_add(lists->attendance, make_attendance(id, 1));
+        student_list_add(lists->students, make_student(id, 2.0f));
+        if (i % 3 == 0) {
+            membership_list_remove(lists->memberships, id - 1);
+            attendance_list_update(lists->attendance, make_attendance(id - 2, 2));
+        }
+    }
+    return NULL;
+}
+
+static void* run_checkpoint(void* arg) {
+    journal_checkpoint((Journal*)arg);
+    return NULL;
+}
+
+static void test_concurrent_checkpoint(const char* dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/busy.wal", dir);
+    JournalConfig config;
+    journal_config_default(&config);
+    config.sync_commits = 0;
+    config.checkpoint_bytes = 16 * 1024;
+    Lists lists;
+    lists_create(&lists);
+    Journal* journal = lists_journal(&lists, path, &config);
+    REQUIRE(journal != NULL);
+
+    // A checkpoint waits for a list another thread is editing in place
+    JournalStats stats;
+    membership_list_lock(lists.memberships);
+    pthread_t checkpointer;
+    REQUIRE(pthread_create(&checkpointer, NULL, run_checkpoint, journal) == 0);
+    usleep(200 * 1000);
+    journal_get_stats(journal, &stats);
+    CHECK(stats.checkpoints == 0);
+    membership_list_unlock(lists.memberships);
+    pthread_join(checkpointer, NULL);
+    journal_get_stats(journal, &stats);
+    CHECK(stats.checkpoints == 1);
+
+    Editor editors[2] = { { &lists, 0 }, { &lists, 1000 } };
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        REQUIRE(pthread_create(&threads[i], NULL, edit_lists, &editors[i]) == 0);
+    }
+    int checkpoints = 0;
+    for (int i = 0; i < 50; i++) {
+        checkpoints += journal_checkpoint(journal);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(checkpoints == 50);
+    CHECK(journal_sync(journal));
+    journal_close(journal);
+
+    // Every snapshot was a consistent copy, so the log on top of the last
+    // one rebuilds the lists exactly
+    Lists fresh;
+    lists_create(&fresh);
+    journal = lists_journal(&fresh, path, &config);
+    REQUIRE(journal != NULL);
+    CHECK(journal_replay(journal));
+    CHECK(fresh.students->count == lists.students->count);
+    CHECK(fresh.attendance->count == lists.attendance->count);
+    CHECK(fresh.memberships->count == lists.memberships->count);
+    int same = 1;
+    for (int i = 0; i < lists.attendance->count; i++) {
+        AttendanceRecord* record = attendance_list_find_by_id(fresh.attendance, lists.attendance->records[i].id);
+        same &= record != NULL && record->status == lists.attendance->records[i].status;
+    }
+    CHECK(same);
+    journal_close(journal);
+
+    lists_destroy(&lists);
+    lists_destroy(&fresh);
+    remove(path);
+    char snapshot[300];
+    snprintf(snapshot, sizeof(snapshot), "%s.snap", path);
+    remove(snapshot);
+}
+
+int main(void) {
+    char dir[] = "/tmp/test_journal_XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    test_replay(dir);
+    test_concurrent_checkpoint(dir);
+    rmdir(dir);
+    return test_report("journal");
+}
@@ -0,0 +1,123 @@
+// gcc -std=gnu11 -Iinclude tests/test_log_async.c src/log.c src/log_async.c src/log_codec.c src/log_store.c
+//     src/log_stats.c src/lz_block.c src/heavy_hitters.c src/crypto.c src/utils.c src/calendar.c
+//     -lcrypto -lpthread -lm -o test_log_async
+#include "test.h"
+#include "log_async.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BLOCK_PUSHES 3000
+
+static char log_dir[64];
+
+static void start_backend(LogOverflowPolicy policy, int ring_slots) {
+    LogConfig config;
+    memset(&config, 0, sizeof(config));
+    config.min_level = LOG_LEVEL_DEBUG;
+    config.enable_file_output = 1;
+    snprintf(config.log_directory, sizeof(config.log_directory), "%s", log_dir);
+    snprintf(config.log_filename, sizeof(config.log_filename), "test.log");
+    LogAsyncConfig async_config = { ring_slots, policy, LOG_ASYNC_DEFAULT_FLUSH_MS };
+    CHECK(log_async_start(&config, &async_config));
+}
+
+static long count_lines(void) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/test.log", log_dir);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    long lines = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        lines += c == '\n';
+    }
+    fclose(file);
+    remove(path);
+    return lines;
+}
+
+static void* push_block(void* arg) {
+    long thread = (long)arg;
+    for (int i = 0; i < BLOCK_PUSHES; i++) {
+        log_async_push(LOG_LEVEL_INFO, LOG_MODULE_ID_STUDENT, 1, "thread %ld record %d", thread, i);
+    }
+    return NULL;
+}
+
+// Blocked producers sleep until the writer drains; nothing is dropped
+static void test_block_policy(void) {
+    LogAsyncStats before;
+    log_async_get_stats(&before);
+    start_backend(LOG_OVERFLOW_BLOCK, 8);
+    pthread_t threads[3];
+    for (long i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, push_block, (void*)i);
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    log_async_stop();
+
+    LogAsyncStats stats;
+    log_async_get_stats(&stats);
+    CHECK(stats.records_dropped == before.records_dropped);
+    CHECK(stats.records_pushed - before.records_pushed == 3 * BLOCK_PUSHES);
+    CHECK(stats.records_written - before.records_written == 3 * BLOCK_PUSHES);
+    CHECK(count_lines() == 3 * BLOCK_PUSHES);
+}
+
+static void* push_until_stopped(void* arg) {
+    long* accepted = (long*)arg;
+    while (log_async_push(LOG_LEVEL_INFO, LOG_MODULE_ID_BACKUP, 0, "record %ld of %s", *accepted, "a busy thread")) {
+        (*accepted)++;
+        if (*accepted % 64 == 0) {
+            log_async_flush();
+        }
+    }
+    return NULL;
+}
+
+// Threads still logging while the backend stops: every accepted record is
+// written and later calls are refused instead of touching freed rings
+static void test_stop_while_logging(void) {
+    for (int round = 0; round < 3; round++) {
+        LogAsyncStats before;
+        log_async_get_stats(&before);
+        start_backend(round == 1 ? LOG_OVERFLOW_DROP : LOG_OVERFLOW_BLOCK, 16);
+        pthread_t threads[3];
+        long accepted[3] = { 0, 0, 0 };
+        for (int i = 0; i < 3; i++) {
+            pthread_create(&threads[i], NULL, push_until_stopped, &accepted[i]);
+        }
+        struct timespec pause = { 0, 20000000 };
+        nanosleep(&pause, NULL);
+        log_async_stop();
+        for (int i = 0; i < 3; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        CHECK(log_async_push(LOG_LEVEL_INFO, LOG_MODULE_ID_BACKUP, 1, "after stop") == 0);
+
+        LogAsyncStats stats;
+        log_async_get_stats(&stats);
+        long total = accepted[0] + accepted[1] + accepted[2];
+        CHECK(stats.records_pushed - before.records_pushed == (unsigned long long)total);
+        CHECK(stats.records_written - before.records_written == (unsigned long long)total);
+        CHECK(count_lines() == total);
+    }
+}
+
+int main(void) {
+    snprintf(log_dir, sizeof(log_dir), "/tmp/test_log_async_XXXXXX");
+    if (mkdtemp(log_dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    test_block_policy();
+    test_stop_while_logging();
+    rmdir(log_dir);
+    return test_report("log_async");
+}
@@ -0,0 +1,156 @@
+// gcc -std=gnu11 -Iinclude tests/test_log_codec.c src/log_codec.c src/lz_block.c src/log.c src/log_async.c
+//     src/log_store.c src/log_stats.c src/heavy_hitters.c src/crypto.c src/utils.c src/calendar.c
+//     -lcrypto -lpthread -lm -o test_log_codec
+#include "test.h"
+#include "log_codec.h"
+#include <string.h>
+#include <unistd.h>
+
+static char test_dir[64];
+
+static void make_entry(LogEntry* entry, int i) {
+    memset(entry, 0, sizeof(LogEntry));
+    entry->timestamp = 1700000000 + i * 3 - (i % 5 == 0 ? 40 : 0);     // Some out of order
+    entry->level = (LogLevel)(i % 5);
+    snprintf(entry->module, sizeof(entry->module), "%s", i % 3 == 0 ? LOG_MODULE_AUTH : LOG_MODULE_GRADE);
+    entry->user_id = i % 7 == 0 ? -1 : 1000 + i % 40;
+    snprintf(entry->username, sizeof(entry->username), "user%d", i % 40);
+    if (i % 4 == 0) {
+        snprintf(entry->ip_address, sizeof(entry->ip_address), "10.0.%d.%d", i % 256, (i * 7) % 256);
+    } else if (i % 4 == 1) {
+        snprintf(entry->ip_address, sizeof(entry->ip_address), "localhost");
+    }
+    snprintf(entry->message, sizeof(entry->message), "Grade %d recorded for course %d", i, i % 12);
+}
+
+static int same_entry(const LogEntry* a, const LogEntry* b) {
+    return a->timestamp == b->timestamp && a->level == b->level && a->user_id == b->user_id &&
+           strcmp(a->module, b->module) == 0 && strcmp(a->username, b->username) == 0 &&
+           strcmp(a->ip_address, b->ip_address) == 0 && strcmp(a->message, b->message) == 0;
+}
+
+// Every field comes back from a block as it went in
+static void test_block_round_trip(void) {
+    LogBlockEncoder encoder;
+    LogBlockDecoder decoder;
+    LogBuffer block;
+    memset(&block, 0, sizeof(block));
+    log_block_encoder_init(&encoder);
+    log_block_decoder_init(&decoder);
+
+    const int count = 1000;
+    LogEntry entry, decoded;
+    for (int i = 0; i < count; i++) {
+        make_entry(&entry, i);
+        CHECK(log_block_encoder_add(&encoder, &entry));
+    }
+    CHECK(log_block_encoder_finish(&encoder, &block));
+    CHECK(block.size < (size_t)count * 64);
+
+    REQUIRE(log_block_decoder_open(&decoder, block.data, block.size));
+    int decoded_count = 0;
+    int same = 1;
+    while (log_block_decoder_next(&decoder, &decoded)) {
+        make_entry(&entry, decoded_count++);
+        same = same && same_entry(&entry, &decoded);
+    }
+    CHECK(decoded_count == count && same);
+
+    // A truncated block is refused or ends early, never overread
+    LogBlockDecoder cut;
+    log_block_decoder_init(&cut);
+    int read = 0;
+    if (log_block_decoder_open(&cut, block.data, block.size / 2)) {
+        while (log_block_decoder_next(&cut, &decoded)) read++;
+    }
+    CHECK(read < count);
+
+    log_block_decoder_free(&cut);
+    log_block_decoder_free(&decoder);
+    log_block_encoder_free(&encoder);
+    log_buffer_free(&block);
+}
+
+// Files with several blocks read back in order, compressed or not
+static void test_file_round_trip(void) {
+    const int count = 3 * LOG_CODEC_BLOCK_ENTRIES + 17;
+    long long sizes[2];
+    for (int compress = 0; compress < 2; compress++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/logs%d.slog", test_dir, compress);
+        LogWriter* writer = log_writer_open(path, compress);
+        REQUIRE(writer != NULL);
+        LogEntry entry, read_back;
+        for (int i = 0; i < count; i++) {
+            make_entry(&entry, i);
+            CHECK(log_writer_append(writer, &entry));
+        }
+        sizes[compress] = writer->stored_bytes;
+        CHECK(log_writer_close(writer));
+        CHECK(log_codec_is_compact_file(path));
+
+        LogReader* reader = log_reader_open(path);
+        REQUIRE(reader != NULL);
+        CHECK(reader->format == LOG_FORMAT_COMPACT);
+        int read = 0;
+        int same = 1;
+        while (log_reader_next(reader, &read_back)) {
+            make_entry(&entry, read++);
+            same = same && same_entry(&entry, &read_back);
+        }
+        CHECK(read == count && same);
+        log_reader_close(reader);
+        remove(path);
+    }
+    CHECK(sizes[1] < sizes[0]);
+}
+
+// Text logs are read line by line and can be rewritten compact
+static void test_text_file(void) {
+    char text_path[128], compact_path[128];
+    snprintf(text_path, sizeof(text_path), "%s/app.log", test_dir);
+    snprintf(compact_path, sizeof(compact_path), "%s/app.slog", test_dir);
+    FILE* file = fopen(text_path, "w");
+    REQUIRE(file != NULL);
+    fprintf(file, "[2024-03-15 09:30:00.125] [WARNING] [AUTH] Failed login for bob\n");
+    fprintf(file, "[2024-03-15 09:31:00.000] [INFO] [STUDENT] Student 12 added\n");
+    fclose(file);
+    CHECK(!log_codec_is_compact_file(text_path));
+
+    LogReader* reader = log_reader_open(text_path);
+    REQUIRE(reader != NULL);
+    CHECK(reader->format == LOG_FORMAT_TEXT);
+    LogEntry first, second;
+    CHECK(log_reader_next(reader, &first) && log_reader_next(reader, &second));
+    CHECK(first.level == LOG_LEVEL_WARNING && strcmp(first.module, LOG_MODULE_AUTH) == 0);
+    CHECK(strcmp(first.message, "Failed login for bob") == 0);
+    CHECK(second.timestamp - first.timestamp == 60);
+    log_reader_close(reader);
+
+    CHECK(log_codec_compress_file(text_path, compact_path));
+    reader = log_reader_open(compact_path);
+    REQUIRE(reader != NULL);
+    LogEntry entry;
+    int read = 0;
+    while (log_reader_next(reader, &entry)) {
+        CHECK(same_entry(&entry, read == 0 ? &first : &second));
+        read++;
+    }
+    CHECK(read == 2);
+    log_reader_close(reader);
+    remove(text_path);
+    remove(compact_path);
+}
+
+int main(void) {
+    snprintf(test_dir, sizeof(test_dir), "/tmp/test_log_codec_XXXXXX");
+    if (mkdtemp(test_dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    test_block_round_trip();
+    test_file_round_trip();
+    test_text_file();
+    rmdir(test_dir);
+    return test_report("log_codec");
+}
@@ -0,0 +1,84 @@
+// gcc -std=gnu11 -Iinclude tests/test_log_stats.c src/log.c src/log_async.c src/log_codec.c src/log_store.c
+//     src/log_stats.c src/lz_block.c src/heavy_hitters.c src/utils.c src/calendar.c -lcrypto -lpthread -lm
+//     -o test_log_stats
+#include "test.h"
+#include "log.h"
+#include "log_codec.h"
+#include <string.h>
+#include <unistd.h>
+
+static char test_dir[64];
+static char test_log[128];
+
+// Writes a log the way the application does: through log_init and the
+// async writer, which only stores the formatted text
+static void write_log(void) {
+    LogConfig* config = log_config_create();
+    REQUIRE(config != NULL);
+    snprintf(config->log_directory, sizeof(config->log_directory), "%s", test_dir);
+    snprintf(config->log_filename, sizeof(config->log_filename), "app.log");
+    REQUIRE(log_init(config));
+    for (int i = 0; i < 5; i++) {
+        log_user_login(7, "alice", "192.0.2.1");
+    }
+    log_user_logout(7, "alice");
+    for (int i = 0; i < 3; i++) {
+        log_grade_added(100 + i, 2, 15.5f, 3);
+    }
+    log_student_added(12, "Carol by user 99", 4);
+    log_system_startup();
+    log_cleanup();
+    log_config_destroy(config);
+}
+
+static void check_users(const char* log_file) {
+    LogStatistics* stats = calculate_log_statistics_from_files(log_file, 0, 2);
+    REQUIRE(stats != NULL);
+    CHECK(stats->total_entries == 11);
+    CHECK(stats->most_active_user == 7);
+    CHECK(stats->top_user_count == 3);
+    CHECK(stats->top_users[0] == 7 && stats->top_user_entries[0] == 6);
+    CHECK(stats->top_users[1] == 3 && stats->top_user_entries[1] == 3);
+    CHECK(stats->top_users[2] == 4 && stats->top_user_entries[2] == 1);
+    free_log_statistics(stats);
+}
+
+static void test_text_entries(void) {
+    LogReader* reader = log_reader_open(test_log);
+    REQUIRE(reader != NULL);
+    LogEntry entry;
+    REQUIRE(log_reader_next(reader, &entry));
+    CHECK(entry.user_id == 7);
+    CHECK(strcmp(entry.username, "alice") == 0);
+    int last_user = -1;
+    while (log_reader_next(reader, &entry)) {
+        last_user = entry.user_id;
+    }
+    // The startup message names no user
+    CHECK(last_user == 0);
+    log_reader_close(reader);
+}
+
+int main(void) {
+    snprintf(test_dir, sizeof(test_dir), "/tmp/test_log_stats_XXXXXX");
+    if (mkdtemp(test_dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    snprintf(test_log, sizeof(test_log), "%s/app.log", test_dir);
+    write_log();
+    test_text_entries();
+    check_users(test_log);
+
+    // Converted to the compact format, the user ids are stored as fields
+    char compact[160];
+    snprintf(compact, sizeof(compact), "%s/compact.log", test_dir);
+    CHECK(log_codec_compress_file(test_log, compact));
+    CHECK(log_codec_is_compact_file(compact));
+    check_users(compact);
+
+    remove(compact);
+    remove(test_log);
+    rmdir(test_dir);
+    return test_report("log_stats");
+}
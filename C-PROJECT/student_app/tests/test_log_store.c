@@ -0,0 +1,67 @@
+// gcc -std=gnu11 -Iinclude tests/test_log_store.c src/log_store.c src/log.c src/log_async.c src/log_codec.c
+//     src/log_stats.c src/lz_block.c src/heavy_hitters.c src/crypto.c src/utils.c src/calendar.c
+//     -lcrypto -lpthread -lm -o test_log_store
+#include "test.h"
+#include "log_store.h"
+#include <string.h>
+
+static long long count_module(LogStore* store, const char* module) {
+    LogCursor* cursor = log_store_filter_by_module(store, module);
+    long long count = log_cursor_count(cursor);
+    log_cursor_destroy(cursor);
+    return count;
+}
+
+// Modules past the table size are stored under OTHER and counted, instead
+// of being filed under whichever module came first
+static void test_module_overflow(void) {
+    LogStore* store = log_store_create();
+    REQUIRE(store != NULL);
+    char module[32];
+    for (int i = 0; i < LOG_STORE_MAX_MODULES + 6; i++) {
+        snprintf(module, sizeof(module), "M%d", i);
+        for (int copy = 0; copy <= i % 2; copy++) {
+            CHECK(log_store_append_fields(store, 1700000000 + i, LOG_LEVEL_INFO, module, i, "user",
+                                          "127.0.0.1", "entry"));
+        }
+    }
+    // M63 through M69 do not fit; each odd one was logged twice
+    CHECK(log_store_module_overflow(store) == 7 + 4);
+    CHECK(count_module(store, "M0") == 1);
+    CHECK(count_module(store, "M1") == 2);
+    CHECK(count_module(store, "M62") == 1);
+    CHECK(count_module(store, "M65") == 11);
+    CHECK(count_module(store, LOG_STORE_OVERFLOW_NAME) == 11);
+    CHECK(count_module(store, "never logged") == 11);
+
+    LogCursor* cursor = log_store_filter_by_user(store, 68);
+    LogRecordView view;
+    REQUIRE(cursor != NULL);
+    CHECK(log_cursor_next(cursor, &view) && strcmp(view.module, LOG_STORE_OVERFLOW_NAME) == 0);
+    log_cursor_destroy(cursor);
+
+    // Sealing builds the module row sets; the answers stay the same
+    CHECK(log_store_seal(store));
+    CHECK(count_module(store, "M0") == 1);
+    CHECK(count_module(store, "M65") == 11);
+    log_store_destroy(store);
+}
+
+// A store that never overflows still treats unknown modules as no match
+static void test_unknown_module(void) {
+    LogStore* store = log_store_create();
+    REQUIRE(store != NULL);
+    CHECK(log_store_append_fields(store, 1700000000, LOG_LEVEL_ERROR, LOG_MODULE_AUTH, 1, "admin",
+                                  "10.0.0.1", "login failed"));
+    CHECK(count_module(store, LOG_MODULE_AUTH) == 1);
+    CHECK(count_module(store, LOG_MODULE_GRADE) == 0);
+    CHECK(count_module(store, LOG_STORE_OVERFLOW_NAME) == 0);
+    CHECK(log_store_module_overflow(store) == 0);
+    log_store_destroy(store);
+}
+
+int main(void) {
+    test_module_overflow();
+    test_unknown_module();
+    return test_report("log_store");
+}
@@ -0,0 +1,95 @@
+// gcc -std=gnu11 -Iinclude tests/test_lz_block.c src/lz_block.c -o test_lz_block
+#include "test.h"
+#include "lz_block.h"
+#include <string.h>
+
+// Compresses, checks the bound, decompresses and compares
+static int round_trip(const unsigned char* data, int size, int* compressed_size) {
+    int bound = lz_block_bound(size);
+    unsigned char* packed = (unsigned char*)malloc(bound > 0 ? bound : 1);
+    unsigned char* unpacked = (unsigned char*)malloc(size > 0 ? size : 1);
+    int ok = packed != NULL && unpacked != NULL;
+    int packed_size = ok ? lz_block_compress(data, size, packed, bound) : -1;
+    ok = ok && packed_size >= 0 && packed_size <= bound;
+    ok = ok && lz_block_decompress(packed, packed_size, unpacked, size) == size &&
+         memcmp(unpacked, data, size) == 0;
+    if (compressed_size != NULL) {
+        *compressed_size = packed_size;
+    }
+    free(packed);
+    free(unpacked);
+    return ok;
+}
+
+static void test_round_trips(void) {
+    static unsigned char data[200000];
+    int size;
+
+    CHECK(round_trip(data, 0, NULL));
+    data[0] = 'x';
+    CHECK(round_trip(data, 1, NULL));
+
+    // Repetitive text, like log lines, shrinks
+    size = 0;
+    for (int i = 0; size + 80 < (int)sizeof(data); i++) {
+        size += snprintf((char*)data + size, sizeof(data) - size,
+                         "[2024-03-%02d 10:00:00] [INFO] [STUDENT] Student %d updated\n", 1 + i % 28, i);
+    }
+    int packed = 0;
+    CHECK(round_trip(data, size, &packed));
+    CHECK(packed < size / 3);
+
+    // Long runs exercise overlapping matches and long length fields
+    memset(data, 'a', sizeof(data));
+    CHECK(round_trip(data, (int)sizeof(data), &packed));
+    CHECK(packed < 1000);
+
+    // Random bytes do not compress but stay within the bound
+    unsigned int state = 1;
+    for (int i = 0; i < (int)sizeof(data); i++) {
+        state = state * 1103515245u + 12345u;
+        data[i] = (unsigned char)(state >> 16);
+    }
+    CHECK(round_trip(data, (int)sizeof(data), NULL));
+    for (int n = 2; n < 40; n++) {
+        CHECK(round_trip(data, n, NULL));
+    }
+}
+
+// Too little room and malformed input are refused, never overrun
+static void test_rejects(void) {
+    unsigned char text[4096];
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        text[i] = (unsigned char)("student grades "[i % 15]);
+    }
+    unsigned char packed[8192];
+    unsigned char unpacked[4096];
+    int size = lz_block_compress(text, sizeof(text), packed, sizeof(packed));
+    REQUIRE(size > 0);
+    CHECK(lz_block_compress(text, sizeof(text), packed, 4) == -1);
+    CHECK(lz_block_decompress(packed, size, unpacked, sizeof(unpacked) - 1) == -1);
+    CHECK(lz_block_decompress(packed, size - 1, unpacked, sizeof(unpacked)) == -1);
+    CHECK(lz_block_compress(text, LZ_BLOCK_MAX_INPUT + 1, packed, sizeof(packed)) == -1);
+
+    // An offset reaching before the start of the output
+    const unsigned char bad_offset[] = { 0x14, 'a', 0x10, 0x00 };
+    CHECK(lz_block_decompress(bad_offset, sizeof(bad_offset), unpacked, sizeof(unpacked)) == -1);
+
+    // Arbitrary bytes either decode within the buffer or are refused
+    unsigned int state = 7;
+    for (int round = 0; round < 2000; round++) {
+        unsigned char noise[64];
+        for (int i = 0; i < 64; i++) {
+            state = state * 1103515245u + 12345u;
+            noise[i] = (unsigned char)(state >> 16);
+        }
+        int got = lz_block_decompress(noise, 1 + round % 64, unpacked, 256);
+        CHECK(got >= -1 && got <= 256);
+    }
+}
+
+int main(void) {
+    test_round_trips();
+    test_rejects();
+    return test_report("lz_block");
+}
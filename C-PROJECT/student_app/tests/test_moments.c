@@ -0,0 +1,136 @@
+// gcc -std=gnu11 -Iinclude tests/test_moments.c src/moments.c -lpthread -lm -o test_moments
+#include "test.h"
+#include "moments.h"
+#include <math.h>
+#include <string.h>
+
+static unsigned int test_random_state = 777;
+
+static float test_random_unit(void) {
+    test_random_state = test_random_state * 1103515245u + 12345u;
+    return (float)(test_random_state >> 8) / 16777216.0f;
+}
+
+static int close_to(double a, double b, double tolerance) {
+    return fabs(a - b) <= tolerance * (fabs(b) > 1.0 ? fabs(b) : 1.0);
+}
+
+// Two-pass reference in long double
+static void reference(const float* x, const float* y, int count, double* mean, double* variance,
+                      double* covariance) {
+    long double sx = 0, sy = 0;
+    for (int i = 0; i < count; i++) {
+        sx += x[i];
+        sy += y[i];
+    }
+    long double mx = sx / count, my = sy / count, vx = 0, cxy = 0;
+    for (int i = 0; i < count; i++) {
+        vx += (x[i] - mx) * (x[i] - mx);
+        cxy += (x[i] - mx) * (y[i] - my);
+    }
+    *mean = (double)mx;
+    *variance = (double)(vx / count);
+    *covariance = (double)(cxy / count);
+}
+
+// Adding one value at a time, merging halves and the array kernels agree
+// with a two-pass computation
+static void test_accumulators(void) {
+    const int count = 10000;
+    float x[10000], y[10000];
+    for (int i = 0; i < count; i++) {
+        x[i] = 2.0f + 4.0f * test_random_unit();
+        y[i] = 0.5f * x[i] + test_random_unit();
+    }
+    double mean, variance, covariance;
+    reference(x, y, count, &mean, &variance, &covariance);
+
+    StatsMoments all, first, second;
+    stats_moments_init(&all);
+    stats_moments_init(&first);
+    stats_moments_init(&second);
+    for (int i = 0; i < count; i++) {
+        stats_moments_add(&all, x[i]);
+        stats_moments_add(i < 3000 ? &first : &second, x[i]);
+    }
+    stats_moments_merge(&first, &second);
+    CHECK(all.n == count && first.n == count);
+    CHECK(close_to(all.mean, mean, 1e-9) && close_to(stats_moments_variance(&all), variance, 1e-9));
+    CHECK(close_to(first.mean, mean, 1e-9) && close_to(stats_moments_variance(&first), variance, 1e-9));
+    CHECK(close_to(stats_moments_stddev(&all), sqrt(variance), 1e-9));
+
+    StatsComoments c;
+    stats_comoments_init(&c);
+    for (int i = 0; i < count; i++) {
+        stats_comoments_add(&c, x[i], y[i]);
+    }
+    CHECK(close_to(stats_comoments_covariance(&c), covariance, 1e-9));
+    double correlation = stats_comoments_correlation(&c);
+    CHECK(correlation > 0.8 && correlation < 1.0);
+
+    for (int scalar = 0; scalar < 2; scalar++) {
+        stats_moments_force_scalar(scalar);
+        StatsMoments kernel;
+        stats_moments_init(&kernel);
+        stats_moments_accumulate(&kernel, x, count);
+        CHECK(kernel.n == count && close_to(kernel.mean, mean, 1e-6));
+        CHECK(close_to(stats_moments_variance(&kernel), variance, 1e-6));
+        StatsComoments joint;
+        stats_comoments_init(&joint);
+        stats_comoments_accumulate(&joint, x, y, count);
+        CHECK(close_to(stats_comoments_correlation(&joint), correlation, 1e-6));
+    }
+    stats_moments_force_scalar(0);
+}
+
+// Block-parallel results do not depend on the thread count or the kernel
+static void test_parallel_deterministic(void) {
+    const int count = MOMENTS_PARALLEL_THRESHOLD + 12345;
+    float* x = (float*)malloc(sizeof(float) * count);
+    float* y = (float*)malloc(sizeof(float) * count);
+    REQUIRE(x != NULL && y != NULL);
+    for (int i = 0; i < count; i++) {
+        x[i] = 60.0f + 40.0f * test_random_unit();
+        y[i] = x[i] * 0.01f + test_random_unit();
+    }
+
+    StatsMoments one, many;
+    StatsComoments joint_one, joint_many;
+    CHECK(stats_moments_compute(x, count, 1, &one));
+    CHECK(stats_moments_compute(x, count, 4, &many));
+    CHECK(memcmp(&one, &many, sizeof(one)) == 0);
+    CHECK(stats_comoments_compute(x, y, count, 1, &joint_one));
+    CHECK(stats_comoments_compute(x, y, count, 3, &joint_many));
+    CHECK(memcmp(&joint_one, &joint_many, sizeof(joint_one)) == 0);
+
+    double mean, variance, covariance;
+    reference(x, y, count, &mean, &variance, &covariance);
+    CHECK(one.n == count && close_to(one.mean, mean, 1e-6));
+    CHECK(close_to(stats_moments_variance(&one), variance, 1e-5));
+    CHECK(close_to(stats_comoments_covariance(&joint_one), covariance, 1e-5));
+    free(x);
+    free(y);
+}
+
+// Empty and single inputs have no spread
+static void test_degenerate(void) {
+    StatsMoments m;
+    stats_moments_init(&m);
+    CHECK(stats_moments_variance(&m) == 0.0);
+    stats_moments_add(&m, 3.5);
+    CHECK(m.mean == 3.5 && stats_moments_variance(&m) == 0.0);
+
+    StatsComoments c;
+    stats_comoments_init(&c);
+    stats_comoments_add(&c, 1.0, 2.0);
+    stats_comoments_add(&c, 1.0, 5.0);
+    CHECK(stats_comoments_covariance(&c) == 0.0);
+    CHECK(!isnan(stats_comoments_correlation(&c)));
+}
+
+int main(void) {
+    test_accumulators();
+    test_parallel_deterministic();
+    test_degenerate();
+    return test_report("moments");
+}
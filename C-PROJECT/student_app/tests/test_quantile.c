@@ -0,0 +1,121 @@
+// gcc -std=gnu11 -Iinclude tests/test_quantile.c src/quantile.c -lm -o test_quantile
+#include "test.h"
+#include "quantile.h"
+#include <math.h>
+
+static unsigned int test_random_state = 4242;
+
+static float test_random_unit(void) {
+    test_random_state = test_random_state * 1103515245u + 12345u;
+    return (float)(test_random_state >> 8) / 16777216.0f;
+}
+
+// Exact rank of `value` among the inputs, as a fraction
+static double exact_rank(const float* values, int count, float value) {
+    int below = 0;
+    for (int i = 0; i < count; i++) {
+        below += values[i] <= value;
+    }
+    return (double)below / count;
+}
+
+// Quantiles land within the sketch's rank error of the exact answer
+static void test_accuracy(void) {
+    const int count = 200000;
+    float* values = (float*)malloc(sizeof(float) * count);
+    REQUIRE(values != NULL);
+    QuantileSketch* sketch = quantile_sketch_create(QUANTILE_DEFAULT_K);
+    REQUIRE(sketch != NULL);
+    for (int i = 0; i < count; i++) {
+        // Skewed like grades: most near the top
+        values[i] = 100.0f * sqrtf(test_random_unit());
+        CHECK(quantile_sketch_add(sketch, values[i]));
+    }
+    CHECK(quantile_sketch_count(sketch) == count);
+
+    int stored = 0;
+    for (int h = 0; h < sketch->level_count; h++) {
+        stored += sketch->levels[h].count;
+    }
+    CHECK(stored < 4 * QUANTILE_DEFAULT_K);
+
+    const float qs[] = { 0.01f, 0.1f, 0.25f, 0.5f, 0.75f, 0.9f, 0.99f };
+    for (int i = 0; i < 7; i++) {
+        float estimate = quantile_sketch_query(sketch, qs[i]);
+        CHECK(fabs(exact_rank(values, count, estimate) - qs[i]) < 0.02);
+        CHECK(fabs(quantile_sketch_rank(sketch, estimate) - qs[i]) < 0.02);
+    }
+
+    float min_value = values[0], max_value = values[0];
+    for (int i = 1; i < count; i++) {
+        if (values[i] < min_value) min_value = values[i];
+        if (values[i] > max_value) max_value = values[i];
+    }
+    CHECK(quantile_sketch_query(sketch, 0.0f) == min_value);
+    CHECK(quantile_sketch_query(sketch, 1.0f) == max_value);
+
+    quantile_sketch_destroy(sketch);
+    free(values);
+}
+
+// Sketches built over separate halves merge into one as accurate as a
+// sketch over everything
+static void test_merge(void) {
+    const int count = 100000;
+    QuantileSketch* low = quantile_sketch_create(QUANTILE_DEFAULT_K);
+    QuantileSketch* high = quantile_sketch_create(QUANTILE_DEFAULT_K);
+    REQUIRE(low != NULL && high != NULL);
+    for (int i = 0; i < count; i++) {
+        CHECK(quantile_sketch_add(low, (float)i));
+        CHECK(quantile_sketch_add(high, (float)(count + i)));
+    }
+    CHECK(quantile_sketch_merge(low, high));
+    CHECK(quantile_sketch_count(low) == 2 * count);
+    CHECK(fabs(quantile_sketch_query(low, 0.5f) - count) < 0.02 * 2 * count);
+    CHECK(fabs(quantile_sketch_query(low, 0.25f) - count / 2) < 0.02 * 2 * count);
+    CHECK(quantile_sketch_query(low, 0.0f) == 0.0f);
+    CHECK(quantile_sketch_query(low, 1.0f) == (float)(2 * count - 1));
+
+    quantile_sketch_reset(low);
+    CHECK(quantile_sketch_count(low) == 0);
+    CHECK(quantile_sketch_query(low, 0.5f) == 0.0f);
+    quantile_sketch_destroy(low);
+    quantile_sketch_destroy(high);
+}
+
+// Small inputs are kept exactly
+static void test_small_exact(void) {
+    QuantileSketch* sketch = quantile_sketch_create(QUANTILE_DEFAULT_K);
+    REQUIRE(sketch != NULL);
+    const float grades[] = { 55, 90, 72, 81, 64, 99, 47, 88, 73, 60 };
+    CHECK(quantile_sketch_add_array(sketch, grades, 10));
+    CHECK(quantile_sketch_query(sketch, 0.5f) == 72.0f);
+    CHECK(quantile_sketch_rank(sketch, 80.0f) == 0.6f);
+    quantile_sketch_destroy(sketch);
+}
+
+// Selection leaves the k-th smallest in place with the partition around it
+static void test_select_nth(void) {
+    const int count = 1001;
+    float values[1001];
+    for (int k = 0; k < count; k += 125) {
+        for (int i = 0; i < count; i++) {
+            values[i] = (float)((i * 7919) % count);
+        }
+        CHECK(quantile_select_nth(values, count, k) == (float)k);
+        CHECK(values[k] == (float)k);
+        int ordered = 1;
+        for (int i = 0; i < count; i++) {
+            if ((i < k && values[i] > values[k]) || (i > k && values[i] < values[k])) ordered = 0;
+        }
+        CHECK(ordered);
+    }
+}
+
+int main(void) {
+    test_accuracy();
+    test_merge();
+    test_small_exact();
+    test_select_nth();
+    return test_report("quantile");
+}
@@ -0,0 +1,99 @@
+// gcc -std=gnu11 -Iinclude tests/test_rate_limiter.c src/rate_limiter.c -lcrypto -lpthread -o test_rate_limiter
+#include "test.h"
+#include "rate_limiter.h"
+#include <string.h>
+
+static long long test_now_ms = 1000;
+
+static long long test_clock(void) {
+    return test_now_ms;
+}
+
+static RateLimiter* test_limiter(int buckets, double capacity, double refill_per_second) {
+    RateLimiter* limiter = rate_limiter_create(buckets, capacity, refill_per_second);
+    if (limiter != NULL) {
+        limiter->clock = test_clock;
+    }
+    return limiter;
+}
+
+static void test_bucket(void) {
+    RateLimiter* limiter = test_limiter(64, 5, 1.0 / 12.0);
+    REQUIRE(limiter != NULL);
+    for (int i = 0; i < 5; i++) {
+        CHECK(rate_limiter_allow(limiter, "alice"));
+    }
+    CHECK(!rate_limiter_allow(limiter, "alice"));
+    // Other keys are not affected
+    CHECK(rate_limiter_allow(limiter, "bob"));
+
+    // One token back about 12 s later (rates are kept in thousandths)
+    test_now_ms += 11000;
+    CHECK(!rate_limiter_allow(limiter, "alice"));
+    test_now_ms += 1100;
+    CHECK(rate_limiter_allow(limiter, "alice"));
+    CHECK(!rate_limiter_allow(limiter, "alice"));
+
+    // Refill stops at capacity
+    test_now_ms += 3600 * 1000;
+    CHECK(rate_limiter_available(limiter, "alice") == 5.0);
+
+    rate_limiter_allow(limiter, "alice");
+    rate_limiter_reset(limiter, "alice");
+    CHECK(rate_limiter_available(limiter, "alice") == 5.0);
+    CHECK(limiter->refused == 3);
+    rate_limiter_destroy(limiter);
+}
+
+// A flood of keys that keeps every bucket refilling must not throttle a
+// key that shows up afterwards
+static void test_flood(void) {
+    RateLimiter* limiter = test_limiter(64, 5, 1.0 / 12.0);
+    REQUIRE(limiter != NULL);
+    char key[32];
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 10000; i++) {
+            snprintf(key, sizeof(key), "flood%d", i);
+            rate_limiter_allow(limiter, key);
+        }
+        test_now_ms += 10;
+    }
+    CHECK(limiter->evictions > 0);
+    int allowed = 0;
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "user%d", i);
+        allowed += rate_limiter_allow(limiter, key);
+    }
+    CHECK(allowed == 20);
+    rate_limiter_destroy(limiter);
+}
+
+// With room in the table a throttled key stays throttled however many
+// keys come and go
+static void test_eviction_order(void) {
+    RateLimiter* limiter = test_limiter(4096, 2, 1.0);
+    REQUIRE(limiter != NULL);
+    CHECK(rate_limiter_allow(limiter, "victim"));
+    CHECK(rate_limiter_allow(limiter, "victim"));
+    char key[32];
+    for (int i = 0; i < 100000; i++) {
+        snprintf(key, sizeof(key), "idle%d", i);
+        rate_limiter_available(limiter, key);
+    }
+    CHECK(!rate_limiter_allow(limiter, "victim"));
+    rate_limiter_destroy(limiter);
+}
+
+static void test_invalid(void) {
+    CHECK(rate_limiter_create(0, 5, 1) == NULL);
+    CHECK(rate_limiter_create(16, 0.5, 1) == NULL);
+    CHECK(!rate_limiter_allow(NULL, "x"));
+}
+
+int main(void) {
+    test_bucket();
+    test_flood();
+    test_eviction_order();
+    test_invalid();
+    return test_report("rate_limiter");
+}
@@ -0,0 +1,134 @@
+// gcc -std=gnu11 -Iinclude tests/test_segment_cache.c src/file_manager.c src/segment_cache.c src/crypto_stream.c
+//     src/crypto.c src/utils.c src/calendar.c -lcrypto -lpthread -lm -o test_segment_cache
+#include "test.h"
+#include "file_manager.h"
+#include "segment_cache.h"
+#include "crypto.h"
+#include <openssl/rand.h>
+#include <string.h>
+#include <unistd.h>
+
+static char test_dir[64];
+
+// Plaintext spanning a few segments, each byte depending on its offset
+static char* make_content(size_t size) {
+    char* content = (char*)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        content[i] = (char)('a' + (i * 7 + i / 1000) % 26);
+    }
+    return content;
+}
+
+static void test_range_reads(void) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/records.enc", test_dir);
+    unsigned char key[AES_KEY_SIZE];
+    REQUIRE(RAND_bytes(key, sizeof(key)) == 1);
+    size_t size = 3 * CRYPTO_STREAM_DEFAULT_SEGMENT + 1234;
+    char* content = make_content(size);
+    REQUIRE(write_encrypted_file(path, content, size, key) == FILE_SUCCESS);
+
+    SegmentCache* cache = file_manager_segment_cache();
+    REQUIRE(cache != NULL);
+    long long misses = cache->misses;
+    long long hits = cache->hits;
+    char buffer[300];
+    size_t got = 0;
+    // A read across a segment boundary decrypts both segments once
+    long long offset = CRYPTO_STREAM_DEFAULT_SEGMENT - 100;
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), offset, &got, key) == FILE_SUCCESS);
+    CHECK(got == sizeof(buffer) && memcmp(buffer, content + offset, got) == 0);
+    CHECK(cache->misses == misses + 2 && cache->hits == hits);
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), offset, &got, key) == FILE_SUCCESS);
+    CHECK(got == sizeof(buffer) && memcmp(buffer, content + offset, got) == 0);
+    CHECK(cache->misses == misses + 2 && cache->hits == hits + 2);
+
+    // Short at the end of the file, empty past it
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), (long long)size - 10, &got, key) == FILE_SUCCESS);
+    CHECK(got == 10 && memcmp(buffer, content + size - 10, 10) == 0);
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), (long long)size + 5, &got, key) == FILE_SUCCESS);
+    CHECK(got == 0);
+
+    // A rewrite is a new generation: the old plaintext is never served
+    for (size_t i = 0; i < size; i++) {
+        content[i] = (char)(content[i] ^ 0x20);
+    }
+    REQUIRE(write_encrypted_file(path, content, size, key) == FILE_SUCCESS);
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), offset, &got, key) == FILE_SUCCESS);
+    CHECK(got == sizeof(buffer) && memcmp(buffer, content + offset, got) == 0);
+
+    segment_cache_invalidate(cache, path);
+    remove(path);
+    free(content);
+    secure_memory_clear(key, sizeof(key));
+}
+
+// Loading a whole file again is served from the cache
+static void test_whole_reads(void) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/students.enc", test_dir);
+    unsigned char key[AES_KEY_SIZE];
+    REQUIRE(RAND_bytes(key, sizeof(key)) == 1);
+    size_t size = 2 * CRYPTO_STREAM_DEFAULT_SEGMENT + 10;
+    char* content = make_content(size);
+    REQUIRE(write_encrypted_file(path, content, size, key) == FILE_SUCCESS);
+
+    SegmentCache* cache = file_manager_segment_cache();
+    REQUIRE(cache != NULL);
+    long long misses = cache->misses;
+    long long hits = cache->hits;
+    for (int i = 0; i < 2; i++) {
+        char* loaded = NULL;
+        size_t loaded_size = 0;
+        CHECK(read_encrypted_file(path, &loaded, &loaded_size, key) == FILE_SUCCESS);
+        CHECK(loaded_size == size && loaded != NULL && memcmp(loaded, content, size) == 0);
+        free(loaded);
+    }
+    CHECK(cache->misses == misses + 3 && cache->hits == hits + 3);
+
+    segment_cache_invalidate(cache, path);
+    remove(path);
+    free(content);
+    secure_memory_clear(key, sizeof(key));
+}
+
+// A range read with the wrong key must fail the same way whether or not
+// the right key has warmed the cache
+static void test_range_keys(void) {
+    static const char secret[] = "range check: not for other keys";
+    unsigned char key[AES_KEY_SIZE];
+    unsigned char wrong_key[AES_KEY_SIZE];
+    char path[128];
+    char buffer[sizeof(secret)];
+    size_t got = 0;
+    REQUIRE(RAND_bytes(key, sizeof(key)) == 1);
+    memcpy(wrong_key, key, sizeof(wrong_key));
+    wrong_key[0] ^= 1;
+    snprintf(path, sizeof(path), "%s/range_key_check.enc", test_dir);
+    REQUIRE(write_encrypted_file(path, secret, sizeof(secret), key) == FILE_SUCCESS);
+
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), 0, &got, wrong_key) != FILE_SUCCESS);
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), 0, &got, key) == FILE_SUCCESS);
+    CHECK(got == sizeof(secret) && memcmp(buffer, secret, sizeof(secret)) == 0);
+    memset(buffer, 0, sizeof(buffer));
+    CHECK(read_encrypted_file_range(path, buffer, sizeof(buffer), 0, &got, wrong_key) != FILE_SUCCESS);
+    CHECK(memcmp(buffer, secret, sizeof(secret)) != 0);
+
+    segment_cache_invalidate(file_manager_segment_cache(), path);
+    remove(path);
+    secure_memory_clear(key, sizeof(key));
+    secure_memory_clear(wrong_key, sizeof(wrong_key));
+}
+
+int main(void) {
+    snprintf(test_dir, sizeof(test_dir), "/tmp/test_segment_cache_XXXXXX");
+    if (mkdtemp(test_dir) == NULL) {
+        printf("FAIL: no scratch directory\n");
+        return 1;
+    }
+    test_range_reads();
+    test_whole_reads();
+    test_range_keys();
+    rmdir(test_dir);
+    return test_report("segment_cache");
+}
@@ -0,0 +1,111 @@
+// gcc -std=gnu11 -Iinclude tests/test_topk.c src/topk.c -lpthread -o test_topk
+#include "test.h"
+#include "topk.h"
+
+typedef struct {
+    int id;
+    float gpa;
+    int active;
+} TestStudent;
+
+typedef struct {
+    int id;
+    float gpa;
+} TestRanked;
+
+// Higher GPA first, then lower id
+static int compare_ranked(const void* a, const void* b) {
+    const TestRanked* x = (const TestRanked*)a;
+    const TestRanked* y = (const TestRanked*)b;
+    if (x->gpa != y->gpa) return x->gpa > y->gpa ? 1 : -1;
+    return x->id < y->id ? 1 : (x->id > y->id ? -1 : 0);
+}
+
+static int project_active(const void* element, void* item, void* user_data) {
+    (void)user_data;
+    const TestStudent* student = (const TestStudent*)element;
+    if (!student->active) {
+        return 0;
+    }
+    TestRanked* ranked = (TestRanked*)item;
+    ranked->id = student->id;
+    ranked->gpa = student->gpa;
+    return 1;
+}
+
+static int compare_for_sort(const void* a, const void* b) {
+    return compare_ranked(b, a);
+}
+
+// The selection matches the head of a full sort, ties included, on one
+// thread and on several
+static void test_select_matches_sort(void) {
+    const int count = TOPK_PARALLEL_THRESHOLD + 777;
+    const int k = 50;
+    TestStudent* students = (TestStudent*)malloc(sizeof(TestStudent) * count);
+    TestRanked* sorted = (TestRanked*)malloc(sizeof(TestRanked) * count);
+    REQUIRE(students != NULL && sorted != NULL);
+    int active = 0;
+    unsigned int state = 99;
+    for (int i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        students[i].id = i;
+        students[i].gpa = (float)((state >> 8) % 401) / 100.0f;     // Many ties
+        students[i].active = (state >> 4) % 5 != 0;
+        if (students[i].active) {
+            sorted[active].id = i;
+            sorted[active].gpa = students[i].gpa;
+            active++;
+        }
+    }
+    qsort(sorted, active, sizeof(TestRanked), compare_for_sort);
+
+    for (int threads = 1; threads <= 4; threads += 3) {
+        TestRanked best[50];
+        int got = topk_select(students, count, sizeof(TestStudent), project_active, NULL, k,
+                              sizeof(TestRanked), compare_ranked, best, threads);
+        CHECK(got == k);
+        int same = 1;
+        for (int i = 0; i < got; i++) {
+            same = same && best[i].id == sorted[i].id && best[i].gpa == sorted[i].gpa;
+        }
+        CHECK(same);
+    }
+    free(students);
+    free(sorted);
+}
+
+// A heap keeps the k best, its root is the worst kept, and merging two
+// heaps keeps the best of both
+static void test_heap(void) {
+    TopK* a = topk_create(3, sizeof(TestRanked), compare_ranked);
+    TopK* b = topk_create(3, sizeof(TestRanked), compare_ranked);
+    REQUIRE(a != NULL && b != NULL);
+    const float gpas[] = { 2.0f, 3.9f, 1.0f, 3.1f, 3.5f };
+    for (int i = 0; i < 5; i++) {
+        TestRanked item = { i, gpas[i] };
+        topk_offer(i % 2 == 0 ? a : b, &item);
+    }
+    CHECK(topk_count(a) == 3 && topk_count(b) == 2);
+    CHECK(((const TestRanked*)topk_worst(a))->gpa == 1.0f);
+
+    CHECK(topk_merge(a, b));
+    CHECK(topk_count(a) == 3);
+    TestRanked out[3];
+    CHECK(topk_finish(a, out) == 3);
+    CHECK(out[0].id == 1 && out[1].id == 4 && out[2].id == 3);
+    CHECK(topk_count(a) == 0);
+
+    // Fewer inputs than k
+    TestRanked only = { 7, 2.5f };
+    topk_offer(a, &only);
+    CHECK(topk_finish(a, out) == 1 && out[0].id == 7);
+    topk_destroy(a);
+    topk_destroy(b);
+}
+
+int main(void) {
+    test_select_matches_sort();
+    test_heap();
+    return test_report("topk");
+}